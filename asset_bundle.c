@@ -0,0 +1,211 @@
+#include "asset_bundle.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct _AssetBundle
+{
+    const uint8_t* data;
+    size_t size;
+    const AssetBundleHeader* header;
+    const AssetEntry* entries;
+};
+
+
+static bool entryValid(const AssetBundle* bundle, const AssetEntry* entry);
+static const AssetEntry* findEntry(AssetBundle* bundle, const char* name, AssetType type);
+
+
+AssetBundleError assetBundleOpen(const char* fileName, AssetBundle** bundle)
+{
+    AssetBundle* newBundle = NULL;
+    struct stat fileStatus;
+    void* data = MAP_FAILED;
+    int32_t fileDescriptor = -1;
+    uint32_t i = 0;
+
+    if (fileName == NULL || bundle == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return AB_ERROR;
+    }
+
+    fileDescriptor = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor < 0 || fstat(fileDescriptor, &fileStatus) < 0 || (size_t)fileStatus.st_size < sizeof(AssetBundleHeader))
+    {
+        printf("\n%s : ERROR cannot open %s\n", __FUNCTION__, fileName);
+        if (fileDescriptor >= 0)
+        {
+            close(fileDescriptor);
+        }
+        return AB_ERROR;
+    }
+
+    /* mapping keeps the file, descriptor is not needed any more */
+    data = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (data == MAP_FAILED)
+    {
+        printf("\n%s : ERROR cannot map %s (%s)\n", __FUNCTION__, fileName, strerror(errno));
+        return AB_ERROR;
+    }
+
+    /* start reading ahead now, first OSD should not wait for page faults */
+    madvise(data, (size_t)fileStatus.st_size, MADV_WILLNEED);
+
+    newBundle = (AssetBundle*)malloc(sizeof(AssetBundle));
+    if (newBundle == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        munmap(data, (size_t)fileStatus.st_size);
+        return AB_ERROR;
+    }
+    newBundle->data = (const uint8_t*)data;
+    newBundle->size = (size_t)fileStatus.st_size;
+    newBundle->header = (const AssetBundleHeader*)data;
+    newBundle->entries = (const AssetEntry*)(newBundle->data + sizeof(AssetBundleHeader));
+
+    if (newBundle->header->magic != ASSET_BUNDLE_MAGIC || newBundle->header->version != ASSET_BUNDLE_VERSION
+        || newBundle->header->fileSize != newBundle->size
+        || newBundle->header->numberOfAssets > (newBundle->size - sizeof(AssetBundleHeader)) / sizeof(AssetEntry))
+    {
+        printf("\n%s : ERROR %s is not an asset bundle of this version\n", __FUNCTION__, fileName);
+        assetBundleClose(newBundle);
+        return AB_ERROR;
+    }
+
+    for (i = 0; i < newBundle->header->numberOfAssets; i++)
+    {
+        if (!entryValid(newBundle, &newBundle->entries[i]))
+        {
+            printf("\n%s : ERROR asset %u of %s is damaged\n", __FUNCTION__, i, fileName);
+            assetBundleClose(newBundle);
+            return AB_ERROR;
+        }
+    }
+
+    *bundle = newBundle;
+
+    return AB_NO_ERROR;
+}
+
+AssetBundleError assetBundleClose(AssetBundle* bundle)
+{
+    if (bundle == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return AB_ERROR;
+    }
+
+    munmap((void*)bundle->data, bundle->size);
+    free(bundle);
+
+    return AB_NO_ERROR;
+}
+
+AssetBundleError assetBundleGetImage(AssetBundle* bundle, const char* name, AssetImage* image)
+{
+    const AssetEntry* entry = NULL;
+
+    if (bundle == NULL || name == NULL || image == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return AB_ERROR;
+    }
+
+    entry = findEntry(bundle, name, ASSET_TYPE_IMAGE);
+    if (entry == NULL)
+    {
+        return AB_ERROR;
+    }
+
+    image->pixels = (const uint32_t*)(bundle->data + entry->dataOffset);
+    image->width = entry->width;
+    image->height = entry->height;
+    image->pitch = entry->pitch / (int32_t)sizeof(uint32_t);
+
+    return AB_NO_ERROR;
+}
+
+AssetBundleError assetBundleGetFont(AssetBundle* bundle, const char* name, AssetFont* font)
+{
+    const AssetEntry* entry = NULL;
+
+    if (bundle == NULL || name == NULL || font == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return AB_ERROR;
+    }
+
+    entry = findEntry(bundle, name, ASSET_TYPE_FONT);
+    if (entry == NULL)
+    {
+        return AB_ERROR;
+    }
+
+    font->strip = bundle->data + entry->dataOffset;
+    font->width = entry->width;
+    font->height = entry->height;
+    font->pitch = entry->pitch;
+    font->ascent = entry->ascent;
+    font->glyphs = (const AssetGlyph*)(bundle->data + entry->glyphOffset);
+
+    return AB_NO_ERROR;
+}
+
+/* Assets are read straight from the mapping, so everything they point to has to be inside the file */
+bool entryValid(const AssetBundle* bundle, const AssetEntry* entry)
+{
+    const AssetGlyph* glyphs = NULL;
+    int32_t bytesPerPixel = (entry->type == ASSET_TYPE_IMAGE) ? sizeof(uint32_t) : 1;
+    uint32_t i = 0;
+
+    if ((entry->type != ASSET_TYPE_IMAGE && entry->type != ASSET_TYPE_FONT)
+        || memchr(entry->name, '\0', ASSET_NAME_LENGTH) == NULL
+        || entry->width <= 0 || entry->height <= 0 || entry->pitch < (int64_t)entry->width * bytesPerPixel
+        || entry->pitch % bytesPerPixel != 0
+        || entry->dataOffset % ASSET_DATA_ALIGNMENT != 0 || entry->dataOffset > bundle->size
+        || entry->dataSize > bundle->size - entry->dataOffset
+        || (uint64_t)entry->pitch * entry->height > entry->dataSize)
+    {
+        return false;
+    }
+
+    if (entry->type == ASSET_TYPE_FONT)
+    {
+        if (entry->glyphOffset % sizeof(int16_t) != 0 || entry->glyphOffset > bundle->size
+            || ASSET_GLYPH_COUNT * sizeof(AssetGlyph) > bundle->size - entry->glyphOffset
+            || entry->ascent < 0 || entry->ascent > entry->height)
+        {
+            return false;
+        }
+
+        glyphs = (const AssetGlyph*)(bundle->data + entry->glyphOffset);
+        for (i = 0; i < ASSET_GLYPH_COUNT; i++)
+        {
+            if (glyphs[i].x < 0 || glyphs[i].width < 0 || glyphs[i].x + glyphs[i].width > entry->width)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+const AssetEntry* findEntry(AssetBundle* bundle, const char* name, AssetType type)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < bundle->header->numberOfAssets; i++)
+    {
+        if (bundle->entries[i].type == (uint32_t)type && strcmp(bundle->entries[i].name, name) == 0)
+        {
+            return &bundle->entries[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,144 @@
+#ifndef __ASSET_BUNDLE_H__
+#define __ASSET_BUNDLE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define ASSET_BUNDLE_MAGIC 0x4244534F               /* "OSDB" */
+#define ASSET_BUNDLE_VERSION 1
+#define ASSET_NAME_LENGTH 32
+#define ASSET_DATA_ALIGNMENT 64                     /* Pixel data of every asset starts at this file offset alignment */
+#define ASSET_GLYPH_FIRST ' '
+#define ASSET_GLYPH_COUNT ('~' - ' ' + 1)           /* Fonts hold printable ASCII */
+
+/**
+ * @brief Enumeration of possible asset bundle error codes
+ */
+typedef enum _AssetBundleError
+{
+    AB_NO_ERROR = 0,
+    AB_ERROR
+}AssetBundleError;
+
+/**
+ * @brief Enumeration of asset types
+ */
+typedef enum _AssetType
+{
+    ASSET_TYPE_IMAGE = 1,                           /* ARGB32 pixels, 0xAARRGGBB in native byte order */
+    ASSET_TYPE_FONT                                 /* A8 strip of glyphs, one row per pixel line of the font */
+}AssetType;
+
+/**
+ * @brief Bundle file header, followed by numberOfAssets entries
+ *
+ * All fields are in byte order of the box, the packer has to run on a machine of the same byte order.
+ */
+typedef struct _AssetBundleHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numberOfAssets;
+    uint32_t fileSize;
+}AssetBundleHeader;
+
+/**
+ * @brief Bundle file entry of one asset
+ */
+typedef struct _AssetEntry
+{
+    char name[ASSET_NAME_LENGTH];                   /* Zero terminated, e.g. "volume_3" or "osd" */
+    uint32_t type;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;                                  /* Bytes between starts of two rows */
+    uint32_t dataOffset;                            /* File offset of first row */
+    uint32_t dataSize;
+    int32_t ascent;                                 /* Font only, rows above baseline */
+    uint32_t glyphOffset;                           /* Font only, file offset of ASSET_GLYPH_COUNT glyphs */
+}AssetEntry;
+
+/**
+ * @brief Bundle file glyph, cell of the strip drawn for one character
+ */
+typedef struct _AssetGlyph
+{
+    int16_t x;                                      /* Left column of the cell in the strip */
+    int16_t width;                                  /* Cell width, cell spans whole strip height */
+    int16_t offsetX;                                /* Cell left edge relative to pen position */
+    int16_t advance;                                /* Pen movement after the character */
+}AssetGlyph;
+
+/**
+ * @brief Image found in bundle, pixels point into the mapped file
+ */
+typedef struct _AssetImage
+{
+    const uint32_t* pixels;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;                                  /* Number of pixels between starts of two rows */
+}AssetImage;
+
+/**
+ * @brief Font found in bundle, strip and glyphs point into the mapped file
+ */
+typedef struct _AssetFont
+{
+    const uint8_t* strip;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;                                  /* Bytes between starts of two rows */
+    int32_t ascent;
+    const AssetGlyph* glyphs;                       /* ASSET_GLYPH_COUNT glyphs starting with ASSET_GLYPH_FIRST */
+}AssetFont;
+
+/**
+ * @brief Asset bundle, file mapped read only
+ */
+typedef struct _AssetBundle AssetBundle;
+
+/**
+ * @brief Maps bundle file and checks that all its entries lie inside the file
+ *
+ * Nothing is decoded or copied, assets are used straight from the page cache, so their pages stay
+ * clean and are shared with every process that maps the same file.
+ *
+ * @param [in] fileName - bundle file
+ * @param [out] bundle - opened bundle
+ * @return asset bundle error code
+ */
+AssetBundleError assetBundleOpen(const char* fileName, AssetBundle** bundle);
+
+/**
+ * @brief Unmaps bundle, no image or font of it may be used afterwards
+ *
+ * @param [in] bundle - bundle to close
+ * @return asset bundle error code
+ */
+AssetBundleError assetBundleClose(AssetBundle* bundle);
+
+/**
+ * @brief Finds image by name
+ *
+ * @param [in] bundle - asset bundle
+ * @param [in] name - image name
+ * @param [out] image - image pixels and size
+ * @return asset bundle error code, AB_ERROR if there is no such image
+ */
+AssetBundleError assetBundleGetImage(AssetBundle* bundle, const char* name, AssetImage* image);
+
+/**
+ * @brief Finds font by name
+ *
+ * @param [in] bundle - asset bundle
+ * @param [in] name - font name
+ * @param [out] font - glyph strip and metrics
+ * @return asset bundle error code, AB_ERROR if there is no such font
+ */
+AssetBundleError assetBundleGetFont(AssetBundle* bundle, const char* name, AssetFont* font);
+
+#endif /* __ASSET_BUNDLE_H__ */
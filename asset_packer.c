@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <png.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "asset_bundle.h"
+
+#define MAX_ASSETS 64
+#define ROW_ALIGNMENT 16                            /* Rows start at vector load alignment */
+#define FONT_NAME "osd"
+#define ALIGN(value, alignment) (((value) + (alignment) - 1) / (alignment) * (alignment))
+
+/**
+ * @brief Structure that holds one asset until bundle is written
+ */
+typedef struct _PackedAsset
+{
+    AssetEntry entry;
+    uint8_t* data;
+    AssetGlyph glyphs[ASSET_GLYPH_COUNT];
+}PackedAsset;
+
+
+static int32_t packImage(const char* fileName, PackedAsset* asset);
+static int32_t packFont(const char* fileName, int32_t height, PackedAsset* asset);
+static int32_t writeBundle(const char* fileName, PackedAsset* assets, uint32_t numberOfAssets);
+static void setAssetName(PackedAsset* asset, const char* fileName);
+
+static PackedAsset assets[MAX_ASSETS];
+
+
+/* Runs at build time, decodes PNG images and rasterizes the font once so the box never has to */
+int main(int argc, char* argv[])
+{
+    uint32_t numberOfAssets = 0;
+    int32_t result = 0;
+    int32_t i = 0;
+
+    if (argc < 4)
+    {
+        printf("Usage: %s <bundle file> <font.ttf> <font height> [image.png ...]\n", argv[0]);
+        return -1;
+    }
+
+    if (argc - 3 > MAX_ASSETS)
+    {
+        printf("\n%s : ERROR at most %d images can be packed\n", __FUNCTION__, MAX_ASSETS - 1);
+        return -1;
+    }
+
+    if (packFont(argv[2], atoi(argv[3]), &assets[numberOfAssets++]))
+    {
+        return -1;
+    }
+
+    for (i = 4; i < argc; i++)
+    {
+        if (packImage(argv[i], &assets[numberOfAssets++]))
+        {
+            return -1;
+        }
+    }
+
+    result = writeBundle(argv[1], assets, numberOfAssets);
+
+    for (i = 0; i < (int32_t)numberOfAssets; i++)
+    {
+        free(assets[i].data);
+    }
+
+    return result;
+}
+
+/* Image is stored as ARGB32, as DirectFB ARGB surfaces and the software framebuffer hold it */
+int32_t packImage(const char* fileName, PackedAsset* asset)
+{
+    png_image image;
+
+    memset(&image, 0x0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, fileName))
+    {
+        printf("\n%s : ERROR cannot read %s (%s)\n", __FUNCTION__, fileName, image.message);
+        return -1;
+    }
+
+    /* B, G, R, A bytes are 0xAARRGGBB words on a little endian box */
+    image.format = PNG_FORMAT_BGRA;
+    setAssetName(asset, fileName);
+    asset->entry.type = ASSET_TYPE_IMAGE;
+    asset->entry.width = (int32_t)image.width;
+    asset->entry.height = (int32_t)image.height;
+    asset->entry.pitch = ALIGN(image.width * sizeof(uint32_t), ROW_ALIGNMENT);
+    asset->entry.dataSize = (uint32_t)asset->entry.pitch * image.height;
+    asset->data = (uint8_t*)calloc(1, asset->entry.dataSize);
+    if (asset->data == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        png_image_free(&image);
+        return -1;
+    }
+
+    if (!png_image_finish_read(&image, NULL, asset->data, asset->entry.pitch, NULL))
+    {
+        printf("\n%s : ERROR cannot decode %s (%s)\n", __FUNCTION__, fileName, image.message);
+        return -1;
+    }
+
+    printf("%-32s image %dx%d\n", asset->entry.name, asset->entry.width, asset->entry.height);
+
+    return 0;
+}
+
+/* Every printable ASCII glyph gets a cell of full line height in one A8 strip */
+int32_t packFont(const char* fileName, int32_t height, PackedAsset* asset)
+{
+    FT_Library library;
+    FT_Face face;
+    FT_GlyphSlot slot = NULL;
+    AssetGlyph* glyph = NULL;
+    int32_t ascent = 0;
+    int32_t descent = 0;
+    int32_t stripWidth = 0;
+    int32_t right = 0;
+    int32_t row = 0;
+    int32_t column = 0;
+    int32_t stripRow = 0;
+    uint32_t i = 0;
+    uint32_t pass = 0;
+
+    if (height <= 0 || FT_Init_FreeType(&library))
+    {
+        printf("\n%s : ERROR font height %d or FreeType init not ok\n", __FUNCTION__, height);
+        return -1;
+    }
+
+    /* DirectFB font height is the FreeType pixel size */
+    if (FT_New_Face(library, fileName, 0, &face) || FT_Set_Pixel_Sizes(face, 0, (FT_UInt)height))
+    {
+        printf("\n%s : ERROR cannot load font %s\n", __FUNCTION__, fileName);
+        FT_Done_FreeType(library);
+        return -1;
+    }
+
+    ascent = (int32_t)(face->size->metrics.ascender >> 6);
+    descent = (int32_t)(-face->size->metrics.descender >> 6);
+
+    strcpy(asset->entry.name, FONT_NAME);
+    asset->entry.type = ASSET_TYPE_FONT;
+    asset->entry.height = ascent + descent;
+    asset->entry.ascent = ascent;
+
+    /* first pass measures cells, second one renders them into the strip */
+    for (pass = 0; pass < 2; pass++)
+    {
+        stripWidth = 0;
+        for (i = 0; i < ASSET_GLYPH_COUNT; i++)
+        {
+            if (FT_Load_Char(face, ASSET_GLYPH_FIRST + i, FT_LOAD_RENDER)
+                || (face->glyph->bitmap.width != 0 && face->glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY))
+            {
+                printf("\n%s : ERROR cannot render character 0x%x\n", __FUNCTION__, ASSET_GLYPH_FIRST + i);
+                FT_Done_Face(face);
+                FT_Done_FreeType(library);
+                return -1;
+            }
+            slot = face->glyph;
+            glyph = &asset->glyphs[i];
+
+            glyph->advance = (int16_t)(slot->advance.x >> 6);
+            glyph->offsetX = (int16_t)((slot->bitmap_left < 0) ? slot->bitmap_left : 0);
+            right = slot->bitmap_left + (int32_t)slot->bitmap.width;
+            glyph->width = (int16_t)(((right > glyph->advance) ? right : glyph->advance) - glyph->offsetX);
+            glyph->x = (int16_t)stripWidth;
+            stripWidth += glyph->width;
+
+            if (pass == 0)
+            {
+                continue;
+            }
+
+            for (row = 0; row < (int32_t)slot->bitmap.rows; row++)
+            {
+                stripRow = ascent - slot->bitmap_top + row;
+                if (stripRow < 0 || stripRow >= asset->entry.height)
+                {
+                    continue;
+                }
+                for (column = 0; column < (int32_t)slot->bitmap.width; column++)
+                {
+                    asset->data[stripRow * asset->entry.pitch + glyph->x + slot->bitmap_left - glyph->offsetX + column] =
+                        slot->bitmap.buffer[row * slot->bitmap.pitch + column];
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            asset->entry.width = stripWidth;
+            asset->entry.pitch = ALIGN(stripWidth, ROW_ALIGNMENT);
+            asset->entry.dataSize = (uint32_t)asset->entry.pitch * asset->entry.height;
+            asset->data = (uint8_t*)calloc(1, asset->entry.dataSize);
+            if (asset->data == NULL)
+            {
+                printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+                FT_Done_Face(face);
+                FT_Done_FreeType(library);
+                return -1;
+            }
+        }
+    }
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+
+    printf("%-32s font %d px, strip %dx%d\n", asset->entry.name, height, asset->entry.width, asset->entry.height);
+
+    return 0;
+}
+
+int32_t writeBundle(const char* fileName, PackedAsset* assets, uint32_t numberOfAssets)
+{
+    static const uint8_t padding[ASSET_DATA_ALIGNMENT] = {0};
+    AssetBundleHeader header;
+    FILE* outputFile = NULL;
+    uint32_t offset = 0;
+    uint32_t i = 0;
+
+    /* lay out data behind header and entries, glyph tables behind their strips */
+    offset = sizeof(AssetBundleHeader) + numberOfAssets * sizeof(AssetEntry);
+    for (i = 0; i < numberOfAssets; i++)
+    {
+        offset = ALIGN(offset, ASSET_DATA_ALIGNMENT);
+        assets[i].entry.dataOffset = offset;
+        offset += assets[i].entry.dataSize;
+        if (assets[i].entry.type == ASSET_TYPE_FONT)
+        {
+            offset = ALIGN(offset, sizeof(uint32_t));
+            assets[i].entry.glyphOffset = offset;
+            offset += sizeof(assets[i].glyphs);
+        }
+    }
+
+    header.magic = ASSET_BUNDLE_MAGIC;
+    header.version = ASSET_BUNDLE_VERSION;
+    header.numberOfAssets = numberOfAssets;
+    header.fileSize = offset;
+
+    outputFile = fopen(fileName, "wb");
+    if (outputFile == NULL)
+    {
+        printf("\n%s : ERROR cannot create %s (%s)\n", __FUNCTION__, fileName, strerror(errno));
+        return -1;
+    }
+
+    fwrite(&header, sizeof(header), 1, outputFile);
+    for (i = 0; i < numberOfAssets; i++)
+    {
+        fwrite(&assets[i].entry, sizeof(AssetEntry), 1, outputFile);
+    }
+
+    offset = sizeof(AssetBundleHeader) + numberOfAssets * sizeof(AssetEntry);
+    for (i = 0; i < numberOfAssets; i++)
+    {
+        fwrite(padding, 1, assets[i].entry.dataOffset - offset, outputFile);
+        fwrite(assets[i].data, 1, assets[i].entry.dataSize, outputFile);
+        offset = assets[i].entry.dataOffset + assets[i].entry.dataSize;
+        if (assets[i].entry.type == ASSET_TYPE_FONT)
+        {
+            fwrite(padding, 1, assets[i].entry.glyphOffset - offset, outputFile);
+            fwrite(assets[i].glyphs, sizeof(assets[i].glyphs), 1, outputFile);
+            offset = assets[i].entry.glyphOffset + sizeof(assets[i].glyphs);
+        }
+    }
+
+    if (ferror(outputFile) || fclose(outputFile))
+    {
+        printf("\n%s : ERROR cannot write %s\n", __FUNCTION__, fileName);
+        return -1;
+    }
+
+    printf("%s: %u assets, %u bytes\n", fileName, numberOfAssets, header.fileSize);
+
+    return 0;
+}
+
+/* Asset is named after its file, without directory and extension */
+void setAssetName(PackedAsset* asset, const char* fileName)
+{
+    const char* baseName = strrchr(fileName, '/');
+    const char* extension = NULL;
+    size_t length = 0;
+
+    baseName = (baseName != NULL) ? baseName + 1 : fileName;
+    extension = strrchr(baseName, '.');
+    length = (extension != NULL) ? (size_t)(extension - baseName) : strlen(baseName);
+    if (length >= ASSET_NAME_LENGTH)
+    {
+        length = ASSET_NAME_LENGTH - 1;
+    }
+
+    memset(asset->entry.name, 0x0, ASSET_NAME_LENGTH);
+    memcpy(asset->entry.name, baseName, length);
+}
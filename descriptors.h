@@ -0,0 +1,216 @@
+#ifndef __DESCRIPTORS_H__
+#define __DESCRIPTORS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tables.h"
+
+#define DESCRIPTOR_TAG_ISO_639_LANGUAGE     0x0A
+#define DESCRIPTOR_TAG_STREAM_IDENTIFIER    0x52
+#define DESCRIPTOR_TAG_TELETEXT             0x56
+#define DESCRIPTOR_TAG_LOCAL_TIME_OFFSET    0x58
+#define DESCRIPTOR_TAG_SUBTITLING           0x59
+
+/**
+ * @brief Structure that defines raw descriptor, data points into the section it was found in
+ */
+typedef struct _Descriptor
+{
+    uint8_t tag;
+    uint8_t length;
+    const uint8_t* data;                            /* First byte after descriptor length */
+}Descriptor;
+
+/**
+ * @brief Structure that holds position of the iteration over one descriptor loop
+ */
+typedef struct _DescriptorIterator
+{
+    const uint8_t* position;
+    const uint8_t* end;
+}DescriptorIterator;
+
+/**
+ * @brief Structure that defines ISO 639 language descriptor
+ */
+typedef struct _ISO639LanguageDescriptor
+{
+    uint8_t numberOfEntries;
+    const uint8_t* entries;                         /* 4 bytes per entry */
+}ISO639LanguageDescriptor;
+
+/**
+ * @brief Structure that defines single ISO 639 language descriptor entry
+ */
+typedef struct _ISO639LanguageEntry
+{
+    char language[4];
+    uint8_t audioType;
+}ISO639LanguageEntry;
+
+/**
+ * @brief Structure that defines teletext descriptor
+ */
+typedef struct _TeletextDescriptor
+{
+    uint8_t numberOfEntries;
+    const uint8_t* entries;                         /* 5 bytes per entry */
+}TeletextDescriptor;
+
+/**
+ * @brief Structure that defines single teletext descriptor entry
+ */
+typedef struct _TeletextEntry
+{
+    char language[4];
+    uint8_t teletextType;
+    uint8_t magazineNumber;
+    uint8_t pageNumber;
+}TeletextEntry;
+
+/**
+ * @brief Structure that defines subtitling descriptor
+ */
+typedef struct _SubtitlingDescriptor
+{
+    uint8_t numberOfEntries;
+    const uint8_t* entries;                         /* 8 bytes per entry */
+}SubtitlingDescriptor;
+
+/**
+ * @brief Structure that defines single subtitling descriptor entry
+ */
+typedef struct _SubtitlingEntry
+{
+    char language[4];
+    uint8_t subtitlingType;
+    uint16_t compositionPageId;
+    uint16_t ancillaryPageId;
+}SubtitlingEntry;
+
+/**
+ * @brief Structure that defines stream identifier descriptor
+ */
+typedef struct _StreamIdentifierDescriptor
+{
+    uint8_t componentTag;
+}StreamIdentifierDescriptor;
+
+/**
+ * @brief Structure that defines local time offset descriptor view
+ */
+typedef struct _LocalTimeOffsetView
+{
+    uint8_t numberOfEntries;
+    const uint8_t* entries;                         /* 13 bytes per entry */
+}LocalTimeOffsetView;
+
+/**
+ * @brief Structure that holds descriptor decoded by the registered decoder of its tag
+ */
+typedef struct _TypedDescriptor
+{
+    uint8_t tag;
+    union
+    {
+        ISO639LanguageDescriptor language;
+        TeletextDescriptor teletext;
+        SubtitlingDescriptor subtitling;
+        StreamIdentifierDescriptor streamIdentifier;
+        LocalTimeOffsetView localTimeOffset;
+    } value;
+}TypedDescriptor;
+
+/**
+ * @brief Descriptor decoder, fills typed descriptor from raw descriptor
+ */
+typedef ParseErrorCode(*DescriptorDecoder)(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+
+/**
+ * @brief Starts iteration over a descriptor loop
+ *
+ * @param [out] iterator - iterator to be initialized
+ * @param [in]  loopBuffer - buffer that contains first descriptor of the loop
+ * @param [in]  loopLength - length of the whole descriptor loop
+ */
+void descriptorIteratorInit(DescriptorIterator* iterator, const uint8_t* loopBuffer, uint16_t loopLength);
+
+/**
+ * @brief Moves to the next descriptor of the loop
+ *
+ * @param [in,out] iterator - iterator over descriptor loop
+ * @param [out]    descriptor - next descriptor, valid while the section buffer is valid
+ * @return true if descriptor is returned, false at end of loop or on truncated descriptor
+ */
+bool descriptorIteratorNext(DescriptorIterator* iterator, Descriptor* descriptor);
+
+/**
+ * @brief Finds first descriptor with given tag in a descriptor loop
+ *
+ * @param [in]  loopBuffer - buffer that contains first descriptor of the loop
+ * @param [in]  loopLength - length of the whole descriptor loop
+ * @param [in]  tag - descriptor tag to look for
+ * @param [out] descriptor - found descriptor
+ * @return true if descriptor is found
+ */
+bool descriptorFind(const uint8_t* loopBuffer, uint16_t loopLength, uint8_t tag, Descriptor* descriptor);
+
+/**
+ * @brief Registers decoder for descriptor tag, replaces built in decoder if one exists
+ *
+ * @param [in] tag - descriptor tag
+ * @param [in] decoder - decoder function, NULL removes decoder
+ */
+void registerDescriptorDecoder(uint8_t tag, DescriptorDecoder decoder);
+
+/**
+ * @brief Decodes descriptor with decoder registered for its tag
+ *
+ * @param [in]  descriptor - raw descriptor
+ * @param [out] typedDescriptor - decoded descriptor
+ * @return tables error code, error if no decoder is registered for the tag
+ */
+ParseErrorCode decodeDescriptor(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+
+/**
+ * @brief Decodes single entry of ISO 639 language descriptor
+ *
+ * @param [in]  languageDescriptor - decoded descriptor
+ * @param [in]  index - entry index
+ * @param [out] entry - decoded entry
+ * @return tables error code
+ */
+ParseErrorCode getISO639LanguageEntry(const ISO639LanguageDescriptor* languageDescriptor, uint8_t index, ISO639LanguageEntry* entry);
+
+/**
+ * @brief Decodes single entry of teletext descriptor
+ *
+ * @param [in]  teletextDescriptor - decoded descriptor
+ * @param [in]  index - entry index
+ * @param [out] entry - decoded entry
+ * @return tables error code
+ */
+ParseErrorCode getTeletextEntry(const TeletextDescriptor* teletextDescriptor, uint8_t index, TeletextEntry* entry);
+
+/**
+ * @brief Decodes single entry of subtitling descriptor
+ *
+ * @param [in]  subtitlingDescriptor - decoded descriptor
+ * @param [in]  index - entry index
+ * @param [out] entry - decoded entry
+ * @return tables error code
+ */
+ParseErrorCode getSubtitlingEntry(const SubtitlingDescriptor* subtitlingDescriptor, uint8_t index, SubtitlingEntry* entry);
+
+/**
+ * @brief Decodes single entry of local time offset descriptor
+ *
+ * @param [in]  localTimeOffset - decoded descriptor
+ * @param [in]  index - entry index
+ * @param [out] entry - decoded entry
+ * @return tables error code
+ */
+ParseErrorCode getLocalTimeOffsetEntry(const LocalTimeOffsetView* localTimeOffset, uint8_t index, LTODescriptorInfo* entry);
+
+#endif /* __DESCRIPTORS_H__ */
@@ -0,0 +1,206 @@
+#include "descriptors.h"
+#include "tables_fields.h"
+
+TABLES_DEFINE_EXTRACTOR(extractISO639LanguageEntry, ISO639LanguageEntry, ISO_639_LANGUAGE_ENTRY_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractTeletextEntry, TeletextEntry, TELETEXT_ENTRY_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractSubtitlingEntry, SubtitlingEntry, SUBTITLING_ENTRY_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractLtoInfo, LTODescriptorInfo, LTO_INFO_FIELDS)
+
+static ParseErrorCode decodeISO639Language(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+static ParseErrorCode decodeTeletext(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+static ParseErrorCode decodeSubtitling(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+static ParseErrorCode decodeStreamIdentifier(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+static ParseErrorCode decodeLocalTimeOffset(const Descriptor* descriptor, TypedDescriptor* typedDescriptor);
+
+/* decoders indexed by descriptor tag */
+static DescriptorDecoder decoders[256] =
+{
+    [DESCRIPTOR_TAG_ISO_639_LANGUAGE] = decodeISO639Language,
+    [DESCRIPTOR_TAG_STREAM_IDENTIFIER] = decodeStreamIdentifier,
+    [DESCRIPTOR_TAG_TELETEXT] = decodeTeletext,
+    [DESCRIPTOR_TAG_LOCAL_TIME_OFFSET] = decodeLocalTimeOffset,
+    [DESCRIPTOR_TAG_SUBTITLING] = decodeSubtitling
+};
+
+
+void descriptorIteratorInit(DescriptorIterator* iterator, const uint8_t* loopBuffer, uint16_t loopLength)
+{
+    iterator->position = loopBuffer;
+    iterator->end = loopBuffer + loopLength;
+}
+
+bool descriptorIteratorNext(DescriptorIterator* iterator, Descriptor* descriptor)
+{
+    const uint8_t* position = iterator->position;
+
+    if (position + DESCRIPTOR_HEADER_SIZE > iterator->end)
+    {
+        return false;
+    }
+
+    descriptor->tag = *position;
+    descriptor->length = *(position + 1);
+    descriptor->data = position + DESCRIPTOR_HEADER_SIZE;
+
+    /* descriptor runs past end of the loop, stop iterating */
+    if (descriptor->data + descriptor->length > iterator->end)
+    {
+        iterator->position = iterator->end;
+        return false;
+    }
+
+    iterator->position = descriptor->data + descriptor->length;
+
+    return true;
+}
+
+bool descriptorFind(const uint8_t* loopBuffer, uint16_t loopLength, uint8_t tag, Descriptor* descriptor)
+{
+    DescriptorIterator iterator;
+
+    if (loopBuffer == NULL)
+    {
+        return false;
+    }
+
+    descriptorIteratorInit(&iterator, loopBuffer, loopLength);
+    while (descriptorIteratorNext(&iterator, descriptor))
+    {
+        if (descriptor->tag == tag)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void registerDescriptorDecoder(uint8_t tag, DescriptorDecoder decoder)
+{
+    decoders[tag] = decoder;
+}
+
+ParseErrorCode decodeDescriptor(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    if (descriptor == NULL || typedDescriptor == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
+
+    if (decoders[descriptor->tag] == NULL)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    typedDescriptor->tag = descriptor->tag;
+
+    return decoders[descriptor->tag](descriptor, typedDescriptor);
+}
+
+ParseErrorCode getISO639LanguageEntry(const ISO639LanguageDescriptor* languageDescriptor, uint8_t index, ISO639LanguageEntry* entry)
+{
+    const uint8_t* entryBuffer = NULL;
+
+    if (languageDescriptor == NULL || entry == NULL || index >= languageDescriptor->numberOfEntries)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    entryBuffer = languageDescriptor->entries + index*ISO_639_LANGUAGE_ENTRY_SIZE;
+    memcpy(entry->language, entryBuffer, LANGUAGE_CODE_SIZE);
+    entry->language[LANGUAGE_CODE_SIZE] = '\0';
+    extractISO639LanguageEntry(entryBuffer, entry);
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode getTeletextEntry(const TeletextDescriptor* teletextDescriptor, uint8_t index, TeletextEntry* entry)
+{
+    const uint8_t* entryBuffer = NULL;
+
+    if (teletextDescriptor == NULL || entry == NULL || index >= teletextDescriptor->numberOfEntries)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    entryBuffer = teletextDescriptor->entries + index*TELETEXT_ENTRY_SIZE;
+    memcpy(entry->language, entryBuffer, LANGUAGE_CODE_SIZE);
+    entry->language[LANGUAGE_CODE_SIZE] = '\0';
+    extractTeletextEntry(entryBuffer, entry);
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode getSubtitlingEntry(const SubtitlingDescriptor* subtitlingDescriptor, uint8_t index, SubtitlingEntry* entry)
+{
+    const uint8_t* entryBuffer = NULL;
+
+    if (subtitlingDescriptor == NULL || entry == NULL || index >= subtitlingDescriptor->numberOfEntries)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    entryBuffer = subtitlingDescriptor->entries + index*SUBTITLING_ENTRY_SIZE;
+    memcpy(entry->language, entryBuffer, LANGUAGE_CODE_SIZE);
+    entry->language[LANGUAGE_CODE_SIZE] = '\0';
+    extractSubtitlingEntry(entryBuffer, entry);
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode getLocalTimeOffsetEntry(const LocalTimeOffsetView* localTimeOffset, uint8_t index, LTODescriptorInfo* entry)
+{
+    if (localTimeOffset == NULL || entry == NULL || index >= localTimeOffset->numberOfEntries)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    extractLtoInfo(localTimeOffset->entries + index*LTO_INFO_SIZE, entry);
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode decodeISO639Language(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    typedDescriptor->value.language.numberOfEntries = descriptor->length / ISO_639_LANGUAGE_ENTRY_SIZE;
+    typedDescriptor->value.language.entries = descriptor->data;
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode decodeTeletext(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    typedDescriptor->value.teletext.numberOfEntries = descriptor->length / TELETEXT_ENTRY_SIZE;
+    typedDescriptor->value.teletext.entries = descriptor->data;
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode decodeSubtitling(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    typedDescriptor->value.subtitling.numberOfEntries = descriptor->length / SUBTITLING_ENTRY_SIZE;
+    typedDescriptor->value.subtitling.entries = descriptor->data;
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode decodeStreamIdentifier(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    if (descriptor->length < 1)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    typedDescriptor->value.streamIdentifier.componentTag = *(descriptor->data);
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode decodeLocalTimeOffset(const Descriptor* descriptor, TypedDescriptor* typedDescriptor)
+{
+    typedDescriptor->value.localTimeOffset.numberOfEntries = descriptor->length / LTO_INFO_SIZE;
+    typedDescriptor->value.localTimeOffset.entries = descriptor->data;
+
+    return TABLES_PARSE_OK;
+}
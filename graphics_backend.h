@@ -0,0 +1,64 @@
+#ifndef __GRAPHICS_BACKEND_H__
+#define __GRAPHICS_BACKEND_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "graphics_controller.h"
+#include "asset_bundle.h"
+
+/**
+ * @brief Image loaded by a backend, contents are known only to the backend that loaded it
+ */
+typedef void* GraphicsImage;
+
+/**
+ * @brief Structure that defines drawing operations of one graphics backend
+ *
+ * Graphics controller draws only through these operations, all of them are called from the render thread
+ * except init, deinit and the loading ones. loadImage may run on several executor workers at once.
+ */
+typedef struct _GraphicsBackend
+{
+    const char* name;                                   /* Name used to select backend in config file */
+    bool needsRenderThread;                             /* false if nothing is ever shown, render thread is not started */
+
+    GraphicsControllerError (*init)(int32_t* screenWidth, int32_t* screenHeight);
+    void (*deinit)();
+    GraphicsControllerError (*loadFont)(const char* fileName, int32_t height);      /* TrueType font, when bundle has none */
+    GraphicsControllerError (*useBundleFont)(const AssetFont* font);                /* Glyphs are drawn from the mapped strip */
+    void (*setColor)(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+    void (*fillRectangle)(int32_t x, int32_t y, int32_t width, int32_t height);
+    void (*drawString)(const char* text, int32_t x, int32_t y);
+    GraphicsControllerError (*loadImage)(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height);
+    GraphicsControllerError (*wrapImage)(const AssetImage* asset, GraphicsImage* image);  /* Pixels are used in place */
+    void (*releaseImage)(GraphicsImage image);
+    void (*blit)(GraphicsImage image, int32_t x, int32_t y, bool blend);          /* Source over if blend, plain copy otherwise */
+    void (*flip)();
+}GraphicsBackend;
+
+#ifdef GRAPHICS_DIRECTFB
+/**
+ * @brief Returns backend drawing through DirectFB on the primary layer, built only with GRAPHICS_DIRECTFB
+ *
+ * @return DirectFB backend
+ */
+const GraphicsBackend* getDirectFBBackend();
+#endif
+
+/**
+ * @brief Returns backend that draws nothing, for boxes without display
+ *
+ * @return headless backend
+ */
+const GraphicsBackend* getHeadlessBackend();
+
+/**
+ * @brief Returns backend rasterizing into an in-memory ARGB framebuffer, frames can be dumped as PPM
+ *
+ * @return software backend
+ */
+const GraphicsBackend* getSoftwareBackend();
+
+#endif /* __GRAPHICS_BACKEND_H__ */
@@ -0,0 +1,268 @@
+#include "graphics_backend.h"
+#include <directfb.h>
+
+
+static GraphicsControllerError directFBInit(int32_t* screenWidth, int32_t* screenHeight);
+static void directFBDeinit();
+static GraphicsControllerError directFBLoadFont(const char* fileName, int32_t height);
+static GraphicsControllerError directFBUseBundleFont(const AssetFont* font);
+static void directFBSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+static void directFBFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height);
+static void directFBDrawString(const char* text, int32_t x, int32_t y);
+static GraphicsControllerError directFBLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height);
+static GraphicsControllerError directFBWrapImage(const AssetImage* asset, GraphicsImage* image);
+static void directFBReleaseImage(GraphicsImage image);
+static void directFBBlit(GraphicsImage image, int32_t x, int32_t y, bool blend);
+static void directFBFlip();
+
+
+static IDirectFBSurface* primary = NULL;
+static IDirectFB* dfbInterface = NULL;
+static IDirectFBFont* fontInterface = NULL;
+static IDirectFBSurface* glyphStrip = NULL;
+static AssetFont bundleFont;
+
+static const GraphicsBackend directFBBackend =
+{
+    "directfb",
+    true,
+    directFBInit,
+    directFBDeinit,
+    directFBLoadFont,
+    directFBUseBundleFont,
+    directFBSetColor,
+    directFBFillRectangle,
+    directFBDrawString,
+    directFBLoadImage,
+    directFBWrapImage,
+    directFBReleaseImage,
+    directFBBlit,
+    directFBFlip
+};
+
+
+/* helper macro for error checking */
+#define DFBCHECK(x...)                                      \
+{                                                           \
+DFBResult err = x;                                          \
+                                                            \
+if (err != DFB_OK)                                          \
+  {                                                         \
+    fprintf( stderr, "%s <%d>:\n\t", __FILE__, __LINE__ );  \
+    DirectFBErrorFatal( #x, err );                          \
+  }                                                         \
+}
+
+
+const GraphicsBackend* getDirectFBBackend()
+{
+    return &directFBBackend;
+}
+
+GraphicsControllerError directFBInit(int32_t* screenWidth, int32_t* screenHeight)
+{
+    DFBSurfaceDescription surfaceDesc;
+
+    /* initialize DirectFB */
+    if (DirectFBInit(0, NULL))
+    {
+        return GC_ERROR;
+    }
+
+    /* fetch the DirectFB interface */
+    if (DirectFBCreate(&dfbInterface))
+    {
+        return GC_ERROR;
+    }
+
+    /* tell the DirectFB to take the full screen for this application */
+    if (dfbInterface->SetCooperativeLevel(dfbInterface, DFSCL_FULLSCREEN))
+    {
+        return GC_ERROR;
+    }
+
+    /* create primary surface with double buffering enabled */
+    surfaceDesc.flags = DSDESC_CAPS;
+    surfaceDesc.caps = DSCAPS_PRIMARY | DSCAPS_FLIPPING;
+
+    if (dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &primary))
+    {
+        return GC_ERROR;
+    }
+
+    /* fetch the screen size */
+    if (primary->GetSize(primary, screenWidth, screenHeight))
+    {
+        return GC_ERROR;
+    }
+
+    return GC_NO_ERROR;
+}
+
+void directFBDeinit()
+{
+    if (glyphStrip != NULL)
+    {
+        glyphStrip->Release(glyphStrip);
+        glyphStrip = NULL;
+    }
+    if (fontInterface != NULL)
+    {
+        fontInterface->Release(fontInterface);
+        fontInterface = NULL;
+    }
+    primary->Release(primary);
+    dfbInterface->Release(dfbInterface);
+}
+
+GraphicsControllerError directFBLoadFont(const char* fileName, int32_t height)
+{
+    DFBFontDescription fontDesc;
+
+    /* create font */
+    fontDesc.flags = DFDESC_HEIGHT;
+    fontDesc.height = height;
+
+    if (dfbInterface->CreateFont(dfbInterface, fileName, &fontDesc, &fontInterface))
+    {
+        printf("\n%s : ERROR cannot load font %s\n", __FUNCTION__, fileName);
+        return GC_ERROR;
+    }
+    DFBCHECK(primary->SetFont(primary, fontInterface));
+
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError directFBUseBundleFont(const AssetFont* font)
+{
+    DFBSurfaceDescription surfaceDesc;
+
+    /* surface is a view of the mapped strip, nothing is rasterized or copied */
+    surfaceDesc.flags = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_PREALLOCATED;
+    surfaceDesc.width = font->width;
+    surfaceDesc.height = font->height;
+    surfaceDesc.pixelformat = DSPF_A8;
+    surfaceDesc.preallocated[0].data = (void*)font->strip;
+    surfaceDesc.preallocated[0].pitch = font->pitch;
+    surfaceDesc.preallocated[1].data = NULL;
+    surfaceDesc.preallocated[1].pitch = 0;
+
+    if (dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &glyphStrip))
+    {
+        printf("\n%s : ERROR cannot create glyph strip surface\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+    bundleFont = *font;
+
+    return GC_NO_ERROR;
+}
+
+void directFBSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+{
+    DFBCHECK(primary->SetColor(primary, red, green, blue, alpha));
+}
+
+void directFBFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    DFBCHECK(primary->FillRectangle(primary, x, y, width, height));
+}
+
+void directFBDrawString(const char* text, int32_t x, int32_t y)
+{
+    const AssetGlyph* glyph = NULL;
+    DFBRectangle glyphRect;
+
+    if (glyphStrip == NULL)
+    {
+        DFBCHECK(primary->DrawString(primary, text, -1, x, y, DSTF_LEFT));
+        return;
+    }
+
+    /* A8 cells are colorized with the current color, cells span the whole line starting ascent above the baseline */
+    DFBCHECK(primary->SetBlittingFlags(primary, DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA));
+    glyphRect.y = 0;
+    glyphRect.h = bundleFont.height;
+    for (; *text != '\0'; text++)
+    {
+        if (*text < ASSET_GLYPH_FIRST || *text >= ASSET_GLYPH_FIRST + ASSET_GLYPH_COUNT)
+        {
+            continue;
+        }
+
+        glyph = &bundleFont.glyphs[*text - ASSET_GLYPH_FIRST];
+        if (glyph->width != 0)
+        {
+            glyphRect.x = glyph->x;
+            glyphRect.w = glyph->width;
+            DFBCHECK(primary->Blit(primary, glyphStrip, &glyphRect, x + glyph->offsetX, y - bundleFont.ascent));
+        }
+        x += glyph->advance;
+    }
+}
+
+GraphicsControllerError directFBLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height)
+{
+    IDirectFBImageProvider* provider = NULL;
+    IDirectFBSurface* surface = NULL;
+    DFBSurfaceDescription surfaceDesc;
+
+    if (dfbInterface->CreateImageProvider(dfbInterface, fileName, &provider))
+    {
+        printf("\n%s : ERROR cannot open image %s\n", __FUNCTION__, fileName);
+        return GC_ERROR;
+    }
+
+    DFBCHECK(provider->GetSurfaceDescription(provider, &surfaceDesc));
+    DFBCHECK(dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &surface));
+    DFBCHECK(provider->RenderTo(provider, surface, NULL));
+    provider->Release(provider);
+
+    DFBCHECK(surface->GetSize(surface, width, height));
+    *image = surface;
+
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError directFBWrapImage(const AssetImage* asset, GraphicsImage* image)
+{
+    IDirectFBSurface* surface = NULL;
+    DFBSurfaceDescription surfaceDesc;
+
+    /* mapping is read only, surface is only ever used as blit source */
+    surfaceDesc.flags = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_PREALLOCATED;
+    surfaceDesc.width = asset->width;
+    surfaceDesc.height = asset->height;
+    surfaceDesc.pixelformat = DSPF_ARGB;
+    surfaceDesc.preallocated[0].data = (void*)asset->pixels;
+    surfaceDesc.preallocated[0].pitch = asset->pitch * (int32_t)sizeof(uint32_t);
+    surfaceDesc.preallocated[1].data = NULL;
+    surfaceDesc.preallocated[1].pitch = 0;
+
+    if (dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &surface))
+    {
+        printf("\n%s : ERROR cannot create image surface\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+    *image = surface;
+
+    return GC_NO_ERROR;
+}
+
+void directFBReleaseImage(GraphicsImage image)
+{
+    IDirectFBSurface* surface = (IDirectFBSurface*)image;
+
+    surface->Release(surface);
+}
+
+void directFBBlit(GraphicsImage image, int32_t x, int32_t y, bool blend)
+{
+    /* strings drawn from bundle font leave blending flags behind */
+    DFBCHECK(primary->SetBlittingFlags(primary, blend ? DSBLIT_BLEND_ALPHACHANNEL : DSBLIT_NOFX));
+    DFBCHECK(primary->Blit(primary, (IDirectFBSurface*)image, NULL, x, y));
+}
+
+void directFBFlip()
+{
+    DFBCHECK(primary->Flip(primary, NULL, 0));
+}
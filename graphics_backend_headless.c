@@ -0,0 +1,106 @@
+#include "graphics_backend.h"
+
+#define HEADLESS_SCREEN_WIDTH 1920
+#define HEADLESS_SCREEN_HEIGHT 1080
+
+
+static GraphicsControllerError headlessInit(int32_t* screenWidth, int32_t* screenHeight);
+static void headlessDeinit();
+static GraphicsControllerError headlessLoadFont(const char* fileName, int32_t height);
+static GraphicsControllerError headlessUseBundleFont(const AssetFont* font);
+static void headlessSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+static void headlessFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height);
+static void headlessDrawString(const char* text, int32_t x, int32_t y);
+static GraphicsControllerError headlessLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height);
+static GraphicsControllerError headlessWrapImage(const AssetImage* asset, GraphicsImage* image);
+static void headlessReleaseImage(GraphicsImage image);
+static void headlessBlit(GraphicsImage image, int32_t x, int32_t y, bool blend);
+static void headlessFlip();
+
+
+/* nothing is shown, so the render thread is not needed at all */
+static const GraphicsBackend headlessBackend =
+{
+    "headless",
+    false,
+    headlessInit,
+    headlessDeinit,
+    headlessLoadFont,
+    headlessUseBundleFont,
+    headlessSetColor,
+    headlessFillRectangle,
+    headlessDrawString,
+    headlessLoadImage,
+    headlessWrapImage,
+    headlessReleaseImage,
+    headlessBlit,
+    headlessFlip
+};
+
+
+const GraphicsBackend* getHeadlessBackend()
+{
+    return &headlessBackend;
+}
+
+GraphicsControllerError headlessInit(int32_t* screenWidth, int32_t* screenHeight)
+{
+    *screenWidth = HEADLESS_SCREEN_WIDTH;
+    *screenHeight = HEADLESS_SCREEN_HEIGHT;
+
+    return GC_NO_ERROR;
+}
+
+void headlessDeinit()
+{
+}
+
+GraphicsControllerError headlessLoadFont(const char* fileName, int32_t height)
+{
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError headlessUseBundleFont(const AssetFont* font)
+{
+    return GC_NO_ERROR;
+}
+
+void headlessSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+{
+}
+
+void headlessFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+}
+
+void headlessDrawString(const char* text, int32_t x, int32_t y)
+{
+}
+
+GraphicsControllerError headlessLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height)
+{
+    *image = NULL;
+    *width = 0;
+    *height = 0;
+
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError headlessWrapImage(const AssetImage* asset, GraphicsImage* image)
+{
+    *image = NULL;
+
+    return GC_NO_ERROR;
+}
+
+void headlessReleaseImage(GraphicsImage image)
+{
+}
+
+void headlessBlit(GraphicsImage image, int32_t x, int32_t y, bool blend)
+{
+}
+
+void headlessFlip()
+{
+}
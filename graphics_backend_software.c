@@ -0,0 +1,458 @@
+#include "graphics_backend.h"
+#include "software_rasterizer.h"
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <ctype.h>
+
+#define SOFTWARE_SCREEN_WIDTH 1920
+#define SOFTWARE_SCREEN_HEIGHT 1080
+#define SOFTWARE_FRAME_PERIOD_NS 20000000       /* Flip is paced to 50 Hz, there is no vsync to wait for */
+#define SOFTWARE_DUMP_ENV "OSD_DUMP_PREFIX"     /* If set, changed frames are written as <prefix>_<frame>.ppm */
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+#define GLYPH_SCALE 5                           /* 7 rows of 5 pixels, close to 40 pixel DirectFB font */
+#define GLYPH_ADVANCE ((GLYPH_WIDTH + 1) * GLYPH_SCALE)
+#define GLYPH_FIRST ' '
+#define GLYPH_LAST '~'
+
+/**
+ * @brief Image of software backend, pixels of bundle images belong to the mapped bundle
+ */
+typedef struct _SoftwareImage
+{
+    Framebuffer frame;
+    bool ownsPixels;
+}SoftwareImage;
+
+static GraphicsControllerError softwareInit(int32_t* screenWidth, int32_t* screenHeight);
+static void softwareDeinit();
+static GraphicsControllerError softwareLoadFont(const char* fileName, int32_t height);
+static GraphicsControllerError softwareUseBundleFont(const AssetFont* font);
+static void softwareSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+static void softwareFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height);
+static void softwareDrawString(const char* text, int32_t x, int32_t y);
+static GraphicsControllerError softwareLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height);
+static GraphicsControllerError softwareWrapImage(const AssetImage* asset, GraphicsImage* image);
+static void softwareReleaseImage(GraphicsImage image);
+static void softwareBlit(GraphicsImage image, int32_t x, int32_t y, bool blend);
+static void softwareFlip();
+static int32_t readNetpbmToken(FILE* file, char* token, size_t size);
+static GraphicsControllerError loadNetpbm(const char* fileName, Framebuffer* image);
+static uint64_t frameChecksum();
+
+
+static const GraphicsBackend softwareBackend =
+{
+    "software",
+    true,
+    softwareInit,
+    softwareDeinit,
+    softwareLoadFont,
+    softwareUseBundleFont,
+    softwareSetColor,
+    softwareFillRectangle,
+    softwareDrawString,
+    softwareLoadImage,
+    softwareWrapImage,
+    softwareReleaseImage,
+    softwareBlit,
+    softwareFlip
+};
+
+/* Columns of 5x7 glyphs for ASCII 0x20 - 0x7E, bit 0 is the top row */
+static const uint8_t glyphs[GLYPH_LAST - GLYPH_FIRST + 1][GLYPH_WIDTH] =
+{
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+    {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+    {0x38, 0x44, 0x44, 0x48, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00},
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+    {0x7C, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C},
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+    {0x00, 0x00, 0x7F, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}
+};
+
+static Framebuffer framebuffer;
+static AssetFont bundleFont;
+static bool bundleFontUsed = false;
+static uint32_t currentColor = 0;
+static uint32_t frameNumber = 0;
+static const char* dumpPrefix = NULL;
+static uint64_t lastDumpChecksum = 0;
+static struct timespec nextFlipTime;
+
+
+const GraphicsBackend* getSoftwareBackend()
+{
+    return &softwareBackend;
+}
+
+GraphicsControllerError softwareInit(int32_t* screenWidth, int32_t* screenHeight)
+{
+    RasterizerKernel kernel = rasterizerInit();
+
+    if (framebufferCreate(&framebuffer, SOFTWARE_SCREEN_WIDTH, SOFTWARE_SCREEN_HEIGHT))
+    {
+        printf("\n%s : ERROR framebufferCreate() fail\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+
+    dumpPrefix = getenv(SOFTWARE_DUMP_ENV);
+    if (dumpPrefix != NULL && dumpPrefix[0] == '\0')
+    {
+        dumpPrefix = NULL;
+    }
+    frameNumber = 0;
+    lastDumpChecksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &nextFlipTime);
+
+    printf("Software framebuffer %dx%d, %s kernel%s%s\n", framebuffer.width, framebuffer.height,
+        kernel == RASTERIZER_KERNEL_AVX2 ? "AVX2" : (kernel == RASTERIZER_KERNEL_SSE2 ? "SSE2" : "scalar"),
+        dumpPrefix != NULL ? ", dumping frames to " : "", dumpPrefix != NULL ? dumpPrefix : "");
+
+    *screenWidth = framebuffer.width;
+    *screenHeight = framebuffer.height;
+
+    return GC_NO_ERROR;
+}
+
+void softwareDeinit()
+{
+    framebufferDestroy(&framebuffer);
+    bundleFontUsed = false;
+}
+
+/* TrueType is not rasterized here, built in glyphs are used instead */
+GraphicsControllerError softwareLoadFont(const char* fileName, int32_t height)
+{
+    (void)fileName;
+    (void)height;
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError softwareUseBundleFont(const AssetFont* font)
+{
+    bundleFont = *font;
+    bundleFontUsed = true;
+
+    return GC_NO_ERROR;
+}
+
+void softwareSetColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+{
+    currentColor = ((uint32_t)alpha << 24) | ((uint32_t)red << 16) | ((uint32_t)green << 8) | blue;
+}
+
+void softwareFillRectangle(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    /* same as DirectFB without blending flags, color is written as is */
+    rasterizerFill(&framebuffer, x, y, width, height, currentColor);
+}
+
+void softwareDrawString(const char* text, int32_t x, int32_t y)
+{
+    const uint8_t* glyph = NULL;
+    int32_t top = y - GLYPH_HEIGHT * GLYPH_SCALE;        /* y is the baseline, as in DirectFB */
+    int32_t column = 0;
+    int32_t row = 0;
+    const AssetGlyph* bundleGlyph = NULL;
+
+    /* bundle cells span the whole line, top of the line is ascent above the baseline */
+    if (bundleFontUsed)
+    {
+        for (; *text != '\0'; text++)
+        {
+            if (*text < ASSET_GLYPH_FIRST || *text >= ASSET_GLYPH_FIRST + ASSET_GLYPH_COUNT)
+            {
+                continue;
+            }
+
+            bundleGlyph = &bundleFont.glyphs[*text - ASSET_GLYPH_FIRST];
+            rasterizerBlendMask(&framebuffer, bundleFont.strip + bundleGlyph->x, bundleFont.pitch, x + bundleGlyph->offsetX,
+                y - bundleFont.ascent, bundleGlyph->width, bundleFont.height, currentColor);
+            x += bundleGlyph->advance;
+        }
+        return;
+    }
+
+    for (; *text != '\0'; text++, x += GLYPH_ADVANCE)
+    {
+        if (*text < GLYPH_FIRST || *text > GLYPH_LAST)
+        {
+            continue;
+        }
+
+        glyph = glyphs[*text - GLYPH_FIRST];
+        for (column = 0; column < GLYPH_WIDTH; column++)
+        {
+            for (row = 0; row < GLYPH_HEIGHT; row++)
+            {
+                if (glyph[column] & (1 << row))
+                {
+                    rasterizerBlendFill(&framebuffer, x + column * GLYPH_SCALE, top + row * GLYPH_SCALE,
+                        GLYPH_SCALE, GLYPH_SCALE, currentColor);
+                }
+            }
+        }
+    }
+}
+
+GraphicsControllerError softwareLoadImage(const char* fileName, GraphicsImage* image, int32_t* width, int32_t* height)
+{
+    SoftwareImage* loadedImage = NULL;
+    char netpbmName[256];
+    const char* extension = strrchr(fileName, '.');
+    size_t baseLength = (extension != NULL) ? (size_t)(extension - fileName) : strlen(fileName);
+
+    loadedImage = (SoftwareImage*)malloc(sizeof(SoftwareImage));
+    if (loadedImage == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+    loadedImage->ownsPixels = true;
+
+    /* there is no PNG decoder here, use PAM (with alpha) or PPM saved next to the original */
+    snprintf(netpbmName, sizeof(netpbmName), "%.*s.pam", (int)baseLength, fileName);
+    if (loadNetpbm(netpbmName, &loadedImage->frame))
+    {
+        snprintf(netpbmName, sizeof(netpbmName), "%.*s.ppm", (int)baseLength, fileName);
+        if (loadNetpbm(netpbmName, &loadedImage->frame))
+        {
+            printf("\n%s : ERROR no PAM or PPM version of %s\n", __FUNCTION__, fileName);
+            free(loadedImage);
+            return GC_ERROR;
+        }
+    }
+
+    *image = loadedImage;
+    *width = loadedImage->frame.width;
+    *height = loadedImage->frame.height;
+
+    return GC_NO_ERROR;
+}
+
+GraphicsControllerError softwareWrapImage(const AssetImage* asset, GraphicsImage* image)
+{
+    SoftwareImage* wrappedImage = NULL;
+
+    wrappedImage = (SoftwareImage*)malloc(sizeof(SoftwareImage));
+    if (wrappedImage == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+
+    /* blit only reads source pixels, so they can stay in the read only mapping */
+    wrappedImage->frame.pixels = (uint32_t*)asset->pixels;
+    wrappedImage->frame.width = asset->width;
+    wrappedImage->frame.height = asset->height;
+    wrappedImage->frame.pitch = asset->pitch;
+    wrappedImage->ownsPixels = false;
+
+    *image = wrappedImage;
+
+    return GC_NO_ERROR;
+}
+
+void softwareReleaseImage(GraphicsImage image)
+{
+    SoftwareImage* releasedImage = (SoftwareImage*)image;
+
+    if (releasedImage->ownsPixels)
+    {
+        framebufferDestroy(&releasedImage->frame);
+    }
+    free(releasedImage);
+}
+
+void softwareBlit(GraphicsImage image, int32_t x, int32_t y, bool blend)
+{
+    if (blend)
+    {
+        rasterizerBlit(&framebuffer, &((const SoftwareImage*)image)->frame, x, y);
+    }
+    else
+    {
+        rasterizerCopy(&framebuffer, &((const SoftwareImage*)image)->frame, x, y);
+    }
+}
+
+void softwareFlip()
+{
+    char fileName[256];
+    uint64_t checksum = 0;
+
+    frameNumber++;
+
+    if (dumpPrefix != NULL)
+    {
+        /* render thread redraws the same frame all the time, keep only frames that changed */
+        checksum = frameChecksum();
+        if (checksum != lastDumpChecksum)
+        {
+            snprintf(fileName, sizeof(fileName), "%s_%06u.ppm", dumpPrefix, frameNumber);
+            rasterizerWritePpm(&framebuffer, fileName);
+            lastDumpChecksum = checksum;
+        }
+    }
+
+    nextFlipTime.tv_nsec += SOFTWARE_FRAME_PERIOD_NS;
+    if (nextFlipTime.tv_nsec >= 1000000000)
+    {
+        nextFlipTime.tv_sec++;
+        nextFlipTime.tv_nsec -= 1000000000;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextFlipTime, NULL) == EINTR);
+}
+
+/* FNV-1a over pixels, only used to skip dumping unchanged frames */
+uint64_t frameChecksum()
+{
+    uint64_t checksum = 14695981039346656037ULL;
+    size_t count = (size_t)framebuffer.pitch * framebuffer.height;
+    size_t i = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        checksum = (checksum ^ framebuffer.pixels[i]) * 1099511628211ULL;
+    }
+
+    return checksum;
+}
+
+/* Reads next header token of a netpbm file, skipping comments */
+int32_t readNetpbmToken(FILE* file, char* token, size_t size)
+{
+    size_t length = 0;
+    int character = fgetc(file);
+
+    while (character != EOF && (isspace(character) || character == '#'))
+    {
+        if (character == '#')
+        {
+            while (character != EOF && character != '\n')
+            {
+                character = fgetc(file);
+            }
+        }
+        character = fgetc(file);
+    }
+
+    while (character != EOF && !isspace(character) && length + 1 < size)
+    {
+        token[length++] = (char)character;
+        character = fgetc(file);
+    }
+    token[length] = '\0';
+
+    return (length > 0) ? 0 : -1;
+}
+
+/* Loads binary PPM (P6) or PAM (P7, RGB or RGB_ALPHA) with maxval 255 */
+GraphicsControllerError loadNetpbm(const char* fileName, Framebuffer* image)
+{
+    FILE* inputFile = NULL;
+    char token[32];
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t depth = 3;
+    int32_t maxValue = 0;
+    uint8_t pixel[4] = {0, 0, 0, 0xFF};
+    int32_t x = 0;
+    int32_t y = 0;
+
+    if ((inputFile = fopen(fileName, "rb")) == NULL)
+    {
+        return GC_ERROR;
+    }
+
+    if (readNetpbmToken(inputFile, token, sizeof(token)))
+    {
+        fclose(inputFile);
+        return GC_ERROR;
+    }
+
+    if (strcmp(token, "P6") == 0)
+    {
+        if (readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+        {
+            width = atoi(token);
+        }
+        if (readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+        {
+            height = atoi(token);
+        }
+        if (readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+        {
+            maxValue = atoi(token);
+        }
+    }
+    else if (strcmp(token, "P7") == 0)
+    {
+        while (readNetpbmToken(inputFile, token, sizeof(token)) == 0 && strcmp(token, "ENDHDR") != 0)
+        {
+            if (strcmp(token, "WIDTH") == 0 && readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+            {
+                width = atoi(token);
+            }
+            else if (strcmp(token, "HEIGHT") == 0 && readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+            {
+                height = atoi(token);
+            }
+            else if (strcmp(token, "DEPTH") == 0 && readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+            {
+                depth = atoi(token);
+            }
+            else if (strcmp(token, "MAXVAL") == 0 && readNetpbmToken(inputFile, token, sizeof(token)) == 0)
+            {
+                maxValue = atoi(token);
+            }
+        }
+    }
+
+    if (maxValue != 255 || (depth != 3 && depth != 4) || framebufferCreate(image, width, height))
+    {
+        printf("\n%s : ERROR unsupported image %s\n", __FUNCTION__, fileName);
+        fclose(inputFile);
+        return GC_ERROR;
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            if (fread(pixel, 1, depth, inputFile) != (size_t)depth)
+            {
+                printf("\n%s : ERROR %s is truncated\n", __FUNCTION__, fileName);
+                framebufferDestroy(image);
+                fclose(inputFile);
+                return GC_ERROR;
+            }
+            image->pixels[(size_t)y * image->pitch + x] =
+                ((uint32_t)pixel[3] << 24) | ((uint32_t)pixel[0] << 16) | ((uint32_t)pixel[1] << 8) | pixel[2];
+        }
+    }
+
+    fclose(inputFile);
+
+    return GC_NO_ERROR;
+}
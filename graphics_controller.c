@@ -1,35 +1,49 @@
 #include "graphics_controller.h"
-#include <directfb.h>
+#include "graphics_backend.h"
+#include "thread_policy.h"
+#include "task_executor.h"
+#include "time_service.h"
 #include <signal.h>
 #include <stdio.h>
 #include <time.h>
 #include "pthread.h"
 
+#define NUMBER_OF_VOLUME_IMAGES 11      /* Volume bar images for volume 0 to 10 */
+#define OSD_FONT_FILE "/home/galois/fonts/DejaVuSans.ttf"
+#define OSD_FONT_NAME "osd"             /* Name of the font in asset bundle */
+#define OSD_FONT_HEIGHT 40
+#define DIRECTFB_BACKEND_NAME "directfb"
+
+#ifdef GRAPHICS_DIRECTFB
+#define DEFAULT_BACKEND getDirectFBBackend()
+#else
+#define DEFAULT_BACKEND getSoftwareBackend()  /* Builds without DirectFB still draw, frames stay in memory */
+#endif
+
 
-static void setTimerParams();
 static void removeProgramNumber();
 static void removeVolumeBar();
 static void removeInfo();
 static void* renderThread();
 static void wipeScreen();
-
-
-static IDirectFBImageProvider* provider;
-static IDirectFBSurface* logoSurface = NULL;
-static IDirectFBSurface* primary = NULL;
-static IDirectFB* dfbInterface = NULL;
-static DFBSurfaceDescription surfaceDesc;
-static DFBFontDescription fontDesc;
-static IDirectFBFont* fontInterface = NULL;
+static void loadFont();
+static void loadVolumeImages();
+static void loadVolumeImageTask(void* indexArgument);
+static void releaseVolumeImages();
+static void markInteraction(OsdInteraction interaction, uint64_t keyTime);
+static void takePendingKeyTimes(uint64_t keyTimes[]);
+static void recordLatencies(const uint64_t keyTimes[]);
+
+
+static const GraphicsBackend* backend = NULL;
+static AssetBundle* assetBundle = NULL;
+static GraphicsImage volumeImages[NUMBER_OF_VOLUME_IMAGES];
+static int32_t volumeImageWidths[NUMBER_OF_VOLUME_IMAGES];
 static int32_t screenWidth = 0;
 static int32_t screenHeight = 0;
-static int32_t logoHeight;
-static int32_t logoWidth;
 
 static uint8_t stopDrawing = 0;
 static pthread_t gcThread;
-static pthread_cond_t graphicsCond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t graphicsMutex = PTHREAD_MUTEX_INITIALIZER;
 static DrawComponents componentsToDraw;
 
 static timer_t volumeTimer;
@@ -45,68 +59,69 @@ static int32_t timerFlags = 0;
 static int32_t numberOfKeys;
 static int32_t keysToShow[3];
 
+static pthread_mutex_t latencyMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t pendingKeyTimes[OSD_INTERACTION_COUNT];    /* Key events whose change is not drawn yet, 0 for none */
+static OsdLatencyStatistics latencyStatistics;
 
-/* helper macro for error checking */
-#define DFBCHECK(x...)                                      \
-{                                                           \
-DFBResult err = x;                                          \
-                                                            \
-if (err != DFB_OK)                                          \
-  {                                                         \
-    fprintf( stderr, "%s <%d>:\n\t", __FILE__, __LINE__ );  \
-    DirectFBErrorFatal( #x, err );                          \
-  }                                                         \
-}
 
-
-GraphicsControllerError graphicsControllerInit()
+GraphicsControllerError graphicsControllerInit(const char* backendName, const char* assetBundleFile)
 {
-    /* initialize DirectFB */
-    if (DirectFBInit(0, NULL))
+    if (backendName == NULL || backendName[0] == '\0')
     {
-        return GC_ERROR;
+        backend = DEFAULT_BACKEND;
     }
-
-    setTimerParams();
-
-    /* fetch the DirectFB interface */
-    if (DirectFBCreate(&dfbInterface))
+    else if (strcmp(backendName, DIRECTFB_BACKEND_NAME) == 0)
     {
+#ifdef GRAPHICS_DIRECTFB
+        backend = getDirectFBBackend();
+#else
+        /* configs written for DirectFB builds keep working */
+        backend = DEFAULT_BACKEND;
+        printf("Graphics backend %s is not built in, using %s\n", DIRECTFB_BACKEND_NAME, backend->name);
+#endif
+    }
+    else if (strcmp(backendName, getHeadlessBackend()->name) == 0)
+    {
+        backend = getHeadlessBackend();
+    }
+    else if (strcmp(backendName, getSoftwareBackend()->name) == 0)
+    {
+        backend = getSoftwareBackend();
+    }
+    else
+    {
+        printf("\n%s : ERROR unknown graphics backend %s\n", __FUNCTION__, backendName);
         return GC_ERROR;
     }
 
-    /* tell the DirectFB to take the full screen for this application */
-    if (dfbInterface->SetCooperativeLevel(dfbInterface, DFSCL_FULLSCREEN))
+    if (backend->init(&screenWidth, &screenHeight))
     {
+        printf("\n%s : ERROR %s backend init fail\n", __FUNCTION__, backend->name);
         return GC_ERROR;
     }
 
-    /* create primary surface with double buffering enabled */
-    surfaceDesc.flags = DSDESC_CAPS;
-    surfaceDesc.caps = DSCAPS_PRIMARY | DSCAPS_FLIPPING;
-
-    if (dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &primary))
+    if (!backend->needsRenderThread)
     {
-        return GC_ERROR;
-    }    
+        printf("Graphics backend %s, nothing will be drawn\n", backend->name);
+        return GC_NO_ERROR;
+    }
 
-    /* fetch the screen size */
-    if (primary->GetSize(primary, &screenWidth, &screenHeight))
+    /* bundle holds decoded images and rasterized glyphs, missing or damaged bundle falls back to original files */
+    if (assetBundleFile != NULL && assetBundleFile[0] != '\0' && assetBundleOpen(assetBundleFile, &assetBundle))
     {
-        return GC_ERROR;
+        printf("\n%s : ERROR cannot use asset bundle %s, loading original files\n", __FUNCTION__, assetBundleFile);
+        assetBundle = NULL;
     }
 
-    /* create font */
-    fontDesc.flags = DFDESC_HEIGHT;
-    fontDesc.height = 40;
+    loadFont();
 
-    DFBCHECK(dfbInterface->CreateFont(dfbInterface, "/home/galois/fonts/DejaVuSans.ttf", &fontDesc, &fontInterface));
-    DFBCHECK(primary->SetFont(primary, fontInterface));
+    /* decode volume images once, not on every frame they are shown */
+    loadVolumeImages();
 
     /* clear the screen before drawing anything */
     wipeScreen();
 
-    if (pthread_create(&gcThread, NULL, &renderThread, NULL))
+    if (threadPolicyCreateThread(THREAD_ROLE_RENDER, &gcThread, &renderThread, NULL))
     {
         printf("Error creating input event task!\n");
         return GC_THREAD_ERROR;
@@ -117,113 +132,164 @@ GraphicsControllerError graphicsControllerInit()
 
 GraphicsControllerError graphicsControllerDeinit()
 {
-    stopDrawing = 1;
-
-    /* wait for render thread to finish */
-    pthread_mutex_lock(&graphicsMutex);
-    if (ETIMEDOUT == pthread_cond_wait(&graphicsCond, &graphicsMutex))
+    if (backend->needsRenderThread)
     {
-        printf("\n%s : ERROR Lock timeout exceeded!\n", __FUNCTION__);
-    }	
-    pthread_mutex_unlock(&graphicsMutex);
+        stopDrawing = 1;
 
-    if (pthread_join(gcThread, NULL))
-    {
-        printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
-        return GC_THREAD_ERROR;
+        /* wait for render thread to finish */
+        if (pthread_join(gcThread, NULL))
+        {
+            printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
+            return GC_THREAD_ERROR;
+        }
+
+        releaseVolumeImages();
     }
 
     timer_delete(volumeTimer);
     timer_delete(infoTimer);
 
-    primary->Release(primary);
-    dfbInterface->Release(dfbInterface);
+    backend->deinit();
+
+    /* backend surfaces may point into the mapping until deinit */
+    if (assetBundle != NULL)
+    {
+        assetBundleClose(assetBundle);
+        assetBundle = NULL;
+    }
 
     return GC_NO_ERROR;
 }
 
+void loadFont()
+{
+    AssetFont font;
+
+    if (assetBundle != NULL && assetBundleGetFont(assetBundle, OSD_FONT_NAME, &font) == AB_NO_ERROR
+        && backend->useBundleFont(&font) == GC_NO_ERROR)
+    {
+        return;
+    }
+
+    if (backend->loadFont(OSD_FONT_FILE, OSD_FONT_HEIGHT))
+    {
+        printf("\n%s : ERROR no font, strings will not be drawn\n", __FUNCTION__);
+    }
+}
+
+void loadVolumeImages()
+{
+    TaskExecutor* executor = NULL;
+    TaskGroup decodeGroup;
+    AssetImage asset;
+    char fileName[20];
+    uint8_t i = 0;
+
+    /* images missing from the bundle are decoded on the shared pool, all of them at once */
+    if (taskExecutorAcquireShared(&executor))
+    {
+        executor = NULL;
+    }
+    taskGroupInit(&decodeGroup);
+
+    for (i = 0; i < NUMBER_OF_VOLUME_IMAGES; i++)
+    {
+        sprintf(fileName, "volume_%d", i);
+        if (assetBundle != NULL && assetBundleGetImage(assetBundle, fileName, &asset) == AB_NO_ERROR
+            && backend->wrapImage(&asset, &volumeImages[i]) == GC_NO_ERROR)
+        {
+            volumeImageWidths[i] = asset.width;
+            continue;
+        }
+
+        if (executor == NULL || taskExecutorSubmit(executor, TASK_PRIORITY_NORMAL, loadVolumeImageTask, (void*)(uintptr_t)i,
+            &decodeGroup))
+        {
+            loadVolumeImageTask((void*)(uintptr_t)i);
+        }
+    }
+
+    if (executor != NULL)
+    {
+        taskExecutorWait(executor, &decodeGroup);
+        taskExecutorReleaseShared();
+    }
+    taskGroupDestroy(&decodeGroup);
+}
+
+/* Every task writes only its own image slot */
+void loadVolumeImageTask(void* indexArgument)
+{
+    uint8_t index = (uint8_t)(uintptr_t)indexArgument;
+    char fileName[20];
+    int32_t height = 0;
+
+    sprintf(fileName, "volume_%d.png", index);
+    if (backend->loadImage(fileName, &volumeImages[index], &volumeImageWidths[index], &height))
+    {
+        volumeImages[index] = NULL;
+    }
+}
+
+void releaseVolumeImages()
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < NUMBER_OF_VOLUME_IMAGES; i++)
+    {
+        if (volumeImages[i] != NULL)
+        {
+            backend->releaseImage(volumeImages[i]);
+            volumeImages[i] = NULL;
+        }
+    }
+}
+
 void* renderThread()
 {
     char tempString[20];
+    uint64_t keyTimes[OSD_INTERACTION_COUNT];
 
     while (!stopDrawing)
     {
+        /* changes marked before this point are in the frame drawn now */
+        takePendingKeyTimes(keyTimes);
+
         wipeScreen();
 
         if (componentsToDraw.showRadioLogo == true)
         {
-            primary->SetColor(primary, 0x66, 0x00, 0x00, 0xFF);
-            primary->FillRectangle(primary, 0, 0, screenWidth, screenHeight);
+            backend->setColor(0x66, 0x00, 0x00, 0xFF);
+            backend->fillRectangle(0, 0, screenWidth, screenHeight);
 
-            primary->SetColor(primary, 0xFF, 0xFF, 0x00, 0xEF);
+            backend->setColor(0xFF, 0xFF, 0x00, 0xEF);
             sprintf(tempString, "RADIO");
-            DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/2 - 50, screenHeight/2, DSTF_LEFT));
+            backend->drawString(tempString, screenWidth/2 - 50, screenHeight/2);
         }
 
-        if (componentsToDraw.showVolume)
+        if (componentsToDraw.showVolume && componentsToDraw.volume < NUMBER_OF_VOLUME_IMAGES
+            && volumeImages[componentsToDraw.volume] != NULL)
         {
-            switch (componentsToDraw.volume)
-            {
-                case 0:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_0.png", &provider));
-                    break;
-                case 1:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_1.png", &provider));
-                    break;
-                case 2:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_2.png", &provider));
-                    break;
-                case 3:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_3.png", &provider));
-                    break;
-                case 4:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_4.png", &provider));
-                    break;
-                case 5:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_5.png", &provider));
-                    break;
-                case 6:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_6.png", &provider));
-                    break;
-                case 7:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_7.png", &provider));
-                    break;
-                case 8:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_8.png", &provider));
-                    break;
-                case 9:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_9.png", &provider));
-                    break;
-                case 10:
-                    DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_10.png", &provider));
-                    break;
-            }
-            DFBCHECK(provider->GetSurfaceDescription(provider, &surfaceDesc));
-            DFBCHECK(dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &logoSurface));
-            DFBCHECK(provider->RenderTo(provider, logoSurface, NULL));
-
-            provider->Release(provider);
-
-            DFBCHECK(logoSurface->GetSize(logoSurface, &logoWidth, &logoHeight));
-            DFBCHECK(primary->Blit(primary, logoSurface, NULL, screenWidth - logoWidth - 100, 50));
+            backend->blit(volumeImages[componentsToDraw.volume], screenWidth - volumeImageWidths[componentsToDraw.volume] - 100, 50,
+                false);
         }
 
         if (componentsToDraw.showInfo)
         {
-            primary->SetColor(primary, 0x00, 0x66, 0x99, 0xFF);
-            primary->FillRectangle(primary, screenWidth/10 - 20, 3*screenHeight/4 - 20, 8*screenWidth/10 + 40, screenHeight/5 + 40);
-            primary->SetColor(primary, 0xB3, 0xE6, 0xFF, 0xFF);
-            primary->FillRectangle(primary, screenWidth/10, 3*screenHeight/4, 8*screenWidth/10, screenHeight/5);
+            backend->setColor(0x00, 0x66, 0x99, 0xFF);
+            backend->fillRectangle(screenWidth/10 - 20, 3*screenHeight/4 - 20, 8*screenWidth/10 + 40, screenHeight/5 + 40);
+            backend->setColor(0xB3, 0xE6, 0xFF, 0xFF);
+            backend->fillRectangle(screenWidth/10, 3*screenHeight/4, 8*screenWidth/10, screenHeight/5);
 
-            DFBCHECK(primary->SetColor(primary, 0x00, 0x00, 0x00, 0xFF));
+            backend->setColor(0x00, 0x00, 0x00, 0xFF);
             sprintf(tempString, "Program number : %d", componentsToDraw.programNumber);
-            DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/9, 3*screenHeight/4 + 40, DSTF_LEFT));
+            backend->drawString(tempString, screenWidth/9, 3*screenHeight/4 + 40);
 
             sprintf(tempString, "Video PID : %d", componentsToDraw.videoPidToDraw);
-            DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/9, 3*screenHeight/4 + 80, DSTF_LEFT));
+            backend->drawString(tempString, screenWidth/9, 3*screenHeight/4 + 80);
 
             sprintf(tempString, "Audio PID : %d", componentsToDraw.audioPidToDraw);
-            DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/9, 3*screenHeight/4 + 120, DSTF_LEFT));
+            backend->drawString(tempString, screenWidth/9, 3*screenHeight/4 + 120);
 
             if (componentsToDraw.hoursToDraw == 30)
             {
@@ -234,69 +300,73 @@ void* renderThread()
                 sprintf(tempString, "%.2d:%.2d", componentsToDraw.hoursToDraw, componentsToDraw.minutesToDraw);
             }
 
-            DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/9, screenHeight - 60, DSTF_LEFT));
+            backend->drawString(tempString, screenWidth/9, screenHeight - 60);
 
             if (componentsToDraw.teletext == -1)
             {
-                primary->SetColor(primary, 0xFF, 0x00, 0x00, 0xFF);
+                backend->setColor(0xFF, 0x00, 0x00, 0xFF);
             }
             else
             {
-                primary->SetColor(primary, 0x00, 0xFF, 0x00, 0xFF);
+                backend->setColor(0x00, 0xFF, 0x00, 0xFF);
             }
 
             sprintf(tempString, "teletext");
-            DFBCHECK(primary->DrawString(primary, tempString, -1, 7*screenWidth/9 + 40, 3*screenHeight/4 + 40, DSTF_LEFT));
+            backend->drawString(tempString, 7*screenWidth/9 + 40, 3*screenHeight/4 + 40);
         }
 
         if (componentsToDraw.showChannelDial)
         {
-            primary->SetColor(primary, 0x00, 0x00, 0x00, 0xFF);
-            primary->FillRectangle(primary, screenWidth/2 - 110 , screenHeight/2 - 210, 220, 70);
+            backend->setColor(0x00, 0x00, 0x00, 0xFF);
+            backend->fillRectangle(screenWidth/2 - 110 , screenHeight/2 - 210, 220, 70);
 
-            primary->SetColor(primary, 0xFF, 0xFF, 0xFF, 0xFF);
-            primary->FillRectangle(primary, screenWidth/2 - 100, screenHeight/2 - 200, 200, 50);
+            backend->setColor(0xFF, 0xFF, 0xFF, 0xFF);
+            backend->fillRectangle(screenWidth/2 - 100, screenHeight/2 - 200, 200, 50);
 
-            primary->SetColor(primary, 0x00, 0x00, 0x00, 0xEF);
+            backend->setColor(0x00, 0x00, 0x00, 0xEF);
 
             if (numberOfKeys == 1)
             {
                 sprintf(tempString, "%d", keysToShow[0]);
-                DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/2 - 15, screenHeight/2 - 160, DSTF_LEFT));
+                backend->drawString(tempString, screenWidth/2 - 15, screenHeight/2 - 160);
             }
             else if (numberOfKeys == 2)
             {
                 sprintf(tempString, "%d%d", keysToShow[0], keysToShow[1]);
-                DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/2 - 25, screenHeight/2 - 160, DSTF_LEFT));
+                backend->drawString(tempString, screenWidth/2 - 25, screenHeight/2 - 160);
             }
             else if (numberOfKeys == 3)
             {
                 sprintf(tempString, "%d%d%d", keysToShow[0], keysToShow[1], keysToShow[2]);
-                DFBCHECK(primary->DrawString(primary, tempString, -1, screenWidth/2 - 35, screenHeight/2 - 160, DSTF_LEFT));
+                backend->drawString(tempString, screenWidth/2 - 35, screenHeight/2 - 160);
             }
         }
-        DFBCHECK(primary->Flip(primary, NULL, 0));
+        backend->flip();
+
+        recordLatencies(keyTimes);
     }
-    pthread_mutex_lock(&graphicsMutex);
-    pthread_cond_signal(&graphicsCond);
-    pthread_mutex_unlock(&graphicsMutex);
+
+    return NULL;
 }
 
 void wipeScreen()
 {
-    DFBCHECK(primary->SetColor(primary, 0x00, 0x00, 0x00, 0x00));
-    DFBCHECK(primary->FillRectangle(primary, 0, 0, screenWidth, screenHeight));
+    backend->setColor(0x00, 0x00, 0x00, 0x00);
+    backend->fillRectangle(0, 0, screenWidth, screenHeight);
 }
 
-void drawVolumeBar(uint8_t volumeValue)
+void drawVolumeBar(uint8_t volumeValue, uint64_t keyTime)
 {
     componentsToDraw.volume = volumeValue;
 
     timer_settime(volumeTimer, timerFlags, &volumeTimerSpec, &volumeTimerSpecOld);
     componentsToDraw.showVolume = true;
+
+    markInteraction(OSD_INTERACTION_VOLUME, keyTime);
 }
 
-void drawInfoRect(uint8_t hours, uint8_t minutes, int16_t audioPid, int16_t videoPid, uint8_t programNumber, int8_t teletext)
+void drawInfoRect(uint8_t hours, uint8_t minutes, int16_t audioPid, int16_t videoPid, uint8_t programNumber, int8_t teletext,
+    uint64_t keyTime)
 {
     componentsToDraw.audioPidToDraw = audioPid;
     componentsToDraw.videoPidToDraw = videoPid;
@@ -307,16 +377,28 @@ void drawInfoRect(uint8_t hours, uint8_t minutes, int16_t audioPid, int16_t vide
 
     timer_settime(infoTimer, timerFlags, &infoTimerSpec, &infoTimerSpecOld);
     componentsToDraw.showInfo = true;
+
+    markInteraction(OSD_INTERACTION_INFO, keyTime);
+}
+
+void updateInfoClock(uint8_t hours, uint8_t minutes)
+{
+    componentsToDraw.hoursToDraw = hours;
+    componentsToDraw.minutesToDraw = minutes;
 }
 
-void setTimerParams()
+GraphicsControllerError graphicsControllerInitTimers()
 {
     /* Settings for volume bar timer */
     volumeSignalEvent.sigev_notify = SIGEV_THREAD;
     volumeSignalEvent.sigev_notify_function = removeVolumeBar;
     volumeSignalEvent.sigev_value.sival_ptr = NULL;
-    volumeSignalEvent.sigev_notify_attributes = NULL;
-    timer_create(CLOCK_REALTIME, &volumeSignalEvent, &volumeTimer);
+    volumeSignalEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_RENDER);
+    if (timer_create(CLOCK_REALTIME, &volumeSignalEvent, &volumeTimer))
+    {
+        printf("\n%s : ERROR timer_create() fail\n", __FUNCTION__);
+        return GC_ERROR;
+    }
 
     memset(&volumeTimerSpec, 0, sizeof(volumeTimerSpec));
     volumeTimerSpec.it_value.tv_sec = 3;
@@ -326,15 +408,22 @@ void setTimerParams()
     infoSignalEvent.sigev_notify = SIGEV_THREAD;
     infoSignalEvent.sigev_notify_function = removeInfo;
     infoSignalEvent.sigev_value.sival_ptr = NULL;
-    infoSignalEvent.sigev_notify_attributes = NULL;
-    timer_create(CLOCK_REALTIME, &infoSignalEvent, &infoTimer);
+    infoSignalEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_RENDER);
+    if (timer_create(CLOCK_REALTIME, &infoSignalEvent, &infoTimer))
+    {
+        printf("\n%s : ERROR timer_create() fail\n", __FUNCTION__);
+        timer_delete(volumeTimer);
+        return GC_ERROR;
+    }
 
     memset(&infoTimerSpec, 0, sizeof(infoTimerSpec));
     infoTimerSpec.it_value.tv_sec = 3;
     infoTimerSpec.it_value.tv_nsec = 0;
+
+    return GC_NO_ERROR;
 }
 
-void channelDial(uint8_t keysPressed, uint8_t keys[])
+void channelDial(uint8_t keysPressed, uint8_t keys[], uint64_t keyTime)
 {
     numberOfKeys = keysPressed;
     keysToShow[0] = keys[0];
@@ -342,6 +431,95 @@ void channelDial(uint8_t keysPressed, uint8_t keys[])
     keysToShow[2] = keys[2];
 
     componentsToDraw.showChannelDial = true;
+
+    markInteraction(OSD_INTERACTION_DIAL, keyTime);
+}
+
+GraphicsControllerError getOsdLatencyStatistics(OsdLatencyStatistics* statistics)
+{
+    if (statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return GC_ERROR;
+    }
+
+    pthread_mutex_lock(&latencyMutex);
+    *statistics = latencyStatistics;
+    pthread_mutex_unlock(&latencyMutex);
+
+    return GC_NO_ERROR;
+}
+
+/* Called after components are changed, so render thread that takes the key time also sees the change */
+void markInteraction(OsdInteraction interaction, uint64_t keyTime)
+{
+    if (keyTime == 0)
+    {
+        return;
+    }
+
+    /* keys coming faster than frames are drawn together, oldest one is the one that waited longest */
+    pthread_mutex_lock(&latencyMutex);
+    if (pendingKeyTimes[interaction] == 0)
+    {
+        pendingKeyTimes[interaction] = keyTime;
+    }
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+void takePendingKeyTimes(uint64_t keyTimes[])
+{
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&latencyMutex);
+    for (i = 0; i < OSD_INTERACTION_COUNT; i++)
+    {
+        keyTimes[i] = pendingKeyTimes[i];
+        pendingKeyTimes[i] = 0;
+    }
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+/* Flip has returned, changes drawn in this frame are on screen */
+void recordLatencies(const uint64_t keyTimes[])
+{
+    OsdLatencyHistogram* histogram = NULL;
+    uint64_t now = monotonicMicroseconds();
+    uint32_t latency = 0;
+    uint8_t bucket = 0;
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&latencyMutex);
+    for (i = 0; i < OSD_INTERACTION_COUNT; i++)
+    {
+        if (keyTimes[i] == 0 || keyTimes[i] > now)
+        {
+            continue;
+        }
+
+        latency = (uint32_t)(now - keyTimes[i]);
+        histogram = &latencyStatistics.interactions[i];
+        for (bucket = 0; bucket < OSD_LATENCY_BUCKETS - 1; bucket++)
+        {
+            if (latency < (uint32_t)(OSD_LATENCY_FIRST_BUCKET_MS << bucket) * 1000)
+            {
+                break;
+            }
+        }
+        histogram->buckets[bucket]++;
+
+        if (histogram->count == 0 || latency < histogram->min)
+        {
+            histogram->min = latency;
+        }
+        if (latency > histogram->max)
+        {
+            histogram->max = latency;
+        }
+        histogram->total += latency;
+        histogram->count++;
+    }
+    pthread_mutex_unlock(&latencyMutex);
 }
 
 void removeChannelDial()
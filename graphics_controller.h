@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define OSD_LATENCY_BUCKETS 8
+#define OSD_LATENCY_FIRST_BUCKET_MS 4               /* Bucket i counts latencies below 4 << i ms, last one all longer */
+
 /**
  * @brief Structure that defines stream controller error
  */
@@ -32,15 +35,67 @@ typedef struct _DrawComponents
     int16_t videoPidToDraw;
 }DrawComponents;
 
+/**
+ * @brief Enumeration of OSD changes whose latency from the key is measured
+ */
+typedef enum _OsdInteraction
+{
+    OSD_INTERACTION_VOLUME = 0,
+    OSD_INTERACTION_DIAL,
+    OSD_INTERACTION_INFO,
+    OSD_INTERACTION_COUNT
+}OsdInteraction;
+
+/**
+ * @brief Structure that holds input to photon latencies of one interaction, in microseconds
+ */
+typedef struct _OsdLatencyHistogram
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t buckets[OSD_LATENCY_BUCKETS];
+}OsdLatencyHistogram;
+
+/**
+ * @brief Structure that holds input to photon latencies of all interactions
+ *
+ * Latency lasts from the input event of the key until the flip that first shows the change returns,
+ * so it includes waiting for the input thread, callback, render thread and the rest of the frame drawn before.
+ */
+typedef struct _OsdLatencyStatistics
+{
+    OsdLatencyHistogram interactions[OSD_INTERACTION_COUNT];
+}OsdLatencyStatistics;
+
 /**
  * @brief Initializes graphics controller module
  *
+ * Font and volume images are taken from the asset bundle when it can be opened, otherwise they are loaded
+ * from the TrueType font and PNG files.
+ *
+ * NULL or empty backend name takes DirectFB in builds with GRAPHICS_DIRECTFB (DIRECTFB=1, the makefile default)
+ * and the software backend otherwise. "directfb" falls back to software when DirectFB is not built in.
+ *
+ * @param [in] backendName - name of graphics backend ("directfb", "software" or "headless"), NULL or empty for default
+ * @param [in] assetBundleFile - bundle made by asset_packer, NULL or empty to load the original files
  * @return graphics controller error code
  */
-GraphicsControllerError graphicsControllerInit();
+GraphicsControllerError graphicsControllerInit(const char* backendName, const char* assetBundleFile);
 
 /**
- * @brief Deinitializes graphics controller module
+ * @brief Creates timers that hide the volume bar and info banner
+ *
+ * Called before the stream controller can report a channel, its callbacks draw before graphicsControllerInit
+ * may have run. Draw requests only set what the render thread shows once it is started.
+ *
+ * @return graphics controller error code
+ */
+GraphicsControllerError graphicsControllerInitTimers();
+
+/**
+ * @brief Deinitializes graphics controller module, also deletes timers of graphicsControllerInitTimers
  *
  * @return graphics controller error code
  */
@@ -50,8 +105,9 @@ GraphicsControllerError graphicsControllerDeinit();
  * @brief Initiates drawing of volume logo
  *
  * @param [in] volumeValue - current volume value
+ * @param [in] keyTime - monotonic microseconds of key event that changed volume, 0 if not caused by a key
  */
-void drawVolumeBar(uint8_t volumeValue);
+void drawVolumeBar(uint8_t volumeValue, uint64_t keyTime);
 
 /**
  * @brief Initiates drawing of info bar
@@ -62,16 +118,35 @@ void drawVolumeBar(uint8_t volumeValue);
  * @param [in] videoPid - current channel video PID
  * @param [in] programNumber - current program number
  * @param [in] teletext - teletext available or not (-1)
+ * @param [in] keyTime - monotonic microseconds of key event that asked for info, 0 if not caused by a key
+ */
+void drawInfoRect(uint8_t hours, uint8_t minutes, int16_t audioPid, int16_t videoPid, uint8_t programNumber, int8_t teletext,
+    uint64_t keyTime);
+
+/**
+ * @brief Updates time shown in the info bar, also while the bar is visible
+ *
+ * @param [in] hours - current hours value
+ * @param [in] minutes - current minutes value
  */
-void drawInfoRect(uint8_t hours, uint8_t minutes, int16_t audioPid, int16_t videoPid, uint8_t programNumber, int8_t teletext);
+void updateInfoClock(uint8_t hours, uint8_t minutes);
 
 /**
  * @brief Initiates drawing of channel number dial rectangle
  *
  * @param [in] keysPressed - number of digits in channel number
  * @param [in] keys[] - array of digits in channel number
+ * @param [in] keyTime - monotonic microseconds of key event of last digit, 0 if not caused by a key
+ */
+void channelDial(uint8_t keysPressed, uint8_t keys[], uint64_t keyTime);
+
+/**
+ * @brief Returns input to photon latencies of OSD changes made so far
+ *
+ * @param [out] statistics - latency histograms per interaction
+ * @return graphics controller error code
  */
-void channelDial(uint8_t keysPressed, uint8_t keys[]);
+GraphicsControllerError getOsdLatencyStatistics(OsdLatencyStatistics* statistics);
 
 /**
  * @brief Removes channel nubmer dial rectangle
@@ -0,0 +1,323 @@
+#include "packet_classifier.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#define PACKET_CLASSIFIER_X86
+#include <immintrin.h>
+#endif
+
+#define SYNC_SPAN ((PACKET_CLASSIFIER_SYNC_CONFIRMATIONS - 1) * TS_PACKET_SIZE)
+
+/* header word, loaded little endian, is turned into ClassifiedPacket layout:
+ * pid = (b1 & 0x1F) << 8 | b2, flags = b1 >> 6 | (b3 & 0xF0) >> 2, cc = b3 & 0x0F
+ */
+#define HEADER_PID_HIGH_MASK 0x00001F00
+#define HEADER_CC_MASK 0x0F000000
+#define HEADER_SYNC_MASK 0x000000FF
+
+typedef uint32_t (*ClassifyFunction)(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets);
+typedef int32_t (*FindSyncFunction)(const uint8_t* data, uint32_t length);
+
+static uint32_t classifyPacketsScalar(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets);
+static int32_t findPacketSyncScalar(const uint8_t* data, uint32_t length);
+#ifdef PACKET_CLASSIFIER_X86
+static uint32_t classifyPacketsSse2(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets);
+static uint32_t classifyPacketsAvx2(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets);
+static int32_t findPacketSyncSse2(const uint8_t* data, uint32_t length);
+static int32_t findPacketSyncAvx2(const uint8_t* data, uint32_t length);
+#endif
+
+static ClassifyFunction classifyFunction = NULL;
+static FindSyncFunction findSyncFunction = NULL;
+static PacketClassifierKernel currentKernel = PC_KERNEL_SCALAR;
+
+
+PacketClassifierKernel packetClassifierInit()
+{
+#ifdef PACKET_CLASSIFIER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        packetClassifierSelect(PC_KERNEL_AVX2);
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        packetClassifierSelect(PC_KERNEL_SSE2);
+    }
+    else
+#endif
+    {
+        packetClassifierSelect(PC_KERNEL_SCALAR);
+    }
+
+    return currentKernel;
+}
+
+PacketClassifierError packetClassifierSelect(PacketClassifierKernel kernel)
+{
+    switch (kernel)
+    {
+        case PC_KERNEL_SCALAR:
+            classifyFunction = classifyPacketsScalar;
+            findSyncFunction = findPacketSyncScalar;
+            break;
+#ifdef PACKET_CLASSIFIER_X86
+        case PC_KERNEL_SSE2:
+            classifyFunction = classifyPacketsSse2;
+            findSyncFunction = findPacketSyncSse2;
+            break;
+        case PC_KERNEL_AVX2:
+            if (!__builtin_cpu_supports("avx2"))
+            {
+                printf("\n%s : ERROR AVX2 is not supported by this CPU\n", __FUNCTION__);
+                return PC_ERROR;
+            }
+            classifyFunction = classifyPacketsAvx2;
+            findSyncFunction = findPacketSyncAvx2;
+            break;
+#endif
+        default:
+            printf("\n%s : ERROR kernel %d is not available in this build\n", __FUNCTION__, kernel);
+            return PC_ERROR;
+    }
+
+    currentKernel = kernel;
+
+    return PC_NO_ERROR;
+}
+
+PacketClassifierKernel packetClassifierGetKernel()
+{
+    return currentKernel;
+}
+
+uint32_t classifyPackets(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets)
+{
+    if (classifyFunction == NULL)
+    {
+        packetClassifierInit();
+    }
+
+    return classifyFunction(data, numberOfPackets, packets);
+}
+
+int32_t findPacketSync(const uint8_t* data, uint32_t length)
+{
+    if (findSyncFunction == NULL)
+    {
+        packetClassifierInit();
+    }
+
+    return findSyncFunction(data, length);
+}
+
+/* Reference implementation, every other kernel must produce the same output */
+uint32_t classifyPacketsScalar(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets)
+{
+    uint32_t i = 0;
+    const uint8_t* packet = data;
+
+    for (i = 0; i < numberOfPackets; i++, packet += TS_PACKET_SIZE)
+    {
+        if (packet[0] != TS_SYNC_BYTE)
+        {
+            break;
+        }
+
+        packets[i].pid = (uint16_t)(((packet[1] & 0x1F) << 8) | packet[2]);
+        packets[i].flags = (uint8_t)((packet[1] >> 6) | ((packet[3] & 0xF0) >> 2));
+        packets[i].continuityCounter = packet[3] & 0x0F;
+    }
+
+    return i;
+}
+
+int32_t findPacketSyncScalar(const uint8_t* data, uint32_t length)
+{
+    uint32_t offset = 0;
+    uint32_t i = 0;
+
+    for (offset = 0; offset + SYNC_SPAN < length; offset++)
+    {
+        for (i = 0; i < PACKET_CLASSIFIER_SYNC_CONFIRMATIONS; i++)
+        {
+            if (data[offset + i * TS_PACKET_SIZE] != TS_SYNC_BYTE)
+            {
+                break;
+            }
+        }
+
+        if (i == PACKET_CLASSIFIER_SYNC_CONFIRMATIONS)
+        {
+            return (int32_t)offset;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef PACKET_CLASSIFIER_X86
+
+static inline int32_t loadHeader(const uint8_t* packet)
+{
+    int32_t header;
+
+    memcpy(&header, packet, sizeof(header));
+
+    return header;
+}
+
+__attribute__((target("sse2")))
+static inline __m128i transformHeadersSse2(__m128i header)
+{
+    __m128i pid = _mm_or_si128(_mm_and_si128(header, _mm_set1_epi32(HEADER_PID_HIGH_MASK | HEADER_CC_MASK)),
+        _mm_and_si128(_mm_srli_epi32(header, 16), _mm_set1_epi32(0xFF)));
+    __m128i flags = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(header, 2), _mm_set1_epi32(0x00030000)),
+        _mm_and_si128(_mm_srli_epi32(header, 10), _mm_set1_epi32(0x003C0000)));
+
+    return _mm_or_si128(pid, flags);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i transformHeadersAvx2(__m256i header)
+{
+    __m256i pid = _mm256_or_si256(_mm256_and_si256(header, _mm256_set1_epi32(HEADER_PID_HIGH_MASK | HEADER_CC_MASK)),
+        _mm256_and_si256(_mm256_srli_epi32(header, 16), _mm256_set1_epi32(0xFF)));
+    __m256i flags = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(header, 2), _mm256_set1_epi32(0x00030000)),
+        _mm256_and_si256(_mm256_srli_epi32(header, 10), _mm256_set1_epi32(0x003C0000)));
+
+    return _mm256_or_si256(pid, flags);
+}
+
+__attribute__((target("sse2")))
+uint32_t classifyPacketsSse2(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets)
+{
+    const __m128i syncByte = _mm_set1_epi32(TS_SYNC_BYTE);
+    const __m128i syncMask = _mm_set1_epi32(HEADER_SYNC_MASK);
+    const uint8_t* packet = data;
+    uint32_t i = 0;
+    __m128i header;
+
+    for (i = 0; i + 4 <= numberOfPackets; i += 4, packet += 4 * TS_PACKET_SIZE)
+    {
+        /* SSE2 has no gather, headers one packet apart are interleaved from 32-bit loads */
+        header = _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32(_mm_cvtsi32_si128(loadHeader(packet)),
+                _mm_cvtsi32_si128(loadHeader(packet + TS_PACKET_SIZE))),
+            _mm_unpacklo_epi32(_mm_cvtsi32_si128(loadHeader(packet + 2 * TS_PACKET_SIZE)),
+                _mm_cvtsi32_si128(loadHeader(packet + 3 * TS_PACKET_SIZE))));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(header, syncMask), syncByte)) != 0xFFFF)
+        {
+            break;
+        }
+
+        _mm_storeu_si128((__m128i*)(packets + i), transformHeadersSse2(header));
+    }
+
+    /* tail and batch holding the lost sync */
+    return i + classifyPacketsScalar(data + i * TS_PACKET_SIZE, numberOfPackets - i, packets + i);
+}
+
+__attribute__((target("avx2")))
+uint32_t classifyPacketsAvx2(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets)
+{
+    const __m256i offsets = _mm256_setr_epi32(0, 1 * TS_PACKET_SIZE, 2 * TS_PACKET_SIZE,
+        3 * TS_PACKET_SIZE, 4 * TS_PACKET_SIZE, 5 * TS_PACKET_SIZE,
+        6 * TS_PACKET_SIZE, 7 * TS_PACKET_SIZE);
+    const __m256i syncByte = _mm256_set1_epi32(TS_SYNC_BYTE);
+    const __m256i syncMask = _mm256_set1_epi32(HEADER_SYNC_MASK);
+    uint32_t i = 0;
+    __m256i header;
+    __m256i nextHeader;
+
+    /* two independent gathers per round keep more header loads in flight */
+    for (i = 0; i + 16 <= numberOfPackets; i += 16)
+    {
+        header = _mm256_i32gather_epi32((const int*)(data + i * TS_PACKET_SIZE), offsets, 1);
+        nextHeader = _mm256_i32gather_epi32((const int*)(data + (i + 8) * TS_PACKET_SIZE), offsets, 1);
+
+        if (_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(header, syncMask), syncByte),
+            _mm256_cmpeq_epi32(_mm256_and_si256(nextHeader, syncMask), syncByte))) != -1)
+        {
+            break;
+        }
+
+        _mm256_storeu_si256((__m256i*)(packets + i), transformHeadersAvx2(header));
+        _mm256_storeu_si256((__m256i*)(packets + i + 8), transformHeadersAvx2(nextHeader));
+    }
+
+    for (; i + 8 <= numberOfPackets; i += 8)
+    {
+        header = _mm256_i32gather_epi32((const int*)(data + i * TS_PACKET_SIZE), offsets, 1);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(header, syncMask), syncByte)) != -1)
+        {
+            break;
+        }
+
+        _mm256_storeu_si256((__m256i*)(packets + i), transformHeadersAvx2(header));
+    }
+
+    return i + classifyPacketsScalar(data + i * TS_PACKET_SIZE, numberOfPackets - i, packets + i);
+}
+
+/* Compares 16 candidate offsets at once, a bit survives only if every confirmation position holds the sync byte */
+__attribute__((target("sse2")))
+int32_t findPacketSyncSse2(const uint8_t* data, uint32_t length)
+{
+    const __m128i syncByte = _mm_set1_epi8(TS_SYNC_BYTE);
+    uint32_t offset = 0;
+    uint32_t i = 0;
+    int32_t result = 0;
+    int mask = 0;
+
+    for (offset = 0; offset + 16 + SYNC_SPAN <= length; offset += 16)
+    {
+        mask = 0xFFFF;
+        for (i = 0; i < PACKET_CLASSIFIER_SYNC_CONFIRMATIONS && mask; i++)
+        {
+            mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_loadu_si128((const __m128i*)(data + offset + i * TS_PACKET_SIZE)), syncByte));
+        }
+
+        if (mask)
+        {
+            return (int32_t)offset + __builtin_ctz(mask);
+        }
+    }
+
+    result = findPacketSyncScalar(data + offset, length - offset);
+
+    return (result < 0) ? -1 : (int32_t)offset + result;
+}
+
+__attribute__((target("avx2")))
+int32_t findPacketSyncAvx2(const uint8_t* data, uint32_t length)
+{
+    const __m256i syncByte = _mm256_set1_epi8(TS_SYNC_BYTE);
+    uint32_t offset = 0;
+    uint32_t i = 0;
+    int32_t result = 0;
+    uint32_t mask = 0;
+
+    for (offset = 0; offset + 32 + SYNC_SPAN <= length; offset += 32)
+    {
+        mask = 0xFFFFFFFF;
+        for (i = 0; i < PACKET_CLASSIFIER_SYNC_CONFIRMATIONS && mask; i++)
+        {
+            mask &= (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i*)(data + offset + i * TS_PACKET_SIZE)), syncByte));
+        }
+
+        if (mask)
+        {
+            return (int32_t)offset + __builtin_ctz(mask);
+        }
+    }
+
+    result = findPacketSyncSse2(data + offset, length - offset);
+
+    return (result < 0) ? -1 : (int32_t)offset + result;
+}
+
+#endif /* PACKET_CLASSIFIER_X86 */
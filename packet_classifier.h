@@ -0,0 +1,91 @@
+#ifndef __PACKET_CLASSIFIER_H__
+#define __PACKET_CLASSIFIER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "ts_packet.h"
+
+#define PACKET_CLASSIFIER_SYNC_CONFIRMATIONS 5      /* Consecutive sync bytes needed to accept a packet boundary */
+
+#define PACKET_FLAG_PUSI 0x01                       /* payload_unit_start_indicator */
+#define PACKET_FLAG_TEI 0x02                        /* transport_error_indicator */
+#define PACKET_FLAG_PAYLOAD 0x04                    /* Packet carries payload */
+#define PACKET_FLAG_ADAPTATION 0x08                 /* Packet carries adaptation field */
+#define PACKET_FLAG_SCRAMBLING_MASK 0x30            /* transport_scrambling_control */
+
+/**
+ * @brief Enumeration of classification kernels
+ */
+typedef enum _PacketClassifierKernel
+{
+    PC_KERNEL_SCALAR = 0,
+    PC_KERNEL_SSE2,
+    PC_KERNEL_AVX2
+}PacketClassifierKernel;
+
+/**
+ * @brief Enumeration of possible packet classifier error codes
+ */
+typedef enum _PacketClassifierError
+{
+    PC_NO_ERROR = 0,
+    PC_ERROR
+}PacketClassifierError;
+
+/**
+ * @brief Structure that holds header fields of one packet, 4 bytes so kernels store it as one word
+ */
+typedef struct _ClassifiedPacket
+{
+    uint16_t pid;
+    uint8_t flags;                                  /* PACKET_FLAG_* */
+    uint8_t continuityCounter;
+}ClassifiedPacket;
+
+/**
+ * @brief Selects the fastest kernel supported by the CPU
+ *
+ * Called implicitly by the first classification, calling it again is harmless.
+ *
+ * @return selected kernel
+ */
+PacketClassifierKernel packetClassifierInit();
+
+/**
+ * @brief Forces use of the given kernel
+ *
+ * @param [in] kernel - kernel to use
+ * @return packet classifier error code, PC_ERROR if the CPU or build does not support the kernel
+ */
+PacketClassifierError packetClassifierSelect(PacketClassifierKernel kernel);
+
+/**
+ * @brief Returns kernel currently in use
+ *
+ * @return kernel in use
+ */
+PacketClassifierKernel packetClassifierGetKernel();
+
+/**
+ * @brief Extracts PID, flags and continuity counter from a batch of consecutive packets
+ *
+ * Classification stops at the first packet without the sync byte.
+ *
+ * @param [in] data - first byte of the first packet
+ * @param [in] numberOfPackets - number of packets in data
+ * @param [out] packets - array of at least numberOfPackets entries
+ * @return number of packets classified, less than numberOfPackets when sync is lost
+ */
+uint32_t classifyPackets(const uint8_t* data, uint32_t numberOfPackets, ClassifiedPacket* packets);
+
+/**
+ * @brief Finds first offset followed by PACKET_CLASSIFIER_SYNC_CONFIRMATIONS sync bytes spaced one packet apart
+ *
+ * @param [in] data - bytes to search
+ * @param [in] length - number of bytes in data
+ * @return offset of the packet boundary or -1 if none was found
+ */
+int32_t findPacketSync(const uint8_t* data, uint32_t length);
+
+#endif /* __PACKET_CLASSIFIER_H__ */
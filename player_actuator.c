@@ -0,0 +1,348 @@
+#include "player_actuator.h"
+#include "thread_policy.h"
+#include "time_service.h"
+
+/**
+ * @brief Structure that defines one queued player command
+ */
+typedef struct _PlayerCommand
+{
+    PlayerCommandType type;
+    uint8_t slot;
+    int16_t pid;
+    tStreamType streamType;
+    uint32_t volume;
+    uint32_t tag;
+}PlayerCommand;
+
+/**
+ * @brief Structure that holds stream created in one slot
+ */
+typedef struct _PlayerActuatorStream
+{
+    uint32_t handle;                                /* 0 if slot has no stream */
+    int16_t pid;
+    tStreamType streamType;
+}PlayerActuatorStream;
+
+struct _PlayerActuator
+{
+    uint32_t playerHandle;
+    uint32_t sourceHandle;
+    PlayerCommandCallback callback;
+    void* userData;
+
+    PlayerCommand queue[PLAYER_ACTUATOR_QUEUE_SIZE];
+    uint32_t queueHead;
+    uint32_t queueCount;
+    PlayerActuatorStream streams[PLAYER_ACTUATOR_MAX_STREAMS];   /* Touched by actuator thread only */
+    PlayerActuatorStatistics statistics;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t commandCond;
+    bool threadExit;
+};
+
+
+static void* actuatorTask(void* actuatorArgument);
+static PlayerActuatorError queueCommand(PlayerActuator* actuator, const PlayerCommand* command);
+static bool isSameTarget(const PlayerCommand* first, const PlayerCommand* second);
+static void executeCommand(PlayerActuator* actuator, const PlayerCommand* command, PlayerCommandResult* result);
+static void fillResult(const PlayerCommand* command, PlayerCommandStatus status, PlayerCommandResult* result);
+
+
+PlayerActuatorError playerActuatorCreate(uint32_t playerHandle, uint32_t sourceHandle, PlayerCommandCallback callback, void* userData,
+    PlayerActuator** actuator)
+{
+    PlayerActuator* newActuator = NULL;
+
+    if (actuator == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return PA_ERROR;
+    }
+
+    newActuator = (PlayerActuator*)malloc(sizeof(PlayerActuator));
+    if (newActuator == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return PA_ERROR;
+    }
+    memset(newActuator, 0x0, sizeof(PlayerActuator));
+
+    newActuator->playerHandle = playerHandle;
+    newActuator->sourceHandle = sourceHandle;
+    newActuator->callback = callback;
+    newActuator->userData = userData;
+    pthread_mutex_init(&newActuator->mutex, NULL);
+    pthread_cond_init(&newActuator->commandCond, NULL);
+
+    if (threadPolicyCreateThread(THREAD_ROLE_ZAP_CONTROL, &newActuator->thread, &actuatorTask, newActuator))
+    {
+        printf("\n%s : ERROR creating actuator task\n", __FUNCTION__);
+        pthread_cond_destroy(&newActuator->commandCond);
+        pthread_mutex_destroy(&newActuator->mutex);
+        free(newActuator);
+        return PA_THREAD_ERROR;
+    }
+
+    *actuator = newActuator;
+
+    return PA_NO_ERROR;
+}
+
+PlayerActuatorError playerActuatorDestroy(PlayerActuator* actuator)
+{
+    if (actuator == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return PA_ERROR;
+    }
+
+    /* thread empties the queue before it exits */
+    pthread_mutex_lock(&actuator->mutex);
+    actuator->threadExit = true;
+    pthread_cond_signal(&actuator->commandCond);
+    pthread_mutex_unlock(&actuator->mutex);
+
+    if (pthread_join(actuator->thread, NULL))
+    {
+        printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
+        return PA_THREAD_ERROR;
+    }
+
+    pthread_cond_destroy(&actuator->commandCond);
+    pthread_mutex_destroy(&actuator->mutex);
+    free(actuator);
+
+    return PA_NO_ERROR;
+}
+
+PlayerActuatorError playerActuatorSetVolume(PlayerActuator* actuator, uint32_t volume, uint32_t tag)
+{
+    PlayerCommand command;
+
+    memset(&command, 0x0, sizeof(PlayerCommand));
+    command.type = PLAYER_COMMAND_SET_VOLUME;
+    command.volume = volume;
+    command.tag = tag;
+
+    return queueCommand(actuator, &command);
+}
+
+PlayerActuatorError playerActuatorSetStream(PlayerActuator* actuator, uint8_t slot, int16_t pid, tStreamType streamType, uint32_t tag)
+{
+    PlayerCommand command;
+
+    memset(&command, 0x0, sizeof(PlayerCommand));
+    command.type = PLAYER_COMMAND_SET_STREAM;
+    command.slot = slot;
+    command.pid = pid;
+    command.streamType = streamType;
+    command.tag = tag;
+
+    return queueCommand(actuator, &command);
+}
+
+PlayerActuatorError playerActuatorRemoveStream(PlayerActuator* actuator, uint8_t slot, uint32_t tag)
+{
+    PlayerCommand command;
+
+    memset(&command, 0x0, sizeof(PlayerCommand));
+    command.type = PLAYER_COMMAND_REMOVE_STREAM;
+    command.slot = slot;
+    command.pid = -1;
+    command.tag = tag;
+
+    return queueCommand(actuator, &command);
+}
+
+PlayerActuatorError playerActuatorGetStatistics(PlayerActuator* actuator, PlayerActuatorStatistics* statistics)
+{
+    if (actuator == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return PA_ERROR;
+    }
+
+    pthread_mutex_lock(&actuator->mutex);
+    *statistics = actuator->statistics;
+    pthread_mutex_unlock(&actuator->mutex);
+
+    return PA_NO_ERROR;
+}
+
+/* Volume commands replace each other, stream commands replace commands of the same slot */
+bool isSameTarget(const PlayerCommand* first, const PlayerCommand* second)
+{
+    if (first->type == PLAYER_COMMAND_SET_VOLUME || second->type == PLAYER_COMMAND_SET_VOLUME)
+    {
+        return first->type == second->type;
+    }
+
+    return first->slot == second->slot;
+}
+
+PlayerActuatorError queueCommand(PlayerActuator* actuator, const PlayerCommand* command)
+{
+    PlayerCommand replacedCommand;
+    PlayerCommandResult result;
+    bool replaced = false;
+    uint32_t position = 0;
+    uint32_t i = 0;
+
+    if (actuator == NULL || (command->type != PLAYER_COMMAND_SET_VOLUME && command->slot >= PLAYER_ACTUATOR_MAX_STREAMS))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return PA_ERROR;
+    }
+
+    pthread_mutex_lock(&actuator->mutex);
+    actuator->statistics.queued++;
+
+    /* command that did not run yet is pointless once a newer one for the same target is queued */
+    for (i = 0; i < actuator->queueCount; i++)
+    {
+        position = (actuator->queueHead + i) % PLAYER_ACTUATOR_QUEUE_SIZE;
+        if (isSameTarget(&actuator->queue[position], command))
+        {
+            replacedCommand = actuator->queue[position];
+            actuator->queue[position] = *command;
+            actuator->statistics.coalesced++;
+            replaced = true;
+            break;
+        }
+    }
+
+    if (!replaced)
+    {
+        if (actuator->queueCount == PLAYER_ACTUATOR_QUEUE_SIZE)
+        {
+            pthread_mutex_unlock(&actuator->mutex);
+            printf("\n%s : ERROR player command queue is full\n", __FUNCTION__);
+            return PA_ERROR;
+        }
+        actuator->queue[(actuator->queueHead + actuator->queueCount) % PLAYER_ACTUATOR_QUEUE_SIZE] = *command;
+        actuator->queueCount++;
+        pthread_cond_signal(&actuator->commandCond);
+    }
+    pthread_mutex_unlock(&actuator->mutex);
+
+    if (replaced && actuator->callback != NULL)
+    {
+        fillResult(&replacedCommand, PLAYER_COMMAND_COALESCED, &result);
+        actuator->callback(&result, actuator->userData);
+    }
+
+    return PA_NO_ERROR;
+}
+
+void* actuatorTask(void* actuatorArgument)
+{
+    PlayerActuator* actuator = (PlayerActuator*)actuatorArgument;
+    PlayerCommand command;
+    PlayerCommandResult result;
+
+    pthread_mutex_lock(&actuator->mutex);
+    while (true)
+    {
+        if (actuator->queueCount == 0)
+        {
+            if (actuator->threadExit)
+            {
+                break;
+            }
+            pthread_cond_wait(&actuator->commandCond, &actuator->mutex);
+            continue;
+        }
+
+        command = actuator->queue[actuator->queueHead];
+        actuator->queueHead = (actuator->queueHead + 1) % PLAYER_ACTUATOR_QUEUE_SIZE;
+        actuator->queueCount--;
+        pthread_mutex_unlock(&actuator->mutex);
+
+        /* driver calls run without the lock, so queueing never waits for them */
+        executeCommand(actuator, &command, &result);
+        if (actuator->callback != NULL)
+        {
+            actuator->callback(&result, actuator->userData);
+        }
+
+        pthread_mutex_lock(&actuator->mutex);
+        actuator->statistics.executed++;
+        if (result.status == PLAYER_COMMAND_UNCHANGED)
+        {
+            actuator->statistics.unchanged++;
+        }
+        else if (result.status == PLAYER_COMMAND_FAILED)
+        {
+            actuator->statistics.failed++;
+        }
+    }
+    pthread_mutex_unlock(&actuator->mutex);
+
+    return NULL;
+}
+
+void executeCommand(PlayerActuator* actuator, const PlayerCommand* command, PlayerCommandResult* result)
+{
+    PlayerActuatorStream* stream = &actuator->streams[command->slot];
+    uint64_t gapStartTime = 0;
+
+    fillResult(command, PLAYER_COMMAND_DONE, result);
+
+    if (command->type == PLAYER_COMMAND_SET_VOLUME)
+    {
+        if (Player_Volume_Set(actuator->playerHandle, command->volume))
+        {
+            printf("\n%s : ERROR Player_Volume_Set() fail\n", __FUNCTION__);
+            result->status = PLAYER_COMMAND_FAILED;
+        }
+        return;
+    }
+
+    /* player API can not retarget a running stream, decoder is kept only if nothing changes */
+    if (command->type == PLAYER_COMMAND_SET_STREAM && stream->handle != 0
+        && stream->pid == command->pid && stream->streamType == command->streamType)
+    {
+        result->status = PLAYER_COMMAND_UNCHANGED;
+        return;
+    }
+
+    gapStartTime = monotonicMicroseconds();
+    if (stream->handle != 0)
+    {
+        Player_Stream_Remove(actuator->playerHandle, actuator->sourceHandle, stream->handle);
+        stream->handle = 0;
+        stream->pid = -1;
+    }
+
+    if (command->type == PLAYER_COMMAND_REMOVE_STREAM || command->pid < 0)
+    {
+        return;
+    }
+
+    if (Player_Stream_Create(actuator->playerHandle, actuator->sourceHandle, command->pid, command->streamType, &stream->handle))
+    {
+        printf("\n%s : ERROR Cannot create stream on pid %d\n", __FUNCTION__, command->pid);
+        stream->handle = 0;
+        result->status = PLAYER_COMMAND_FAILED;
+        return;
+    }
+    stream->pid = command->pid;
+    stream->streamType = command->streamType;
+
+    result->gap = (uint32_t)(monotonicMicroseconds() - gapStartTime);
+}
+
+void fillResult(const PlayerCommand* command, PlayerCommandStatus status, PlayerCommandResult* result)
+{
+    memset(result, 0x0, sizeof(PlayerCommandResult));
+    result->type = command->type;
+    result->status = status;
+    result->slot = command->slot;
+    result->pid = command->pid;
+    result->volume = command->volume;
+    result->tag = command->tag;
+}
@@ -0,0 +1,150 @@
+#ifndef __PLAYER_ACTUATOR_H__
+#define __PLAYER_ACTUATOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "pthread.h"
+#include "tdp_api.h"
+
+#define PLAYER_ACTUATOR_MAX_STREAMS 4               /* Number of stream slots of one actuator */
+#define PLAYER_ACTUATOR_QUEUE_SIZE 16               /* Coalescing keeps at most one command per slot and one volume command queued */
+
+/**
+ * @brief Enumeration of possible player actuator error codes
+ */
+typedef enum _PlayerActuatorError
+{
+    PA_NO_ERROR = 0,
+    PA_ERROR,
+    PA_THREAD_ERROR
+}PlayerActuatorError;
+
+/**
+ * @brief Enumeration of player commands
+ */
+typedef enum _PlayerCommandType
+{
+    PLAYER_COMMAND_SET_VOLUME = 0,
+    PLAYER_COMMAND_SET_STREAM,                      /* Make slot decode pid, creating or replacing its stream */
+    PLAYER_COMMAND_REMOVE_STREAM                    /* Remove stream of slot */
+}PlayerCommandType;
+
+/**
+ * @brief Enumeration of player command outcomes
+ */
+typedef enum _PlayerCommandStatus
+{
+    PLAYER_COMMAND_DONE = 0,
+    PLAYER_COMMAND_FAILED,                          /* Driver returned error */
+    PLAYER_COMMAND_UNCHANGED,                       /* Slot already decoded the same pid and type, decoder was kept */
+    PLAYER_COMMAND_COALESCED                        /* Replaced by a later command of the same slot before it ran */
+}PlayerCommandStatus;
+
+/**
+ * @brief Structure that describes completed player command
+ */
+typedef struct _PlayerCommandResult
+{
+    PlayerCommandType type;
+    PlayerCommandStatus status;
+    uint8_t slot;
+    int16_t pid;
+    uint32_t volume;
+    uint32_t tag;                                   /* Value given when the command was queued */
+    uint32_t gap;                                   /* Microseconds slot decoded nothing while stream was replaced */
+}PlayerCommandResult;
+
+/**
+ * @brief Structure that holds actuator counters
+ */
+typedef struct _PlayerActuatorStatistics
+{
+    uint32_t queued;
+    uint32_t executed;
+    uint32_t coalesced;
+    uint32_t unchanged;
+    uint32_t failed;
+}PlayerActuatorStatistics;
+
+/**
+ * @brief Command completion callback
+ *
+ * Called from the actuator thread once command ran, or from the queueing thread when command
+ * was coalesced away, it must not block.
+ */
+typedef void(*PlayerCommandCallback)(const PlayerCommandResult* result, void* userData);
+
+/**
+ * @brief Player actuator, runs player driver calls on its own thread
+ */
+typedef struct _PlayerActuator PlayerActuator;
+
+/**
+ * @brief Creates actuator and starts its thread
+ *
+ * @param [in] playerHandle - initialized player
+ * @param [in] sourceHandle - opened player source streams are created on
+ * @param [in] callback - called for every command, can be NULL
+ * @param [in] userData - passed to callback
+ * @param [out] actuator - created actuator
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorCreate(uint32_t playerHandle, uint32_t sourceHandle, PlayerCommandCallback callback, void* userData,
+    PlayerActuator** actuator);
+
+/**
+ * @brief Runs all queued commands, stops actuator thread and frees actuator
+ *
+ * Streams that are still created are left to the caller, queue their removal before destroying.
+ *
+ * @param [in] actuator - actuator to destroy
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorDestroy(PlayerActuator* actuator);
+
+/**
+ * @brief Queues volume change, replaces volume change that did not run yet
+ *
+ * @param [in] actuator - player actuator
+ * @param [in] volume - value passed to Player_Volume_Set
+ * @param [in] tag - returned in command result
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorSetVolume(PlayerActuator* actuator, uint32_t volume, uint32_t tag);
+
+/**
+ * @brief Queues change of slot to decode pid, replaces command of the same slot that did not run yet
+ *
+ * @param [in] actuator - player actuator
+ * @param [in] slot - stream slot, 0 to PLAYER_ACTUATOR_MAX_STREAMS - 1
+ * @param [in] pid - pid to decode, -1 only removes slot stream
+ * @param [in] streamType - stream type of pid
+ * @param [in] tag - returned in command result
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorSetStream(PlayerActuator* actuator, uint8_t slot, int16_t pid, tStreamType streamType, uint32_t tag);
+
+/**
+ * @brief Queues removal of slot stream, replaces command of the same slot that did not run yet
+ *
+ * @param [in] actuator - player actuator
+ * @param [in] slot - stream slot
+ * @param [in] tag - returned in command result
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorRemoveStream(PlayerActuator* actuator, uint8_t slot, uint32_t tag);
+
+/**
+ * @brief Returns actuator counters
+ *
+ * @param [in] actuator - player actuator
+ * @param [out] statistics - counters
+ * @return player actuator error code
+ */
+PlayerActuatorError playerActuatorGetStatistics(PlayerActuator* actuator, PlayerActuatorStatistics* statistics);
+
+#endif /* __PLAYER_ACTUATOR_H__ */
@@ -1,4 +1,6 @@
 #include "remote_controller.h"
+#include "thread_policy.h"
+#include <time.h>
 
 static int32_t inputFileDesc;
 static void* inputEventTask();
@@ -6,11 +8,12 @@ static int32_t getKey(uint8_t* buf);
 static pthread_t remote;
 static uint8_t threadExit = 0;
 static RemoteControllerCallback callback = NULL;
+static uint64_t eventTime = 0;
 
 RemoteControllerError remoteControllerInit()
 {
     /* handle input events in background process*/
-    if (pthread_create(&remote, NULL, &inputEventTask, NULL))
+    if (threadPolicyCreateThread(THREAD_ROLE_INPUT, &remote, &inputEventTask, NULL))
     {
         printf("Error creating input event task!\n");
         return RC_THREAD_ERROR;
@@ -53,12 +56,26 @@ RemoteControllerError unregisterRemoteControllerCallback()
     return RC_NO_ERROR;
 }
 
+RemoteControllerError remoteControllerGetEventTime(uint64_t* time)
+{
+    if (time == NULL)
+    {
+        printf("Error wrong parameter!\n");
+        return RC_ERROR;
+    }
+
+    *time = eventTime;
+
+    return RC_NO_ERROR;
+}
+
 void* inputEventTask()
 {
     char deviceName[20];
     struct input_event eventBuf;
     int32_t counter = 0;
     const char* dev = "/dev/input/event0";
+    int32_t clockId = CLOCK_MONOTONIC;
     
     inputFileDesc = open(dev, O_RDWR);
     if(inputFileDesc == -1)
@@ -70,6 +87,13 @@ void* inputEventTask()
     /* get the name of input device */
     ioctl(inputFileDesc, EVIOCGNAME(sizeof(deviceName)), deviceName);
     printf("RC device opened succesfully [%s]\n", deviceName);
+
+    /* event times are compared with monotonic time of the zap */
+    if (ioctl(inputFileDesc, EVIOCSCLOCKID, &clockId) < 0)
+    {
+        printf("Event clock can not be set, key times are not available!\n");
+        clockId = -1;
+    }
         
     while(!threadExit)
     {
@@ -92,6 +116,7 @@ void* inputEventTask()
             printf("Event value: %d\n",eventBuf.value);
             printf("\n");
             
+            eventTime = (clockId == -1) ? 0 : (uint64_t)eventBuf.time.tv_sec * 1000000 + eventBuf.time.tv_usec;
             callback(eventBuf.code, eventBuf.type, eventBuf.value);  
         }
     }
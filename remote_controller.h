@@ -77,4 +77,12 @@ RemoteControllerError registerRemoteControllerCallback(RemoteControllerCallback
  */
 RemoteControllerError unregisterRemoteControllerCallback();
 
+/*
+ * @brief Returns time of the key event the callback is called for, valid only inside the callback
+ *
+ * @param  [out] time - monotonic microseconds of key event, 0 if input device does not report monotonic time
+ * @return remote controller error code
+ */
+RemoteControllerError remoteControllerGetEventTime(uint64_t* time);
+
 #endif /* __REMOTE_CONTROLLER_H__ */
\ No newline at end of file
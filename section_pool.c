@@ -0,0 +1,221 @@
+#include "section_pool.h"
+
+/**
+ * @brief Structure that defines one size class slab and its freelist
+ */
+typedef struct _SectionSizeClass
+{
+    uint32_t bufferSize;
+    uint32_t numberOfBuffers;
+    SectionBuffer* headers;
+    uint8_t* slab;
+    SectionBuffer* freeList;
+    pthread_mutex_t freeListMutex;
+    volatile uint32_t buffersInUse;
+    volatile uint32_t highWaterMark;
+    volatile uint32_t failedAcquires;
+}SectionSizeClass;
+
+/* PSI sections are at most 1024 bytes, private (EIT, SDT...) sections at most 4096 bytes.
+   A table may have 256 sections, the table assembler leaves TABLE_ASSEMBLER_POOL_RESERVE
+   buffers of each class free instead of sizing the classes for that. */
+static SectionSizeClass sizeClasses[SECTION_POOL_NUMBER_OF_CLASSES] =
+{
+    { .bufferSize = 256,  .numberOfBuffers = 64 },
+    { .bufferSize = 1024, .numberOfBuffers = 32 },
+    { .bufferSize = 4096, .numberOfBuffers = 16 }
+};
+
+static bool isInitialized = false;
+
+
+static void updateHighWaterMark(SectionSizeClass* sizeClass, uint32_t inUse)
+{
+    uint32_t highWaterMark = sizeClass->highWaterMark;
+
+    while (inUse > highWaterMark)
+    {
+        if (__sync_bool_compare_and_swap(&sizeClass->highWaterMark, highWaterMark, inUse))
+        {
+            break;
+        }
+        highWaterMark = sizeClass->highWaterMark;
+    }
+}
+
+SectionPoolError sectionPoolInit()
+{
+    uint8_t i = 0;
+    uint32_t j = 0;
+
+    if (isInitialized)
+    {
+        return SP_NO_ERROR;
+    }
+
+    for (i = 0; i < SECTION_POOL_NUMBER_OF_CLASSES; i++)
+    {
+        SectionSizeClass* sizeClass = &sizeClasses[i];
+
+        sizeClass->headers = (SectionBuffer*)malloc(sizeClass->numberOfBuffers * sizeof(SectionBuffer));
+        sizeClass->slab = (uint8_t*)malloc(sizeClass->numberOfBuffers * sizeClass->bufferSize);
+        if (sizeClass->headers == NULL || sizeClass->slab == NULL)
+        {
+            printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+            free(sizeClass->headers);
+            free(sizeClass->slab);
+            sizeClass->headers = NULL;
+            sizeClass->slab = NULL;
+            isInitialized = true;
+            sectionPoolDeinit();
+            return SP_ERROR;
+        }
+
+        /* chain all buffers of the class into its freelist */
+        sizeClass->freeList = NULL;
+        for (j = sizeClass->numberOfBuffers; j > 0; j--)
+        {
+            SectionBuffer* buffer = &sizeClass->headers[j - 1];
+
+            buffer->data = sizeClass->slab + (j - 1) * sizeClass->bufferSize;
+            buffer->size = sizeClass->bufferSize;
+            buffer->length = 0;
+            buffer->refCount = 0;
+            buffer->sizeClass = i;
+            buffer->next = sizeClass->freeList;
+            sizeClass->freeList = buffer;
+        }
+
+        pthread_mutex_init(&sizeClass->freeListMutex, NULL);
+        sizeClass->buffersInUse = 0;
+        sizeClass->highWaterMark = 0;
+        sizeClass->failedAcquires = 0;
+    }
+
+    isInitialized = true;
+
+    return SP_NO_ERROR;
+}
+
+SectionPoolError sectionPoolDeinit()
+{
+    uint8_t i = 0;
+
+    if (!isInitialized)
+    {
+        return SP_ERROR;
+    }
+
+    for (i = 0; i < SECTION_POOL_NUMBER_OF_CLASSES; i++)
+    {
+        if (sizeClasses[i].headers != NULL)
+        {
+            pthread_mutex_destroy(&sizeClasses[i].freeListMutex);
+        }
+
+        free(sizeClasses[i].headers);
+        free(sizeClasses[i].slab);
+        sizeClasses[i].headers = NULL;
+        sizeClasses[i].slab = NULL;
+        sizeClasses[i].freeList = NULL;
+    }
+
+    isInitialized = false;
+
+    return SP_NO_ERROR;
+}
+
+SectionBuffer* sectionBufferAcquire(uint32_t length)
+{
+    uint8_t i = 0;
+
+    if (!isInitialized)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < SECTION_POOL_NUMBER_OF_CLASSES; i++)
+    {
+        SectionSizeClass* sizeClass = &sizeClasses[i];
+        SectionBuffer* buffer = NULL;
+
+        if (length > sizeClass->bufferSize)
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&sizeClass->freeListMutex);
+        buffer = sizeClass->freeList;
+        if (buffer != NULL)
+        {
+            sizeClass->freeList = buffer->next;
+        }
+        pthread_mutex_unlock(&sizeClass->freeListMutex);
+
+        if (buffer == NULL)
+        {
+            /* class exhausted, fall through to the next bigger class */
+            __sync_fetch_and_add(&sizeClass->failedAcquires, 1);
+            continue;
+        }
+
+        buffer->next = NULL;
+        buffer->length = length;
+        buffer->refCount = 1;
+        updateHighWaterMark(sizeClass, __sync_add_and_fetch(&sizeClass->buffersInUse, 1));
+
+        return buffer;
+    }
+
+    return NULL;
+}
+
+void sectionBufferRetain(SectionBuffer* buffer)
+{
+    if (buffer != NULL)
+    {
+        __sync_fetch_and_add(&buffer->refCount, 1);
+    }
+}
+
+void sectionBufferRelease(SectionBuffer* buffer)
+{
+    SectionSizeClass* sizeClass = NULL;
+
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    if (__sync_sub_and_fetch(&buffer->refCount, 1) != 0)
+    {
+        return;
+    }
+
+    /* last user dropped the buffer, return it to its class */
+    sizeClass = &sizeClasses[buffer->sizeClass];
+
+    pthread_mutex_lock(&sizeClass->freeListMutex);
+    buffer->next = sizeClass->freeList;
+    sizeClass->freeList = buffer;
+    pthread_mutex_unlock(&sizeClass->freeListMutex);
+
+    __sync_fetch_and_sub(&sizeClass->buffersInUse, 1);
+}
+
+SectionPoolError sectionPoolGetStatistics(uint8_t sizeClass, SectionPoolStatistics* statistics)
+{
+    if (sizeClass >= SECTION_POOL_NUMBER_OF_CLASSES || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SP_ERROR;
+    }
+
+    statistics->bufferSize = sizeClasses[sizeClass].bufferSize;
+    statistics->totalBuffers = sizeClasses[sizeClass].numberOfBuffers;
+    statistics->buffersInUse = sizeClasses[sizeClass].buffersInUse;
+    statistics->highWaterMark = sizeClasses[sizeClass].highWaterMark;
+    statistics->failedAcquires = sizeClasses[sizeClass].failedAcquires;
+
+    return SP_NO_ERROR;
+}
@@ -0,0 +1,94 @@
+#ifndef __SECTION_POOL_H__
+#define __SECTION_POOL_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define SECTION_POOL_NUMBER_OF_CLASSES 3        /* Number of buffer size classes in the pool */
+
+/**
+ * @brief Enumeration of possible section pool error codes
+ */
+typedef enum _SectionPoolError
+{
+    SP_NO_ERROR = 0,
+    SP_ERROR
+}SectionPoolError;
+
+/**
+ * @brief Structure that defines single pooled section buffer
+ */
+typedef struct _SectionBuffer
+{
+    uint8_t* data;                              /* Section bytes, owned by the pool */
+    uint32_t size;                              /* Capacity of data in bytes */
+    uint32_t length;                            /* Number of valid bytes in data */
+    volatile int32_t refCount;                  /* Number of users holding this buffer */
+    uint8_t sizeClass;                          /* Index of the size class buffer belongs to */
+    struct _SectionBuffer* next;                /* Next free buffer in the size class freelist */
+}SectionBuffer;
+
+/**
+ * @brief Structure that holds usage statistics of one size class
+ */
+typedef struct _SectionPoolStatistics
+{
+    uint32_t bufferSize;                        /* Capacity of each buffer in the class */
+    uint32_t totalBuffers;                      /* Number of buffers in the class slab */
+    uint32_t buffersInUse;                      /* Number of buffers currently acquired */
+    uint32_t highWaterMark;                     /* Max number of buffers acquired at the same time */
+    uint32_t failedAcquires;                    /* Number of acquires that found the class empty */
+}SectionPoolStatistics;
+
+/**
+ * @brief Allocates slabs for all size classes
+ *
+ * @return section pool error code
+ */
+SectionPoolError sectionPoolInit();
+
+/**
+ * @brief Frees all slabs, buffers still referenced become invalid
+ *
+ * @return section pool error code
+ */
+SectionPoolError sectionPoolDeinit();
+
+/**
+ * @brief Takes a free buffer from the smallest size class that fits length
+ *
+ * Returned buffer has reference count of one and length set to the requested length.
+ *
+ * @param [in] length - number of bytes buffer has to hold
+ * @return pointer to buffer, NULL if no buffer is available
+ */
+SectionBuffer* sectionBufferAcquire(uint32_t length);
+
+/**
+ * @brief Adds one reference to the buffer
+ *
+ * @param [in] buffer - buffer to be shared
+ */
+void sectionBufferRetain(SectionBuffer* buffer);
+
+/**
+ * @brief Drops one reference, buffer returns to the pool when the last one is dropped
+ *
+ * @param [in] buffer - buffer to be released
+ */
+void sectionBufferRelease(SectionBuffer* buffer);
+
+/**
+ * @brief Returns usage statistics of one size class
+ *
+ * @param [in]  sizeClass - index of size class
+ * @param [out] statistics - usage statistics of the class
+ * @return section pool error code
+ */
+SectionPoolError sectionPoolGetStatistics(uint8_t sizeClass, SectionPoolStatistics* statistics);
+
+#endif /* __SECTION_POOL_H__ */
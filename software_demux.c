@@ -0,0 +1,372 @@
+#include "software_demux.h"
+#include "tables_fields.h"
+
+#define NO_SECTION_FILTER 0xFF
+
+/**
+ * @brief Structure that collects sections of one PID
+ */
+typedef struct _SectionFilter
+{
+    uint16_t pid;
+    uint16_t collected;
+    uint16_t expected;
+    uint8_t active;
+    uint8_t lastContinuityCounter;
+    uint8_t continuityValid;
+    uint8_t buffer[TABLES_MAX_SECTION_SIZE];
+}SectionFilter;
+
+struct _SoftwareDemux
+{
+    uint64_t pidPacketCounts[SOFTWARE_DEMUX_NUMBER_OF_PIDS];
+    uint8_t pidFilters[SOFTWARE_DEMUX_NUMBER_OF_PIDS];      /* Index of section filter for each PID */
+    SectionFilter filters[SOFTWARE_DEMUX_MAX_SECTION_FILTERS];
+    uint8_t numberOfFilters;
+
+    ClassifiedPacket classified[SOFTWARE_DEMUX_BATCH_SIZE];
+    SoftwareDemuxStatistics statistics;
+
+    DemuxSectionCallback sectionCallback;
+    void* userData;
+    uint64_t packetOffset;                                  /* Stream offset of the packet being handled */
+    uint8_t draining;                                       /* Only sections already started are collected */
+};
+
+
+static void processPackets(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset);
+static uint8_t sectionsPending(SoftwareDemux* demux);
+static void filterPacket(SoftwareDemux* demux, SectionFilter* filter, const uint8_t* packet, const ClassifiedPacket* header);
+static void collectSectionBytes(SoftwareDemux* demux, SectionFilter* filter, const uint8_t* data, uint32_t length);
+
+
+SoftwareDemuxError softwareDemuxCreate(SoftwareDemux** demux, DemuxSectionCallback sectionCallback, void* userData)
+{
+    SoftwareDemux* newDemux = NULL;
+
+    if (demux == NULL || sectionCallback == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    newDemux = (SoftwareDemux*)malloc(sizeof(SoftwareDemux));
+    if (newDemux == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+    memset(newDemux, 0x0, sizeof(SoftwareDemux));
+    memset(newDemux->pidFilters, NO_SECTION_FILTER, sizeof(newDemux->pidFilters));
+
+    newDemux->sectionCallback = sectionCallback;
+    newDemux->userData = userData;
+
+    *demux = newDemux;
+
+    return SD_NO_ERROR;
+}
+
+SoftwareDemuxError softwareDemuxDestroy(SoftwareDemux* demux)
+{
+    if (demux == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    free(demux);
+
+    return SD_NO_ERROR;
+}
+
+SoftwareDemuxError softwareDemuxAddSectionFilter(SoftwareDemux* demux, uint16_t pid)
+{
+    SectionFilter* filter = NULL;
+
+    if (demux == NULL || pid >= SOFTWARE_DEMUX_NUMBER_OF_PIDS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    if (demux->pidFilters[pid] != NO_SECTION_FILTER)
+    {
+        return SD_NO_ERROR;
+    }
+
+    if (demux->numberOfFilters == SOFTWARE_DEMUX_MAX_SECTION_FILTERS)
+    {
+        printf("\n%s : ERROR no free section filter for PID %d\n", __FUNCTION__, pid);
+        return SD_ERROR;
+    }
+
+    filter = &demux->filters[demux->numberOfFilters];
+    filter->pid = pid;
+    filter->active = 0;
+    filter->continuityValid = 0;
+    demux->pidFilters[pid] = demux->numberOfFilters;
+    demux->numberOfFilters++;
+
+    return SD_NO_ERROR;
+}
+
+SoftwareDemuxError softwareDemuxReset(SoftwareDemux* demux)
+{
+    uint8_t i = 0;
+
+    if (demux == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    for (i = 0; i < demux->numberOfFilters; i++)
+    {
+        demux->pidFilters[demux->filters[i].pid] = NO_SECTION_FILTER;
+    }
+    demux->numberOfFilters = 0;
+
+    return SD_NO_ERROR;
+}
+
+SoftwareDemuxError softwareDemuxProcess(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset)
+{
+    if (demux == NULL || data == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    processPackets(demux, data, length, streamOffset);
+
+    return SD_NO_ERROR;
+}
+
+SoftwareDemuxError softwareDemuxDrain(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset)
+{
+    if (demux == NULL || data == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    demux->draining = 1;
+    processPackets(demux, data, length, streamOffset);
+    demux->draining = 0;
+
+    return SD_NO_ERROR;
+}
+
+void processPackets(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset)
+{
+    uint64_t position = 0;
+    uint64_t remainingPackets = 0;
+    uint32_t batchSize = 0;
+    uint32_t classifiedCount = 0;
+    uint32_t i = 0;
+    int32_t syncOffset = 0;
+    const ClassifiedPacket* header = NULL;
+
+    while (position + TS_PACKET_SIZE <= length)
+    {
+        if (demux->draining && !sectionsPending(demux))
+        {
+            return;
+        }
+
+        remainingPackets = (length - position) / TS_PACKET_SIZE;
+        batchSize = (remainingPackets < SOFTWARE_DEMUX_BATCH_SIZE) ? (uint32_t)remainingPackets : SOFTWARE_DEMUX_BATCH_SIZE;
+        classifiedCount = classifyPackets(data + position, batchSize, demux->classified);
+
+        for (i = 0; i < classifiedCount; i++)
+        {
+            header = &demux->classified[i];
+
+            /* packets read while draining belong to the next part of the stream, they are counted there */
+            if (!demux->draining)
+            {
+                demux->pidPacketCounts[header->pid]++;
+            }
+
+            if (demux->pidFilters[header->pid] != NO_SECTION_FILTER)
+            {
+                demux->packetOffset = streamOffset + position + (uint64_t)i * TS_PACKET_SIZE;
+                filterPacket(demux, &demux->filters[demux->pidFilters[header->pid]],
+                    data + position + (uint64_t)i * TS_PACKET_SIZE, header);
+            }
+        }
+
+        if (!demux->draining)
+        {
+            demux->statistics.totalPackets += classifiedCount;
+        }
+        position += (uint64_t)classifiedCount * TS_PACKET_SIZE;
+
+        if (classifiedCount < batchSize)
+        {
+            /* sync lost, partially collected sections can not be completed */
+            if (demux->draining)
+            {
+                return;
+            }
+            demux->statistics.syncLosses++;
+            for (i = 0; i < demux->numberOfFilters; i++)
+            {
+                demux->filters[i].active = 0;
+                demux->filters[i].continuityValid = 0;
+            }
+
+            syncOffset = findPacketSync(data + position + 1, (length - position - 1 > INT32_MAX) ? INT32_MAX : (uint32_t)(length - position - 1));
+            if (syncOffset < 0)
+            {
+                break;
+            }
+            position += 1 + syncOffset;
+        }
+    }
+}
+
+uint8_t sectionsPending(SoftwareDemux* demux)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < demux->numberOfFilters; i++)
+    {
+        if (demux->filters[i].active)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+uint64_t softwareDemuxGetPidPacketCount(SoftwareDemux* demux, uint16_t pid)
+{
+    if (demux == NULL || pid >= SOFTWARE_DEMUX_NUMBER_OF_PIDS)
+    {
+        return 0;
+    }
+
+    return demux->pidPacketCounts[pid];
+}
+
+SoftwareDemuxError softwareDemuxGetStatistics(SoftwareDemux* demux, SoftwareDemuxStatistics* statistics)
+{
+    if (demux == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SD_ERROR;
+    }
+
+    *statistics = demux->statistics;
+
+    return SD_NO_ERROR;
+}
+
+void filterPacket(SoftwareDemux* demux, SectionFilter* filter, const uint8_t* packet, const ClassifiedPacket* header)
+{
+    const uint8_t* payload = packet + 4;
+    uint32_t payloadLength = 0;
+    uint8_t pointerField = 0;
+
+    if ((header->flags & PACKET_FLAG_TEI) || !(header->flags & PACKET_FLAG_PAYLOAD))
+    {
+        return;
+    }
+
+    /* a gap in continuity counters means section bytes are missing */
+    if (filter->continuityValid && header->continuityCounter != ((filter->lastContinuityCounter + 1) & 0x0F))
+    {
+        if (header->continuityCounter == filter->lastContinuityCounter)
+        {
+            /* duplicate packet */
+            return;
+        }
+        if (!demux->draining)
+        {
+            demux->statistics.continuityErrors++;
+        }
+        if (filter->active)
+        {
+            demux->statistics.droppedSections++;
+            filter->active = 0;
+        }
+    }
+    filter->lastContinuityCounter = header->continuityCounter;
+    filter->continuityValid = 1;
+
+    if (header->flags & PACKET_FLAG_ADAPTATION)
+    {
+        payload += packet[4] + 1;
+    }
+    if (payload >= packet + TS_PACKET_SIZE)
+    {
+        return;
+    }
+    payloadLength = (uint32_t)(packet + TS_PACKET_SIZE - payload);
+
+    if (header->flags & PACKET_FLAG_PUSI)
+    {
+        pointerField = payload[0];
+        payload++;
+        payloadLength--;
+        if (pointerField >= payloadLength)
+        {
+            filter->active = 0;
+            return;
+        }
+
+        /* end of the previous section precedes the pointed one */
+        collectSectionBytes(demux, filter, payload, pointerField);
+
+        filter->active = !demux->draining && (payload[pointerField] != 0xFF);
+        filter->collected = 0;
+        filter->expected = 0;
+        collectSectionBytes(demux, filter, payload + pointerField, payloadLength - pointerField);
+    }
+    else
+    {
+        collectSectionBytes(demux, filter, payload, payloadLength);
+    }
+}
+
+void collectSectionBytes(SoftwareDemux* demux, SectionFilter* filter, const uint8_t* data, uint32_t length)
+{
+    uint32_t copyLength = 0;
+
+    while (length > 0 && filter->active)
+    {
+        copyLength = (filter->expected == 0) ? SECTION_LENGTH_OFFSET - filter->collected : filter->expected - filter->collected;
+        if (copyLength > length)
+        {
+            copyLength = length;
+        }
+        memcpy(filter->buffer + filter->collected, data, copyLength);
+        filter->collected += copyLength;
+        data += copyLength;
+        length -= copyLength;
+
+        if (filter->expected == 0 && filter->collected == SECTION_LENGTH_OFFSET)
+        {
+            filter->expected = SECTION_LENGTH_OFFSET + (TABLES_LOAD_2(filter->buffer, 1) & 0x0FFF);
+            if (filter->expected > TABLES_MAX_SECTION_SIZE)
+            {
+                demux->statistics.droppedSections++;
+                filter->active = 0;
+                return;
+            }
+        }
+
+        if (filter->expected != 0 && filter->collected == filter->expected)
+        {
+            demux->sectionCallback(filter->buffer, filter->collected, filter->pid, demux->packetOffset, demux->userData);
+
+            /* another section may follow directly, 0xFF starts stuffing */
+            filter->collected = 0;
+            filter->expected = 0;
+            filter->active = !demux->draining && (length > 0 && data[0] != 0xFF);
+        }
+    }
+}
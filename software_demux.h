@@ -0,0 +1,132 @@
+#ifndef __SOFTWARE_DEMUX_H__
+#define __SOFTWARE_DEMUX_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tables.h"
+#include "packet_classifier.h"
+
+#define SOFTWARE_DEMUX_NUMBER_OF_PIDS 8192          /* Number of different PIDs in a transport stream */
+#define SOFTWARE_DEMUX_MAX_SECTION_FILTERS 32       /* Max number of PIDs sections are collected from */
+#define SOFTWARE_DEMUX_BATCH_SIZE 256               /* Number of packets classified at once */
+
+/**
+ * @brief Enumeration of possible software demux error codes
+ */
+typedef enum _SoftwareDemuxError
+{
+    SD_NO_ERROR = 0,
+    SD_ERROR
+}SoftwareDemuxError;
+
+/**
+ * @brief Section callback, called for every complete section on a filtered PID
+ *
+ * @param [in] section - section bytes, valid only during the call
+ * @param [in] length - number of bytes in section
+ * @param [in] pid - PID section arrived on
+ * @param [in] streamOffset - stream offset of the packet that completed the section
+ * @param [in] userData - user data given at demux creation
+ */
+typedef void(*DemuxSectionCallback)(const uint8_t* section, uint32_t length, uint16_t pid, uint64_t streamOffset, void* userData);
+
+/**
+ * @brief Structure that holds counters of the demux
+ */
+typedef struct _SoftwareDemuxStatistics
+{
+    uint64_t totalPackets;                          /* Number of packets demultiplexed */
+    uint32_t syncLosses;                            /* Number of times sync byte was not found where expected */
+    uint32_t continuityErrors;                      /* Continuity errors on filtered PIDs */
+    uint32_t droppedSections;                       /* Sections dropped because of continuity errors or bad lengths */
+}SoftwareDemuxStatistics;
+
+/**
+ * @brief Software demultiplexer working on memory holding transport stream packets
+ */
+typedef struct _SoftwareDemux SoftwareDemux;
+
+/**
+ * @brief Allocates demux without any section filter
+ *
+ * @param [out] demux - created demux
+ * @param [in] sectionCallback - called for every complete section
+ * @param [in] userData - passed to sectionCallback
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxCreate(SoftwareDemux** demux, DemuxSectionCallback sectionCallback, void* userData);
+
+/**
+ * @brief Frees demux
+ *
+ * @param [in] demux - demux to free
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxDestroy(SoftwareDemux* demux);
+
+/**
+ * @brief Starts collecting sections on PID, adding the same PID twice is harmless
+ *
+ * @param [in] demux - demux
+ * @param [in] pid - PID to filter
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxAddSectionFilter(SoftwareDemux* demux, uint16_t pid);
+
+/**
+ * @brief Removes all section filters and drops partially collected sections, counters are kept
+ *
+ * @param [in] demux - demux
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxReset(SoftwareDemux* demux);
+
+/**
+ * @brief Demultiplexes packets, data does not have to start at a packet boundary
+ *
+ * Bytes of a trailing incomplete packet are ignored.
+ *
+ * @param [in] demux - demux
+ * @param [in] data - transport stream bytes
+ * @param [in] length - number of bytes in data
+ * @param [in] streamOffset - stream offset of data[0], reported back with sections
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxProcess(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset);
+
+/**
+ * @brief Completes sections that were being collected when the previous softwareDemuxProcess call ended
+ *
+ * Data is the stream that follows the processed part. No new section is started and packets are not counted,
+ * so a caller splitting the stream into parts gets every section exactly once from the part it started in.
+ * Returns as soon as no section is pending.
+ *
+ * @param [in] demux - demux
+ * @param [in] data - transport stream bytes following the processed ones, starting at a packet boundary
+ * @param [in] length - number of bytes in data
+ * @param [in] streamOffset - stream offset of data[0], reported back with sections
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxDrain(SoftwareDemux* demux, const uint8_t* data, uint64_t length, uint64_t streamOffset);
+
+/**
+ * @brief Returns number of packets demultiplexed on PID
+ *
+ * @param [in] demux - demux
+ * @param [in] pid - PID
+ * @return number of packets
+ */
+uint64_t softwareDemuxGetPidPacketCount(SoftwareDemux* demux, uint16_t pid);
+
+/**
+ * @brief Returns demux counters
+ *
+ * @param [in] demux - demux
+ * @param [out] statistics - demux counters
+ * @return software demux error code
+ */
+SoftwareDemuxError softwareDemuxGetStatistics(SoftwareDemux* demux, SoftwareDemuxStatistics* statistics);
+
+#endif /* __SOFTWARE_DEMUX_H__ */
@@ -0,0 +1,431 @@
+#include "software_rasterizer.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#define RASTERIZER_X86
+#include <immintrin.h>
+#endif
+
+#define ROW_ALIGNMENT 8                             /* Rows start at 32 bytes so vector stores are aligned */
+
+/* Divides value in [0, 255*255] by 255 with rounding, exact and shared by all kernels */
+#define DIVIDE_BY_255(value) (((value) + 128 + (((value) + 128) >> 8)) >> 8)
+
+typedef void (*FillSpanFunction)(uint32_t* destination, int32_t count, uint32_t color);
+typedef void (*BlendSpanFunction)(uint32_t* destination, const uint32_t* source, int32_t count);
+
+static void fillSpanScalar(uint32_t* destination, int32_t count, uint32_t color);
+static void blendSpanScalar(uint32_t* destination, const uint32_t* source, int32_t count);
+static uint32_t blendPixel(uint32_t destination, uint32_t source);
+#ifdef RASTERIZER_X86
+static void fillSpanSse2(uint32_t* destination, int32_t count, uint32_t color);
+static void fillSpanAvx2(uint32_t* destination, int32_t count, uint32_t color);
+static void blendSpanSse2(uint32_t* destination, const uint32_t* source, int32_t count);
+static void blendSpanAvx2(uint32_t* destination, const uint32_t* source, int32_t count);
+#endif
+
+static FillSpanFunction fillSpan = fillSpanScalar;
+static BlendSpanFunction blendSpan = blendSpanScalar;
+
+
+RasterizerKernel rasterizerInit()
+{
+#ifdef RASTERIZER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        rasterizerSelect(RASTERIZER_KERNEL_AVX2);
+        return RASTERIZER_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        rasterizerSelect(RASTERIZER_KERNEL_SSE2);
+        return RASTERIZER_KERNEL_SSE2;
+    }
+#endif
+    rasterizerSelect(RASTERIZER_KERNEL_SCALAR);
+
+    return RASTERIZER_KERNEL_SCALAR;
+}
+
+RasterizerError rasterizerSelect(RasterizerKernel kernel)
+{
+    switch (kernel)
+    {
+        case RASTERIZER_KERNEL_SCALAR:
+            fillSpan = fillSpanScalar;
+            blendSpan = blendSpanScalar;
+            break;
+#ifdef RASTERIZER_X86
+        case RASTERIZER_KERNEL_SSE2:
+            fillSpan = fillSpanSse2;
+            blendSpan = blendSpanSse2;
+            break;
+        case RASTERIZER_KERNEL_AVX2:
+            if (!__builtin_cpu_supports("avx2"))
+            {
+                printf("\n%s : ERROR AVX2 is not supported by this CPU\n", __FUNCTION__);
+                return RASTERIZER_ERROR;
+            }
+            fillSpan = fillSpanAvx2;
+            blendSpan = blendSpanAvx2;
+            break;
+#endif
+        default:
+            printf("\n%s : ERROR kernel %d is not available in this build\n", __FUNCTION__, kernel);
+            return RASTERIZER_ERROR;
+    }
+
+    return RASTERIZER_NO_ERROR;
+}
+
+RasterizerError framebufferCreate(Framebuffer* framebuffer, int32_t width, int32_t height)
+{
+    void* pixels = NULL;
+
+    if (framebuffer == NULL || width <= 0 || height <= 0)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return RASTERIZER_ERROR;
+    }
+
+    framebuffer->pitch = (width + ROW_ALIGNMENT - 1) & ~(ROW_ALIGNMENT - 1);
+    if (posix_memalign(&pixels, ROW_ALIGNMENT * sizeof(uint32_t), (size_t)framebuffer->pitch * height * sizeof(uint32_t)))
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return RASTERIZER_ERROR;
+    }
+    memset(pixels, 0x0, (size_t)framebuffer->pitch * height * sizeof(uint32_t));
+
+    framebuffer->pixels = (uint32_t*)pixels;
+    framebuffer->width = width;
+    framebuffer->height = height;
+
+    return RASTERIZER_NO_ERROR;
+}
+
+void framebufferDestroy(Framebuffer* framebuffer)
+{
+    free(framebuffer->pixels);
+    framebuffer->pixels = NULL;
+}
+
+/* Clips rectangle to framebuffer, returns 0 if nothing is left */
+static int clipRectangle(const Framebuffer* framebuffer, int32_t* x, int32_t* y, int32_t* width, int32_t* height)
+{
+    if (*x < 0)
+    {
+        *width += *x;
+        *x = 0;
+    }
+    if (*y < 0)
+    {
+        *height += *y;
+        *y = 0;
+    }
+    if (*x + *width > framebuffer->width)
+    {
+        *width = framebuffer->width - *x;
+    }
+    if (*y + *height > framebuffer->height)
+    {
+        *height = framebuffer->height - *y;
+    }
+
+    return (*width > 0 && *height > 0);
+}
+
+void rasterizerFill(Framebuffer* framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color)
+{
+    int32_t row = 0;
+
+    if (!clipRectangle(framebuffer, &x, &y, &width, &height))
+    {
+        return;
+    }
+
+    for (row = y; row < y + height; row++)
+    {
+        fillSpan(framebuffer->pixels + (size_t)row * framebuffer->pitch + x, width, color);
+    }
+}
+
+void rasterizerBlendFill(Framebuffer* framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color)
+{
+    uint32_t* pixel = NULL;
+    int32_t row = 0;
+    int32_t column = 0;
+
+    if (!clipRectangle(framebuffer, &x, &y, &width, &height))
+    {
+        return;
+    }
+
+    /* used for small glyph blocks only, scalar is good enough */
+    for (row = y; row < y + height; row++)
+    {
+        pixel = framebuffer->pixels + (size_t)row * framebuffer->pitch + x;
+        for (column = 0; column < width; column++)
+        {
+            pixel[column] = blendPixel(pixel[column], color);
+        }
+    }
+}
+
+void rasterizerBlit(Framebuffer* framebuffer, const Framebuffer* source, int32_t x, int32_t y)
+{
+    int32_t sourceX = (x < 0) ? -x : 0;
+    int32_t sourceY = (y < 0) ? -y : 0;
+    int32_t width = source->width;
+    int32_t height = source->height;
+    int32_t row = 0;
+
+    if (!clipRectangle(framebuffer, &x, &y, &width, &height))
+    {
+        return;
+    }
+
+    for (row = 0; row < height; row++)
+    {
+        blendSpan(framebuffer->pixels + (size_t)(y + row) * framebuffer->pitch + x,
+            source->pixels + (size_t)(sourceY + row) * source->pitch + sourceX, width);
+    }
+}
+
+void rasterizerCopy(Framebuffer* framebuffer, const Framebuffer* source, int32_t x, int32_t y)
+{
+    int32_t sourceX = (x < 0) ? -x : 0;
+    int32_t sourceY = (y < 0) ? -y : 0;
+    int32_t width = source->width;
+    int32_t height = source->height;
+    int32_t row = 0;
+
+    if (!clipRectangle(framebuffer, &x, &y, &width, &height))
+    {
+        return;
+    }
+
+    for (row = 0; row < height; row++)
+    {
+        memcpy(framebuffer->pixels + (size_t)(y + row) * framebuffer->pitch + x,
+            source->pixels + (size_t)(sourceY + row) * source->pitch + sourceX, width * sizeof(uint32_t));
+    }
+}
+
+void rasterizerBlendMask(Framebuffer* framebuffer, const uint8_t* mask, int32_t maskPitch, int32_t x, int32_t y,
+    int32_t width, int32_t height, uint32_t color)
+{
+    const uint8_t* maskRow = NULL;
+    uint32_t* pixel = NULL;
+    uint32_t alpha = color >> 24;
+    uint32_t coverage = 0;
+    int32_t maskX = (x < 0) ? -x : 0;
+    int32_t maskY = (y < 0) ? -y : 0;
+    int32_t row = 0;
+    int32_t column = 0;
+
+    if (!clipRectangle(framebuffer, &x, &y, &width, &height))
+    {
+        return;
+    }
+
+    /* glyph cells are small and mostly empty, scalar is good enough */
+    for (row = 0; row < height; row++)
+    {
+        pixel = framebuffer->pixels + (size_t)(y + row) * framebuffer->pitch + x;
+        maskRow = mask + (size_t)(maskY + row) * maskPitch + maskX;
+        for (column = 0; column < width; column++)
+        {
+            if (maskRow[column] != 0)
+            {
+                coverage = DIVIDE_BY_255(maskRow[column] * alpha);
+                pixel[column] = blendPixel(pixel[column], (coverage << 24) | (color & 0x00FFFFFF));
+            }
+        }
+    }
+}
+
+RasterizerError rasterizerWritePpm(const Framebuffer* framebuffer, const char* fileName)
+{
+    FILE* outputFile = NULL;
+    uint8_t* row = NULL;
+    uint32_t pixel = 0;
+    int32_t x = 0;
+    int32_t y = 0;
+
+    if ((outputFile = fopen(fileName, "wb")) == NULL)
+    {
+        printf("\n%s : ERROR cannot open %s\n", __FUNCTION__, fileName);
+        return RASTERIZER_ERROR;
+    }
+
+    row = (uint8_t*)malloc((size_t)framebuffer->width * 3);
+    if (row == NULL)
+    {
+        fclose(outputFile);
+        return RASTERIZER_ERROR;
+    }
+
+    fprintf(outputFile, "P6\n%d %d\n255\n", framebuffer->width, framebuffer->height);
+    for (y = 0; y < framebuffer->height; y++)
+    {
+        for (x = 0; x < framebuffer->width; x++)
+        {
+            pixel = framebuffer->pixels[(size_t)y * framebuffer->pitch + x];
+            row[3 * x] = (uint8_t)(pixel >> 16);
+            row[3 * x + 1] = (uint8_t)(pixel >> 8);
+            row[3 * x + 2] = (uint8_t)pixel;
+        }
+        fwrite(row, 3, framebuffer->width, outputFile);
+    }
+
+    free(row);
+    fclose(outputFile);
+
+    return RASTERIZER_NO_ERROR;
+}
+
+void fillSpanScalar(uint32_t* destination, int32_t count, uint32_t color)
+{
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        destination[i] = color;
+    }
+}
+
+/* Source over: color = (source * a + destination * (255 - a)) / 255, alpha = a + destination alpha * (255 - a) / 255 */
+uint32_t blendPixel(uint32_t destination, uint32_t source)
+{
+    uint32_t alpha = source >> 24;
+    uint32_t inverse = 255 - alpha;
+    uint32_t result = 0;
+    uint32_t sourceChannel = 0;
+    uint32_t destinationChannel = 0;
+    int32_t shift = 0;
+
+    for (shift = 0; shift < 32; shift += 8)
+    {
+        /* alpha lane blends 255 instead of source alpha */
+        sourceChannel = (shift == 24) ? 255 : (source >> shift) & 0xFF;
+        destinationChannel = (destination >> shift) & 0xFF;
+        result |= DIVIDE_BY_255(sourceChannel * alpha + destinationChannel * inverse) << shift;
+    }
+
+    return result;
+}
+
+void blendSpanScalar(uint32_t* destination, const uint32_t* source, int32_t count)
+{
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        destination[i] = blendPixel(destination[i], source[i]);
+    }
+}
+
+#ifdef RASTERIZER_X86
+
+__attribute__((target("sse2")))
+void fillSpanSse2(uint32_t* destination, int32_t count, uint32_t color)
+{
+    const __m128i colorVector = _mm_set1_epi32((int32_t)color);
+    int32_t i = 0;
+
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128((__m128i*)(destination + i), colorVector);
+    }
+    fillSpanScalar(destination + i, count - i, color);
+}
+
+__attribute__((target("avx2")))
+void fillSpanAvx2(uint32_t* destination, int32_t count, uint32_t color)
+{
+    const __m256i colorVector = _mm256_set1_epi32((int32_t)color);
+    int32_t i = 0;
+
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256((__m256i*)(destination + i), colorVector);
+    }
+    fillSpanScalar(destination + i, count - i, color);
+}
+
+/* Blends pixels widened to 16 bit lanes, same arithmetic as blendPixel */
+__attribute__((target("sse2")))
+static inline __m128i blendWideSse2(__m128i destination, __m128i source)
+{
+    const __m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const __m128i alphaLaneMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i maximum = _mm_set1_epi16(255);
+    const __m128i rounding = _mm_set1_epi16(128);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source, 0xFF), 0xFF);
+    __m128i value;
+
+    source = _mm_or_si128(_mm_andnot_si128(alphaLaneMask, source), alphaLane);
+    value = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(source, alpha), _mm_mullo_epi16(destination, _mm_sub_epi16(maximum, alpha))), rounding);
+
+    return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+void blendSpanSse2(uint32_t* destination, const uint32_t* source, int32_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sourceVector;
+    __m128i destinationVector;
+    int32_t i = 0;
+
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        sourceVector = _mm_loadu_si128((const __m128i*)(source + i));
+        destinationVector = _mm_loadu_si128((const __m128i*)(destination + i));
+
+        _mm_storeu_si128((__m128i*)(destination + i), _mm_packus_epi16(
+            blendWideSse2(_mm_unpacklo_epi8(destinationVector, zero), _mm_unpacklo_epi8(sourceVector, zero)),
+            blendWideSse2(_mm_unpackhi_epi8(destinationVector, zero), _mm_unpackhi_epi8(sourceVector, zero))));
+    }
+    blendSpanScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blendWideAvx2(__m256i destination, __m256i source)
+{
+    const __m256i alphaLane = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+    const __m256i alphaLaneMask = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+    const __m256i maximum = _mm256_set1_epi16(255);
+    const __m256i rounding = _mm256_set1_epi16(128);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source, 0xFF), 0xFF);
+    __m256i value;
+
+    source = _mm256_or_si256(_mm256_andnot_si256(alphaLaneMask, source), alphaLane);
+    value = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(source, alpha),
+        _mm256_mullo_epi16(destination, _mm256_sub_epi16(maximum, alpha))), rounding);
+
+    return _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_srli_epi16(value, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+void blendSpanAvx2(uint32_t* destination, const uint32_t* source, int32_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sourceVector;
+    __m256i destinationVector;
+    int32_t i = 0;
+
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        sourceVector = _mm256_loadu_si256((const __m256i*)(source + i));
+        destinationVector = _mm256_loadu_si256((const __m256i*)(destination + i));
+
+        /* unpack and pack work per 128 bit half, so pixel order is preserved */
+        _mm256_storeu_si256((__m256i*)(destination + i), _mm256_packus_epi16(
+            blendWideAvx2(_mm256_unpacklo_epi8(destinationVector, zero), _mm256_unpacklo_epi8(sourceVector, zero)),
+            blendWideAvx2(_mm256_unpackhi_epi8(destinationVector, zero), _mm256_unpackhi_epi8(sourceVector, zero))));
+    }
+    blendSpanSse2(destination + i, source + i, count - i);
+}
+
+#endif /* RASTERIZER_X86 */
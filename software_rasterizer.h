@@ -0,0 +1,128 @@
+#ifndef __SOFTWARE_RASTERIZER_H__
+#define __SOFTWARE_RASTERIZER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Enumeration of rasterizer kernels
+ */
+typedef enum _RasterizerKernel
+{
+    RASTERIZER_KERNEL_SCALAR = 0,
+    RASTERIZER_KERNEL_SSE2,
+    RASTERIZER_KERNEL_AVX2
+}RasterizerKernel;
+
+/**
+ * @brief Enumeration of possible rasterizer error codes
+ */
+typedef enum _RasterizerError
+{
+    RASTERIZER_NO_ERROR = 0,
+    RASTERIZER_ERROR
+}RasterizerError;
+
+/**
+ * @brief Structure that defines ARGB32 (0xAARRGGBB) pixel buffer
+ */
+typedef struct _Framebuffer
+{
+    uint32_t* pixels;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;                                  /* Number of pixels between starts of two rows */
+}Framebuffer;
+
+/**
+ * @brief Selects the fastest kernel supported by the CPU
+ *
+ * @return selected kernel
+ */
+RasterizerKernel rasterizerInit();
+
+/**
+ * @brief Forces use of the given kernel, all kernels produce identical pixels
+ *
+ * @param [in] kernel - kernel to use
+ * @return rasterizer error code
+ */
+RasterizerError rasterizerSelect(RasterizerKernel kernel);
+
+/**
+ * @brief Allocates framebuffer with rows aligned for vector stores
+ *
+ * @param [out] framebuffer - framebuffer to initialize
+ * @param [in] width - width in pixels
+ * @param [in] height - height in pixels
+ * @return rasterizer error code
+ */
+RasterizerError framebufferCreate(Framebuffer* framebuffer, int32_t width, int32_t height);
+
+/**
+ * @brief Frees framebuffer pixels
+ *
+ * @param [in] framebuffer - framebuffer to free
+ */
+void framebufferDestroy(Framebuffer* framebuffer);
+
+/**
+ * @brief Writes color into rectangle, clipped to the framebuffer, without blending
+ *
+ * @param [in] framebuffer - destination
+ * @param [in] x, y, width, height - rectangle
+ * @param [in] color - ARGB color
+ */
+void rasterizerFill(Framebuffer* framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+
+/**
+ * @brief Blends color over rectangle using color alpha, clipped to the framebuffer
+ *
+ * @param [in] framebuffer - destination
+ * @param [in] x, y, width, height - rectangle
+ * @param [in] color - ARGB color
+ */
+void rasterizerBlendFill(Framebuffer* framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+
+/**
+ * @brief Blends source over destination at (x, y) using source alpha, clipped to the framebuffer
+ *
+ * @param [in] framebuffer - destination
+ * @param [in] source - source image
+ * @param [in] x, y - destination position of source top left corner
+ */
+void rasterizerBlit(Framebuffer* framebuffer, const Framebuffer* source, int32_t x, int32_t y);
+
+/**
+ * @brief Copies source to destination at (x, y) including its alpha, clipped to the framebuffer
+ *
+ * @param [in] framebuffer - destination
+ * @param [in] source - source image
+ * @param [in] x, y - destination position of source top left corner
+ */
+void rasterizerCopy(Framebuffer* framebuffer, const Framebuffer* source, int32_t x, int32_t y);
+
+/**
+ * @brief Blends color over rectangle using color alpha scaled by 8 bit mask, clipped to the framebuffer
+ *
+ * @param [in] framebuffer - destination
+ * @param [in] mask - coverage of rectangle pixels, e.g. glyph of pre-rasterized font
+ * @param [in] maskPitch - bytes between starts of two mask rows
+ * @param [in] x, y, width, height - rectangle
+ * @param [in] color - ARGB color
+ */
+void rasterizerBlendMask(Framebuffer* framebuffer, const uint8_t* mask, int32_t maskPitch, int32_t x, int32_t y,
+    int32_t width, int32_t height, uint32_t color);
+
+/**
+ * @brief Writes RGB part of framebuffer as binary PPM
+ *
+ * @param [in] framebuffer - framebuffer to write
+ * @param [in] fileName - output file
+ * @return rasterizer error code
+ */
+RasterizerError rasterizerWritePpm(const Framebuffer* framebuffer, const char* fileName);
+
+#endif /* __SOFTWARE_RASTERIZER_H__ */
@@ -0,0 +1,561 @@
+#include "spts_extractor.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define SPTS_NUMBER_OF_PIDS 8192
+#define SPTS_PAT_PID 0x0000
+#define SPTS_MAX_SECTION_SIZE 1024                  /* section_length of PAT and PMT is at most 1021 */
+#define SPTS_PAT_SECTION_SIZE 16                    /* PAT with one program */
+#define SPTS_PMT_FIXED_SIZE 16                      /* PMT header and CRC */
+#define SPTS_ES_INFO_SIZE 5                         /* stream_type, elementary_PID and ES_info_length */
+#define SPTS_CRC_SIZE 4
+
+/**
+ * @brief Structure that holds state of one output
+ */
+typedef struct _SptsOutput
+{
+    bool used;
+    int fileDescriptor;
+    uint16_t programNumber;
+    uint16_t pmtPid;
+    uint8_t patVersion;
+
+    /* generated PAT in the first packet, PMT in the rest */
+    uint8_t psiPackets[SPTS_MAX_PSI_PACKETS * TS_PACKET_SIZE];
+    uint8_t numberOfPsiPackets;
+    uint8_t patContinuity;
+    uint8_t pmtContinuity;
+    uint64_t nextPsiPacket;                         /* Input packet count at which PAT and PMT are inserted again */
+    bool psiPending;                                /* psiPackets are referenced by an iovec that was not written yet */
+
+    struct iovec batch[SPTS_BATCH_IOVECS];
+    uint32_t batchCount;
+
+    SptsOutputStatistics statistics;
+}SptsOutput;
+
+/**
+ * @brief Structure that holds state of the extractor
+ */
+struct _SptsExtractor
+{
+    pthread_mutex_t mutex;
+    uint16_t transportStreamId;
+    uint32_t pidOutputs[SPTS_NUMBER_OF_PIDS];       /* Bitmask of outputs every PID is routed to */
+    uint64_t packetCount;                           /* Input packets processed */
+    SptsOutput outputs[SPTS_MAX_OUTPUTS];
+};
+
+
+static SptsExtractorError setOutputProgram(SptsExtractor* extractor, uint8_t output, const PmtTable* pmtTable, uint16_t pmtPid);
+static void clearOutputPids(SptsExtractor* extractor, uint8_t output);
+static uint32_t buildPatSection(SptsExtractor* extractor, SptsOutput* output, uint8_t* section);
+static uint32_t buildPmtSection(const PmtTable* pmtTable, uint8_t* section);
+static void writeCrc(uint8_t* section, uint32_t length);
+static uint8_t packetizeSection(const uint8_t* section, uint32_t length, uint16_t pid, uint8_t* packets);
+static void insertPsi(SptsOutput* output);
+static void appendToBatch(SptsOutput* output, const uint8_t* data, uint32_t length);
+static void flushOutput(SptsOutput* output);
+
+
+SptsExtractorError sptsExtractorCreate(uint16_t transportStreamId, SptsExtractor** extractor)
+{
+    SptsExtractor* newExtractor = NULL;
+
+    if (extractor == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    newExtractor = (SptsExtractor*)malloc(sizeof(SptsExtractor));
+    if (newExtractor == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+    memset(newExtractor, 0x0, sizeof(SptsExtractor));
+    newExtractor->transportStreamId = transportStreamId;
+
+    if (pthread_mutex_init(&newExtractor->mutex, NULL))
+    {
+        printf("\n%s : ERROR pthread_mutex_init() failed\n", __FUNCTION__);
+        free(newExtractor);
+        return SE_ERROR;
+    }
+
+    *extractor = newExtractor;
+    return SE_NO_ERROR;
+}
+
+SptsExtractorError sptsExtractorDestroy(SptsExtractor* extractor)
+{
+    if (extractor == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_destroy(&extractor->mutex);
+    free(extractor);
+
+    return SE_NO_ERROR;
+}
+
+SptsExtractorError sptsExtractorAddOutput(SptsExtractor* extractor, const PmtTable* pmtTable, uint16_t pmtPid, int fileDescriptor,
+    uint8_t* output)
+{
+    SptsExtractorError result = SE_ERROR;
+    uint8_t i = 0;
+
+    if (extractor == NULL || pmtTable == NULL || output == NULL || fileDescriptor < 0)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_lock(&extractor->mutex);
+
+    for (i = 0; i < SPTS_MAX_OUTPUTS; i++)
+    {
+        if (!extractor->outputs[i].used)
+        {
+            break;
+        }
+    }
+    if (i == SPTS_MAX_OUTPUTS)
+    {
+        printf("\n%s : ERROR all %d outputs are used\n", __FUNCTION__, SPTS_MAX_OUTPUTS);
+        pthread_mutex_unlock(&extractor->mutex);
+        return SE_ERROR;
+    }
+
+    memset(&extractor->outputs[i], 0x0, sizeof(SptsOutput));
+    extractor->outputs[i].fileDescriptor = fileDescriptor;
+    extractor->outputs[i].nextPsiPacket = extractor->packetCount;
+
+    result = setOutputProgram(extractor, i, pmtTable, pmtPid);
+    if (result == SE_NO_ERROR)
+    {
+        extractor->outputs[i].used = true;
+        *output = i;
+    }
+
+    pthread_mutex_unlock(&extractor->mutex);
+
+    return result;
+}
+
+SptsExtractorError sptsExtractorUpdateOutput(SptsExtractor* extractor, uint8_t output, const PmtTable* pmtTable, uint16_t pmtPid)
+{
+    SptsExtractorError result = SE_ERROR;
+
+    if (extractor == NULL || pmtTable == NULL || output >= SPTS_MAX_OUTPUTS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_lock(&extractor->mutex);
+
+    if (extractor->outputs[output].used)
+    {
+        result = setOutputProgram(extractor, output, pmtTable, pmtPid);
+        /* new tables go out with the next packet of the program */
+        extractor->outputs[output].nextPsiPacket = extractor->packetCount;
+    }
+
+    pthread_mutex_unlock(&extractor->mutex);
+
+    return result;
+}
+
+SptsExtractorError sptsExtractorRemoveOutput(SptsExtractor* extractor, uint8_t output)
+{
+    if (extractor == NULL || output >= SPTS_MAX_OUTPUTS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_lock(&extractor->mutex);
+
+    clearOutputPids(extractor, output);
+    extractor->outputs[output].used = false;
+
+    pthread_mutex_unlock(&extractor->mutex);
+
+    return SE_NO_ERROR;
+}
+
+SptsExtractorError sptsExtractorProcess(SptsExtractor* extractor, const uint8_t* data, uint64_t length)
+{
+    const uint8_t* packet = NULL;
+    const uint8_t* end = NULL;
+    SptsOutput* output = NULL;
+    uint32_t usedOutputs = 0;
+    uint32_t outputs = 0;
+    uint16_t pid = 0;
+    uint8_t i = 0;
+
+    if (extractor == NULL || data == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_lock(&extractor->mutex);
+
+    end = data + length / TS_PACKET_SIZE * TS_PACKET_SIZE;
+    for (packet = data; packet < end; packet += TS_PACKET_SIZE)
+    {
+        extractor->packetCount++;
+        if (packet[0] != TS_SYNC_BYTE)
+        {
+            continue;
+        }
+
+        pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        outputs = extractor->pidOutputs[pid];
+        usedOutputs |= outputs;
+
+        while (outputs != 0)
+        {
+            i = (uint8_t)__builtin_ctz(outputs);
+            outputs &= outputs - 1;
+            output = &extractor->outputs[i];
+
+            if (extractor->packetCount >= output->nextPsiPacket)
+            {
+                insertPsi(output);
+                output->nextPsiPacket = extractor->packetCount + SPTS_PSI_INTERVAL;
+            }
+            appendToBatch(output, packet, TS_PACKET_SIZE);
+            output->statistics.packets++;
+        }
+    }
+
+    /* batches point into data, so they cannot outlive the call */
+    while (usedOutputs != 0)
+    {
+        i = (uint8_t)__builtin_ctz(usedOutputs);
+        usedOutputs &= usedOutputs - 1;
+        flushOutput(&extractor->outputs[i]);
+    }
+
+    pthread_mutex_unlock(&extractor->mutex);
+
+    return SE_NO_ERROR;
+}
+
+SptsExtractorError sptsExtractorGetStatistics(SptsExtractor* extractor, uint8_t output, SptsOutputStatistics* statistics)
+{
+    if (extractor == NULL || output >= SPTS_MAX_OUTPUTS || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SE_ERROR;
+    }
+
+    pthread_mutex_lock(&extractor->mutex);
+    *statistics = extractor->outputs[output].statistics;
+    pthread_mutex_unlock(&extractor->mutex);
+
+    return SE_NO_ERROR;
+}
+
+/**
+ * @brief Generates PAT and PMT packets of output and routes program PIDs to it, called with mutex locked
+ */
+SptsExtractorError setOutputProgram(SptsExtractor* extractor, uint8_t output, const PmtTable* pmtTable, uint16_t pmtPid)
+{
+    SptsOutput* spts = &extractor->outputs[output];
+    uint8_t patSection[SPTS_PAT_SECTION_SIZE];
+    uint8_t pmtSection[SPTS_MAX_SECTION_SIZE];
+    uint32_t pmtLength = 0;
+    uint16_t pid = 0;
+    uint8_t i = 0;
+
+    if (pmtPid == SPTS_PAT_PID || pmtPid >= SPTS_NUMBER_OF_PIDS)
+    {
+        printf("\n%s : ERROR PMT pid %d is not valid\n", __FUNCTION__, pmtPid);
+        return SE_ERROR;
+    }
+
+    pmtLength = buildPmtSection(pmtTable, pmtSection);
+    if (pmtLength == 0)
+    {
+        printf("\n%s : ERROR PMT of program %d does not fit one section\n", __FUNCTION__, pmtTable->pmtHeader.programNumber);
+        return SE_ERROR;
+    }
+
+    /* decoders only notice a changed PAT by its version */
+    if (spts->used && (spts->programNumber != pmtTable->pmtHeader.programNumber || spts->pmtPid != pmtPid))
+    {
+        spts->patVersion = (spts->patVersion + 1) & 0x1F;
+    }
+    spts->programNumber = pmtTable->pmtHeader.programNumber;
+    spts->pmtPid = pmtPid;
+    spts->statistics.programNumber = spts->programNumber;
+
+    /* iovec of a pending batch may still point to the old packets */
+    if (spts->psiPending)
+    {
+        flushOutput(spts);
+    }
+    buildPatSection(extractor, spts, patSection);
+    spts->numberOfPsiPackets = packetizeSection(patSection, SPTS_PAT_SECTION_SIZE, SPTS_PAT_PID, spts->psiPackets);
+    spts->numberOfPsiPackets += packetizeSection(pmtSection, pmtLength, pmtPid,
+        spts->psiPackets + spts->numberOfPsiPackets * TS_PACKET_SIZE);
+
+    /* PAT and PMT PIDs of the input are replaced by the generated tables */
+    clearOutputPids(extractor, output);
+    for (i = 0; i <= pmtTable->elementaryInfoCount; i++)
+    {
+        pid = (i < pmtTable->elementaryInfoCount) ? pmtTable->pmtElementaryInfoArray[i].elementaryPid : pmtTable->pmtHeader.pcrPid;
+        if (pid != SPTS_PAT_PID && pid != pmtPid && pid < SPTS_NUMBER_OF_PIDS - 1)
+        {
+            extractor->pidOutputs[pid] |= 1U << output;
+        }
+    }
+
+    return SE_NO_ERROR;
+}
+
+void clearOutputPids(SptsExtractor* extractor, uint8_t output)
+{
+    uint32_t pid = 0;
+
+    for (pid = 0; pid < SPTS_NUMBER_OF_PIDS; pid++)
+    {
+        extractor->pidOutputs[pid] &= ~(1U << output);
+    }
+}
+
+/**
+ * @brief Builds PAT listing only the program of output
+ *
+ * @return section length
+ */
+uint32_t buildPatSection(SptsExtractor* extractor, SptsOutput* output, uint8_t* section)
+{
+    section[0] = 0x00;                              /* table_id */
+    section[1] = 0xB0;                              /* section_syntax_indicator, section_length */
+    section[2] = SPTS_PAT_SECTION_SIZE - 3;
+    section[3] = extractor->transportStreamId >> 8;
+    section[4] = extractor->transportStreamId & 0xFF;
+    section[5] = 0xC1 | (output->patVersion << 1);  /* current_next_indicator */
+    section[6] = 0x00;                              /* section_number */
+    section[7] = 0x00;                              /* last_section_number */
+    section[8] = output->programNumber >> 8;
+    section[9] = output->programNumber & 0xFF;
+    section[10] = 0xE0 | (output->pmtPid >> 8);
+    section[11] = output->pmtPid & 0xFF;
+    writeCrc(section, SPTS_PAT_SECTION_SIZE);
+
+    return SPTS_PAT_SECTION_SIZE;
+}
+
+/**
+ * @brief Builds PMT from parsed table, keeping its version and descriptors
+ *
+ * @return section length, 0 if it would be longer than SPTS_MAX_SECTION_SIZE
+ */
+uint32_t buildPmtSection(const PmtTable* pmtTable, uint8_t* section)
+{
+    const PmtTableHeader* header = &pmtTable->pmtHeader;
+    const PmtElementaryInfo* elementaryInfo = NULL;
+    uint32_t length = SPTS_PMT_FIXED_SIZE + header->programInfoLength;
+    uint32_t position = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < pmtTable->elementaryInfoCount; i++)
+    {
+        length += SPTS_ES_INFO_SIZE + pmtTable->pmtElementaryInfoArray[i].esInfoLength;
+    }
+    if (length > SPTS_MAX_SECTION_SIZE)
+    {
+        return 0;
+    }
+
+    section[0] = 0x02;                              /* table_id */
+    section[1] = 0xB0 | ((length - 3) >> 8);        /* section_syntax_indicator, section_length */
+    section[2] = (length - 3) & 0xFF;
+    section[3] = header->programNumber >> 8;
+    section[4] = header->programNumber & 0xFF;
+    section[5] = 0xC1 | ((header->versionNumber & 0x1F) << 1);
+    section[6] = 0x00;
+    section[7] = 0x00;
+    section[8] = 0xE0 | ((header->pcrPid >> 8) & 0x1F);
+    section[9] = header->pcrPid & 0xFF;
+    section[10] = 0xF0 | ((header->programInfoLength >> 8) & 0x0F);
+    section[11] = header->programInfoLength & 0xFF;
+    position = 12;
+    if (header->programInfoLength != 0)
+    {
+        memcpy(section + position, pmtTable->programInfo, header->programInfoLength);
+        position += header->programInfoLength;
+    }
+
+    for (i = 0; i < pmtTable->elementaryInfoCount; i++)
+    {
+        elementaryInfo = &pmtTable->pmtElementaryInfoArray[i];
+        section[position] = elementaryInfo->streamType;
+        section[position + 1] = 0xE0 | ((elementaryInfo->elementaryPid >> 8) & 0x1F);
+        section[position + 2] = elementaryInfo->elementaryPid & 0xFF;
+        section[position + 3] = 0xF0 | ((elementaryInfo->esInfoLength >> 8) & 0x0F);
+        section[position + 4] = elementaryInfo->esInfoLength & 0xFF;
+        position += SPTS_ES_INFO_SIZE;
+        if (elementaryInfo->esInfoLength != 0)
+        {
+            memcpy(section + position, elementaryInfo->esInfo, elementaryInfo->esInfoLength);
+            position += elementaryInfo->esInfoLength;
+        }
+    }
+    writeCrc(section, length);
+
+    return length;
+}
+
+/**
+ * @brief Writes CRC_32 over the section into its last four bytes
+ */
+void writeCrc(uint8_t* section, uint32_t length)
+{
+    uint32_t crc = tablesCrc32(section, length - SPTS_CRC_SIZE);
+
+    section[length - 4] = crc >> 24;
+    section[length - 3] = (crc >> 16) & 0xFF;
+    section[length - 2] = (crc >> 8) & 0xFF;
+    section[length - 1] = crc & 0xFF;
+}
+
+/**
+ * @brief Splits section into packets padded with stuffing bytes, continuity counters are set on insertion
+ *
+ * @return number of packets
+ */
+uint8_t packetizeSection(const uint8_t* section, uint32_t length, uint16_t pid, uint8_t* packets)
+{
+    uint8_t* packet = packets;
+    uint32_t position = 0;
+    uint32_t payload = 0;
+    uint32_t header = 0;
+    uint8_t count = 0;
+
+    while (position < length)
+    {
+        /* first packet starts with pointer_field */
+        header = (position == 0) ? 5 : 4;
+        payload = (length - position < TS_PACKET_SIZE - header) ? length - position : TS_PACKET_SIZE - header;
+
+        packet[0] = TS_SYNC_BYTE;
+        packet[1] = ((position == 0) ? 0x40 : 0x00) | (pid >> 8);
+        packet[2] = pid & 0xFF;
+        packet[3] = 0x10;                           /* payload only */
+        packet[4] = 0x00;
+        memcpy(packet + header, section + position, payload);
+        memset(packet + header + payload, 0xFF, TS_PACKET_SIZE - header - payload);
+
+        position += payload;
+        packet += TS_PACKET_SIZE;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Queues PAT and PMT packets of output with next continuity counters
+ */
+void insertPsi(SptsOutput* output)
+{
+    uint8_t* continuity = NULL;
+    uint8_t i = 0;
+
+    /* only one copy of the packets exists, the previous insertion has to be written first */
+    if (output->psiPending)
+    {
+        flushOutput(output);
+    }
+
+    for (i = 0; i < output->numberOfPsiPackets; i++)
+    {
+        continuity = (i == 0) ? &output->patContinuity : &output->pmtContinuity;
+        output->psiPackets[i * TS_PACKET_SIZE + 3] = 0x10 | *continuity;
+        *continuity = (*continuity + 1) & 0x0F;
+    }
+
+    appendToBatch(output, output->psiPackets, output->numberOfPsiPackets * TS_PACKET_SIZE);
+    output->psiPending = true;
+    output->statistics.psiPackets += output->numberOfPsiPackets;
+}
+
+/**
+ * @brief Adds bytes to output batch, extending the last iovec when they follow it in memory
+ */
+void appendToBatch(SptsOutput* output, const uint8_t* data, uint32_t length)
+{
+    struct iovec* last = NULL;
+
+    if (output->batchCount != 0)
+    {
+        last = &output->batch[output->batchCount - 1];
+        if ((const uint8_t*)last->iov_base + last->iov_len == data)
+        {
+            last->iov_len += length;
+            return;
+        }
+    }
+
+    if (output->batchCount == SPTS_BATCH_IOVECS)
+    {
+        flushOutput(output);
+    }
+    output->batch[output->batchCount].iov_base = (void*)data;
+    output->batch[output->batchCount].iov_len = length;
+    output->batchCount++;
+}
+
+/**
+ * @brief Writes output batch with as few writev calls as the descriptor allows
+ */
+void flushOutput(SptsOutput* output)
+{
+    struct iovec* iov = output->batch;
+    uint32_t count = output->batchCount;
+    ssize_t written = 0;
+
+    while (count != 0)
+    {
+        written = writev(output->fileDescriptor, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            output->statistics.writeErrors++;
+            break;
+        }
+        output->statistics.writes++;
+        output->statistics.writtenBytes += written;
+
+        /* skip what was written, partial writes are possible on pipes and sockets */
+        while (count != 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count != 0)
+        {
+            iov->iov_base = (uint8_t*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    output->batchCount = 0;
+    output->psiPending = false;
+}
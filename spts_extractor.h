@@ -0,0 +1,121 @@
+#ifndef __SPTS_EXTRACTOR_H__
+#define __SPTS_EXTRACTOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+#include "tables.h"
+#include "ts_packet.h"
+
+#define SPTS_MAX_OUTPUTS 32                         /* Outputs of one extractor, one bit each in the PID map */
+#define SPTS_BATCH_IOVECS 256                       /* Pending iovecs of one output before it is written */
+#define SPTS_MAX_PSI_PACKETS 8                      /* PAT packet and packets of a PMT of up to 1024 bytes */
+#define SPTS_PSI_INTERVAL 2000                      /* Input packets between two PAT/PMT insertions, ~100 ms at 30 Mbit/s */
+
+/**
+ * @brief Enumeration of possible SPTS extractor error codes
+ */
+typedef enum _SptsExtractorError
+{
+    SE_NO_ERROR = 0,
+    SE_ERROR
+}SptsExtractorError;
+
+/**
+ * @brief Structure that holds counters of one output
+ */
+typedef struct _SptsOutputStatistics
+{
+    uint16_t programNumber;
+    uint64_t packets;                               /* Service packets routed to the output */
+    uint64_t psiPackets;                            /* Generated PAT and PMT packets */
+    uint64_t writtenBytes;
+    uint32_t writes;                                /* writev calls */
+    uint32_t writeErrors;
+}SptsOutputStatistics;
+
+/**
+ * @brief SPTS extractor, splits one multi program transport stream into single program streams
+ */
+typedef struct _SptsExtractor SptsExtractor;
+
+/**
+ * @brief Creates extractor without outputs
+ *
+ * @param [in] transportStreamId - transport_stream_id written to generated PATs
+ * @param [out] extractor - created extractor
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorCreate(uint16_t transportStreamId, SptsExtractor** extractor);
+
+/**
+ * @brief Frees extractor, file descriptors of outputs are left to the caller
+ *
+ * @param [in] extractor - extractor to destroy
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorDestroy(SptsExtractor* extractor);
+
+/**
+ * @brief Adds output that receives one program
+ *
+ * Output gets PCR and elementary PIDs of the PMT and its own PAT and PMT, generated from pmtTable.
+ * Descriptor loops are copied, the section pmtTable was parsed from can be freed after the call.
+ *
+ * @param [in] extractor - SPTS extractor
+ * @param [in] pmtTable - parsed PMT of the program
+ * @param [in] pmtPid - PID the generated PMT is sent on
+ * @param [in] fileDescriptor - file or socket the output is written to
+ * @param [out] output - output number, used to update or remove the output
+ * @return SPTS extractor error code, SE_ERROR if all outputs are used
+ */
+SptsExtractorError sptsExtractorAddOutput(SptsExtractor* extractor, const PmtTable* pmtTable, uint16_t pmtPid, int fileDescriptor,
+    uint8_t* output);
+
+/**
+ * @brief Replaces PMT of output after the program changed its streams
+ *
+ * @param [in] extractor - SPTS extractor
+ * @param [in] output - output number
+ * @param [in] pmtTable - new parsed PMT of the program
+ * @param [in] pmtPid - PID the generated PMT is sent on
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorUpdateOutput(SptsExtractor* extractor, uint8_t output, const PmtTable* pmtTable, uint16_t pmtPid);
+
+/**
+ * @brief Removes output, its file descriptor is left to the caller
+ *
+ * @param [in] extractor - SPTS extractor
+ * @param [in] output - output number
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorRemoveOutput(SptsExtractor* extractor, uint8_t output);
+
+/**
+ * @brief Routes packets to outputs and writes them
+ *
+ * Packets are not copied, outputs collect iovecs pointing into data and all of them are written
+ * before the call returns. Outputs can be added and removed from other threads.
+ *
+ * @param [in] extractor - SPTS extractor
+ * @param [in] data - whole transport stream packets
+ * @param [in] length - number of bytes in data
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorProcess(SptsExtractor* extractor, const uint8_t* data, uint64_t length);
+
+/**
+ * @brief Returns counters of one output
+ *
+ * @param [in] extractor - SPTS extractor
+ * @param [in] output - output number
+ * @param [out] statistics - counters
+ * @return SPTS extractor error code
+ */
+SptsExtractorError sptsExtractorGetStatistics(SptsExtractor* extractor, uint8_t output, SptsOutputStatistics* statistics);
+
+#endif /* __SPTS_EXTRACTOR_H__ */
@@ -0,0 +1,332 @@
+#include "startup_graph.h"
+#include "time_service.h"
+
+/**
+ * @brief Enumeration of startup step states
+ */
+typedef enum _StartupNodeState
+{
+    STARTUP_NODE_WAITING = 0,
+    STARTUP_NODE_RUNNING,
+    STARTUP_NODE_DONE,
+    STARTUP_NODE_FAILED,
+    STARTUP_NODE_SKIPPED                            /* A dependency failed or was skipped */
+}StartupNodeState;
+
+/**
+ * @brief Structure that holds one startup step
+ */
+typedef struct _StartupNode
+{
+    char name[STARTUP_GRAPH_NAME_LENGTH];
+    StartupStep step;
+    void* argument;
+    uint8_t dependencies[STARTUP_GRAPH_MAX_DEPENDENCIES];
+    uint8_t numberOfDependencies;
+    StartupNodeState state;
+    uint64_t startTime;                             /* Microseconds since start of run */
+    uint64_t endTime;
+    pthread_t thread;
+    bool threadCreated;
+    struct _StartupGraph* graph;
+}StartupNode;
+
+struct _StartupGraph
+{
+    StartupNode nodes[STARTUP_GRAPH_MAX_NODES];
+    uint8_t numberOfNodes;
+    uint64_t runTime;                               /* Monotonic microseconds of start of run */
+    pthread_mutex_t mutex;
+    pthread_cond_t stateCond;                       /* Broadcast whenever a step finishes */
+};
+
+
+static void* nodeTask(void* nodeArgument);
+static int16_t findNode(StartupGraph* graph, const char* name);
+
+static const char* const stateNames[] = {"waiting", "running", "done", "failed", "skipped"};
+
+
+StartupGraphError startupGraphCreate(StartupGraph** graph)
+{
+    StartupGraph* newGraph = NULL;
+
+    if (graph == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SG_ERROR;
+    }
+
+    newGraph = (StartupGraph*)malloc(sizeof(StartupGraph));
+    if (newGraph == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return SG_ERROR;
+    }
+    memset(newGraph, 0x0, sizeof(StartupGraph));
+
+    pthread_mutex_init(&newGraph->mutex, NULL);
+    pthread_cond_init(&newGraph->stateCond, NULL);
+
+    *graph = newGraph;
+
+    return SG_NO_ERROR;
+}
+
+StartupGraphError startupGraphDestroy(StartupGraph* graph)
+{
+    if (graph == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SG_ERROR;
+    }
+
+    pthread_cond_destroy(&graph->stateCond);
+    pthread_mutex_destroy(&graph->mutex);
+    free(graph);
+
+    return SG_NO_ERROR;
+}
+
+StartupGraphError startupGraphAddNode(StartupGraph* graph, const char* name, StartupStep step, void* argument,
+    const char* dependencies)
+{
+    StartupNode* node = NULL;
+    char dependencyNames[STARTUP_GRAPH_MAX_DEPENDENCIES * STARTUP_GRAPH_NAME_LENGTH];
+    char* savePointer = NULL;
+    char* dependencyName = NULL;
+    int16_t dependency = 0;
+
+    if (graph == NULL || name == NULL || step == NULL || strlen(name) >= STARTUP_GRAPH_NAME_LENGTH
+        || (dependencies != NULL && strlen(dependencies) >= sizeof(dependencyNames)))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SG_ERROR;
+    }
+
+    if (graph->numberOfNodes == STARTUP_GRAPH_MAX_NODES || findNode(graph, name) != -1)
+    {
+        printf("\n%s : ERROR step %s can not be added\n", __FUNCTION__, name);
+        return SG_ERROR;
+    }
+
+    node = &graph->nodes[graph->numberOfNodes];
+    memset(node, 0x0, sizeof(StartupNode));
+    strcpy(node->name, name);
+    node->step = step;
+    node->argument = argument;
+    node->graph = graph;
+
+    if (dependencies != NULL)
+    {
+        strcpy(dependencyNames, dependencies);
+        for (dependencyName = strtok_r(dependencyNames, ", ", &savePointer); dependencyName != NULL;
+            dependencyName = strtok_r(NULL, ", ", &savePointer))
+        {
+            dependency = findNode(graph, dependencyName);
+            if (dependency == -1 || node->numberOfDependencies == STARTUP_GRAPH_MAX_DEPENDENCIES)
+            {
+                printf("\n%s : ERROR step %s can not depend on %s\n", __FUNCTION__, name, dependencyName);
+                return SG_ERROR;
+            }
+            node->dependencies[node->numberOfDependencies++] = (uint8_t)dependency;
+        }
+    }
+
+    graph->numberOfNodes++;
+
+    return SG_NO_ERROR;
+}
+
+StartupGraphError startupGraphRun(StartupGraph* graph)
+{
+    StartupGraphError error = SG_NO_ERROR;
+    StartupNode* node = NULL;
+    uint8_t i = 0;
+
+    if (graph == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SG_ERROR;
+    }
+
+    graph->runTime = monotonicMicroseconds();
+
+    /* thread roles are not configured before the config step is done, default scheduling */
+    for (i = 0; i < graph->numberOfNodes; i++)
+    {
+        node = &graph->nodes[i];
+        node->state = STARTUP_NODE_WAITING;
+        if (pthread_create(&node->thread, NULL, nodeTask, node))
+        {
+            printf("\n%s : ERROR pthread_create() failed for step %s\n", __FUNCTION__, node->name);
+            pthread_mutex_lock(&graph->mutex);
+            node->state = STARTUP_NODE_FAILED;
+            pthread_cond_broadcast(&graph->stateCond);
+            pthread_mutex_unlock(&graph->mutex);
+            continue;
+        }
+        node->threadCreated = true;
+    }
+
+    for (i = 0; i < graph->numberOfNodes; i++)
+    {
+        node = &graph->nodes[i];
+        if (node->threadCreated)
+        {
+            pthread_join(node->thread, NULL);
+            node->threadCreated = false;
+        }
+        if (node->state != STARTUP_NODE_DONE)
+        {
+            error = SG_ERROR;
+        }
+    }
+
+    return error;
+}
+
+bool startupGraphNodeDone(StartupGraph* graph, const char* name)
+{
+    int16_t node = -1;
+
+    if (graph == NULL || name == NULL)
+    {
+        return false;
+    }
+
+    node = findNode(graph, name);
+
+    return node != -1 && graph->nodes[node].state == STARTUP_NODE_DONE;
+}
+
+void startupGraphPrintTimeline(StartupGraph* graph)
+{
+    StartupNode* node = NULL;
+    StartupNode* dependency = NULL;
+    int16_t last = -1;
+    uint8_t i = 0;
+
+    if (graph == NULL)
+    {
+        return;
+    }
+
+    printf("\n********************* Boot timeline *********************\n");
+    for (i = 0; i < graph->numberOfNodes; i++)
+    {
+        node = &graph->nodes[i];
+        if (node->state == STARTUP_NODE_DONE || node->state == STARTUP_NODE_FAILED)
+        {
+            printf("%-16s %8.1f ms + %8.1f ms %s\n", node->name, node->startTime / 1000.0,
+                (node->endTime - node->startTime) / 1000.0, stateNames[node->state]);
+        }
+        else
+        {
+            printf("%-16s %25s %s\n", node->name, "", stateNames[node->state]);
+        }
+
+        if (node->state == STARTUP_NODE_DONE && (last == -1 || node->endTime > graph->nodes[last].endTime))
+        {
+            last = i;
+        }
+    }
+
+    /* walk back from the step that finished last through the dependency each step waited for longest */
+    if (last != -1)
+    {
+        printf("Waited for: %s", graph->nodes[last].name);
+        node = &graph->nodes[last];
+        while (node->numberOfDependencies != 0)
+        {
+            dependency = &graph->nodes[node->dependencies[0]];
+            for (i = 1; i < node->numberOfDependencies; i++)
+            {
+                if (graph->nodes[node->dependencies[i]].endTime > dependency->endTime)
+                {
+                    dependency = &graph->nodes[node->dependencies[i]];
+                }
+            }
+            node = dependency;
+            printf(" <- %s", node->name);
+        }
+        printf("\n");
+    }
+    printf("**********************************************************\n");
+}
+
+void* nodeTask(void* nodeArgument)
+{
+    StartupNode* node = (StartupNode*)nodeArgument;
+    StartupGraph* graph = node->graph;
+    StartupNodeState dependencyState = STARTUP_NODE_DONE;
+    int32_t result = 0;
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&graph->mutex);
+    for (;;)
+    {
+        /* done only when all dependencies are done, skipped as soon as one can not be */
+        dependencyState = STARTUP_NODE_DONE;
+        for (i = 0; i < node->numberOfDependencies; i++)
+        {
+            if (graph->nodes[node->dependencies[i]].state == STARTUP_NODE_FAILED
+                || graph->nodes[node->dependencies[i]].state == STARTUP_NODE_SKIPPED)
+            {
+                dependencyState = STARTUP_NODE_SKIPPED;
+                break;
+            }
+            if (graph->nodes[node->dependencies[i]].state != STARTUP_NODE_DONE)
+            {
+                dependencyState = STARTUP_NODE_WAITING;
+            }
+        }
+        if (dependencyState != STARTUP_NODE_WAITING)
+        {
+            break;
+        }
+        pthread_cond_wait(&graph->stateCond, &graph->mutex);
+    }
+
+    if (dependencyState == STARTUP_NODE_SKIPPED)
+    {
+        node->state = STARTUP_NODE_SKIPPED;
+        pthread_cond_broadcast(&graph->stateCond);
+        pthread_mutex_unlock(&graph->mutex);
+        return NULL;
+    }
+
+    node->state = STARTUP_NODE_RUNNING;
+    node->startTime = monotonicMicroseconds() - graph->runTime;
+    pthread_mutex_unlock(&graph->mutex);
+
+    result = node->step(node->argument);
+
+    pthread_mutex_lock(&graph->mutex);
+    node->endTime = monotonicMicroseconds() - graph->runTime;
+    node->state = (result == 0) ? STARTUP_NODE_DONE : STARTUP_NODE_FAILED;
+    pthread_cond_broadcast(&graph->stateCond);
+    pthread_mutex_unlock(&graph->mutex);
+
+    if (result != 0)
+    {
+        printf("\n%s : ERROR startup step %s failed with %d\n", __FUNCTION__, node->name, result);
+    }
+
+    return NULL;
+}
+
+int16_t findNode(StartupGraph* graph, const char* name)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < graph->numberOfNodes; i++)
+    {
+        if (strcmp(graph->nodes[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,93 @@
+#ifndef __STARTUP_GRAPH_H__
+#define __STARTUP_GRAPH_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+
+#define STARTUP_GRAPH_MAX_NODES 16
+#define STARTUP_GRAPH_MAX_DEPENDENCIES 4
+#define STARTUP_GRAPH_NAME_LENGTH 16
+
+/**
+ * @brief Enumeration of possible startup graph error codes
+ */
+typedef enum _StartupGraphError
+{
+    SG_NO_ERROR = 0,
+    SG_ERROR,
+    SG_THREAD_ERROR
+}StartupGraphError;
+
+/**
+ * @brief Startup step, returns 0 on success so module init functions can be returned as they are
+ */
+typedef int32_t(*StartupStep)(void* argument);
+
+/**
+ * @brief Startup graph, steps with dependencies that run in parallel once their dependencies are done
+ */
+typedef struct _StartupGraph StartupGraph;
+
+/**
+ * @brief Creates empty startup graph
+ *
+ * @param [out] graph - created graph
+ * @return startup graph error code
+ */
+StartupGraphError startupGraphCreate(StartupGraph** graph);
+
+/**
+ * @brief Frees startup graph, graph must not be running
+ *
+ * @param [in] graph - graph to free
+ * @return startup graph error code
+ */
+StartupGraphError startupGraphDestroy(StartupGraph* graph);
+
+/**
+ * @brief Adds step to graph
+ *
+ * Dependencies have to be added before the steps that depend on them, so the graph can not have cycles.
+ *
+ * @param [in] graph - startup graph
+ * @param [in] name - step name, shown in timeline
+ * @param [in] step - step function
+ * @param [in] argument - passed to step
+ * @param [in] dependencies - comma separated names of steps that have to finish first, NULL or empty for none
+ * @return startup graph error code
+ */
+StartupGraphError startupGraphAddNode(StartupGraph* graph, const char* name, StartupStep step, void* argument,
+    const char* dependencies);
+
+/**
+ * @brief Runs all steps and waits for them, every step on its own thread
+ *
+ * Steps that depend on a failed step are skipped. Steps may block on hardware for seconds,
+ * so they get plain threads instead of task executor workers, which parse sections meanwhile.
+ *
+ * @param [in] graph - startup graph
+ * @return startup graph error code, SG_ERROR if any step failed or was skipped
+ */
+StartupGraphError startupGraphRun(StartupGraph* graph);
+
+/**
+ * @brief Tells if step finished successfully in last run
+ *
+ * @param [in] graph - startup graph that was run
+ * @param [in] name - step name
+ * @return true if step is done, false if it failed, was skipped or does not exist
+ */
+bool startupGraphNodeDone(StartupGraph* graph, const char* name);
+
+/**
+ * @brief Prints start and duration of every step since the run started, and the chain of steps startup waited for
+ *
+ * @param [in] graph - startup graph that was run
+ */
+void startupGraphPrintTimeline(StartupGraph* graph);
+
+#endif /* __STARTUP_GRAPH_H__ */
@@ -1,429 +1,1119 @@
 #include "stream_controller.h"
+#include "player_actuator.h"
+#include "task_executor.h"
 
 #define LINE_LENGTH 100          /* Max line length in config file */
+#define STREAM_MAX_PIPELINES 8   /* Max number of pipelines running at the same time */
+#define STREAM_PMT_CACHE_SIZE 4  /* Number of PMT sections kept per pipeline for fast zapping */
+#define STREAM_PMT_CACHE_MAX_AGE 10   /* Seconds after which cached PMT is not trusted any more */
+#define STREAM_SLOT_AUDIO 0      /* Player actuator stream slots */
+#define STREAM_SLOT_VIDEO 1
+#define STREAM_SECTION_QUEUE_SIZE 32  /* Sections one pipeline holds while its parsers are busy */
+#define STREAM_TABLE_TIMEOUT 5   /* Seconds to wait for PAT or PMT of a channel */
+
+
+/**
+ * @brief Structure that holds one cached PMT section
+ */
+typedef struct _PmtCacheEntry
+{
+    uint16_t programNumber;
+    SectionBuffer* section;
+    time_t receivedTime;
+}PmtCacheEntry;
+
+
+/**
+ * @brief Structure that holds complete state of one stream pipeline
+ */
+struct _StreamPipeline
+{
+    InitialInfo configInfo;
+
+    PatTable patTable;
+    PmtTable pmtTable;
+    TdtTable tdtTable;
+    TotTable totTable;
+    SectionBuffer* pmtSection;
+    TableAssembler patAssembler;
+    uint16_t requestedProgramNumber;
+    PmtCacheEntry pmtCache[STREAM_PMT_CACHE_SIZE];
+    uint8_t pmtCacheNext;
+    uint16_t prefetchProgramNumber;
+    uint16_t pmtPid;
+    int16_t pmtVersion;                             /* Version of parsed PMT, -1 until one is parsed */
+
+    pthread_cond_t initCond;                        /* Broadcast on every startup stage and when initialization finishes */
+    pthread_mutex_t initMutex;
+    pthread_cond_t demuxCond;
+    pthread_mutex_t demuxMutex;
+    pthread_cond_t commandCond;
+    pthread_mutex_t commandMutex;
+    pthread_t thread;
+
+    SectionBuffer* sectionQueue[STREAM_SECTION_QUEUE_SIZE]; /* Sections waiting for the parsers, guarded by sectionQueueMutex */
+    uint8_t sectionQueueHead;
+    uint8_t sectionQueueCount;
+    bool sectionDrainScheduled;                     /* Drain task of this pipeline is queued or running */
+    uint32_t droppedSections;
+    pthread_mutex_t sectionQueueMutex;
+    TaskGroup sectionTasks;
+
+    uint32_t playerHandle;
+    uint32_t sourceHandle;
+    PlayerActuator* actuator;                       /* Runs all player calls, so no pipeline thread waits for the driver */
+    uint32_t patFilterHandle;
+    uint32_t pmtFilterHandle;
+    uint32_t timeFilterHandle;
+    uint32_t tdtFilterHandle;
+    uint32_t prefetchFilterHandle;
+
+    bool patReceived;
+    bool pmtReceived;
+    bool changeChannel;
+    bool patChanged;
+    bool pmtChanged;
+    bool pmtFilterSet;
+    bool prefetchRequested;
+    bool prefetchFilterSet;
+    bool isInitialized;
+    bool initFinished;
+    StreamStartupStage startupStage;                /* Guarded by initMutex */
+    bool ownsTimeFilter;
+    bool reportsToUi;
+
+    uint32_t currentVolume;
+    int16_t programNumber;
+    int16_t prefetchChannel;
+    uint8_t threadExit;
+
+    ChannelInfo currentChannel;
+    ZapStatistics zapStatistics;
+    uint64_t zapRequestTime;                        /* Monotonic microseconds of pending channel change request */
+    uint64_t zapStartTime;                          /* Monotonic microseconds of request of zap in progress */
+    uint64_t zapKeyTime;                            /* Monotonic microseconds of key event of pending request, 0 if none */
+    uint64_t zapKeyStartTime;                       /* Key event time of zap in progress, 0 if it was not started by a key */
+    uint32_t zapTag;                                /* Tag of stream commands of zap in progress, 0 for other commands */
+    uint8_t pendingZapStreams;                      /* Stream commands of zap in progress that did not complete */
+};
 
 
 static StreamControllerError loadConfigFile(char* filename, InitialInfo* configInfo);
-static void startChannel(int32_t channelNumber);
+static void startChannel(StreamPipeline* pipeline, int32_t channelNumber);
+static void selectStreams(StreamPipeline* pipeline, int16_t* audioPid, int16_t* videoPid, int8_t* teletext);
+static void playerCommandCallback(const PlayerCommandResult* result, void* userData);
+static void updateGapStatistics(ZapGapStatistics* statistics, uint32_t gap);
+static StreamControllerError setPmtFilter(StreamPipeline* pipeline, uint16_t pid);
+static void freePmtFilter(StreamPipeline* pipeline);
+static void handlePatChange(StreamPipeline* pipeline);
+static void handlePmtChange(StreamPipeline* pipeline);
+static void prefetchChannel(StreamPipeline* pipeline, int32_t channelNumber);
+static uint16_t countChannels(StreamPipeline* pipeline);
+static const PatServiceInfo* findChannel(const PatTable* patTable, int32_t channelNumber);
+static void freePrefetchFilter(StreamPipeline* pipeline);
+static void cachePmtSection(StreamPipeline* pipeline, uint16_t programNumber, SectionBuffer* section);
+static SectionBuffer* findCachedPmtSection(StreamPipeline* pipeline, uint16_t programNumber);
+static void clearPmtCache(StreamPipeline* pipeline);
 static void removeWhiteSpaces(char* string);
-static void* streamControllerTask();
-static void* parseTimeTables();
+static ThreadRole threadRoleByKey(const char* key);
+static void* streamControllerTask(void* pipelineArgument);
+static void reportCurrentTime();
 static int32_t sectionReceivedCallback(uint8_t *buffer);
+static void queueSection(StreamPipeline* pipeline, SectionBuffer* section);
+static void drainSectionQueue(void* pipelineArgument);
+static void stopSectionDispatch(StreamPipeline* pipeline);
+static void dispatchSection(StreamPipeline* pipeline, SectionBuffer* section);
+static void tableWaitDeadline(struct timespec* deadline);
+static bool tableWaitInterrupted(StreamPipeline* pipeline);
+static void wakeTableWait(StreamPipeline* pipeline);
+static void patAssembledCallback(const AssembledTable* table, void* userData);
 static int32_t tunerStatusCallback(t_LockStatus status);
+static StreamControllerError acquireSharedResources(const InitialInfo* configInfo);
+static void releaseSharedResources(StreamPipeline* pipeline);
+static void setVolume(StreamPipeline* pipeline, uint32_t volume);
+static StreamControllerError createPipeline(const InitialInfo* initialInfo, StreamPipeline** pipeline, bool isDefault);
+static void setStartupStage(StreamPipeline* pipeline, StreamStartupStage stage);
 
 
-static PatTable *patTable;
-static PmtTable *pmtTable;
-static TdtTable *tdtTable;
-static TotTable *totTable;
-
+/* resources shared by all pipelines: tuner, section pool, time service and demux callback */
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t statusCondition = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t statusMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t initCond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t initMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t demuxCond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t demuxMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_t scThread;
-
-static uint32_t playerHandle = 0;
-static uint32_t sourceHandle = 0;
-static uint32_t streamHandleA = 0;
-static uint32_t streamHandleV = 0;
-static uint32_t filterHandle = 0;
+static uint32_t sharedUsers = 0;
+static bool tunerLocked = false;
+static uint32_t sharedFrequency = 0;              /* Tuning of the shared tuner, every pipeline has to match it */
+static uint32_t sharedBandwidth = 0;
+static t_Module sharedModule;
+static TaskExecutor* sectionExecutor = NULL;      /* Runs parsers of all pipelines, NULL parses on the driver thread */
+
+static pthread_mutex_t pipelinesMutex = PTHREAD_MUTEX_INITIALIZER;
+static StreamPipeline* pipelines[STREAM_MAX_PIPELINES];
+static StreamPipeline* defaultPipeline = NULL;
 
 static VolumeCallback volumeReportCallback = NULL;
 static TimeCallback timeRecievedCallback = NULL;
 static ProgramTypeCallback programType = NULL;
 
-static bool timeTablesRecieved = false;
-static bool changeChannel = false;
-static bool isInitialized = false;
-
 static uint32_t volumeConstant = 160400000;
-static uint32_t currentVolume = 5;
 static int16_t programNumber = 0;
-static uint8_t threadExit = 0;
 
-static ChannelInfo currentChannel;
-static TimeStructure startTime;
 static InitialInfo configFile;
 
-static struct timespec lockStatusWaitTime;
-static struct timeval now;
-
 
 StreamControllerError streamControllerInit()
 {
-    if (pthread_create(&scThread, NULL, &streamControllerTask, NULL))
+    configFile.programNumber = programNumber;
+
+    return createPipeline(&configFile, &defaultPipeline, true);
+}
+
+StreamControllerError streamControllerDeinit()
+{
+    StreamControllerError error = SC_NO_ERROR;
+
+    if (defaultPipeline == NULL)
     {
-        printf("Error creating input event task!\n");
+        printf("\n%s : ERROR streamControllerDeinit() fail, module is not initialized!\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    error = streamPipelineDestroy(defaultPipeline);
+    defaultPipeline = NULL;
+
+    return error;
+}
+
+StreamControllerError streamPipelineCreate(const InitialInfo* initialInfo, StreamPipeline** pipeline)
+{
+    return createPipeline(initialInfo, pipeline, false);
+}
+
+StreamControllerError createPipeline(const InitialInfo* initialInfo, StreamPipeline** pipeline, bool isDefault)
+{
+    StreamPipeline* newPipeline = NULL;
+    uint8_t i = 0;
+
+    if (initialInfo == NULL || pipeline == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    newPipeline = (StreamPipeline*)malloc(sizeof(StreamPipeline));
+    if (newPipeline == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+    memset(newPipeline, 0x0, sizeof(StreamPipeline));
+
+    newPipeline->configInfo = *initialInfo;
+    newPipeline->programNumber = initialInfo->programNumber;
+    newPipeline->currentVolume = 5;
+    pthread_cond_init(&newPipeline->initCond, NULL);
+    pthread_mutex_init(&newPipeline->initMutex, NULL);
+    pthread_cond_init(&newPipeline->demuxCond, NULL);
+    pthread_mutex_init(&newPipeline->demuxMutex, NULL);
+    pthread_cond_init(&newPipeline->commandCond, NULL);
+    pthread_mutex_init(&newPipeline->commandMutex, NULL);
+    pthread_mutex_init(&newPipeline->sectionQueueMutex, NULL);
+    taskGroupInit(&newPipeline->sectionTasks);
+    tableAssemblerInit(&newPipeline->patAssembler, patAssembledCallback, newPipeline);
+
+    /* register pipeline so demux callback can hand sections to it */
+    pthread_mutex_lock(&pipelinesMutex);
+    for (i = 0; i < STREAM_MAX_PIPELINES; i++)
+    {
+        if (pipelines[i] == NULL)
+        {
+            break;
+        }
+    }
+    if (i == STREAM_MAX_PIPELINES)
+    {
+        pthread_mutex_unlock(&pipelinesMutex);
+        printf("\n%s : ERROR too many stream pipelines\n", __FUNCTION__);
+        free(newPipeline);
+        return SC_ERROR;
+    }
+    /* default pipeline shows its channel and time on the OSD and keeps the TOT and TDT filters */
+    newPipeline->reportsToUi = isDefault;
+    newPipeline->ownsTimeFilter = newPipeline->reportsToUi;
+    pipelines[i] = newPipeline;
+    pthread_mutex_unlock(&pipelinesMutex);
+
+    if (threadPolicyCreateThread(THREAD_ROLE_ZAP_CONTROL, &newPipeline->thread, &streamControllerTask, newPipeline))
+    {
+        printf("Error creating stream controller task!\n");
+        pthread_mutex_lock(&pipelinesMutex);
+        pipelines[i] = NULL;
+        pthread_mutex_unlock(&pipelinesMutex);
+        free(newPipeline);
         return SC_THREAD_ERROR;
     }
 
+    *pipeline = newPipeline;
+
     return SC_NO_ERROR;
 }
 
-StreamControllerError streamControllerDeinit()
+StreamControllerError streamPipelineDestroy(StreamPipeline* pipeline)
 {
-    if (!isInitialized)
+    if (pipeline == NULL)
     {
-        pthread_mutex_lock(&initMutex);
-        pthread_cond_wait(&initCond, &initMutex);
-        pthread_mutex_unlock(&initMutex);
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SC_ERROR;
     }
-    
-    if (!isInitialized) 
+
+    /* pipeline task may still wait for PAT or PMT, it gives up as soon as it sees the exit request */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    pipeline->threadExit = 1;
+    pthread_cond_signal(&pipeline->commandCond);
+    pthread_mutex_unlock(&pipeline->commandMutex);
+    wakeTableWait(pipeline);
+
+    /* wait for pipeline task to finish its initialization */
+    pthread_mutex_lock(&pipeline->initMutex);
+    while (!pipeline->initFinished)
     {
-        printf("\n%s : ERROR streamControllerDeinit() fail, module is not initialized!\n", __FUNCTION__);
-        return SC_ERROR;
+        pthread_cond_wait(&pipeline->initCond, &pipeline->initMutex);
     }
-    
-    threadExit = 1;
-    if (pthread_join(scThread, NULL))
+    pthread_mutex_unlock(&pipeline->initMutex);
+
+    if (pthread_join(pipeline->thread, NULL))
     {
         printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
         return SC_THREAD_ERROR;
     }
-    
-    /* free demux filter */  
-    Demux_Free_Filter(playerHandle, filterHandle);
 
-    /* remove audio stream */
-    Player_Stream_Remove(playerHandle, sourceHandle, streamHandleA);
-    
-    /* remove video stream */
-    Player_Stream_Remove(playerHandle, sourceHandle, streamHandleV);
-    
-    /* close player source */
-    Player_Source_Close(playerHandle, sourceHandle);
-    
-    /* deinitialize player */
-    Player_Deinit(playerHandle);
-    
-    /* deinitialize tuner device */
-    Tuner_Deinit();
-    
-    /* free allocated memory */  
-    free(patTable);
-    free(pmtTable);
-    free(tdtTable);
-    free(totTable);
+    stopSectionDispatch(pipeline);
 
-    /* set isInitialized flag */
-    isInitialized = false;
+    if (pipeline->isInitialized)
+    {
+        /* free demux filters */  
+        Demux_Free_Filter(pipeline->playerHandle, pipeline->patFilterHandle);
+        freePmtFilter(pipeline);
+        freePrefetchFilter(pipeline);
+        if (pipeline->ownsTimeFilter)
+        {
+            Demux_Free_Filter(pipeline->playerHandle, pipeline->timeFilterHandle);
+            Demux_Free_Filter(pipeline->playerHandle, pipeline->tdtFilterHandle);
+        }
+
+        /* remove audio and video streams, actuator runs all queued commands before it stops */
+        playerActuatorRemoveStream(pipeline->actuator, STREAM_SLOT_AUDIO, 0);
+        playerActuatorRemoveStream(pipeline->actuator, STREAM_SLOT_VIDEO, 0);
+        playerActuatorDestroy(pipeline->actuator);
+        
+        /* close player source */
+        Player_Source_Close(pipeline->playerHandle, pipeline->sourceHandle);
+        
+        /* deinitialize player */
+        Player_Deinit(pipeline->playerHandle);
+
+        /* free section buffers held by this pipeline */
+        tableAssemblerReset(&pipeline->patAssembler);
+        sectionBufferRelease(pipeline->pmtSection);
+        pipeline->pmtSection = NULL;
+        clearPmtCache(pipeline);
+
+        /* deinitialize tuner device and section pool when last pipeline is gone */
+        releaseSharedResources(pipeline);
+    }
+
+    pthread_cond_destroy(&pipeline->initCond);
+    pthread_mutex_destroy(&pipeline->initMutex);
+    pthread_cond_destroy(&pipeline->demuxCond);
+    pthread_mutex_destroy(&pipeline->demuxMutex);
+    pthread_cond_destroy(&pipeline->commandCond);
+    pthread_mutex_destroy(&pipeline->commandMutex);
+    pthread_mutex_destroy(&pipeline->sectionQueueMutex);
+    taskGroupDestroy(&pipeline->sectionTasks);
+
+    free(pipeline);
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelineChangeChannel(StreamPipeline* pipeline, uint16_t channelNumber)
+{
+    if (pipeline == NULL || !pipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    if (channelNumber < countChannels(pipeline))
+    {
+        pthread_mutex_lock(&pipeline->commandMutex);
+        pipeline->programNumber = channelNumber;
+        pipeline->changeChannel = true;
+        pipeline->zapRequestTime = monotonicMicroseconds();
+        pthread_cond_signal(&pipeline->commandCond);
+        pthread_mutex_unlock(&pipeline->commandMutex);
+
+        /* channel that is still waiting for its PMT is abandoned */
+        wakeTableWait(pipeline);
+    }
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelinePrefetchChannel(StreamPipeline* pipeline, uint16_t channelNumber)
+{
+    if (pipeline == NULL || !pipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    if (channelNumber < countChannels(pipeline))
+    {
+        pthread_mutex_lock(&pipeline->commandMutex);
+        pipeline->prefetchChannel = channelNumber;
+        pipeline->prefetchRequested = true;
+        pthread_cond_signal(&pipeline->commandCond);
+        pthread_mutex_unlock(&pipeline->commandMutex);
+    }
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelineSetZapKeyTime(StreamPipeline* pipeline, uint64_t keyTime)
+{
+    if (pipeline == NULL || !pipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    pthread_mutex_lock(&pipeline->commandMutex);
+    pipeline->zapKeyTime = keyTime;
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelineGetChannelCount(StreamPipeline* pipeline, uint16_t* channelCount)
+{
+    if (pipeline == NULL || channelCount == NULL)
+    {
+        printf("\n%s : Error wrong parameter\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    if (!pipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    *channelCount = countChannels(pipeline);
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelineGetZapStatistics(StreamPipeline* pipeline, ZapStatistics* zapStatistics)
+{
+    if (pipeline == NULL || zapStatistics == NULL)
+    {
+        printf("\n%s : Error wrong parameter\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    pthread_mutex_lock(&pipeline->commandMutex);
+    *zapStatistics = pipeline->zapStatistics;
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError streamPipelineWaitStartupStage(StreamPipeline* pipeline, StreamStartupStage stage, uint32_t timeoutMs)
+{
+    StreamControllerError error = SC_NO_ERROR;
+    struct timespec deadline;
+
+    if (pipeline == NULL)
+    {
+        printf("\n%s : Error wrong parameter\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    /* failed initialization finishes without reaching its remaining stages */
+    pthread_mutex_lock(&pipeline->initMutex);
+    while (pipeline->startupStage < stage)
+    {
+        if ((pipeline->initFinished && !pipeline->isInitialized)
+            || ETIMEDOUT == pthread_cond_timedwait(&pipeline->initCond, &pipeline->initMutex, &deadline))
+        {
+            error = (pipeline->startupStage < stage) ? SC_ERROR : SC_NO_ERROR;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pipeline->initMutex);
+
+    return error;
+}
+
+StreamControllerError streamPipelineGetChannelInfo(StreamPipeline* pipeline, ChannelInfo* channelInfo)
+{
+    if (pipeline == NULL || channelInfo == NULL)
+    {
+        printf("\n%s : Error wrong parameter\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    channelInfo->programNumber = pipeline->currentChannel.programNumber;
+    channelInfo->audioPid = pipeline->currentChannel.audioPid;
+    channelInfo->videoPid = pipeline->currentChannel.videoPid;
+    channelInfo->teletext = pipeline->currentChannel.teletext;
 
     return SC_NO_ERROR;
 }
 
 StreamControllerError channelUp()
 {   
-    if (programNumber >= patTable->serviceInfoCount - 2)
+    int16_t nextProgram = 0;
+    uint16_t channelCount = 0;
+
+    if (defaultPipeline == NULL || !defaultPipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    channelCount = countChannels(defaultPipeline);
+    if (channelCount == 0)
+    {
+        return SC_ERROR;
+    }
+
+    if (defaultPipeline->programNumber >= channelCount - 1)
     {
-        programNumber = 0;
+        nextProgram = 0;
     } 
     else
     {
-        programNumber++;
+        nextProgram = defaultPipeline->programNumber + 1;
     }
 
-    /* set flag to start current channel */
-    changeChannel = true;
-
-    return SC_NO_ERROR;
+    /* start next channel */
+    return streamPipelineChangeChannel(defaultPipeline, nextProgram);
 }
 
 StreamControllerError channelDown()
 {
-    if (programNumber <= 0)
+    int16_t nextProgram = 0;
+    uint16_t channelCount = 0;
+
+    if (defaultPipeline == NULL || !defaultPipeline->isInitialized)
+    {
+        return SC_ERROR;
+    }
+
+    channelCount = countChannels(defaultPipeline);
+    if (channelCount == 0)
+    {
+        return SC_ERROR;
+    }
+
+    if (defaultPipeline->programNumber <= 0)
     {
-        programNumber = patTable->serviceInfoCount - 2;
+        nextProgram = channelCount - 1;
     } 
     else
     {
-        programNumber--;
+        nextProgram = defaultPipeline->programNumber - 1;
     }
    
-    /* set flag to start current channel */
-    changeChannel = true;
-
-    return SC_NO_ERROR;
+    /* start previous channel */
+    return streamPipelineChangeChannel(defaultPipeline, nextProgram);
 }
 
 StreamControllerError getChannelInfo(ChannelInfo* channelInfo)
 {
-    if (channelInfo == NULL)
-    {
-        printf("\n Error wrong parameter\n", __FUNCTION__);
-        return SC_ERROR;
-    }
-    
-    channelInfo->programNumber = currentChannel.programNumber;
-    channelInfo->audioPid = currentChannel.audioPid;
-    channelInfo->videoPid = currentChannel.videoPid;
-    
-    return SC_NO_ERROR;
+    return streamPipelineGetChannelInfo(defaultPipeline, channelInfo);
+}
+
+StreamControllerError getChannelCount(uint16_t* channelCount)
+{
+    return streamPipelineGetChannelCount(defaultPipeline, channelCount);
+}
+
+StreamControllerError getZapStatistics(ZapStatistics* zapStatistics)
+{
+    return streamPipelineGetZapStatistics(defaultPipeline, zapStatistics);
+}
+
+StreamControllerError waitStartupStage(StreamStartupStage stage, uint32_t timeoutMs)
+{
+    return streamPipelineWaitStartupStage(defaultPipeline, stage, timeoutMs);
 }
 
 /* Sets filter to receive current channel PMT table
  * Parses current channel PMT table when it arrives
  * Creates streams with current channel audio and video pids
  */
-void startChannel(int32_t channelNumber)
+void startChannel(StreamPipeline* pipeline, int32_t channelNumber)
 {
-    /* free PAT table filter */
-    Demux_Free_Filter(playerHandle, filterHandle);
+    SectionBuffer* cachedSection = NULL;
+    const PatServiceInfo* channel = NULL;
+    SectionView view;
+    struct timespec deadline;
+    uint16_t pmtPid = 0;
+    int16_t audioPid = -1;
+    int16_t videoPid = -1;
+    int8_t teletext = -1;
+    uint64_t zapStartTime = 0;
+    uint64_t zapKeyStartTime = 0;
+    uint32_t zapTag = 0;
+
+    /* zap is measured from the request, first start of the pipeline from here */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    zapStartTime = (pipeline->zapRequestTime != 0) ? pipeline->zapRequestTime : monotonicMicroseconds();
+    zapKeyStartTime = pipeline->zapKeyTime;
+    pipeline->zapRequestTime = 0;
+    pipeline->zapKeyTime = 0;
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    /* free previous PMT filter, PAT filter stays for the whole session, prefetch is over once a channel is started */
+    freePmtFilter(pipeline);
+    freePrefetchFilter(pipeline);
     
     /* set demux filter for receive PMT table of program */
-    if(Demux_Set_Filter(playerHandle, patTable->patServiceInfoArray[channelNumber + 1].pid, 0x02, &filterHandle))
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    channel = findChannel(&pipeline->patTable, channelNumber);
+    if (channel == NULL)
+    {
+        pthread_mutex_unlock(&pipeline->demuxMutex);
+        printf("\n%s : ERROR channel %d is not in PAT\n", __FUNCTION__, channelNumber);
+        return;
+    }
+    pipeline->requestedProgramNumber = channel->programNumber;
+    pmtPid = channel->pid;
+    pipeline->pmtTable.elementaryInfoCount = 0;
+    pipeline->pmtReceived = false;
+    pipeline->pmtVersion = -1;
+
+    /* PMT prefetched while channel number was typed, streams can be started without waiting for it */
+    cachedSection = findCachedPmtSection(pipeline, pipeline->requestedProgramNumber);
+    if (cachedSection != NULL && sectionViewInit(&view, cachedSection->data, cachedSection->length) == TABLES_PARSE_OK
+        && parsePmtTable(&view, &pipeline->pmtTable) == TABLES_PARSE_OK)
+    {
+        sectionBufferRetain(cachedSection);
+        sectionBufferRelease(pipeline->pmtSection);
+        pipeline->pmtSection = cachedSection;
+        pipeline->pmtVersion = pipeline->pmtTable.pmtHeader.versionNumber;
+        pipeline->pmtReceived = true;
+    }
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+
+    if (setPmtFilter(pipeline, pmtPid))
     {
-        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
         return;
     }
     
-    /* wait for a PMT table to be parsed*/
-    pthread_mutex_lock(&demuxMutex);
-    if (ETIMEDOUT == pthread_cond_wait(&demuxCond, &demuxMutex))
+    /* wait for a PMT table to be parsed, newer channel request or exit abandons this channel */
+    tableWaitDeadline(&deadline);
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    while (!pipeline->pmtReceived)
+    {
+        if (tableWaitInterrupted(pipeline))
+        {
+            pthread_mutex_unlock(&pipeline->demuxMutex);
+            return;
+        }
+        if (ETIMEDOUT == pthread_cond_timedwait(&pipeline->demuxCond, &pipeline->demuxMutex, &deadline))
+        {
+            printf("\n%s : ERROR PMT of program %d not received!\n", __FUNCTION__, pipeline->requestedProgramNumber);
+            pthread_mutex_unlock(&pipeline->demuxMutex);
+            return;
+        }
+    }
+    selectStreams(pipeline, &audioPid, &videoPid, &teletext);
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+
+    /* streams are switched by the actuator, zap is complete when both commands report back */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    pipeline->zapTag = (pipeline->zapTag == UINT32_MAX) ? 1 : pipeline->zapTag + 1;
+    zapTag = pipeline->zapTag;
+    pipeline->zapStartTime = zapStartTime;
+    pipeline->zapKeyStartTime = zapKeyStartTime;
+    pipeline->pendingZapStreams = (videoPid != -1) + (audioPid != -1);
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    if (videoPid != -1) 
+    {
+        playerActuatorSetStream(pipeline->actuator, STREAM_SLOT_VIDEO, videoPid, VIDEO_TYPE_MPEG2, zapTag);
+    }
+
+    if (audioPid != -1)
+    {   
+        playerActuatorSetStream(pipeline->actuator, STREAM_SLOT_AUDIO, audioPid, AUDIO_TYPE_MPEG_AUDIO, zapTag);
+    }
+
+    /* channel without streams is started as soon as it is selected, others when the actuator reports back */
+    if (videoPid == -1 && audioPid == -1)
     {
-        printf("\n%s : ERROR Lock timeout exceeded!\n", __FUNCTION__);
-        streamControllerDeinit();
+        setStartupStage(pipeline, STREAM_STAGE_PLAYING);
     }
-    pthread_mutex_unlock(&demuxMutex);
     
-    /* get audio and video pids */
-    int16_t audioPid = -1;
-    int16_t videoPid = -1;
-    int8_t teletext = -1;
+    /* store current channel info */
+    pipeline->currentChannel.programNumber = channelNumber + 1;
+    pipeline->currentChannel.audioPid = audioPid;
+    pipeline->currentChannel.videoPid = videoPid;
+    pipeline->currentChannel.teletext = teletext;
+
+    if (!pipeline->reportsToUi)
+    {
+        return;
+    }
+
+    if (programType != NULL)
+    {
+        programType(videoPid);
+    }
+    else
+    {
+        printf("\n%s : ERROR Program type callback not registred!\n", __FUNCTION__);
+    }
+}
+
+/* Called with demuxMutex locked, PMT section stays referenced while it is held */
+void selectStreams(StreamPipeline* pipeline, int16_t* audioPid, int16_t* videoPid, int8_t* teletext)
+{
+    PmtTable* pmtTable = &pipeline->pmtTable;
+    Descriptor descriptor;
     uint8_t i = 0;
 
+    *audioPid = -1;
+    *videoPid = -1;
+    *teletext = -1;
+
     for (i = 0; i < pmtTable->elementaryInfoCount; i++)
     {
         if (((pmtTable->pmtElementaryInfoArray[i].streamType == 0x1) || (pmtTable->pmtElementaryInfoArray[i].streamType == 0x2) || (pmtTable->pmtElementaryInfoArray[i].streamType == 0x1b))
-            && (videoPid == -1))
+            && (*videoPid == -1))
         {
-            videoPid = pmtTable->pmtElementaryInfoArray[i].elementaryPid;
+            *videoPid = pmtTable->pmtElementaryInfoArray[i].elementaryPid;
         } 
         else if (((pmtTable->pmtElementaryInfoArray[i].streamType == 0x3) || (pmtTable->pmtElementaryInfoArray[i].streamType == 0x4))
-            && (audioPid == -1))
+            && (*audioPid == -1))
         {
-            audioPid = pmtTable->pmtElementaryInfoArray[i].elementaryPid;
+            *audioPid = pmtTable->pmtElementaryInfoArray[i].elementaryPid;
         }
 
-        if (pmtTable->pmtElementaryInfoArray[i].elementaryPid == 0x56)
+        if (descriptorFind(pmtTable->pmtElementaryInfoArray[i].esInfo, pmtTable->pmtElementaryInfoArray[i].esInfoLength, DESCRIPTOR_TAG_TELETEXT, &descriptor))
         {
-            teletext = 1;
+            *teletext = 1;
         }
     }
+}
 
-    if (videoPid != -1) 
+/* Completion of player commands, called on actuator thread */
+void playerCommandCallback(const PlayerCommandResult* result, void* userData)
+{
+    StreamPipeline* pipeline = (StreamPipeline*)userData;
+    ZapStatistics* zapStatistics = &pipeline->zapStatistics;
+    uint64_t now = 0;
+    uint32_t zapTime = 0;
+    bool zapFinished = false;
+
+    if (result->status == PLAYER_COMMAND_FAILED)
+    {
+        printf("\n%s : ERROR player command %d on pid %d failed\n", __FUNCTION__, result->type, result->pid);
+    }
+
+    if (result->type != PLAYER_COMMAND_SET_STREAM || result->tag == 0)
+    {
+        return;
+    }
+
+    /* commands of a zap that was overtaken by a newer one are not counted */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    if (result->tag == pipeline->zapTag && pipeline->pendingZapStreams > 0)
     {
-        /* remove previous video stream */
-        if (streamHandleV != 0)
+        if (result->status == PLAYER_COMMAND_DONE || result->status == PLAYER_COMMAND_UNCHANGED)
         {
-            Player_Stream_Remove(playerHandle, sourceHandle, streamHandleV);
-            streamHandleV = 0;
+            updateGapStatistics((result->slot == STREAM_SLOT_VIDEO) ? &zapStatistics->blackScreen : &zapStatistics->silence,
+                result->gap);
         }
 
-        /* create video stream */
-        if(Player_Stream_Create(playerHandle, sourceHandle, videoPid, VIDEO_TYPE_MPEG2, &streamHandleV))
+        pipeline->pendingZapStreams--;
+        if (pipeline->pendingZapStreams == 0)
         {
-            printf("\n%s : ERROR Cannot create video stream\n", __FUNCTION__);
-            streamControllerDeinit();
+            now = monotonicMicroseconds();
+            zapTime = (uint32_t)(now - pipeline->zapStartTime);
+            zapStatistics->zapCount++;
+            updateGapStatistics(&zapStatistics->zap, zapTime);
+            if (pipeline->zapKeyStartTime != 0 && pipeline->zapKeyStartTime <= now)
+            {
+                updateGapStatistics(&zapStatistics->keyToZap, (uint32_t)(now - pipeline->zapKeyStartTime));
+            }
+            zapFinished = true;
         }
     }
+    pthread_mutex_unlock(&pipeline->commandMutex);
 
-    if (audioPid != -1)
-    {   
-        /* remove previos audio stream */
-        if (streamHandleA != 0)
+    if (zapFinished)
+    {
+        setStartupStage(pipeline, STREAM_STAGE_PLAYING);
+        printf("\nZap finished : %u us, black screen %u us, silence %u us\n", zapTime,
+            zapStatistics->blackScreen.last, zapStatistics->silence.last);
+    }
+}
+
+void setStartupStage(StreamPipeline* pipeline, StreamStartupStage stage)
+{
+    pthread_mutex_lock(&pipeline->initMutex);
+    if (stage > pipeline->startupStage)
+    {
+        pipeline->startupStage = stage;
+        pthread_cond_broadcast(&pipeline->initCond);
+    }
+    pthread_mutex_unlock(&pipeline->initMutex);
+}
+
+/* Called with commandMutex locked */
+void updateGapStatistics(ZapGapStatistics* statistics, uint32_t gap)
+{
+    if (gap == 0)
+    {
+        statistics->keptCount++;
+    }
+    if (statistics->count == 0 || gap < statistics->min)
+    {
+        statistics->min = gap;
+    }
+    statistics->count++;
+    statistics->last = gap;
+    statistics->total += gap;
+    statistics->totalSquares += (uint64_t)gap * gap;
+    if (gap > statistics->max)
+    {
+        statistics->max = gap;
+    }
+}
+
+StreamControllerError setPmtFilter(StreamPipeline* pipeline, uint16_t pid)
+{
+    if (Demux_Set_Filter(pipeline->playerHandle, pid, 0x02, &pipeline->pmtFilterHandle))
+    {
+        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+    pipeline->pmtFilterSet = true;
+    pipeline->pmtPid = pid;
+
+    return SC_NO_ERROR;
+}
+
+void freePmtFilter(StreamPipeline* pipeline)
+{
+    if (pipeline->pmtFilterSet)
+    {
+        Demux_Free_Filter(pipeline->playerHandle, pipeline->pmtFilterHandle);
+        pipeline->pmtFilterSet = false;
+    }
+}
+
+/* New PAT version while channel plays, PMT filter follows current program if its PMT pid moved */
+void handlePatChange(StreamPipeline* pipeline)
+{
+    int32_t channelNumber = -1;
+    int32_t channelIndex = 0;
+    uint16_t pmtPid = 0;
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    for (i = 0; i < pipeline->patTable.serviceInfoCount; i++)
+    {
+        if (pipeline->patTable.patServiceInfoArray[i].programNumber == 0)
         {
-            Player_Stream_Remove(playerHandle, sourceHandle, streamHandleA);
-            streamHandleA = 0;
+            continue;
         }
-
-        /* create audio stream */
-        if(Player_Stream_Create(playerHandle, sourceHandle, audioPid, AUDIO_TYPE_MPEG_AUDIO, &streamHandleA))
+        if (pipeline->patTable.patServiceInfoArray[i].programNumber == pipeline->requestedProgramNumber)
         {
-            printf("\n%s : ERROR Cannot create audio stream\n", __FUNCTION__);
-            streamControllerDeinit();
+            channelNumber = channelIndex;
+            pmtPid = pipeline->patTable.patServiceInfoArray[i].pid;
+            break;
         }
+        channelIndex++;
     }
-    
-    /* store current channel info */
-    currentChannel.programNumber = channelNumber + 1;
-    currentChannel.audioPid = audioPid;
-    currentChannel.videoPid = videoPid;
-    currentChannel.teletext = teletext;
+    pthread_mutex_unlock(&pipeline->demuxMutex);
 
-    if (programType != NULL)
+    if (channelNumber == -1)
     {
-        programType(videoPid);
+        printf("\n%s : program %d is not in PAT any more\n", __FUNCTION__, pipeline->requestedProgramNumber);
+        return;
     }
-    else
+
+    /* channel numbers are positions among PAT programs, keep them pointing to the program that plays */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    if (!pipeline->changeChannel)
     {
-        printf("\n%s : ERROR Program type callback not registred!\n", __FUNCTION__);
-        streamControllerDeinit();
+        pipeline->programNumber = channelNumber;
     }
+    pthread_mutex_unlock(&pipeline->commandMutex);
+    pipeline->currentChannel.programNumber = channelNumber + 1;
 
-    if (timeTablesRecieved == false)
+    if (pmtPid != pipeline->pmtPid)
     {
-        parseTimeTables();
+        printf("\n%s : PMT of program %d moved to pid %d\n", __FUNCTION__, pipeline->requestedProgramNumber, pmtPid);
+        freePmtFilter(pipeline);
+
+        /* PMT on the new pid may reuse the old version number */
+        pthread_mutex_lock(&pipeline->demuxMutex);
+        pipeline->pmtVersion = -1;
+        pthread_mutex_unlock(&pipeline->demuxMutex);
+
+        setPmtFilter(pipeline, pmtPid);
     }
 }
 
-void* parseTimeTables()
+/* New PMT version while channel plays, only streams whose pid changed are recreated, -1 pid removes the stream */
+void handlePmtChange(StreamPipeline* pipeline)
 {
-    struct timeval tempTime;
+    int16_t audioPid = -1;
+    int16_t videoPid = -1;
+    int8_t teletext = -1;
+
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    selectStreams(pipeline, &audioPid, &videoPid, &teletext);
+    pthread_mutex_unlock(&pipeline->demuxMutex);
 
-    /* free previous table filter */
-    Demux_Free_Filter(playerHandle, filterHandle);
+    pipeline->currentChannel.teletext = teletext;
 
-    /* set demux filter for receive TDT table of program */
-    if(Demux_Set_Filter(playerHandle, 0x0014, 0x70, &filterHandle))
+    if (audioPid != pipeline->currentChannel.audioPid)
     {
-        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
-        return (void*) SC_ERROR;
+        printf("\n%s : audio pid %d -> %d\n", __FUNCTION__, pipeline->currentChannel.audioPid, audioPid);
+        playerActuatorSetStream(pipeline->actuator, STREAM_SLOT_AUDIO, audioPid, AUDIO_TYPE_MPEG_AUDIO, 0);
+        pipeline->currentChannel.audioPid = audioPid;
     }
 
-    /* wait for a TDT table to be parsed*/
-    pthread_mutex_lock(&demuxMutex);
-    if (ETIMEDOUT == pthread_cond_wait(&demuxCond, &demuxMutex))
+    if (videoPid == pipeline->currentChannel.videoPid)
     {
-        printf("\n%s : ERROR Lock timeout exceeded!\n", __FUNCTION__);
-        streamControllerDeinit();
-    }    
-    pthread_mutex_unlock(&demuxMutex);
+        return;
+    }
+
+    printf("\n%s : video pid %d -> %d\n", __FUNCTION__, pipeline->currentChannel.videoPid, videoPid);
+    playerActuatorSetStream(pipeline->actuator, STREAM_SLOT_VIDEO, videoPid, VIDEO_TYPE_MPEG2, 0);
+    pipeline->currentChannel.videoPid = videoPid;
 
-    gettimeofday(&tempTime, NULL);
+    /* program may have turned into radio or back */
+    if (pipeline->reportsToUi && programType != NULL)
+    {
+        programType(videoPid);
+    }
+}
 
-    /* free TDT table filter */
-    Demux_Free_Filter(playerHandle, filterHandle);
+/* Sets filter on PMT of a channel that is likely to be started next, PMT is cached when it arrives */
+void prefetchChannel(StreamPipeline* pipeline, int32_t channelNumber)
+{
+    const PatServiceInfo* channel = NULL;
+    uint16_t prefetchProgramNumber = 0;
+    uint16_t prefetchPid = 0;
 
-    /* set demux filter for receive TOT table of program */
-    if(Demux_Set_Filter(playerHandle, 0x0014, 0x73, &filterHandle))
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    channel = findChannel(&pipeline->patTable, channelNumber);
+    if (channel == NULL)
     {
-        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
-        return (void*) SC_ERROR;
+        pthread_mutex_unlock(&pipeline->demuxMutex);
+        return;
     }
+    prefetchProgramNumber = channel->programNumber;
+    prefetchPid = channel->pid;
 
-    /* wait for a TDT table to be parsed*/
-    pthread_mutex_lock(&demuxMutex);
-    if (ETIMEDOUT == pthread_cond_wait(&demuxCond, &demuxMutex))
+    if (prefetchProgramNumber == pipeline->requestedProgramNumber || prefetchProgramNumber == pipeline->prefetchProgramNumber
+        || findCachedPmtSection(pipeline, prefetchProgramNumber) != NULL)
     {
-        printf("\n%s : ERROR Lock timeout exceeded!\n", __FUNCTION__);
-        streamControllerDeinit();
+        pthread_mutex_unlock(&pipeline->demuxMutex);
+        return;
     }
-    pthread_mutex_unlock(&demuxMutex);
+    pthread_mutex_unlock(&pipeline->demuxMutex);
 
-    uint8_t offsetHours = totTable->descriptors[0].ltoInfo[0].localTimeOffsetHours;
-    uint8_t offsetMinutes = totTable->descriptors[0].ltoInfo[0].localTimeOffsetMinutes;
+    freePrefetchFilter(pipeline);
 
-    startTime.hours = tdtTable->hours;
-    startTime.minutes = tdtTable->minutes;
-    startTime.seconds = tdtTable->seconds;
-    startTime.timeStampSeconds = tempTime.tv_sec;
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    pipeline->prefetchProgramNumber = prefetchProgramNumber;
+    pthread_mutex_unlock(&pipeline->demuxMutex);
 
-    if (totTable->descriptors[0].ltoInfo[0].localTimeOffsetPolarity == 0)
+    if (Demux_Set_Filter(pipeline->playerHandle, prefetchPid, 0x02, &pipeline->prefetchFilterHandle))
     {
-        startTime.hours += offsetHours;
-        startTime.minutes += offsetMinutes;
+        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
+        return;
+    }
+    pipeline->prefetchFilterSet = true;
+}
 
-        if (startTime.hours > 23)
-        {
-            startTime.hours -= 24;
-        }
+/* PAT entries with program number 0 point to the NIT, all others are channels in PAT order */
+uint16_t countChannels(StreamPipeline* pipeline)
+{
+    uint16_t channelCount = 0;
+    uint8_t i = 0;
 
-        if (startTime.minutes > 59)
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    for (i = 0; i < pipeline->patTable.serviceInfoCount; i++)
+    {
+        if (pipeline->patTable.patServiceInfoArray[i].programNumber != 0)
         {
-            startTime.minutes -= 60;
+            channelCount++;
         }
     }
-    else if (totTable->descriptors[0].ltoInfo[0].localTimeOffsetPolarity == 1)
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+
+    return channelCount;
+}
+
+/* Called with demuxMutex locked, returns NULL if PAT has no such channel */
+const PatServiceInfo* findChannel(const PatTable* patTable, int32_t channelNumber)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < patTable->serviceInfoCount; i++)
     {
-        if (offsetHours > startTime.hours)
-        {
-            startTime.hours = 24 - offsetHours;
-        }
-        else
+        if (patTable->patServiceInfoArray[i].programNumber != 0 && channelNumber-- == 0)
         {
-            startTime.hours -= offsetHours;
+            return &patTable->patServiceInfoArray[i];
         }
+    }
 
-        if (offsetMinutes > startTime.minutes)
-        {
-            startTime.hours = 60 - offsetMinutes;
-        }
-        else
+    return NULL;
+}
+
+void freePrefetchFilter(StreamPipeline* pipeline)
+{
+    if (pipeline->prefetchFilterSet)
+    {
+        Demux_Free_Filter(pipeline->playerHandle, pipeline->prefetchFilterHandle);
+        pipeline->prefetchFilterSet = false;
+    }
+
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    pipeline->prefetchProgramNumber = 0;
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+}
+
+/* Called with demuxMutex locked, replaces entry of the same program or the oldest one */
+void cachePmtSection(StreamPipeline* pipeline, uint16_t programNumber, SectionBuffer* section)
+{
+    PmtCacheEntry* entry = NULL;
+    uint8_t i = 0;
+
+    for (i = 0; i < STREAM_PMT_CACHE_SIZE; i++)
+    {
+        if (pipeline->pmtCache[i].section != NULL && pipeline->pmtCache[i].programNumber == programNumber)
         {
-            startTime.minutes -= offsetMinutes;
+            entry = &pipeline->pmtCache[i];
+            break;
         }
     }
 
-    if (timeRecievedCallback != NULL)
+    if (entry == NULL)
     {
-        timeRecievedCallback(&startTime);
+        entry = &pipeline->pmtCache[pipeline->pmtCacheNext];
+        pipeline->pmtCacheNext = (pipeline->pmtCacheNext + 1) % STREAM_PMT_CACHE_SIZE;
     }
-    else
+
+    sectionBufferRetain(section);
+    sectionBufferRelease(entry->section);
+    entry->section = section;
+    entry->programNumber = programNumber;
+    entry->receivedTime = time(NULL);
+}
+
+/* Called with demuxMutex locked, returns NULL if PMT of program is not cached or is too old */
+SectionBuffer* findCachedPmtSection(StreamPipeline* pipeline, uint16_t programNumber)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < STREAM_PMT_CACHE_SIZE; i++)
     {
-        printf("\n%s : ERROR Time callback not registred!\n", __FUNCTION__);
-        streamControllerDeinit();
+        if (pipeline->pmtCache[i].section != NULL && pipeline->pmtCache[i].programNumber == programNumber
+            && time(NULL) - pipeline->pmtCache[i].receivedTime <= STREAM_PMT_CACHE_MAX_AGE)
+        {
+            return pipeline->pmtCache[i].section;
+        }
     }
 
-    printf("Time tables parsed!\n");
-
-    timeTablesRecieved = true;
+    return NULL;
 }
 
-void* streamControllerTask()
+void clearPmtCache(StreamPipeline* pipeline)
 {
-    gettimeofday(&now,NULL);
-    lockStatusWaitTime.tv_sec = now.tv_sec+10;
+    uint8_t i = 0;
 
-    /* allocate memory for PAT table section */
-    patTable=(PatTable*)malloc(sizeof(PatTable));
-    if(patTable==NULL)
+    for (i = 0; i < STREAM_PMT_CACHE_SIZE; i++)
     {
-        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
-        return (void*) SC_ERROR;
-    }  
-    memset(patTable, 0x0, sizeof(PatTable));
+        sectionBufferRelease(pipeline->pmtCache[i].section);
+        pipeline->pmtCache[i].section = NULL;
+    }
+}
+
+void reportCurrentTime()
+{
+    LocalTime localTime;
+    TimeStructure currentTime;
 
-    /* allocate memory for PMT table section */
-    pmtTable=(PmtTable*)malloc(sizeof(PmtTable));
-    if(pmtTable==NULL)
+    if (timeServiceGetLocalTime(&localTime) != TS_NO_ERROR)
     {
-        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
-        return (void*) SC_ERROR;
+        return;
     }
-    memset(pmtTable, 0x0, sizeof(PmtTable));
 
-    /* allocate memory for TDT table section */
-    tdtTable=(TdtTable*)malloc(sizeof(TdtTable));
-    if(tdtTable==NULL)
+    currentTime.hours = localTime.hours;
+    currentTime.minutes = localTime.minutes;
+    currentTime.seconds = localTime.seconds;
+    currentTime.timeStampSeconds = localTime.utcSeconds;
+
+    if (timeRecievedCallback != NULL)
     {
-        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
-        return (void*) SC_ERROR;
-    }  
-    memset(tdtTable, 0x0, sizeof(TdtTable));
+        timeRecievedCallback(&currentTime);
+    }
+}
 
-    /* allocate memory for TOT table section */
-    totTable=(TotTable*)malloc(sizeof(TotTable));
-    if(totTable==NULL)
+StreamControllerError acquireSharedResources(const InitialInfo* configInfo)
+{
+    struct timespec lockStatusWaitTime;
+    struct timeval now;
+
+    pthread_mutex_lock(&sharedMutex);
+    if (sharedUsers > 0)
     {
-        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
-        return (void*) SC_ERROR;
-    }  
-    memset(totTable, 0x0, sizeof(TotTable));
+        /* one tuner, a pipeline tuned elsewhere would get sections from the wrong multiplex */
+        if (configInfo->tuneFrequency != sharedFrequency || configInfo->tuneBandwidth != sharedBandwidth
+            || configInfo->tuneModule != sharedModule)
+        {
+            printf("\n%s : ERROR pipeline tuning %d Hz, bandwidth %d, module %d differs from shared tuner %d Hz, bandwidth %d, module %d\n",
+                __FUNCTION__, configInfo->tuneFrequency, configInfo->tuneBandwidth, configInfo->tuneModule,
+                sharedFrequency, sharedBandwidth, sharedModule);
+            pthread_mutex_unlock(&sharedMutex);
+            return SC_ERROR;
+        }
+        sharedUsers++;
+        pthread_mutex_unlock(&sharedMutex);
+        return SC_NO_ERROR;
+    }
 
+    /* allocate section buffers shared between demux callback and parsers */
+    if (sectionPoolInit())
+    {
+        printf("\n%s : ERROR sectionPoolInit() fail\n", __FUNCTION__);
+        pthread_mutex_unlock(&sharedMutex);
+        return SC_ERROR;
+    }
+    timeServiceInit(configInfo->country, configInfo->countryRegionId);
        
     /* initialize tuner device */
     if(Tuner_Init())
     {
         printf("\n%s : ERROR Tuner_Init() fail\n", __FUNCTION__);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
-        return (void*) SC_ERROR;
+        sectionPoolDeinit();
+        pthread_mutex_unlock(&sharedMutex);
+        return SC_ERROR;
     }
     
     /* register tuner status callback */
@@ -433,173 +1123,514 @@ void* streamControllerTask()
     }
     
     /* lock to frequency */
-    if(!Tuner_Lock_To_Frequency(configFile.tuneFrequency, configFile.tuneBandwidth, configFile.tuneModule))
+    gettimeofday(&now,NULL);
+    lockStatusWaitTime.tv_sec = now.tv_sec+10;
+    lockStatusWaitTime.tv_nsec = 0;
+
+    if(!Tuner_Lock_To_Frequency(configInfo->tuneFrequency, configInfo->tuneBandwidth, configInfo->tuneModule))
     {
-        printf("\n%s: INFO Tuner_Lock_To_Frequency(): %d Hz - success!\n",__FUNCTION__, configFile.tuneFrequency);
+        printf("\n%s: INFO Tuner_Lock_To_Frequency(): %d Hz - success!\n",__FUNCTION__, configInfo->tuneFrequency);
     }
     else
     {
-        printf("\n%s: ERROR Tuner_Lock_To_Frequency(): %d Hz - fail!\n",__FUNCTION__, configFile.tuneFrequency);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
+        printf("\n%s: ERROR Tuner_Lock_To_Frequency(): %d Hz - fail!\n",__FUNCTION__, configInfo->tuneFrequency);
+        sectionPoolDeinit();
         Tuner_Deinit();
-        return (void*) SC_ERROR;
+        pthread_mutex_unlock(&sharedMutex);
+        return SC_ERROR;
     }
     
     /* wait for tuner to lock */
     pthread_mutex_lock(&statusMutex);
-    if(ETIMEDOUT == pthread_cond_timedwait(&statusCondition, &statusMutex, &lockStatusWaitTime))
+    while (!tunerLocked)
+    {
+        if(ETIMEDOUT == pthread_cond_timedwait(&statusCondition, &statusMutex, &lockStatusWaitTime))
+        {
+            printf("\n%s : ERROR Lock timeout exceeded!\n",__FUNCTION__);
+            pthread_mutex_unlock(&statusMutex);
+            sectionPoolDeinit();
+            Tuner_Deinit();
+            pthread_mutex_unlock(&sharedMutex);
+            return SC_ERROR;
+        }
+    }
+    pthread_mutex_unlock(&statusMutex);
+
+    /* sections are parsed on the shared executor, driver thread only queues them */
+    if (taskExecutorAcquireShared(&sectionExecutor))
+    {
+        printf("\n%s : ERROR taskExecutorAcquireShared() fail, sections are parsed on the driver thread\n", __FUNCTION__);
+        sectionExecutor = NULL;
+    }
+
+    /* register section filter callback, it hands every section to all pipelines */
+    if(Demux_Register_Section_Filter_Callback(sectionReceivedCallback))
+    {
+        printf("\n%s : ERROR Demux_Register_Section_Filter_Callback() fail\n", __FUNCTION__);
+    }
+
+    sharedFrequency = configInfo->tuneFrequency;
+    sharedBandwidth = configInfo->tuneBandwidth;
+    sharedModule = configInfo->tuneModule;
+    sharedUsers = 1;
+    pthread_mutex_unlock(&sharedMutex);
+
+    return SC_NO_ERROR;
+}
+
+void releaseSharedResources(StreamPipeline* pipeline)
+{
+    /* parsers of this pipeline must be done before the executor and the section pool can go away */
+    stopSectionDispatch(pipeline);
+
+    pthread_mutex_lock(&sharedMutex);
+    if (sharedUsers > 0 && --sharedUsers == 0)
     {
-        printf("\n%s : ERROR Lock timeout exceeded!\n",__FUNCTION__);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
+        Demux_Unregister_Section_Filter_Callback(sectionReceivedCallback);
+        if (sectionExecutor != NULL)
+        {
+            taskExecutorReleaseShared();
+            sectionExecutor = NULL;
+        }
+
+        /* deinitialize tuner device */
         Tuner_Deinit();
+        tunerLocked = false;
+
+        /* free section buffers */
+        sectionPoolDeinit();
+    }
+    pthread_mutex_unlock(&sharedMutex);
+}
+
+void* streamControllerTask(void* pipelineArgument)
+{
+    StreamPipeline* pipeline = (StreamPipeline*)pipelineArgument;
+    struct timespec deadline;
+
+    if (acquireSharedResources(&pipeline->configInfo))
+    {
+        pthread_mutex_lock(&pipeline->initMutex);
+        pipeline->initFinished = true;
+        pthread_cond_broadcast(&pipeline->initCond);
+        pthread_mutex_unlock(&pipeline->initMutex);
         return (void*) SC_ERROR;
     }
-    pthread_mutex_unlock(&statusMutex);
+    setStartupStage(pipeline, STREAM_STAGE_TUNER_LOCKED);
    
     /* initialize player */
-    if (Player_Init(&playerHandle))
+    if (Player_Init(&pipeline->playerHandle))
     {
         printf("\n%s : ERROR Player_Init() fail\n", __FUNCTION__);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
-        Tuner_Deinit();
+        releaseSharedResources(pipeline);
+        pthread_mutex_lock(&pipeline->initMutex);
+        pipeline->initFinished = true;
+        pthread_cond_broadcast(&pipeline->initCond);
+        pthread_mutex_unlock(&pipeline->initMutex);
         return (void*) SC_ERROR;
     }
 
-    /* set initial volume value */
-    if (Player_Volume_Set(playerHandle, currentVolume*volumeConstant))
-    {
-        printf("\n%sError setting volume", __FUNCTION__);
-    }
-    
     /* open source */
-    if (Player_Source_Open(playerHandle, &sourceHandle))
+    if (Player_Source_Open(pipeline->playerHandle, &pipeline->sourceHandle))
     {
         printf("\n%s : ERROR Player_Source_Open() fail\n", __FUNCTION__);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
-        Player_Deinit(playerHandle);
-        Tuner_Deinit();
+        Player_Deinit(pipeline->playerHandle);
+        releaseSharedResources(pipeline);
+        pthread_mutex_lock(&pipeline->initMutex);
+        pipeline->initFinished = true;
+        pthread_cond_broadcast(&pipeline->initCond);
+        pthread_mutex_unlock(&pipeline->initMutex);
         return (void*) SC_ERROR;    
     }
 
+    /* start thread that runs volume and stream commands */
+    if (playerActuatorCreate(pipeline->playerHandle, pipeline->sourceHandle, playerCommandCallback, pipeline, &pipeline->actuator))
+    {
+        printf("\n%s : ERROR playerActuatorCreate() fail\n", __FUNCTION__);
+        Player_Source_Close(pipeline->playerHandle, pipeline->sourceHandle);
+        Player_Deinit(pipeline->playerHandle);
+        releaseSharedResources(pipeline);
+        pthread_mutex_lock(&pipeline->initMutex);
+        pipeline->initFinished = true;
+        pthread_cond_broadcast(&pipeline->initCond);
+        pthread_mutex_unlock(&pipeline->initMutex);
+        return (void*) SC_ERROR;
+    }
+
+    /* set initial volume value */
+    setVolume(pipeline, pipeline->currentVolume);
+
     /* set PAT pid and tableID to demultiplexer */
-    if(Demux_Set_Filter(playerHandle, 0x00, 0x00, &filterHandle))
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    if(Demux_Set_Filter(pipeline->playerHandle, 0x00, 0x00, &pipeline->patFilterHandle))
     {
         printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
     }
-    
-    /* register section filter callback */
-    if(Demux_Register_Section_Filter_Callback(sectionReceivedCallback))
+
+    tableWaitDeadline(&deadline);
+    while (!pipeline->patReceived)
     {
-        printf("\n%s : ERROR Demux_Register_Section_Filter_Callback() fail\n", __FUNCTION__);
+        if (tableWaitInterrupted(pipeline)
+            || ETIMEDOUT == pthread_cond_timedwait(&pipeline->demuxCond, &pipeline->demuxMutex, &deadline))
+        {
+            printf("\n%s : ERROR PAT not received!\n", __FUNCTION__);
+            pthread_mutex_unlock(&pipeline->demuxMutex);
+            Demux_Free_Filter(pipeline->playerHandle, pipeline->patFilterHandle);
+            playerActuatorDestroy(pipeline->actuator);
+            Player_Source_Close(pipeline->playerHandle, pipeline->sourceHandle);
+            Player_Deinit(pipeline->playerHandle);
+            releaseSharedResources(pipeline);
+            pthread_mutex_lock(&pipeline->initMutex);
+            pipeline->initFinished = true;
+            pthread_cond_broadcast(&pipeline->initCond);
+            pthread_mutex_unlock(&pipeline->initMutex);
+            return (void*) SC_ERROR;
+        }
     }
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+    setStartupStage(pipeline, STREAM_STAGE_PAT_RECEIVED);
 
-    pthread_mutex_lock(&demuxMutex);
-    if (ETIMEDOUT == pthread_cond_wait(&demuxCond, &demuxMutex))
+    /* keep TOT and TDT filters for the whole session, time service is updated in the background */
+    if (pipeline->ownsTimeFilter && Demux_Set_Filter(pipeline->playerHandle, 0x0014, 0x73, &pipeline->timeFilterHandle))
     {
-        printf("\n%s:ERROR Lock timeout exceeded!\n", __FUNCTION__);
-        free(patTable);
-        free(pmtTable);
-        free(tdtTable);
-        free(totTable);
-        Player_Deinit(playerHandle);
-        Tuner_Deinit();
-        return (void*) SC_ERROR;
+        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
+    }
+    /* TDT comes more often than TOT, streams without TOT only have it */
+    if (pipeline->ownsTimeFilter && Demux_Set_Filter(pipeline->playerHandle, 0x0014, 0x70, &pipeline->tdtFilterHandle))
+    {
+        printf("\n%s : ERROR Demux_Set_Filter() fail\n", __FUNCTION__);
     }
-    pthread_mutex_unlock(&demuxMutex);
     
     /* start current channel */
-    startChannel(programNumber);
+    startChannel(pipeline, pipeline->programNumber);
     
     /* set isInitialized flag */
-    isInitialized = true;
+    pthread_mutex_lock(&pipeline->initMutex);
+    pipeline->isInitialized = true;
+    pipeline->initFinished = true;
+    pthread_cond_broadcast(&pipeline->initCond);
+    pthread_mutex_unlock(&pipeline->initMutex);
 
-    pthread_mutex_lock(&initMutex);
-    pthread_cond_signal(&initCond);
-    pthread_mutex_unlock(&initMutex);
-
-    while(!threadExit)
+    /* sleep until channel change or exit is requested */
+    pthread_mutex_lock(&pipeline->commandMutex);
+    while(!pipeline->threadExit)
     {
-        if (changeChannel)
+        if (pipeline->changeChannel)
+        {
+            pipeline->changeChannel = false;
+            pthread_mutex_unlock(&pipeline->commandMutex);
+            startChannel(pipeline, pipeline->programNumber);
+            pthread_mutex_lock(&pipeline->commandMutex);
+            continue;
+        }
+        if (pipeline->patChanged)
+        {
+            pipeline->patChanged = false;
+            pthread_mutex_unlock(&pipeline->commandMutex);
+            handlePatChange(pipeline);
+            pthread_mutex_lock(&pipeline->commandMutex);
+            continue;
+        }
+        if (pipeline->pmtChanged)
+        {
+            pipeline->pmtChanged = false;
+            pthread_mutex_unlock(&pipeline->commandMutex);
+            handlePmtChange(pipeline);
+            pthread_mutex_lock(&pipeline->commandMutex);
+            continue;
+        }
+        if (pipeline->prefetchRequested)
         {
-            changeChannel = false;
-            startChannel(programNumber);
+            pipeline->prefetchRequested = false;
+            pthread_mutex_unlock(&pipeline->commandMutex);
+            prefetchChannel(pipeline, pipeline->prefetchChannel);
+            pthread_mutex_lock(&pipeline->commandMutex);
+            continue;
         }
+        pthread_cond_wait(&pipeline->commandCond, &pipeline->commandMutex);
     }
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    return (void*) SC_NO_ERROR;
 }
 
 int32_t sectionReceivedCallback(uint8_t *buffer)
 {
-    uint8_t tableId = *buffer;
+    SectionBuffer* section = NULL;
+    uint16_t sectionLength = (uint16_t)(((*(buffer + 1) << 8) + *(buffer + 2)) & 0x0FFF);
+    uint8_t i = 0;
 
-    if (tableId==0x00)
+    /* driver thread is not created by us, it gets its scheduling on first callback */
+    threadPolicyApplyOnce(THREAD_ROLE_SECTIONS);
+
+    /* copy section out of the driver buffer once, every pipeline shares the pooled copy */
+    section = sectionBufferAcquire(sectionLength + 3);
+    if (section == NULL)
     {
-        //printf("\n%s -----PAT TABLE ARRIVED-----\n",__FUNCTION__);
-        
-        if (parsePatTable(buffer,patTable) == TABLES_PARSE_OK)
+        printf("\n%s : ERROR no free section buffer\n", __FUNCTION__);
+        return 0;
+    }
+    memcpy(section->data, buffer, section->length);
+
+    /* global lock only covers queueing, pipelines parse in parallel on the executor */
+    pthread_mutex_lock(&pipelinesMutex);
+    for (i = 0; i < STREAM_MAX_PIPELINES; i++)
+    {
+        if (pipelines[i] != NULL)
+        {
+            queueSection(pipelines[i], section);
+        }
+    }
+    pthread_mutex_unlock(&pipelinesMutex);
+
+    sectionBufferRelease(section);
+
+    return 0;
+}
+
+/* Called with pipelinesMutex locked, one drain task per pipeline keeps its sections in order */
+void queueSection(StreamPipeline* pipeline, SectionBuffer* section)
+{
+    bool schedule = false;
+
+    pthread_mutex_lock(&pipeline->sectionQueueMutex);
+    if (pipeline->sectionQueueCount == STREAM_SECTION_QUEUE_SIZE)
+    {
+        pipeline->droppedSections++;
+        pthread_mutex_unlock(&pipeline->sectionQueueMutex);
+        printf("\n%s : ERROR section queue full, %u sections dropped\n", __FUNCTION__, pipeline->droppedSections);
+        return;
+    }
+    sectionBufferRetain(section);
+    pipeline->sectionQueue[(pipeline->sectionQueueHead + pipeline->sectionQueueCount) % STREAM_SECTION_QUEUE_SIZE] = section;
+    pipeline->sectionQueueCount++;
+    if (!pipeline->sectionDrainScheduled)
+    {
+        pipeline->sectionDrainScheduled = true;
+        schedule = true;
+    }
+    pthread_mutex_unlock(&pipeline->sectionQueueMutex);
+
+    if (schedule && (sectionExecutor == NULL
+        || taskExecutorSubmit(sectionExecutor, TASK_PRIORITY_HIGH, drainSectionQueue, pipeline, &pipeline->sectionTasks)))
+    {
+        drainSectionQueue(pipeline);
+    }
+}
+
+void drainSectionQueue(void* pipelineArgument)
+{
+    StreamPipeline* pipeline = (StreamPipeline*)pipelineArgument;
+    SectionBuffer* section = NULL;
+
+    /* sections are parsed here, executor workers are not created with a role */
+    threadPolicyApplyOnce(THREAD_ROLE_SECTIONS);
+
+    while (true)
+    {
+        pthread_mutex_lock(&pipeline->sectionQueueMutex);
+        if (pipeline->sectionQueueCount == 0)
+        {
+            pipeline->sectionDrainScheduled = false;
+            pthread_mutex_unlock(&pipeline->sectionQueueMutex);
+            return;
+        }
+        section = pipeline->sectionQueue[pipeline->sectionQueueHead];
+        pipeline->sectionQueueHead = (pipeline->sectionQueueHead + 1) % STREAM_SECTION_QUEUE_SIZE;
+        pipeline->sectionQueueCount--;
+        pthread_mutex_unlock(&pipeline->sectionQueueMutex);
+
+        dispatchSection(pipeline, section);
+        sectionBufferRelease(section);
+    }
+}
+
+/* Removes pipeline from the demux callback and waits for sections already queued to it, can be called again */
+void stopSectionDispatch(StreamPipeline* pipeline)
+{
+    uint8_t i = 0;
+
+    pthread_mutex_lock(&pipelinesMutex);
+    for (i = 0; i < STREAM_MAX_PIPELINES; i++)
+    {
+        if (pipelines[i] == pipeline)
         {
-            //printPatTable(patTable);
-            pthread_mutex_lock(&demuxMutex);
-            pthread_cond_signal(&demuxCond);
-            pthread_mutex_unlock(&demuxMutex);
+            pipelines[i] = NULL;
         }
+    }
+    pthread_mutex_unlock(&pipelinesMutex);
+
+    if (sectionExecutor != NULL)
+    {
+        taskExecutorWait(sectionExecutor, &pipeline->sectionTasks);
+    }
+}
+
+void dispatchSection(StreamPipeline* pipeline, SectionBuffer* section)
+{
+    SectionView view;
+    uint8_t tableId = 0;
+
+    /* lengths are validated once here, parsers below trust the view */
+    if (sectionViewInit(&view, section->data, section->length) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+    tableId = view.tableId;
+
+    if (tableId==0x00)
+    {
+        //printf("\n%s -----PAT TABLE ARRIVED-----\n",__FUNCTION__);
+
+        /* PAT may span several sections, it is parsed once all of them arrived */
+        tableAssemblerPushSection(&pipeline->patAssembler, &view, section);
     } 
     else if (tableId==0x02)
     {
         //printf("\n%s -----PMT TABLE ARRIVED-----\n",__FUNCTION__);
         
-        if (parsePmtTable(buffer,pmtTable) == TABLES_PARSE_OK)
+        uint16_t sectionProgramNumber = (view.sectionLength >= 2) ? ((view.buffer[3] << 8) | view.buffer[4]) : 0;
+        int16_t sectionVersion = (view.sectionLength >= 3) ? ((view.buffer[5] >> 1) & 0x1F) : -1;
+        bool pmtChanged = false;
+
+        pthread_mutex_lock(&pipeline->demuxMutex);
+
+        /* only PMT of the program this pipeline plays is taken, and it is parsed only when its version changes */
+        if (sectionProgramNumber == pipeline->requestedProgramNumber)
+        {
+            if (sectionVersion != pipeline->pmtVersion && (view.buffer[5] & 0x01)
+                && parsePmtTable(&view, &pipeline->pmtTable) == TABLES_PARSE_OK)
+            {
+                //printPmtTable(&pipeline->pmtTable);
+
+                /* keep section referenced, PMT descriptor loops point into it */
+                sectionBufferRetain(section);
+                sectionBufferRelease(pipeline->pmtSection);
+                pipeline->pmtSection = section;
+                cachePmtSection(pipeline, sectionProgramNumber, section);
+                pipeline->pmtVersion = sectionVersion;
+
+                /* channel already plays, its streams are updated by pipeline task */
+                if (pipeline->pmtReceived)
+                {
+                    pmtChanged = true;
+                }
+                else
+                {
+                    pipeline->pmtReceived = true;
+                    pthread_cond_signal(&pipeline->demuxCond);
+                }
+            }
+        }
+        else if (sectionProgramNumber != 0 && sectionProgramNumber == pipeline->prefetchProgramNumber)
+        {
+            /* parsed only when the channel is started */
+            cachePmtSection(pipeline, sectionProgramNumber, section);
+        }
+        pthread_mutex_unlock(&pipeline->demuxMutex);
+
+        if (pmtChanged)
         {
-            //printPmtTable(pmtTable);
-            pthread_mutex_lock(&demuxMutex);
-            pthread_cond_signal(&demuxCond);
-            pthread_mutex_unlock(&demuxMutex);
+            pthread_mutex_lock(&pipeline->commandMutex);
+            pipeline->pmtChanged = true;
+            pthread_cond_signal(&pipeline->commandCond);
+            pthread_mutex_unlock(&pipeline->commandMutex);
         }
     }
-    else if (tableId == 0x70)
+    else if (tableId == 0x70 && pipeline->ownsTimeFilter)
     {
         //printf("\n%s -----TDT TABLE ARRIVED-----\n",__FUNCTION__);
 
-        if (parseTdtTable(buffer, tdtTable) == TABLES_PARSE_OK)
+        if (parseTdtTable(&view, &pipeline->tdtTable) == TABLES_PARSE_OK)
         {
-            //printTdtTable(tdtTable);
-            pthread_mutex_lock(&demuxMutex);
-            pthread_cond_signal(&demuxCond);
-            pthread_mutex_unlock(&demuxMutex);
+            //printTdtTable(&pipeline->tdtTable);
+            timeServiceUpdateFromTdt(&pipeline->tdtTable);
+            reportCurrentTime();
         }
     }
-    else if (tableId == 0x73)
+    else if (tableId == 0x73 && pipeline->ownsTimeFilter)
     {
         //printf("\n%s -----TOT TABLE ARRIVED-----\n",__FUNCTION__);
 
-        if (parseTotTable(buffer, totTable) == TABLES_PARSE_OK)
+        if (parseTotTable(&view, &pipeline->totTable) == TABLES_PARSE_OK)
         {
-            //printTotTable(totTable);
-            pthread_mutex_lock(&demuxMutex);
-            pthread_cond_signal(&demuxCond);
-            pthread_mutex_unlock(&demuxMutex);
+            //printTotTable(&pipeline->totTable);
+            timeServiceUpdateFromTot(&pipeline->totTable);
+            reportCurrentTime();
         }
     }
+}
 
-    return 0;
+void patAssembledCallback(const AssembledTable* table, void* userData)
+{
+    StreamPipeline* pipeline = (StreamPipeline*)userData;
+    SectionView view;
+    bool patChanged = false;
+    uint16_t i = 0;
+
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    pipeline->patTable.serviceInfoCount = 0;
+    for (i = 0; i < table->numberOfSections; i++)
+    {
+        if (sectionViewInit(&view, table->sections[i]->data, table->sections[i]->length) != TABLES_PARSE_OK
+            || appendPatTable(&view, &pipeline->patTable) != TABLES_PARSE_OK)
+        {
+            printf("\n%s : ERROR parsing PAT section %d\n", __FUNCTION__, i);
+            pthread_mutex_unlock(&pipeline->demuxMutex);
+            return;
+        }
+    }
+    //printPatTable(&pipeline->patTable);
+
+    /* PAT filter is kept while channel plays, assembler reports only new versions */
+    patChanged = pipeline->patReceived;
+    pipeline->patReceived = true;
+    pthread_cond_signal(&pipeline->demuxCond);
+    pthread_mutex_unlock(&pipeline->demuxMutex);
+
+    if (patChanged)
+    {
+        pthread_mutex_lock(&pipeline->commandMutex);
+        pipeline->patChanged = true;
+        pthread_cond_signal(&pipeline->commandCond);
+        pthread_mutex_unlock(&pipeline->commandMutex);
+    }
+}
+
+void tableWaitDeadline(struct timespec* deadline)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += STREAM_TABLE_TIMEOUT;
+}
+
+/* Called with demuxMutex locked, exit and channel change requests wake demuxCond through wakeTableWait */
+bool tableWaitInterrupted(StreamPipeline* pipeline)
+{
+    bool interrupted = false;
+
+    pthread_mutex_lock(&pipeline->commandMutex);
+    interrupted = pipeline->threadExit || pipeline->changeChannel;
+    pthread_mutex_unlock(&pipeline->commandMutex);
+
+    return interrupted;
+}
+
+/* Called after threadExit or changeChannel is set, demuxMutex orders it with the check in the waiting task */
+void wakeTableWait(StreamPipeline* pipeline)
+{
+    pthread_mutex_lock(&pipeline->demuxMutex);
+    pthread_cond_broadcast(&pipeline->demuxCond);
+    pthread_mutex_unlock(&pipeline->demuxMutex);
 }
 
 int32_t tunerStatusCallback(t_LockStatus status)
 {
+    threadPolicyApplyOnce(THREAD_ROLE_SECTIONS);
+
     if(status == STATUS_LOCKED)
     {
         pthread_mutex_lock(&statusMutex);
+        tunerLocked = true;
         pthread_cond_signal(&statusCondition);
         pthread_mutex_unlock(&statusMutex);
         printf("\n%s -----TUNER LOCKED-----\n",__FUNCTION__);
@@ -613,6 +1644,8 @@ int32_t tunerStatusCallback(t_LockStatus status)
 
 StreamControllerError loadInitialInfo(char* fileName)
 {
+    uint8_t i = 0;
+
     if (loadConfigFile(fileName, &configFile))
     {
         return SC_ERROR;
@@ -620,6 +1653,28 @@ StreamControllerError loadInitialInfo(char* fileName)
 
     programNumber = configFile.programNumber;
 
+    /* roles are set before any thread of them is created */
+    for (i = 0; i < THREAD_ROLE_COUNT; i++)
+    {
+        if (configFile.threadPolicies[i].configured)
+        {
+            threadPolicyConfigure((ThreadRole)i, &configFile.threadPolicies[i]);
+        }
+    }
+
+    return SC_NO_ERROR;
+}
+
+StreamControllerError getInitialInfo(InitialInfo* initialInfo)
+{
+    if (initialInfo == NULL)
+    {
+        printf("\n%s : Error wrong parameter\n", __FUNCTION__);
+        return SC_ERROR;
+    }
+
+    *initialInfo = configFile;
+
     return SC_NO_ERROR;
 }
 
@@ -628,6 +1683,7 @@ StreamControllerError loadConfigFile(char* filename, InitialInfo* configInfo)
     FILE* inputFile;
     char singleLine[LINE_LENGTH];
     char* singleWord;
+    ThreadRole role = THREAD_ROLE_COUNT;
 
     if ((inputFile = fopen(filename, "r")) == NULL)
     {
@@ -667,6 +1723,47 @@ StreamControllerError loadConfigFile(char* filename, InitialInfo* configInfo)
                 return SC_ERROR;
             }
         }
+        else if (strcmp(singleWord, "country") == 0)
+        {
+            singleWord = strtok(NULL, "-");
+            removeWhiteSpaces(singleWord);
+            strncpy(configInfo->country, singleWord, sizeof(configInfo->country) - 1);
+        }
+        else if (strcmp(singleWord, "region") == 0)
+        {
+            singleWord = strtok(NULL, "-");
+            removeWhiteSpaces(singleWord);
+            configInfo->countryRegionId = atoi(singleWord);
+        }
+        else if (strcmp(singleWord, "graphics") == 0)
+        {
+            singleWord = strtok(NULL, "-");
+            removeWhiteSpaces(singleWord);
+            strncpy(configInfo->graphicsBackend, singleWord, sizeof(configInfo->graphicsBackend) - 1);
+        }
+        else if (strcmp(singleWord, "asset_bundle") == 0)
+        {
+            singleWord = strtok(NULL, "-");
+            removeWhiteSpaces(singleWord);
+            strncpy(configInfo->assetBundle, singleWord, sizeof(configInfo->assetBundle) - 1);
+        }
+        else if (strncmp(singleWord, "thread_", strlen("thread_")) == 0)
+        {
+            /* negative nice values hold '-', so value is the rest of the line */
+            role = threadRoleByKey(singleWord + strlen("thread_"));
+            singleWord = strtok(NULL, "\n");
+            if (role == THREAD_ROLE_COUNT || singleWord == NULL)
+            {
+                printf("Unknown thread role in config file!\n");
+                continue;
+            }
+            removeWhiteSpaces(singleWord);
+            if (threadPolicyParse(singleWord, &configInfo->threadPolicies[role]))
+            {
+                fclose(inputFile);
+                return SC_ERROR;
+            }
+        }
         else if (strcmp(singleWord, "program_number") == 0)
         {
             singleWord = strtok(NULL, "-");
@@ -686,36 +1783,56 @@ static void removeWhiteSpaces(char* word)
     int i = 0;
     int j = 0;
     int k = stringLen - 1;
-    char* startString = word;
-    char* returnString;
 
-    while (startString[i] == 32)
+    /* trailing new line is trimmed too, string values are compared as they are */
+    while (isspace((unsigned char)word[i]))
     {
         i++;
     }
 
-    while ((startString[k] == 32) & (startString[k] != '\0'))
+    while ((k >= i) && isspace((unsigned char)word[k]))
     {
         k--;
     }
 
-    for (j = 0; j < (k - i); j++)
+    for (j = 0; j <= (k - i); j++)
     {
-        word[j] = startString[j+i];
+        word[j] = word[j+i];
     }
 
     word[k-i+1] = '\0';
 }
 
-StreamControllerError changeChannelKey(uint16_t channelNumber)
+/* Role of config key thread_<role>, THREAD_ROLE_COUNT if there is none */
+ThreadRole threadRoleByKey(const char* key)
 {
-    if ((channelNumber > -1) && (channelNumber < patTable->serviceInfoCount))
+    static const char* const roleKeys[THREAD_ROLE_COUNT] = {"input", "zap", "sections", "render", "background"};
+    uint8_t i = 0;
+
+    for (i = 0; i < THREAD_ROLE_COUNT; i++)
     {
-        programNumber = channelNumber;
-        changeChannel = true;
+        if (strcmp(key, roleKeys[i]) == 0)
+        {
+            break;
+        }
     }
 
-    return SC_NO_ERROR;
+    return (ThreadRole)i;
+}
+
+StreamControllerError changeChannelKey(uint16_t channelNumber)
+{
+    return streamPipelineChangeChannel(defaultPipeline, channelNumber);
+}
+
+StreamControllerError prefetchChannelKey(uint16_t channelNumber)
+{
+    return streamPipelinePrefetchChannel(defaultPipeline, channelNumber);
+}
+
+StreamControllerError setZapKeyTime(uint64_t keyTime)
+{
+    return streamPipelineSetZapKeyTime(defaultPipeline, keyTime);
 }
 
 StreamControllerError registerTimeCallback(TimeCallback timeCallback)
@@ -787,74 +1904,64 @@ StreamControllerError unregisterProgramTypeCallback()
     return SC_NO_ERROR;
 }
 
-StreamControllerError volumeUp()
+/* Sets pipeline player volume and reports it to the UI */
+void setVolume(StreamPipeline* pipeline, uint32_t volume)
 {
-    if (++currentVolume > 10)
+    pipeline->currentVolume = volume;
+
+    /* autorepeat bursts end up as one driver call, only the last queued value is set */
+    if (playerActuatorSetVolume(pipeline->actuator, pipeline->currentVolume*volumeConstant, 0))
     {
-        currentVolume = 10;
+        printf("\n%sError changing volume", __FUNCTION__);
     }
 
-    if (Player_Volume_Set(playerHandle, currentVolume*volumeConstant))
+    if (!pipeline->reportsToUi || !pipeline->isInitialized)
     {
-        printf("\n%sError changing volume", __FUNCTION__);
+        return;
     }
 
     if (volumeReportCallback != NULL)
     {
-        volumeReportCallback(currentVolume);
+        volumeReportCallback(pipeline->currentVolume);
     }
     else
     {
         printf("\n%s : ERROR Volume callback not registred!\n", __FUNCTION__);
-        streamControllerDeinit();
     }
-
-    return SC_NO_ERROR;
 }
 
-StreamControllerError volumeDown()
+StreamControllerError volumeUp()
 {
-    if (currentVolume > 0)
+    if (defaultPipeline == NULL || !defaultPipeline->isInitialized)
     {
-        currentVolume--;
+        return SC_ERROR;
     }
 
-    if (Player_Volume_Set(playerHandle, currentVolume*volumeConstant))
-    {
-        printf("\n%sError changing volume", __FUNCTION__);
-    }
+    setVolume(defaultPipeline, (defaultPipeline->currentVolume >= 10) ? 10 : defaultPipeline->currentVolume + 1);
 
-    if (volumeReportCallback != NULL)
-    {
-        volumeReportCallback(currentVolume);
-    }
-    else
+    return SC_NO_ERROR;
+}
+
+StreamControllerError volumeDown()
+{
+    if (defaultPipeline == NULL || !defaultPipeline->isInitialized)
     {
-        printf("\n%s : ERROR Volume callback not registred!\n", __FUNCTION__);
-        streamControllerDeinit();
+        return SC_ERROR;
     }
 
+    setVolume(defaultPipeline, (defaultPipeline->currentVolume > 0) ? defaultPipeline->currentVolume - 1 : 0);
+
     return SC_NO_ERROR;
 }
 
 StreamControllerError volumeMute()
 {
-    currentVolume = 0;
-
-    if (Player_Volume_Set(playerHandle, currentVolume*volumeConstant))
+    if (defaultPipeline == NULL || !defaultPipeline->isInitialized)
     {
-        printf("\n%sError changing volume", __FUNCTION__);
+        return SC_ERROR;
     }
 
-    if (volumeReportCallback != NULL)
-    {
-        volumeReportCallback(currentVolume);
-    }
-    else
-    {
-        printf("\n%s : ERROR Volume callback not registred!\n", __FUNCTION__);
-        streamControllerDeinit();
-    }
+    setVolume(defaultPipeline, 0);
 
     return SC_NO_ERROR;
 }
@@ -4,12 +4,17 @@
 #include <stdio.h>
 #include "tables.h"
 #include "tdp_api.h"
-#include "tables.h"
+#include "section_pool.h"
+#include "descriptors.h"
+#include "table_assembler.h"
+#include "time_service.h"
+#include "thread_policy.h"
 #include "pthread.h"
 #include <stdlib.h>
 #include <time.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <ctype.h>
 
 
 /**
@@ -33,6 +38,48 @@ typedef struct _ChannelInfo
     int8_t teletext;
 }ChannelInfo;
 
+/**
+ * @brief Structure that holds durations of one kind of gap over all zaps, in microseconds
+ */
+typedef struct _ZapGapStatistics
+{
+    uint32_t count;
+    uint32_t keptCount;                             /* Zaps where decoder was kept, so there was no gap */
+    uint32_t last;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint64_t totalSquares;                          /* Sum of squared durations in square microseconds, gives jitter */
+}ZapGapStatistics;
+
+/**
+ * @brief Structure that holds channel change timing of a pipeline
+ *
+ * Black screen and silence last from removing the old video or audio stream
+ * until the new one is created, zap lasts from the request until both are created.
+ * Key to zap lasts from the input event of the key until both are created, it is counted
+ * only for zaps started by a key and includes the time input and zap threads waited for a CPU.
+ */
+typedef struct _ZapStatistics
+{
+    uint32_t zapCount;
+    ZapGapStatistics blackScreen;
+    ZapGapStatistics silence;
+    ZapGapStatistics zap;
+    ZapGapStatistics keyToZap;
+}ZapStatistics;
+
+/**
+ * @brief Enumeration of stages a pipeline passes on its way to the first picture
+ */
+typedef enum _StreamStartupStage
+{
+    STREAM_STAGE_NONE = 0,
+    STREAM_STAGE_TUNER_LOCKED,
+    STREAM_STAGE_PAT_RECEIVED,
+    STREAM_STAGE_PLAYING                            /* Streams of the first channel are started */
+}StreamStartupStage;
+
 /**
  * @brief Structure that defines initial info
  */
@@ -42,10 +89,15 @@ typedef struct _InitialInfo
     uint32_t tuneBandwidth;
     uint32_t programNumber;
     t_Module tuneModule;
+    char country[4];                /* Country whose local time offset is applied, empty for first one in TOT */
+    uint8_t countryRegionId;        /* Region inside the country */
+    char graphicsBackend[16];       /* Name of graphics backend, empty for default one */
+    char assetBundle[64];           /* OSD asset bundle, empty to load font and images from original files */
+    ThreadPolicy threadPolicies[THREAD_ROLE_COUNT]; /* Scheduling of thread roles, unconfigured roles keep defaults */
 }InitialInfo;
 
 /**
- * @brief Structure that holds time when TOT table was received
+ * @brief Structure that holds local time reported by the time service
  */
 typedef struct _TimeStructure
 {
@@ -56,7 +108,12 @@ typedef struct _TimeStructure
 }TimeStructure;
 
 /**
- * @brief Time callback
+ * @brief Stream pipeline instance, one per tuned transport stream and player
+ */
+typedef struct _StreamPipeline StreamPipeline;
+
+/**
+ * @brief Time callback, called every time TDT or TOT updates the time service
  */
 typedef void(*TimeCallback)(TimeStructure* timeStructure);
 
@@ -151,6 +208,31 @@ StreamControllerError channelDown();
  */
 StreamControllerError getChannelInfo(ChannelInfo* channelInfo);
 
+/**
+ * @brief Returns number of channels in the current transport stream
+ *
+ * @param [out] channelCount - number of channels, valid channel numbers are 1 to channelCount
+ * @return stream controller error code, SC_ERROR until PAT is received
+ */
+StreamControllerError getChannelCount(uint16_t* channelCount);
+
+/**
+ * @brief Returns channel change timing of the current transport stream
+ *
+ * @param [out] zapStatistics - black screen, silence and zap durations
+ * @return stream controller error code
+ */
+StreamControllerError getZapStatistics(ZapStatistics* zapStatistics);
+
+/**
+ * @brief Waits until stream controller startup reaches a stage
+ *
+ * @param [in] stage - stage to wait for
+ * @param [in] timeoutMs - longest wait in milliseconds
+ * @return stream controller error code, SC_ERROR on timeout or if startup failed before the stage
+ */
+StreamControllerError waitStartupStage(StreamStartupStage stage, uint32_t timeoutMs);
+
 /**
  * @brief Loads config.ini file holding initial configuration
  *
@@ -159,6 +241,14 @@ StreamControllerError getChannelInfo(ChannelInfo* channelInfo);
  */
 StreamControllerError loadInitialInfo(char fileName[]);
 
+/**
+ * @brief Returns initial configuration loaded by loadInitialInfo
+ *
+ * @param [out] initialInfo - loaded configuration
+ * @return stream controller error code
+ */
+StreamControllerError getInitialInfo(InitialInfo* initialInfo);
+
 /**
  * @brief changes current program to channelNumber
  *
@@ -167,6 +257,22 @@ StreamControllerError loadInitialInfo(char fileName[]);
  */
 StreamControllerError changeChannelKey(uint16_t channelNumber);
 
+/**
+ * @brief Starts fetching PMT of channel that is likely to be changed to, so the change does not wait for it
+ *
+ * @param [in] channelNumber - number of channel to prefetch
+ * @return stream controller error code
+ */
+StreamControllerError prefetchChannelKey(uint16_t channelNumber);
+
+/**
+ * @brief Sets input event time of the key that requests next channel change
+ *
+ * @param [in] keyTime - monotonic microseconds of key event
+ * @return stream controller error code
+ */
+StreamControllerError setZapKeyTime(uint64_t keyTime);
+
 /**
  * @brief Increases current volume value
  *
@@ -188,4 +294,90 @@ StreamControllerError volumeDown();
  */
 StreamControllerError volumeMute();
 
+/**
+ * @brief Creates stream pipeline and starts its task
+ *
+ * Legacy functions of this module act on the pipeline created by streamControllerInit,
+ * only that pipeline reports time, volume and program type through registered callbacks.
+ *
+ * @param [in] initialInfo - tuning parameters and initial program of the pipeline
+ * @param [out] pipeline - created pipeline
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineCreate(const InitialInfo* initialInfo, StreamPipeline** pipeline);
+
+/**
+ * @brief Stops pipeline task and frees all its resources
+ *
+ * @param [in] pipeline - pipeline to destroy
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineDestroy(StreamPipeline* pipeline);
+
+/**
+ * @brief Changes program played by pipeline
+ *
+ * @param [in] pipeline - pipeline whose program is changed
+ * @param [in] channelNumber - number of channel to change to
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineChangeChannel(StreamPipeline* pipeline, uint16_t channelNumber);
+
+/**
+ * @brief Starts fetching PMT of pipeline's channel that is likely to be changed to
+ *
+ * @param [in] pipeline - pipeline that prefetches
+ * @param [in] channelNumber - number of channel to prefetch
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelinePrefetchChannel(StreamPipeline* pipeline, uint16_t channelNumber);
+
+/**
+ * @brief Sets input event time of the key that requests next channel change of pipeline
+ *
+ * Next zap of the pipeline is counted in key to zap statistics, measured from this time.
+ *
+ * @param [in] pipeline - pipeline whose channel is changed
+ * @param [in] keyTime - monotonic microseconds of key event
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineSetZapKeyTime(StreamPipeline* pipeline, uint64_t keyTime);
+
+/**
+ * @brief Returns number of channels in pipeline's transport stream
+ *
+ * @param [in] pipeline - pipeline to query
+ * @param [out] channelCount - number of channels
+ * @return stream controller error code, SC_ERROR until PAT is received
+ */
+StreamControllerError streamPipelineGetChannelCount(StreamPipeline* pipeline, uint16_t* channelCount);
+
+/**
+ * @brief Returns channel change timing of pipeline
+ *
+ * @param [in] pipeline - pipeline to query
+ * @param [out] zapStatistics - black screen, silence and zap durations
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineGetZapStatistics(StreamPipeline* pipeline, ZapStatistics* zapStatistics);
+
+/**
+ * @brief Waits until pipeline startup reaches a stage
+ *
+ * @param [in] pipeline - pipeline to wait for
+ * @param [in] stage - stage to wait for
+ * @param [in] timeoutMs - longest wait in milliseconds
+ * @return stream controller error code, SC_ERROR on timeout or if startup failed before the stage
+ */
+StreamControllerError streamPipelineWaitStartupStage(StreamPipeline* pipeline, StreamStartupStage stage, uint32_t timeoutMs);
+
+/**
+ * @brief Returns channel info of pipeline's current program
+ *
+ * @param [in] pipeline - pipeline to query
+ * @param [out] channelInfo - channel info structure
+ * @return stream controller error code
+ */
+StreamControllerError streamPipelineGetChannelInfo(StreamPipeline* pipeline, ChannelInfo* channelInfo);
+
 #endif /* __STREAM_CONTROLLER_H__ */
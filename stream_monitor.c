@@ -0,0 +1,726 @@
+#include "stream_monitor.h"
+#include "tables_fields.h"
+
+#define SYNC_ACQUIRE_PACKETS 5                      /* Consecutive sync bytes needed to acquire sync */
+#define SYNC_LOSS_PACKETS 2                         /* Consecutive corrupted sync bytes that lose sync */
+#define NULL_PACKET_PID 0x1FFF
+#define NUMBER_OF_SECTION_SLOTS 32                  /* Max number of PIDs whose sections are checked */
+#define NO_SECTION_SLOT 0xFF
+
+#define NS_PER_SECOND 1000000000ULL
+#define NS_PER_MILLISECOND 1000000ULL
+#define PCR_TICKS_PER_MILLISECOND 27000ULL
+#define PCR_WRAP ((1ULL << 33) * 300)
+
+#define WINDOW_DURATION NS_PER_SECOND               /* Bitrate and PID presence are evaluated once per window */
+#define PSI_REPETITION_LIMIT (500 * NS_PER_MILLISECOND)
+#define PID_ABSENCE_LIMIT (5 * NS_PER_SECOND)
+#define PCR_REPETITION_LIMIT (40 * PCR_TICKS_PER_MILLISECOND)
+#define PCR_DISCONTINUITY_LIMIT (100 * PCR_TICKS_PER_MILLISECOND)
+#define PCR_ACCURACY_LIMIT 13                       /* 500 ns in 27 MHz ticks */
+
+#define PID_ROLE_PAT        0x01
+#define PID_ROLE_PMT        0x02
+#define PID_ROLE_REFERENCED 0x04
+#define PID_ROLE_SI         0x08
+
+/* counters are written by the ingestion thread only, readers load them without locking */
+#define MONITOR_INCREMENT(counter) __atomic_store_n(&(counter), (counter) + 1, __ATOMIC_RELAXED)
+#define MONITOR_STORE(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+#define MONITOR_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/**
+ * @brief Structure that holds ingestion state of one PID, never read by other threads
+ */
+typedef struct _PidState
+{
+    uint64_t pcr[2];                                /* Last two PCR values */
+    uint64_t pcrPacketIndex[2];                     /* Stream packet index of last two PCRs */
+    uint64_t lastTableTime;                         /* Arrival time of the last PAT/PMT section */
+    uint64_t windowStartCount;                      /* Packet count at the start of the bitrate window */
+    uint8_t pcrCount;                               /* Number of valid entries in pcr */
+    uint8_t lastContinuityCounter;
+    uint8_t continuityValid;
+    uint8_t duplicateSeen;
+    uint8_t roles;                                  /* PID_ROLE_* flags */
+    uint8_t absenceReported;
+    uint8_t tableOverdueReported;
+    uint8_t sectionSlot;                            /* Index of section slot or NO_SECTION_SLOT */
+}PidState;
+
+/**
+ * @brief Structure that collects one section from packet payloads
+ */
+typedef struct _SectionSlot
+{
+    uint16_t pid;
+    uint16_t collected;
+    uint16_t expected;
+    uint8_t active;
+    uint8_t buffer[TABLES_MAX_SECTION_SIZE];
+}SectionSlot;
+
+struct _StreamMonitor
+{
+    PidStatistics statistics[STREAM_MONITOR_NUMBER_OF_PIDS];
+    PidState state[STREAM_MONITOR_NUMBER_OF_PIDS];
+    StreamMonitorReport report;
+
+    SectionSlot slots[NUMBER_OF_SECTION_SLOTS];
+    uint8_t numberOfSlots;
+
+    uint8_t carry[TS_PACKET_SIZE];                  /* Packet split between two chunks */
+    uint32_t carryLength;
+    uint8_t goodSyncCount;
+    uint8_t badSyncCount;
+
+    uint64_t now;                                   /* Arrival time of the chunk being analyzed */
+    uint64_t windowStart;
+    uint64_t windowStartPackets;
+    uint64_t lastPatTime;
+    uint8_t patOverdueReported;
+};
+
+
+static void processPacket(StreamMonitor* monitor, const uint8_t* packet);
+static void checkContinuity(StreamMonitor* monitor, uint16_t pid, const uint8_t* packet, bool discontinuity);
+static void checkPcr(StreamMonitor* monitor, uint16_t pid, const uint8_t* adaptationField, bool discontinuity);
+static void collectSectionBytes(StreamMonitor* monitor, SectionSlot* slot, const uint8_t* data, uint32_t length);
+static void handleSection(StreamMonitor* monitor, SectionSlot* slot);
+static void handlePat(StreamMonitor* monitor, const SectionView* view);
+static void handlePmt(StreamMonitor* monitor, uint16_t pid, const SectionView* view);
+static void assignSectionSlot(StreamMonitor* monitor, uint16_t pid, uint8_t role);
+static void closeWindow(StreamMonitor* monitor);
+static void resetPidStates(StreamMonitor* monitor);
+
+
+StreamMonitorError streamMonitorCreate(StreamMonitor** monitor)
+{
+    StreamMonitor* newMonitor = NULL;
+    uint32_t i = 0;
+
+    if (monitor == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+
+    newMonitor = (StreamMonitor*)malloc(sizeof(StreamMonitor));
+    if (newMonitor == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+    memset(newMonitor, 0x0, sizeof(StreamMonitor));
+
+    for (i = 0; i < STREAM_MONITOR_NUMBER_OF_PIDS; i++)
+    {
+        newMonitor->state[i].sectionSlot = NO_SECTION_SLOT;
+    }
+
+    /* PAT and SI tables carrying CRC are always checked */
+    assignSectionSlot(newMonitor, 0x0000, PID_ROLE_PAT);
+    assignSectionSlot(newMonitor, 0x0001, PID_ROLE_SI);
+    assignSectionSlot(newMonitor, 0x0010, PID_ROLE_SI);
+    assignSectionSlot(newMonitor, 0x0011, PID_ROLE_SI);
+    assignSectionSlot(newMonitor, 0x0012, PID_ROLE_SI);
+    assignSectionSlot(newMonitor, 0x0014, PID_ROLE_SI);
+
+    *monitor = newMonitor;
+
+    return SM_NO_ERROR;
+}
+
+StreamMonitorError streamMonitorDestroy(StreamMonitor* monitor)
+{
+    if (monitor == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+
+    free(monitor);
+
+    return SM_NO_ERROR;
+}
+
+StreamMonitorError streamMonitorProcess(StreamMonitor* monitor, const uint8_t* data, uint32_t length, uint64_t arrivalTime)
+{
+    uint32_t position = 0;
+    uint32_t copyLength = 0;
+    const uint8_t* packet = NULL;
+    const uint8_t* nextSync = NULL;
+
+    if (monitor == NULL || data == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+
+    monitor->now = arrivalTime;
+    if (monitor->windowStart == 0)
+    {
+        monitor->windowStart = arrivalTime;
+        monitor->lastPatTime = arrivalTime;
+    }
+    else if (arrivalTime - monitor->windowStart >= WINDOW_DURATION)
+    {
+        closeWindow(monitor);
+    }
+
+    while (position < length)
+    {
+        if (monitor->carryLength > 0 || length - position < TS_PACKET_SIZE)
+        {
+            /* packet split between chunks is completed in the carry buffer */
+            copyLength = TS_PACKET_SIZE - monitor->carryLength;
+            if (copyLength > length - position)
+            {
+                copyLength = length - position;
+            }
+            memcpy(monitor->carry + monitor->carryLength, data + position, copyLength);
+            monitor->carryLength += copyLength;
+            position += copyLength;
+
+            if (monitor->carryLength < TS_PACKET_SIZE)
+            {
+                break;
+            }
+
+            if (!monitor->report.inSync && monitor->carry[0] != TS_SYNC_BYTE)
+            {
+                /* drop bytes up to the next sync byte candidate */
+                nextSync = memchr(monitor->carry + 1, TS_SYNC_BYTE, TS_PACKET_SIZE - 1);
+                copyLength = (nextSync != NULL) ? (uint32_t)(nextSync - monitor->carry) : TS_PACKET_SIZE;
+                memmove(monitor->carry, monitor->carry + copyLength, TS_PACKET_SIZE - copyLength);
+                monitor->carryLength = TS_PACKET_SIZE - copyLength;
+                monitor->goodSyncCount = 0;
+                continue;
+            }
+
+            packet = monitor->carry;
+            monitor->carryLength = 0;
+        }
+        else
+        {
+            packet = data + position;
+
+            if (!monitor->report.inSync && *packet != TS_SYNC_BYTE)
+            {
+                nextSync = memchr(packet + 1, TS_SYNC_BYTE, length - position - 1);
+                position = (nextSync != NULL) ? (uint32_t)(nextSync - data) : length;
+                monitor->goodSyncCount = 0;
+                continue;
+            }
+
+            position += TS_PACKET_SIZE;
+        }
+
+        if (*packet == TS_SYNC_BYTE)
+        {
+            monitor->badSyncCount = 0;
+            if (!monitor->report.inSync)
+            {
+                if (++monitor->goodSyncCount < SYNC_ACQUIRE_PACKETS)
+                {
+                    continue;
+                }
+                MONITOR_STORE(monitor->report.inSync, 1);
+            }
+            processPacket(monitor, packet);
+        }
+        else
+        {
+            MONITOR_INCREMENT(monitor->report.syncByteErrors);
+            if (++monitor->badSyncCount >= SYNC_LOSS_PACKETS)
+            {
+                MONITOR_STORE(monitor->report.inSync, 0);
+                MONITOR_INCREMENT(monitor->report.tsSyncLoss);
+                monitor->goodSyncCount = 0;
+                monitor->badSyncCount = 0;
+                resetPidStates(monitor);
+            }
+        }
+    }
+
+    return SM_NO_ERROR;
+}
+
+StreamMonitorError streamMonitorGetReport(StreamMonitor* monitor, StreamMonitorReport* report)
+{
+    if (monitor == NULL || report == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+
+    report->tsSyncLoss = MONITOR_LOAD(monitor->report.tsSyncLoss);
+    report->syncByteErrors = MONITOR_LOAD(monitor->report.syncByteErrors);
+    report->patErrors = MONITOR_LOAD(monitor->report.patErrors);
+    report->continuityErrors = MONITOR_LOAD(monitor->report.continuityErrors);
+    report->pmtErrors = MONITOR_LOAD(monitor->report.pmtErrors);
+    report->pidErrors = MONITOR_LOAD(monitor->report.pidErrors);
+    report->transportErrors = MONITOR_LOAD(monitor->report.transportErrors);
+    report->crcErrors = MONITOR_LOAD(monitor->report.crcErrors);
+    report->pcrRepetitionErrors = MONITOR_LOAD(monitor->report.pcrRepetitionErrors);
+    report->pcrDiscontinuityErrors = MONITOR_LOAD(monitor->report.pcrDiscontinuityErrors);
+    report->pcrAccuracyErrors = MONITOR_LOAD(monitor->report.pcrAccuracyErrors);
+    report->bitrate = MONITOR_LOAD(monitor->report.bitrate);
+    report->totalPackets = MONITOR_LOAD(monitor->report.totalPackets);
+    report->inSync = MONITOR_LOAD(monitor->report.inSync);
+
+    return SM_NO_ERROR;
+}
+
+StreamMonitorError streamMonitorGetPidStatistics(StreamMonitor* monitor, uint16_t pid, PidStatistics* statistics)
+{
+    PidStatistics* pidStatistics = NULL;
+
+    if (monitor == NULL || statistics == NULL || pid >= STREAM_MONITOR_NUMBER_OF_PIDS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return SM_ERROR;
+    }
+
+    pidStatistics = &monitor->statistics[pid];
+    statistics->packetCount = MONITOR_LOAD(pidStatistics->packetCount);
+    statistics->lastArrivalTime = MONITOR_LOAD(pidStatistics->lastArrivalTime);
+    statistics->bitrate = MONITOR_LOAD(pidStatistics->bitrate);
+    statistics->continuityErrors = MONITOR_LOAD(pidStatistics->continuityErrors);
+    statistics->pidErrors = MONITOR_LOAD(pidStatistics->pidErrors);
+    statistics->transportErrors = MONITOR_LOAD(pidStatistics->transportErrors);
+    statistics->crcErrors = MONITOR_LOAD(pidStatistics->crcErrors);
+    statistics->pcrRepetitionErrors = MONITOR_LOAD(pidStatistics->pcrRepetitionErrors);
+    statistics->pcrDiscontinuityErrors = MONITOR_LOAD(pidStatistics->pcrDiscontinuityErrors);
+    statistics->pcrAccuracyErrors = MONITOR_LOAD(pidStatistics->pcrAccuracyErrors);
+
+    return SM_NO_ERROR;
+}
+
+void processPacket(StreamMonitor* monitor, const uint8_t* packet)
+{
+    uint16_t pid = (uint16_t)(((packet[1] & 0x1F) << 8) | packet[2]);
+    uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x03;
+    uint8_t adaptationFieldLength = 0;
+    bool discontinuity = false;
+    const uint8_t* payload = NULL;
+    uint32_t payloadLength = 0;
+    uint8_t pointerField = 0;
+    PidState* state = &monitor->state[pid];
+    SectionSlot* slot = NULL;
+
+    MONITOR_INCREMENT(monitor->statistics[pid].packetCount);
+    MONITOR_STORE(monitor->statistics[pid].lastArrivalTime, monitor->now);
+    MONITOR_INCREMENT(monitor->report.totalPackets);
+    state->absenceReported = 0;
+
+    if (packet[1] & 0x80)
+    {
+        MONITOR_INCREMENT(monitor->statistics[pid].transportErrors);
+        MONITOR_INCREMENT(monitor->report.transportErrors);
+        return;
+    }
+
+    if (pid == NULL_PACKET_PID)
+    {
+        return;
+    }
+
+    if (adaptationFieldControl & 0x02)
+    {
+        adaptationFieldLength = packet[4];
+        if (adaptationFieldLength > TS_PACKET_SIZE - 5)
+        {
+            return;
+        }
+        if (adaptationFieldLength > 0)
+        {
+            discontinuity = (packet[5] & 0x80) != 0;
+            if (packet[5] & 0x10)
+            {
+                checkPcr(monitor, pid, packet + 5, discontinuity);
+            }
+        }
+    }
+
+    checkContinuity(monitor, pid, packet, discontinuity);
+
+    /* PAT and PMT must not be scrambled */
+    if ((state->roles & (PID_ROLE_PAT | PID_ROLE_PMT)) && (packet[3] & 0xC0))
+    {
+        if (state->roles & PID_ROLE_PAT)
+        {
+            MONITOR_INCREMENT(monitor->report.patErrors);
+        }
+        else
+        {
+            MONITOR_INCREMENT(monitor->report.pmtErrors);
+        }
+        return;
+    }
+
+    if (state->sectionSlot == NO_SECTION_SLOT || !(adaptationFieldControl & 0x01))
+    {
+        return;
+    }
+
+    slot = &monitor->slots[state->sectionSlot];
+    payload = packet + 4 + ((adaptationFieldControl & 0x02) ? adaptationFieldLength + 1 : 0);
+    payloadLength = (uint32_t)(packet + TS_PACKET_SIZE - payload);
+
+    if (packet[1] & 0x40)
+    {
+        /* payload unit start, pointer field gives the start of the first new section */
+        if (payloadLength == 0)
+        {
+            return;
+        }
+        pointerField = payload[0];
+        payload++;
+        payloadLength--;
+        if (pointerField >= payloadLength)
+        {
+            slot->active = 0;
+            return;
+        }
+
+        collectSectionBytes(monitor, slot, payload, pointerField);
+
+        slot->active = (payload[pointerField] != 0xFF);
+        slot->collected = 0;
+        slot->expected = 0;
+        collectSectionBytes(monitor, slot, payload + pointerField, payloadLength - pointerField);
+    }
+    else
+    {
+        collectSectionBytes(monitor, slot, payload, payloadLength);
+    }
+}
+
+void checkContinuity(StreamMonitor* monitor, uint16_t pid, const uint8_t* packet, bool discontinuity)
+{
+    PidState* state = &monitor->state[pid];
+    uint8_t continuityCounter = packet[3] & 0x0F;
+    bool hasPayload = (packet[3] & 0x10) != 0;
+    bool error = false;
+
+    if (state->continuityValid && !discontinuity)
+    {
+        if (!hasPayload)
+        {
+            /* counter does not advance on packets without payload */
+            error = (continuityCounter != state->lastContinuityCounter);
+        }
+        else if (continuityCounter == state->lastContinuityCounter)
+        {
+            /* one duplicate is allowed */
+            error = state->duplicateSeen;
+            state->duplicateSeen = 1;
+        }
+        else
+        {
+            error = (continuityCounter != ((state->lastContinuityCounter + 1) & 0x0F));
+            state->duplicateSeen = 0;
+        }
+    }
+    else
+    {
+        state->duplicateSeen = 0;
+    }
+
+    if (error)
+    {
+        MONITOR_INCREMENT(monitor->statistics[pid].continuityErrors);
+        MONITOR_INCREMENT(monitor->report.continuityErrors);
+
+        /* section being collected lost bytes */
+        if (state->sectionSlot != NO_SECTION_SLOT)
+        {
+            monitor->slots[state->sectionSlot].active = 0;
+        }
+    }
+
+    state->lastContinuityCounter = continuityCounter;
+    state->continuityValid = 1;
+}
+
+/* Checks PCR against previous PCR of the PID
+ * Accuracy is checked on the middle one of the last three PCRs against the value
+ * interpolated from packet positions, which assumes constant bitrate between them
+ */
+void checkPcr(StreamMonitor* monitor, uint16_t pid, const uint8_t* adaptationField, bool discontinuity)
+{
+    PidState* state = &monitor->state[pid];
+    uint64_t pcrBase = ((uint64_t)adaptationField[1] << 25) | ((uint64_t)adaptationField[2] << 17)
+        | ((uint64_t)adaptationField[3] << 9) | ((uint64_t)adaptationField[4] << 1) | (adaptationField[5] >> 7);
+    uint64_t pcr = pcrBase * 300 + (((adaptationField[5] & 0x01) << 8) | adaptationField[6]);
+    uint64_t packetIndex = monitor->report.totalPackets;
+    uint64_t pcrDelta = 0;
+    uint64_t expected = 0;
+    int64_t difference = 0;
+
+    if (discontinuity)
+    {
+        state->pcrCount = 0;
+    }
+
+    if (state->pcrCount > 0)
+    {
+        pcrDelta = (pcr + PCR_WRAP - state->pcr[state->pcrCount - 1]) % PCR_WRAP;
+
+        if (pcrDelta > PCR_DISCONTINUITY_LIMIT)
+        {
+            MONITOR_INCREMENT(monitor->statistics[pid].pcrDiscontinuityErrors);
+            MONITOR_INCREMENT(monitor->report.pcrDiscontinuityErrors);
+            state->pcrCount = 0;
+        }
+        else if (pcrDelta > PCR_REPETITION_LIMIT)
+        {
+            MONITOR_INCREMENT(monitor->statistics[pid].pcrRepetitionErrors);
+            MONITOR_INCREMENT(monitor->report.pcrRepetitionErrors);
+        }
+    }
+
+    if (state->pcrCount == 2)
+    {
+        expected = state->pcr[0] + ((pcr + PCR_WRAP - state->pcr[0]) % PCR_WRAP)
+            * (state->pcrPacketIndex[1] - state->pcrPacketIndex[0]) / (packetIndex - state->pcrPacketIndex[0]);
+        difference = (int64_t)((state->pcr[1] + PCR_WRAP - expected % PCR_WRAP) % PCR_WRAP);
+        if (difference > (int64_t)(PCR_WRAP / 2))
+        {
+            difference -= PCR_WRAP;
+        }
+
+        if (difference > PCR_ACCURACY_LIMIT || difference < -PCR_ACCURACY_LIMIT)
+        {
+            MONITOR_INCREMENT(monitor->statistics[pid].pcrAccuracyErrors);
+            MONITOR_INCREMENT(monitor->report.pcrAccuracyErrors);
+        }
+
+        state->pcr[0] = state->pcr[1];
+        state->pcrPacketIndex[0] = state->pcrPacketIndex[1];
+        state->pcrCount = 1;
+    }
+
+    state->pcr[state->pcrCount] = pcr;
+    state->pcrPacketIndex[state->pcrCount] = packetIndex;
+    state->pcrCount++;
+}
+
+void collectSectionBytes(StreamMonitor* monitor, SectionSlot* slot, const uint8_t* data, uint32_t length)
+{
+    uint32_t copyLength = 0;
+
+    while (length > 0 && slot->active)
+    {
+        copyLength = (slot->expected == 0) ? SECTION_LENGTH_OFFSET - slot->collected : slot->expected - slot->collected;
+        if (copyLength > length)
+        {
+            copyLength = length;
+        }
+        memcpy(slot->buffer + slot->collected, data, copyLength);
+        slot->collected += copyLength;
+        data += copyLength;
+        length -= copyLength;
+
+        if (slot->expected == 0 && slot->collected == SECTION_LENGTH_OFFSET)
+        {
+            slot->expected = SECTION_LENGTH_OFFSET + (((slot->buffer[1] << 8) | slot->buffer[2]) & 0x0FFF);
+            if (slot->expected > TABLES_MAX_SECTION_SIZE)
+            {
+                slot->active = 0;
+                return;
+            }
+        }
+
+        if (slot->expected != 0 && slot->collected == slot->expected)
+        {
+            handleSection(monitor, slot);
+
+            /* another section may follow directly, 0xFF starts stuffing, after an empty section only garbage can follow */
+            slot->active = (length > 0 && data[0] != 0xFF && slot->expected > SECTION_LENGTH_OFFSET);
+            slot->collected = 0;
+            slot->expected = 0;
+        }
+    }
+}
+
+void handleSection(StreamMonitor* monitor, SectionSlot* slot)
+{
+    PidState* state = &monitor->state[slot->pid];
+    SectionView view;
+    uint8_t tableId = slot->buffer[0];
+
+    /* TDT and ST carry no CRC, TOT carries one without the syntax indicator */
+    if ((slot->buffer[1] & 0x80) || tableId == 0x73)
+    {
+        if (slot->collected <= SECTION_CRC_SIZE + SECTION_LENGTH_OFFSET || tablesCrc32(slot->buffer, slot->collected) != 0)
+        {
+            MONITOR_INCREMENT(monitor->statistics[slot->pid].crcErrors);
+            MONITOR_INCREMENT(monitor->report.crcErrors);
+            return;
+        }
+    }
+
+    if (sectionViewInit(&view, slot->buffer, slot->collected) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+
+    if (state->roles & PID_ROLE_PAT)
+    {
+        if (tableId != 0x00 || !(slot->buffer[1] & 0x80))
+        {
+            MONITOR_INCREMENT(monitor->report.patErrors);
+            return;
+        }
+        handlePat(monitor, &view);
+    }
+    else if ((state->roles & PID_ROLE_PMT) && tableId == 0x02)
+    {
+        handlePmt(monitor, slot->pid, &view);
+    }
+}
+
+void handlePat(StreamMonitor* monitor, const SectionView* view)
+{
+    PatTable patTable;
+    uint8_t i = 0;
+
+    if (monitor->now - monitor->lastPatTime > PSI_REPETITION_LIMIT && !monitor->patOverdueReported)
+    {
+        MONITOR_INCREMENT(monitor->report.patErrors);
+    }
+    monitor->lastPatTime = monitor->now;
+    monitor->patOverdueReported = 0;
+
+    if (parsePatTable(view, &patTable) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+
+    for (i = 0; i < patTable.serviceInfoCount; i++)
+    {
+        /* program number 0 points to the NIT */
+        if (patTable.patServiceInfoArray[i].programNumber != 0
+            && patTable.patServiceInfoArray[i].pid < STREAM_MONITOR_NUMBER_OF_PIDS
+            && !(monitor->state[patTable.patServiceInfoArray[i].pid].roles & PID_ROLE_PMT))
+        {
+            assignSectionSlot(monitor, patTable.patServiceInfoArray[i].pid, PID_ROLE_PMT);
+            monitor->state[patTable.patServiceInfoArray[i].pid].lastTableTime = monitor->now;
+        }
+    }
+}
+
+void handlePmt(StreamMonitor* monitor, uint16_t pid, const SectionView* view)
+{
+    PidState* state = &monitor->state[pid];
+    PmtTable pmtTable;
+    uint8_t i = 0;
+
+    if (monitor->now - state->lastTableTime > PSI_REPETITION_LIMIT && !state->tableOverdueReported)
+    {
+        MONITOR_INCREMENT(monitor->report.pmtErrors);
+    }
+    state->lastTableTime = monitor->now;
+    state->tableOverdueReported = 0;
+
+    if (parsePmtTable(view, &pmtTable) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+
+    if (pmtTable.pmtHeader.pcrPid < NULL_PACKET_PID)
+    {
+        monitor->state[pmtTable.pmtHeader.pcrPid].roles |= PID_ROLE_REFERENCED;
+    }
+    for (i = 0; i < pmtTable.elementaryInfoCount; i++)
+    {
+        monitor->state[pmtTable.pmtElementaryInfoArray[i].elementaryPid & 0x1FFF].roles |= PID_ROLE_REFERENCED;
+    }
+}
+
+void assignSectionSlot(StreamMonitor* monitor, uint16_t pid, uint8_t role)
+{
+    monitor->state[pid].roles |= role;
+
+    if (monitor->state[pid].sectionSlot != NO_SECTION_SLOT)
+    {
+        return;
+    }
+
+    if (monitor->numberOfSlots == NUMBER_OF_SECTION_SLOTS)
+    {
+        printf("\n%s : ERROR no free section slot for PID %d\n", __FUNCTION__, pid);
+        return;
+    }
+
+    monitor->slots[monitor->numberOfSlots].pid = pid;
+    monitor->state[pid].sectionSlot = monitor->numberOfSlots;
+    monitor->numberOfSlots++;
+}
+
+/* Updates bitrates and reports PSI tables and referenced PIDs gone missing */
+void closeWindow(StreamMonitor* monitor)
+{
+    uint64_t elapsed = monitor->now - monitor->windowStart;
+    uint64_t packetCount = 0;
+    PidState* state = NULL;
+    uint32_t pid = 0;
+
+    for (pid = 0; pid < STREAM_MONITOR_NUMBER_OF_PIDS; pid++)
+    {
+        state = &monitor->state[pid];
+        packetCount = monitor->statistics[pid].packetCount;
+
+        if (packetCount != state->windowStartCount || monitor->statistics[pid].bitrate != 0)
+        {
+            MONITOR_STORE(monitor->statistics[pid].bitrate,
+                (uint32_t)((packetCount - state->windowStartCount) * TS_PACKET_SIZE * 8 * NS_PER_SECOND / elapsed));
+            state->windowStartCount = packetCount;
+        }
+
+        if ((state->roles & PID_ROLE_REFERENCED) && !state->absenceReported
+            && monitor->now - monitor->statistics[pid].lastArrivalTime > PID_ABSENCE_LIMIT)
+        {
+            MONITOR_INCREMENT(monitor->statistics[pid].pidErrors);
+            MONITOR_INCREMENT(monitor->report.pidErrors);
+            state->absenceReported = 1;
+        }
+
+        if ((state->roles & PID_ROLE_PMT) && !state->tableOverdueReported
+            && monitor->now - state->lastTableTime > PSI_REPETITION_LIMIT)
+        {
+            MONITOR_INCREMENT(monitor->report.pmtErrors);
+            state->tableOverdueReported = 1;
+        }
+    }
+
+    if (!monitor->patOverdueReported && monitor->now - monitor->lastPatTime > PSI_REPETITION_LIMIT)
+    {
+        MONITOR_INCREMENT(monitor->report.patErrors);
+        monitor->patOverdueReported = 1;
+    }
+
+    MONITOR_STORE(monitor->report.bitrate,
+        (uint32_t)((monitor->report.totalPackets - monitor->windowStartPackets) * TS_PACKET_SIZE * 8 * NS_PER_SECOND / elapsed));
+    monitor->windowStartPackets = monitor->report.totalPackets;
+    monitor->windowStart = monitor->now;
+}
+
+/* Packets lost while out of sync would show up as continuity and PCR errors */
+void resetPidStates(StreamMonitor* monitor)
+{
+    uint32_t pid = 0;
+
+    for (pid = 0; pid < STREAM_MONITOR_NUMBER_OF_PIDS; pid++)
+    {
+        monitor->state[pid].continuityValid = 0;
+        monitor->state[pid].pcrCount = 0;
+    }
+
+    for (pid = 0; pid < monitor->numberOfSlots; pid++)
+    {
+        monitor->slots[pid].active = 0;
+    }
+}
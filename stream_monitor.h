@@ -0,0 +1,115 @@
+#ifndef __STREAM_MONITOR_H__
+#define __STREAM_MONITOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "tables.h"
+#include "ts_packet.h"
+
+#define STREAM_MONITOR_NUMBER_OF_PIDS 8192          /* Number of different PIDs in a transport stream */
+
+/**
+ * @brief Enumeration of possible stream monitor error codes
+ */
+typedef enum _StreamMonitorError
+{
+    SM_NO_ERROR = 0,
+    SM_ERROR
+}StreamMonitorError;
+
+/**
+ * @brief Structure that holds counters of one PID
+ */
+typedef struct _PidStatistics
+{
+    uint64_t packetCount;                           /* Number of packets received on the PID */
+    uint64_t lastArrivalTime;                       /* Arrival time of the last packet in ns */
+    uint32_t bitrate;                               /* Bits per second measured over the last window */
+    uint32_t continuityErrors;                      /* TR 101 290 1.4 Continuity_count_error */
+    uint32_t pidErrors;                             /* TR 101 290 1.6 PID_error, referenced PID not present */
+    uint32_t transportErrors;                       /* TR 101 290 2.1 Transport_error */
+    uint32_t crcErrors;                             /* TR 101 290 2.2 CRC_error */
+    uint32_t pcrRepetitionErrors;                   /* TR 101 290 2.3a PCR_repetition_error */
+    uint32_t pcrDiscontinuityErrors;                /* TR 101 290 2.3b PCR_discontinuity_indicator_error */
+    uint32_t pcrAccuracyErrors;                     /* TR 101 290 2.4 PCR_accuracy_error */
+}PidStatistics;
+
+/**
+ * @brief Structure that holds counters of the whole transport stream
+ */
+typedef struct _StreamMonitorReport
+{
+    uint32_t tsSyncLoss;                            /* TR 101 290 1.1 TS_sync_loss */
+    uint32_t syncByteErrors;                        /* TR 101 290 1.2 Sync_byte_error */
+    uint32_t patErrors;                             /* TR 101 290 1.3 PAT_error */
+    uint32_t continuityErrors;                      /* TR 101 290 1.4 Continuity_count_error */
+    uint32_t pmtErrors;                             /* TR 101 290 1.5 PMT_error */
+    uint32_t pidErrors;                             /* TR 101 290 1.6 PID_error */
+    uint32_t transportErrors;                       /* TR 101 290 2.1 Transport_error */
+    uint32_t crcErrors;                             /* TR 101 290 2.2 CRC_error */
+    uint32_t pcrRepetitionErrors;                   /* TR 101 290 2.3a PCR_repetition_error */
+    uint32_t pcrDiscontinuityErrors;                /* TR 101 290 2.3b PCR_discontinuity_indicator_error */
+    uint32_t pcrAccuracyErrors;                     /* TR 101 290 2.4 PCR_accuracy_error */
+    uint32_t bitrate;                               /* Bits per second of the whole stream over the last window */
+    uint64_t totalPackets;                          /* Number of packets analyzed */
+    uint8_t inSync;                                 /* 1 while packet synchronization is held */
+}StreamMonitorReport;
+
+/**
+ * @brief Monitor of one transport stream, allocated by streamMonitorCreate
+ */
+typedef struct _StreamMonitor StreamMonitor;
+
+/**
+ * @brief Allocates monitor with all counters cleared
+ *
+ * @param [out] monitor - created monitor
+ * @return stream monitor error code
+ */
+StreamMonitorError streamMonitorCreate(StreamMonitor** monitor);
+
+/**
+ * @brief Frees monitor
+ *
+ * @param [in] monitor - monitor to free
+ * @return stream monitor error code
+ */
+StreamMonitorError streamMonitorDestroy(StreamMonitor* monitor);
+
+/**
+ * @brief Analyzes chunk of transport stream
+ *
+ * Must be called from a single ingestion thread per monitor. Chunks do not have to be packet aligned,
+ * a packet split between two chunks is completed on the next call.
+ *
+ * @param [in] monitor - monitor of the stream
+ * @param [in] data - transport stream bytes
+ * @param [in] length - number of bytes in data
+ * @param [in] arrivalTime - monotonic arrival time of the chunk in ns
+ * @return stream monitor error code
+ */
+StreamMonitorError streamMonitorProcess(StreamMonitor* monitor, const uint8_t* data, uint32_t length, uint64_t arrivalTime);
+
+/**
+ * @brief Reads stream counters, can be called from any thread while ingestion runs
+ *
+ * @param [in] monitor - monitor of the stream
+ * @param [out] report - stream counters
+ * @return stream monitor error code
+ */
+StreamMonitorError streamMonitorGetReport(StreamMonitor* monitor, StreamMonitorReport* report);
+
+/**
+ * @brief Reads counters of one PID, can be called from any thread while ingestion runs
+ *
+ * @param [in] monitor - monitor of the stream
+ * @param [in] pid - PID to read
+ * @param [out] statistics - PID counters
+ * @return stream monitor error code
+ */
+StreamMonitorError streamMonitorGetPidStatistics(StreamMonitor* monitor, uint16_t pid, PidStatistics* statistics);
+
+#endif /* __STREAM_MONITOR_H__ */
@@ -0,0 +1,214 @@
+#include "table_assembler.h"
+#include "tables_fields.h"
+
+/**
+ * @brief Structure that holds extended header fields common to all long sections
+ */
+typedef struct _LongSectionHeader
+{
+    uint8_t tableId;
+    uint8_t sectionSyntaxIndicator;
+    uint16_t sectionLength;
+    uint16_t tableIdExtension;
+    uint8_t versionNumber;
+    uint8_t currentNextIndicator;
+    uint8_t sectionNumber;
+    uint8_t lastSectionNumber;
+}LongSectionHeader;
+
+#define LONG_SECTION_HEADER_FIELDS(X)                           \
+    X(tableId,                  0, 1, 0, 0xFF,   RAW)           \
+    X(sectionSyntaxIndicator,   1, 1, 7, 0x01,   RAW)           \
+    X(sectionLength,            1, 2, 0, 0x0FFF, RAW)           \
+    X(tableIdExtension,         3, 2, 0, 0xFFFF, RAW)           \
+    X(versionNumber,            5, 1, 1, 0x1F,   RAW)           \
+    X(currentNextIndicator,     5, 1, 0, 0x01,   RAW)           \
+    X(sectionNumber,            6, 1, 0, 0xFF,   RAW)           \
+    X(lastSectionNumber,        7, 1, 0, 0xFF,   RAW)
+
+TABLES_DEFINE_EXTRACTOR(extractLongSectionHeader, LongSectionHeader, LONG_SECTION_HEADER_FIELDS)
+
+
+static void releaseEntrySections(TableAssemblyEntry* entry)
+{
+    uint16_t i = 0;
+
+    for (i = 0; i <= entry->lastSectionNumber; i++)
+    {
+        if (entry->sections[i] != NULL)
+        {
+            sectionBufferRelease(entry->sections[i]);
+            entry->sections[i] = NULL;
+        }
+    }
+}
+
+static void startEntryVersion(TableAssemblyEntry* entry, const LongSectionHeader* header)
+{
+    releaseEntrySections(entry);
+
+    entry->complete = false;
+    entry->versionNumber = header->versionNumber;
+    entry->lastSectionNumber = header->lastSectionNumber;
+    entry->receivedCount = 0;
+    memset(entry->receivedBitmap, 0x0, sizeof(entry->receivedBitmap));
+}
+
+static bool poolIsLow(const SectionBuffer* section)
+{
+    SectionPoolStatistics statistics;
+
+    if (sectionPoolGetStatistics(section->sizeClass, &statistics))
+    {
+        return true;
+    }
+
+    return statistics.totalBuffers - statistics.buffersInUse < TABLE_ASSEMBLER_POOL_RESERVE;
+}
+
+static TableAssemblyEntry* findEntry(TableAssembler* assembler, const LongSectionHeader* header)
+{
+    TableAssemblyEntry* freeEntry = NULL;
+    TableAssemblyEntry* oldestEntry = &assembler->entries[0];
+    uint8_t i = 0;
+
+    for (i = 0; i < TABLE_ASSEMBLER_MAX_TABLES; i++)
+    {
+        TableAssemblyEntry* entry = &assembler->entries[i];
+
+        if (!entry->inUse)
+        {
+            if (freeEntry == NULL)
+            {
+                freeEntry = entry;
+            }
+            continue;
+        }
+
+        if (entry->tableId == header->tableId && entry->tableIdExtension == header->tableIdExtension)
+        {
+            return entry;
+        }
+
+        if (entry->lastUsed < oldestEntry->lastUsed)
+        {
+            oldestEntry = entry;
+        }
+    }
+
+    /* no free slot, recycle the least recently used table */
+    if (freeEntry == NULL)
+    {
+        releaseEntrySections(oldestEntry);
+        freeEntry = oldestEntry;
+    }
+
+    memset(freeEntry, 0x0, sizeof(TableAssemblyEntry));
+    freeEntry->inUse = true;
+    freeEntry->tableId = header->tableId;
+    freeEntry->tableIdExtension = header->tableIdExtension;
+    freeEntry->versionNumber = header->versionNumber;
+    freeEntry->lastSectionNumber = header->lastSectionNumber;
+
+    return freeEntry;
+}
+
+void tableAssemblerInit(TableAssembler* assembler, TableCompleteCallback callback, void* userData)
+{
+    memset(assembler, 0x0, sizeof(TableAssembler));
+    assembler->callback = callback;
+    assembler->userData = userData;
+}
+
+void tableAssemblerReset(TableAssembler* assembler)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < TABLE_ASSEMBLER_MAX_TABLES; i++)
+    {
+        if (assembler->entries[i].inUse)
+        {
+            releaseEntrySections(&assembler->entries[i]);
+        }
+        memset(&assembler->entries[i], 0x0, sizeof(TableAssemblyEntry));
+    }
+}
+
+TableAssemblerResult tableAssemblerPushSection(TableAssembler* assembler, const SectionView* sectionView, SectionBuffer* section)
+{
+    LongSectionHeader header;
+    TableAssemblyEntry* entry = NULL;
+    AssembledTable table;
+    uint32_t bitMask = 0;
+
+    if (assembler == NULL || sectionView == NULL || section == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TA_ERROR;
+    }
+
+    if (sectionView->sectionLength < 5 + SECTION_CRC_SIZE)
+    {
+        return TA_ERROR;
+    }
+
+    extractLongSectionHeader(sectionView->buffer, &header);
+
+    /* only long sections of the currently applicable version can be assembled */
+    if (!header.sectionSyntaxIndicator || !header.currentNextIndicator || header.sectionNumber > header.lastSectionNumber)
+    {
+        return TA_ERROR;
+    }
+
+    entry = findEntry(assembler, &header);
+    entry->lastUsed = ++assembler->useCounter;
+
+    if (entry->versionNumber != header.versionNumber || entry->lastSectionNumber != header.lastSectionNumber)
+    {
+        startEntryVersion(entry, &header);
+    }
+    else if (entry->complete)
+    {
+        return TA_TABLE_UNCHANGED;
+    }
+
+    bitMask = (uint32_t)1 << (header.sectionNumber & 31);
+    if (entry->receivedBitmap[header.sectionNumber >> 5] & bitMask)
+    {
+        return TA_SECTION_DUPLICATE;
+    }
+
+    /* a table that stays incomplete must not starve PAT, PMT and TDT of buffers */
+    if (entry->receivedCount + 1 < entry->lastSectionNumber + 1 && poolIsLow(section))
+    {
+        startEntryVersion(entry, &header);
+        return TA_ERROR;
+    }
+
+    sectionBufferRetain(section);
+    entry->sections[header.sectionNumber] = section;
+    entry->receivedBitmap[header.sectionNumber >> 5] |= bitMask;
+    entry->receivedCount++;
+
+    if (entry->receivedCount < entry->lastSectionNumber + 1)
+    {
+        return TA_SECTION_STORED;
+    }
+
+    entry->complete = true;
+
+    if (assembler->callback != NULL)
+    {
+        table.tableId = entry->tableId;
+        table.tableIdExtension = entry->tableIdExtension;
+        table.versionNumber = entry->versionNumber;
+        table.numberOfSections = entry->lastSectionNumber + 1;
+        table.sections = entry->sections;
+        assembler->callback(&table, assembler->userData);
+    }
+
+    /* only version and bitmap are kept for change detection, sections go back to the pool */
+    releaseEntrySections(entry);
+
+    return TA_TABLE_COMPLETE;
+}
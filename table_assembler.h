@@ -0,0 +1,106 @@
+#ifndef __TABLE_ASSEMBLER_H__
+#define __TABLE_ASSEMBLER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tables.h"
+#include "section_pool.h"
+
+#define TABLE_ASSEMBLER_MAX_TABLES 16               /* Max number of tables assembled at the same time */
+#define TABLE_ASSEMBLER_MAX_SECTIONS 256            /* section_number is 8 bits wide */
+#define TABLE_ASSEMBLER_POOL_RESERVE 4              /* Free buffers per pool class incomplete tables leave to others */
+
+/**
+ * @brief Enumeration of possible table assembler results
+ */
+typedef enum _TableAssemblerResult
+{
+    TA_ERROR = 0,                                   /* Section can not be used (short section, next version, pool low) */
+    TA_SECTION_STORED,                              /* Section stored, table still incomplete */
+    TA_SECTION_DUPLICATE,                           /* Section of this version already received */
+    TA_TABLE_COMPLETE,                              /* Last missing section arrived, callback was called */
+    TA_TABLE_UNCHANGED                              /* Table is already complete in this version */
+}TableAssemblerResult;
+
+/**
+ * @brief Structure that defines one completely received table
+ */
+typedef struct _AssembledTable
+{
+    uint8_t tableId;
+    uint16_t tableIdExtension;                      /* transport_stream_id, program_number, service_id... */
+    uint8_t versionNumber;
+    uint16_t numberOfSections;                      /* last_section_number + 1 */
+    SectionBuffer* const* sections;                 /* Sections ordered by section_number */
+}AssembledTable;
+
+/**
+ * @brief Table complete callback, sections are released after it returns unless retained
+ */
+typedef void(*TableCompleteCallback)(const AssembledTable* table, void* userData);
+
+/**
+ * @brief Structure that holds assembly state of one (table_id, extension) pair
+ */
+typedef struct _TableAssemblyEntry
+{
+    bool inUse;
+    bool complete;
+    uint8_t tableId;
+    uint16_t tableIdExtension;
+    uint8_t versionNumber;
+    uint8_t lastSectionNumber;
+    uint16_t receivedCount;
+    uint32_t receivedBitmap[TABLE_ASSEMBLER_MAX_SECTIONS / 32];
+    uint32_t lastUsed;
+    SectionBuffer* sections[TABLE_ASSEMBLER_MAX_SECTIONS];
+}TableAssemblyEntry;
+
+/**
+ * @brief Structure that defines table assembler
+ *
+ * Assembler is not thread safe, sections of one assembler have to be pushed from one thread.
+ */
+typedef struct _TableAssembler
+{
+    TableAssemblyEntry entries[TABLE_ASSEMBLER_MAX_TABLES];
+    TableCompleteCallback callback;
+    void* userData;
+    uint32_t useCounter;
+}TableAssembler;
+
+/**
+ * @brief Initializes table assembler
+ *
+ * @param [out] assembler - assembler to be initialized
+ * @param [in]  callback - called every time a table version is completely received
+ * @param [in]  userData - passed to callback
+ */
+void tableAssemblerInit(TableAssembler* assembler, TableCompleteCallback callback, void* userData);
+
+/**
+ * @brief Releases all sections held by assembler and forgets all tables
+ *
+ * @param [in] assembler - assembler to be reset
+ */
+void tableAssemblerReset(TableAssembler* assembler);
+
+/**
+ * @brief Adds one received section to its table
+ *
+ * Section is retained while its table is incomplete. A new version_number or
+ * last_section_number of the same table drops everything received so far.
+ * The section pool holds far fewer buffers than one table may have sections, so
+ * a section that would leave its pool class with less than TABLE_ASSEMBLER_POOL_RESERVE
+ * free buffers drops the incomplete table instead, it restarts on its next repetition.
+ *
+ * @param [in] assembler - table assembler
+ * @param [in] sectionView - validated view of the section
+ * @param [in] section - pooled buffer that holds the section
+ * @return table assembler result
+ */
+TableAssemblerResult tableAssemblerPushSection(TableAssembler* assembler, const SectionView* sectionView, SectionBuffer* section);
+
+#endif /* __TABLE_ASSEMBLER_H__ */
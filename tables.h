@@ -9,6 +9,7 @@
 #define TABLES_MAX_NUMBER_OF_ELEMENTARY_PID 20      /* Max number of elementary pids in one PMT table */
 #define TABLES_MAX_NUMBER_OF_LTO_DESCRIPTORS 20     /* Max number of elementary info in local time offset descriptor */
 #define TABLES_MAX_NUMBER_OF_TOT_DESCRIPTORS 20     /* Max number of descriptors in tot table */
+#define TABLES_MAX_SECTION_SIZE 4096                /* Max size of private section including header */
 
 /**
  * @brief Enumeration of possible tables parser error codes
@@ -19,6 +20,20 @@ typedef enum _ParseErrorCode
     TABLES_PARSE_OK = 1                             /* TABLES_PARSE_OK */
 }ParseErrorCode;
 
+/**
+ * @brief Structure that defines validated view of one section
+ *
+ * Created by sectionViewInit, which checks section_length against the real buffer size,
+ * so parsers working on a view read fields without further checks.
+ */
+typedef struct _SectionView
+{
+    const uint8_t* buffer;                          /* First byte of the section (table_id) */
+    uint32_t bufferSize;                            /* Number of valid bytes in buffer */
+    uint16_t sectionLength;                         /* Validated section_length */
+    uint8_t tableId;                                /* table_id of the section */
+}SectionView;
+
 /**
  * @brief Structure that defines PAT Table Header
  */
@@ -78,6 +93,7 @@ typedef struct _PmtElementaryInfo
     uint8_t streamType;
     uint16_t elementaryPid;
     uint16_t esInfoLength;
+    const uint8_t* esInfo;                          /* Elementary stream descriptor loop, points into the section buffer */
 }PmtElementaryInfo;
 
 /**
@@ -88,6 +104,7 @@ typedef struct _PmtTable
     PmtTableHeader pmtHeader;
     PmtElementaryInfo pmtElementaryInfoArray[TABLES_MAX_NUMBER_OF_ELEMENTARY_PID];
     uint8_t elementaryInfoCount;
+    const uint8_t* programInfo;                     /* Program descriptor loop, points into the section buffer */
 }PmtTable;
 
 /**
@@ -146,6 +163,16 @@ typedef struct _LocalTimeOffsetDescriptor
     uint8_t descriptorsCount;
  }TotTable;
     
+/**
+ * @brief  Creates section view, validates declared section length against buffer size
+ *
+ * @param  [out]  sectionView View to be initialized
+ * @param  [in]   sectionBuffer Buffer that contains whole section
+ * @param  [in]   bufferSize Number of valid bytes in sectionBuffer
+ * @return tables error code
+ */
+ParseErrorCode sectionViewInit(SectionView* sectionView, const uint8_t* sectionBuffer, uint32_t bufferSize);
+
 /**
  * @brief  Parse PAT header.
  * 
@@ -167,11 +194,20 @@ ParseErrorCode parsePatServiceInfo(const uint8_t* patServiceInfoBuffer, PatServi
 /**
  * @brief  Parse PAT Table.
  * 
- * @param  [in]   patSectionBuffer Buffer that contains PAT table section
+ * @param  [in]   patSection Validated view of PAT table section
  * @param  [out]  patTable PAT Table
  * @return tables error code
  */
-ParseErrorCode parsePatTable(const uint8_t* patSectionBuffer, PatTable* patTable);
+ParseErrorCode parsePatTable(const SectionView* patSection, PatTable* patTable);
+
+/**
+ * @brief  Parse one more section of a multi-section PAT Table, services are appended
+ * 
+ * @param  [in]   patSection Validated view of PAT table section
+ * @param  [out]  patTable PAT Table already holding previous sections
+ * @return tables error code
+ */
+ParseErrorCode appendPatTable(const SectionView* patSection, PatTable* patTable);
 
 /**
  * @brief  Print PAT Table
@@ -202,11 +238,14 @@ ParseErrorCode parsePmtElementaryInfo(const uint8_t* pmtElementaryInfoBuffer, Pm
 /**
  * @brief Parse PMT table
  *
- * @param [in]  pmtSectionBuffer Buffer that contains pmt table section
+ * Descriptor loops are not copied, programInfo and esInfo point into the section buffer
+ * and stay valid as long as it does.
+ *
+ * @param [in]  pmtSection Validated view of PMT table section
  * @param [out] pmtTable PMT table
  * @return tables error code
  */
-ParseErrorCode parsePmtTable(const uint8_t* pmtSectionBuffer, PmtTable* pmtTable);
+ParseErrorCode parsePmtTable(const SectionView* pmtSection, PmtTable* pmtTable);
 
 /**
  * @brief Print PMT table
@@ -219,11 +258,11 @@ ParseErrorCode printPmtTable(PmtTable* pmtTable);
 /**
  * @brief Parse TDT table
  *
- * @param [in]  tdtSectionBuffer Buffer that contains tdt table section
+ * @param [in]  tdtSection Validated view of TDT table section
  * @param [out] tdtTable TDT table
  * @return tables error code
  */
-ParseErrorCode parseTdtTable(const uint8_t* tdtSectionBuffer, TdtTable* tdtTable);
+ParseErrorCode parseTdtTable(const SectionView* tdtSection, TdtTable* tdtTable);
 
 /**
  * @brief Print TDT table
@@ -236,11 +275,11 @@ ParseErrorCode printTdtTable(TdtTable* tdtTable);
 /**
  * @brief Parse TOT table
  *
- * @param [in]  totSectionBuffer Buffer that contains tot table section
+ * @param [in]  totSection Validated view of TOT table section
  * @param [out] totTable TOT table
  * @return tables error code
  */
-ParseErrorCode parseTotTable(const uint8_t* totSectionBuffer, TotTable* totTable);
+ParseErrorCode parseTotTable(const SectionView* totSection, TotTable* totTable);
 
 /**
  * @brief Print TOT table
@@ -250,4 +289,15 @@ ParseErrorCode parseTotTable(const uint8_t* totSectionBuffer, TotTable* totTable
  */
 ParseErrorCode printTotTable(TotTable* totTable);
 
+/**
+ * @brief Calculates CRC-32/MPEG-2 used by PSI/SI sections
+ *
+ * Run over a whole section including its CRC_32 field the result is zero for an intact section.
+ *
+ * @param [in] buffer Bytes to calculate CRC over
+ * @param [in] length Number of bytes in buffer
+ * @return calculated CRC
+ */
+uint32_t tablesCrc32(const uint8_t* buffer, uint32_t length);
+
 #endif /* __TABLES_H__ */
@@ -0,0 +1,127 @@
+#ifndef __TABLES_FIELDS_H__
+#define __TABLES_FIELDS_H__
+
+#include <stdint.h>
+
+/*
+ * Declarative bit-field layouts of PSI/SI tables.
+ *
+ * Every layout is an X-macro list of entries
+ *     X(field, byteOffset, width, shift, mask, decode)
+ * where width is the number of bytes loaded big-endian from byteOffset (1, 2 or 3),
+ * shift and mask select the bits inside the loaded value and decode is RAW or BCD.
+ * TABLES_DEFINE_EXTRACTOR turns a layout into a straight-line extraction function,
+ * so all parsers share one load/shift/mask path instead of hand-written byte juggling.
+ */
+
+/* big-endian loads */
+#define TABLES_LOAD_1(buffer, offset) ((uint32_t)(buffer)[offset])
+#define TABLES_LOAD_2(buffer, offset) (((uint32_t)(buffer)[offset] << 8) | (uint32_t)(buffer)[(offset) + 1])
+#define TABLES_LOAD_3(buffer, offset) (((uint32_t)(buffer)[offset] << 16) | ((uint32_t)(buffer)[(offset) + 1] << 8) | (uint32_t)(buffer)[(offset) + 2])
+
+/* value decoders */
+#define TABLES_DECODE_RAW(value) (value)
+#define TABLES_DECODE_BCD(value) (10*((value) >> 4) + ((value) & 0x0F))
+
+/* PAT header (ISO/IEC 13818-1, 2.4.4.3) */
+#define PAT_HEADER_FIELDS(X)                                    \
+    X(tableId,                  0, 1, 0, 0xFF,   RAW)           \
+    X(sectionSyntaxIndicator,   1, 1, 7, 0x01,   RAW)           \
+    X(sectionLength,            1, 2, 0, 0x0FFF, RAW)           \
+    X(transportStreamId,        3, 2, 0, 0xFFFF, RAW)           \
+    X(versionNumber,            5, 1, 1, 0x1F,   RAW)           \
+    X(currentNextIndicator,     5, 1, 0, 0x01,   RAW)           \
+    X(sectionNumber,            6, 1, 0, 0xFF,   RAW)           \
+    X(lastSectionNumber,        7, 1, 0, 0xFF,   RAW)
+
+/* PAT program loop entry */
+#define PAT_SERVICE_INFO_FIELDS(X)                              \
+    X(programNumber,            0, 2, 0, 0xFFFF, RAW)           \
+    X(pid,                      2, 2, 0, 0x1FFF, RAW)
+
+/* PMT header (ISO/IEC 13818-1, 2.4.4.8) */
+#define PMT_HEADER_FIELDS(X)                                    \
+    X(tableId,                  0, 1, 0, 0xFF,   RAW)           \
+    X(sectionSyntaxIndicator,   1, 1, 7, 0x01,   RAW)           \
+    X(sectionLength,            1, 2, 0, 0x0FFF, RAW)           \
+    X(programNumber,            3, 2, 0, 0xFFFF, RAW)           \
+    X(versionNumber,            5, 1, 1, 0x1F,   RAW)           \
+    X(currentNextIndicator,     5, 1, 0, 0x01,   RAW)           \
+    X(sectionNumber,            6, 1, 0, 0xFF,   RAW)           \
+    X(lastSectionNumber,        7, 1, 0, 0xFF,   RAW)           \
+    X(pcrPid,                   8, 2, 0, 0x1FFF, RAW)           \
+    X(programInfoLength,       10, 2, 0, 0x0FFF, RAW)
+
+/* PMT elementary stream loop entry */
+#define PMT_ELEMENTARY_INFO_FIELDS(X)                           \
+    X(streamType,               0, 1, 0, 0xFF,   RAW)           \
+    X(elementaryPid,            1, 2, 0, 0x1FFF, RAW)           \
+    X(esInfoLength,             3, 2, 0, 0x0FFF, RAW)
+
+/* TDT (ETSI EN 300 468, 5.2.5) */
+#define TDT_FIELDS(X)                                           \
+    X(tableId,                  0, 1, 0, 0xFF,   RAW)           \
+    X(sectionSyntaxIndicator,   1, 1, 7, 0x01,   RAW)           \
+    X(sectionLength,            1, 2, 0, 0x0FFF, RAW)           \
+    X(MJD,                      3, 2, 0, 0xFFFF, RAW)           \
+    X(hours,                    5, 1, 0, 0xFF,   BCD)           \
+    X(minutes,                  6, 1, 0, 0xFF,   BCD)           \
+    X(seconds,                  7, 1, 0, 0xFF,   BCD)
+
+/* TOT header up to the descriptor loop (ETSI EN 300 468, 5.2.6) */
+#define TOT_FIELDS(X)                                           \
+    TDT_FIELDS(X)                                               \
+    X(descriptorsLoopLength,    8, 2, 0, 0x0FFF, RAW)
+
+/* local time offset descriptor loop entry (ETSI EN 300 468, 6.2.20) */
+#define LTO_INFO_FIELDS(X)                                      \
+    X(countryCH1,               0, 1, 0, 0xFF,   RAW)           \
+    X(countryCH2,               1, 1, 0, 0xFF,   RAW)           \
+    X(countryCH3,               2, 1, 0, 0xFF,   RAW)           \
+    X(countryRegionId,          3, 1, 2, 0x3F,   RAW)           \
+    X(localTimeOffsetPolarity,  3, 1, 0, 0x01,   RAW)           \
+    X(localTimeOffsetHours,     4, 1, 0, 0xFF,   BCD)           \
+    X(localTimeOffsetMinutes,   5, 1, 0, 0xFF,   BCD)
+
+/* ISO 639 language descriptor loop entry after the language code (ISO/IEC 13818-1, 2.6.18) */
+#define ISO_639_LANGUAGE_ENTRY_FIELDS(X)                        \
+    X(audioType,                3, 1, 0, 0xFF,   RAW)
+
+/* teletext descriptor loop entry after the language code (ETSI EN 300 468, 6.2.43) */
+#define TELETEXT_ENTRY_FIELDS(X)                                \
+    X(teletextType,             3, 1, 3, 0x1F,   RAW)           \
+    X(magazineNumber,           3, 1, 0, 0x07,   RAW)           \
+    X(pageNumber,               4, 1, 0, 0xFF,   RAW)
+
+/* subtitling descriptor loop entry after the language code (ETSI EN 300 468, 6.2.41) */
+#define SUBTITLING_ENTRY_FIELDS(X)                              \
+    X(subtitlingType,           3, 1, 0, 0xFF,   RAW)           \
+    X(compositionPageId,        4, 2, 0, 0xFFFF, RAW)           \
+    X(ancillaryPageId,          6, 2, 0, 0xFFFF, RAW)
+
+#define TABLES_EXTRACT_FIELD(field, offset, width, shift, mask, decode) \
+    out->field = TABLES_DECODE_##decode((TABLES_LOAD_##width(buffer, offset) >> (shift)) & (mask));
+
+/* defines static inline void name(const uint8_t* buffer, type* out) extracting every field of the layout */
+#define TABLES_DEFINE_EXTRACTOR(name, type, FIELDS)             \
+    static inline void name(const uint8_t* buffer, type* out)   \
+    {                                                           \
+        FIELDS(TABLES_EXTRACT_FIELD)                            \
+    }
+
+#define PAT_HEADER_SIZE             8       /* Size of PAT header before the program loop */
+#define PAT_SERVICE_INFO_SIZE       4       /* Size of one PAT program loop entry */
+#define PMT_HEADER_SIZE             12      /* Size of PMT header before program info descriptors */
+#define PMT_ELEMENTARY_INFO_SIZE    5       /* Size of PMT elementary loop entry without descriptors */
+#define TDT_SECTION_LENGTH          5       /* section_length of TDT, it carries only UTC_time */
+#define TOT_HEADER_SIZE             10      /* Size of TOT header before the descriptor loop */
+#define DESCRIPTOR_HEADER_SIZE      2       /* Size of descriptor tag and length */
+#define LTO_INFO_SIZE               13      /* Size of one local time offset descriptor loop entry */
+#define ISO_639_LANGUAGE_ENTRY_SIZE 4       /* Size of one ISO 639 language descriptor loop entry */
+#define TELETEXT_ENTRY_SIZE         5       /* Size of one teletext descriptor loop entry */
+#define SUBTITLING_ENTRY_SIZE       8       /* Size of one subtitling descriptor loop entry */
+#define LANGUAGE_CODE_SIZE          3       /* Size of ISO 639-2 language code */
+#define SECTION_CRC_SIZE            4       /* Size of CRC_32 at the end of long sections */
+#define SECTION_LENGTH_OFFSET       3       /* Bytes not counted in section_length */
+
+#endif /* __TABLES_FIELDS_H__ */
@@ -1,4 +1,84 @@
 #include "tables.h"
+#include "tables_fields.h"
+#include "descriptors.h"
+
+TABLES_DEFINE_EXTRACTOR(extractPatHeader, PatHeader, PAT_HEADER_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractPatServiceInfo, PatServiceInfo, PAT_SERVICE_INFO_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractPmtHeader, PmtTableHeader, PMT_HEADER_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractPmtElementaryInfo, PmtElementaryInfo, PMT_ELEMENTARY_INFO_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractTdtTable, TdtTable, TDT_FIELDS)
+TABLES_DEFINE_EXTRACTOR(extractTotTable, TotTable, TOT_FIELDS)
+
+/* CRC-32/MPEG-2 lookup table, polynomial 0x04C11DB7, not reflected */
+static const uint32_t crc32Table[256] =
+{
+    0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B,
+    0x1A864DB2, 0x1E475005, 0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+    0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD, 0x4C11DB70, 0x48D0C6C7,
+    0x4593E01E, 0x4152FDA9, 0x5F15ADAC, 0x5BD4B01B, 0x569796C2, 0x52568B75,
+    0x6A1936C8, 0x6ED82B7F, 0x639B0DA6, 0x675A1011, 0x791D4014, 0x7DDC5DA3,
+    0x709F7B7A, 0x745E66CD, 0x9823B6E0, 0x9CE2AB57, 0x91A18D8E, 0x95609039,
+    0x8B27C03C, 0x8FE6DD8B, 0x82A5FB52, 0x8664E6E5, 0xBE2B5B58, 0xBAEA46EF,
+    0xB7A96036, 0xB3687D81, 0xAD2F2D84, 0xA9EE3033, 0xA4AD16EA, 0xA06C0B5D,
+    0xD4326D90, 0xD0F37027, 0xDDB056FE, 0xD9714B49, 0xC7361B4C, 0xC3F706FB,
+    0xCEB42022, 0xCA753D95, 0xF23A8028, 0xF6FB9D9F, 0xFBB8BB46, 0xFF79A6F1,
+    0xE13EF6F4, 0xE5FFEB43, 0xE8BCCD9A, 0xEC7DD02D, 0x34867077, 0x30476DC0,
+    0x3D044B19, 0x39C556AE, 0x278206AB, 0x23431B1C, 0x2E003DC5, 0x2AC12072,
+    0x128E9DCF, 0x164F8078, 0x1B0CA6A1, 0x1FCDBB16, 0x018AEB13, 0x054BF6A4,
+    0x0808D07D, 0x0CC9CDCA, 0x7897AB07, 0x7C56B6B0, 0x71159069, 0x75D48DDE,
+    0x6B93DDDB, 0x6F52C06C, 0x6211E6B5, 0x66D0FB02, 0x5E9F46BF, 0x5A5E5B08,
+    0x571D7DD1, 0x53DC6066, 0x4D9B3063, 0x495A2DD4, 0x44190B0D, 0x40D816BA,
+    0xACA5C697, 0xA864DB20, 0xA527FDF9, 0xA1E6E04E, 0xBFA1B04B, 0xBB60ADFC,
+    0xB6238B25, 0xB2E29692, 0x8AAD2B2F, 0x8E6C3698, 0x832F1041, 0x87EE0DF6,
+    0x99A95DF3, 0x9D684044, 0x902B669D, 0x94EA7B2A, 0xE0B41DE7, 0xE4750050,
+    0xE9362689, 0xEDF73B3E, 0xF3B06B3B, 0xF771768C, 0xFA325055, 0xFEF34DE2,
+    0xC6BCF05F, 0xC27DEDE8, 0xCF3ECB31, 0xCBFFD686, 0xD5B88683, 0xD1799B34,
+    0xDC3ABDED, 0xD8FBA05A, 0x690CE0EE, 0x6DCDFD59, 0x608EDB80, 0x644FC637,
+    0x7A089632, 0x7EC98B85, 0x738AAD5C, 0x774BB0EB, 0x4F040D56, 0x4BC510E1,
+    0x46863638, 0x42472B8F, 0x5C007B8A, 0x58C1663D, 0x558240E4, 0x51435D53,
+    0x251D3B9E, 0x21DC2629, 0x2C9F00F0, 0x285E1D47, 0x36194D42, 0x32D850F5,
+    0x3F9B762C, 0x3B5A6B9B, 0x0315D626, 0x07D4CB91, 0x0A97ED48, 0x0E56F0FF,
+    0x1011A0FA, 0x14D0BD4D, 0x19939B94, 0x1D528623, 0xF12F560E, 0xF5EE4BB9,
+    0xF8AD6D60, 0xFC6C70D7, 0xE22B20D2, 0xE6EA3D65, 0xEBA91BBC, 0xEF68060B,
+    0xD727BBB6, 0xD3E6A601, 0xDEA580D8, 0xDA649D6F, 0xC423CD6A, 0xC0E2D0DD,
+    0xCDA1F604, 0xC960EBB3, 0xBD3E8D7E, 0xB9FF90C9, 0xB4BCB610, 0xB07DABA7,
+    0xAE3AFBA2, 0xAAFBE615, 0xA7B8C0CC, 0xA379DD7B, 0x9B3660C6, 0x9FF77D71,
+    0x92B45BA8, 0x9675461F, 0x8832161A, 0x8CF30BAD, 0x81B02D74, 0x857130C3,
+    0x5D8A9099, 0x594B8D2E, 0x5408ABF7, 0x50C9B640, 0x4E8EE645, 0x4A4FFBF2,
+    0x470CDD2B, 0x43CDC09C, 0x7B827D21, 0x7F436096, 0x7200464F, 0x76C15BF8,
+    0x68860BFD, 0x6C47164A, 0x61043093, 0x65C52D24, 0x119B4BE9, 0x155A565E,
+    0x18197087, 0x1CD86D30, 0x029F3D35, 0x065E2082, 0x0B1D065B, 0x0FDC1BEC,
+    0x3793A651, 0x3352BBE6, 0x3E119D3F, 0x3AD08088, 0x2497D08D, 0x2056CD3A,
+    0x2D15EBE3, 0x29D4F654, 0xC5A92679, 0xC1683BCE, 0xCC2B1D17, 0xC8EA00A0,
+    0xD6AD50A5, 0xD26C4D12, 0xDF2F6BCB, 0xDBEE767C, 0xE3A1CBC1, 0xE760D676,
+    0xEA23F0AF, 0xEEE2ED18, 0xF0A5BD1D, 0xF464A0AA, 0xF9278673, 0xFDE69BC4,
+    0x89B8FD09, 0x8D79E0BE, 0x803AC667, 0x84FBDBD0, 0x9ABC8BD5, 0x9E7D9662,
+    0x933EB0BB, 0x97FFAD0C, 0xAFB010B1, 0xAB710D06, 0xA6322BDF, 0xA2F33668,
+    0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4
+};
+
+ParseErrorCode sectionViewInit(SectionView* sectionView, const uint8_t* sectionBuffer, uint32_t bufferSize)
+{
+    if (sectionView == NULL || sectionBuffer == NULL || bufferSize < SECTION_LENGTH_OFFSET)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
+
+    sectionView->buffer = sectionBuffer;
+    sectionView->bufferSize = bufferSize;
+    sectionView->tableId = *sectionBuffer;
+    sectionView->sectionLength = (uint16_t)(TABLES_LOAD_2(sectionBuffer, 1) & 0x0FFF);
+
+    /* every later length is checked against this one, so it must fit into the real buffer */
+    if ((uint32_t)sectionView->sectionLength + SECTION_LENGTH_OFFSET > bufferSize)
+    {
+        printf("\n%s : ERROR section length %d exceeds buffer size %d\n", __FUNCTION__, sectionView->sectionLength, bufferSize);
+        return TABLES_PARSE_ERROR;
+    }
+
+    return TABLES_PARSE_OK;
+}
 
 ParseErrorCode parsePatHeader(const uint8_t* patHeaderBuffer, PatHeader* patHeader)
 {    
@@ -8,43 +88,13 @@ ParseErrorCode parsePatHeader(const uint8_t* patHeaderBuffer, PatHeader* patHead
         return TABLES_PARSE_ERROR;
     }
 
-    patHeader->tableId = (uint8_t)* patHeaderBuffer; 
-    if (patHeader->tableId != 0x00)
+    if (*patHeaderBuffer != 0x00)
     {
         printf("\n%s : ERROR it is not a PAT Table\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-    
-    lower8Bits = (uint8_t)(*(patHeaderBuffer + 1));
-    lower8Bits = lower8Bits >> 7;
-    patHeader->sectionSyntaxIndicator = lower8Bits & 0x01;
-
-    higher8Bits = (uint8_t) (*(patHeaderBuffer + 1));
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 2));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    patHeader->sectionLength = all16Bits & 0x0FFF;
-    
-    higher8Bits = (uint8_t) (*(patHeaderBuffer + 3));
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 4));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    patHeader->transportStreamId = all16Bits & 0xFFFF;
-    
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 5));
-    lower8Bits = lower8Bits >> 1;
-    patHeader->versionNumber = lower8Bits & 0x1F;
 
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 5));
-    patHeader->currentNextIndicator = lower8Bits & 0x01;
-
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 6));
-    patHeader->sectionNumber = lower8Bits & 0xFF;
-
-    lower8Bits = (uint8_t) (*(patHeaderBuffer + 7));
-    patHeader->lastSectionNumber = lower8Bits & 0xFF;
+    extractPatHeader(patHeaderBuffer, patHeader);
 
     return TABLES_PARSE_OK;
 }
@@ -56,46 +106,41 @@ ParseErrorCode parsePatServiceInfo(const uint8_t* patServiceInfoBuffer, PatServi
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-
-    higher8Bits = (uint8_t) (*(patServiceInfoBuffer));
-    lower8Bits = (uint8_t) (*(patServiceInfoBuffer + 1));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    patServiceInfo->programNumber = all16Bits & 0xFFFF; 
-
-    higher8Bits = (uint8_t) (*(patServiceInfoBuffer + 2));
-    lower8Bits = (uint8_t) (*(patServiceInfoBuffer + 3));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    patServiceInfo->pid = all16Bits & 0x1FFF;
-    
+
+    extractPatServiceInfo(patServiceInfoBuffer, patServiceInfo);
+
     return TABLES_PARSE_OK;
 }
 
-ParseErrorCode parsePatTable(const uint8_t* patSectionBuffer, PatTable* patTable)
+ParseErrorCode appendPatTable(const SectionView* patSection, PatTable* patTable)
 {
-    uint8_t * currentBufferPosition = NULL;
-    uint32_t parsedLength = 0;
+    const uint8_t* currentBufferPosition = NULL;
+    const uint8_t* programLoopEnd = NULL;
     
-    if(patSectionBuffer==NULL || patTable==NULL)
+    if(patSection==NULL || patTable==NULL)
     {
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    if(parsePatHeader(patSectionBuffer,&(patTable->patHeader))!=TABLES_PARSE_OK)
+
+    if (patSection->tableId != 0x00)
     {
-        printf("\n%s : ERROR parsing PAT header\n", __FUNCTION__);
+        printf("\n%s : ERROR it is not a PAT Table\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
+
+    if (patSection->sectionLength < PAT_HEADER_SIZE + SECTION_CRC_SIZE - SECTION_LENGTH_OFFSET)
+    {
+        printf("\n%s : ERROR PAT section is too short\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
+
+    extractPatHeader(patSection->buffer, &(patTable->patHeader));
     
-    parsedLength = 12 /*PAT header size*/ - 3 /*Not in section length*/;
-    currentBufferPosition = (uint8_t *)(patSectionBuffer + 8); /* Position after last_section_number */
-    patTable->serviceInfoCount = 0; /* Number of services info presented in PAT table */
+    currentBufferPosition = patSection->buffer + PAT_HEADER_SIZE; /* Position after last_section_number */
+    programLoopEnd = patSection->buffer + SECTION_LENGTH_OFFSET + patSection->sectionLength - SECTION_CRC_SIZE;
     
-    while(parsedLength < patTable->patHeader.sectionLength)
+    while(currentBufferPosition + PAT_SERVICE_INFO_SIZE <= programLoopEnd)
     {
         if(patTable->serviceInfoCount > TABLES_MAX_NUMBER_OF_PIDS_IN_PAT - 1)
         {
@@ -103,17 +148,27 @@ ParseErrorCode parsePatTable(const uint8_t* patSectionBuffer, PatTable* patTable
             return TABLES_PARSE_ERROR;
         }
         
-        if(parsePatServiceInfo(currentBufferPosition, &(patTable->patServiceInfoArray[patTable->serviceInfoCount])) == TABLES_PARSE_OK)
-        {
-            currentBufferPosition += 4; /* Size from program_number to pid */
-            parsedLength += 4; /* Size from program_number to pid */
-            patTable->serviceInfoCount ++;
-        }    
+        extractPatServiceInfo(currentBufferPosition, &(patTable->patServiceInfoArray[patTable->serviceInfoCount]));
+        currentBufferPosition += PAT_SERVICE_INFO_SIZE;
+        patTable->serviceInfoCount++;
     }
     
     return TABLES_PARSE_OK;
 }
 
+ParseErrorCode parsePatTable(const SectionView* patSection, PatTable* patTable)
+{
+    if(patTable==NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
+
+    patTable->serviceInfoCount = 0; /* Number of services info presented in PAT table */
+
+    return appendPatTable(patSection, patTable);
+}
+
 ParseErrorCode printPatTable(PatTable* patTable)
 {
     uint8_t i=0;
@@ -152,53 +207,13 @@ ParseErrorCode parsePmtHeader(const uint8_t* pmtHeaderBuffer, PmtTableHeader* pm
         return TABLES_PARSE_ERROR;
     }
 
-    pmtHeader->tableId = (uint8_t)* pmtHeaderBuffer; 
-    if (pmtHeader->tableId != 0x02)
+    if (*pmtHeaderBuffer != 0x02)
     {
         printf("\n%s : ERROR it is not a PMT Table\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 1));
-    lower8Bits = lower8Bits >> 7;
-    pmtHeader->sectionSyntaxIndicator = lower8Bits & 0x01;
-    
-    higher8Bits = (uint8_t) (*(pmtHeaderBuffer + 1));
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 2));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtHeader->sectionLength = all16Bits & 0x0FFF;
-
-    higher8Bits = (uint8_t) (*(pmtHeaderBuffer + 3));
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 4));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtHeader->programNumber = all16Bits & 0xFFFF;
-    
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 5));
-    lower8Bits = lower8Bits >> 1;
-    pmtHeader->versionNumber = lower8Bits & 0x1F;
 
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 5));
-    pmtHeader->currentNextIndicator = lower8Bits & 0x01;
-
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 6));
-    pmtHeader->sectionNumber = lower8Bits & 0xFF;
-
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 7));
-    pmtHeader->lastSectionNumber = lower8Bits & 0xFF;
-
-    higher8Bits = (uint8_t) (*(pmtHeaderBuffer + 8));
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 9));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtHeader->pcrPid = all16Bits & 0xFFFF;
-
-    higher8Bits = (uint8_t) (*(pmtHeaderBuffer + 10));
-    lower8Bits = (uint8_t) (*(pmtHeaderBuffer + 11));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtHeader->programInfoLength = all16Bits & 0x0FFF;
+    extractPmtHeader(pmtHeaderBuffer, pmtHeader);
 
     return TABLES_PARSE_OK;
 }
@@ -210,61 +225,69 @@ ParseErrorCode parsePmtElementaryInfo(const uint8_t* pmtElementaryInfoBuffer, Pm
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-    
-    pmtElementaryInfo->streamType = (uint8_t) (*(pmtElementaryInfoBuffer));
 
-    higher8Bits = (uint8_t) (*(pmtElementaryInfoBuffer + 1));
-    lower8Bits = (uint8_t) (*(pmtElementaryInfoBuffer + 2));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtElementaryInfo->elementaryPid = all16Bits & 0x1FFF; 
-
-    higher8Bits = (uint8_t) (*(pmtElementaryInfoBuffer + 3));
-    lower8Bits = (uint8_t) (*(pmtElementaryInfoBuffer + 4));
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    pmtElementaryInfo->esInfoLength = all16Bits & 0x0FFF;
+    extractPmtElementaryInfo(pmtElementaryInfoBuffer, pmtElementaryInfo);
 
     return TABLES_PARSE_OK;
 }
 
-ParseErrorCode parsePmtTable(const uint8_t* pmtSectionBuffer, PmtTable* pmtTable)
+ParseErrorCode parsePmtTable(const SectionView* pmtSection, PmtTable* pmtTable)
 {
-    uint8_t * currentBufferPosition = NULL;
-    uint32_t parsedLength = 0;
+    const uint8_t* currentBufferPosition = NULL;
+    const uint8_t* elementaryLoopEnd = NULL;
     
-    if(pmtSectionBuffer==NULL || pmtTable==NULL)
+    if(pmtSection==NULL || pmtTable==NULL)
     {
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    if(parsePmtHeader(pmtSectionBuffer,&(pmtTable->pmtHeader))!=TABLES_PARSE_OK)
+
+    if (pmtSection->tableId != 0x02)
     {
-        printf("\n%s : ERROR parsing PMT header\n", __FUNCTION__);
+        printf("\n%s : ERROR it is not a PMT Table\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
-    
-    parsedLength = 12 + pmtTable->pmtHeader.programInfoLength /*PMT header size*/ + 4 /*CRC size*/ - 3 /*Not in section length*/;
-    currentBufferPosition = (uint8_t *)(pmtSectionBuffer + 12 + pmtTable->pmtHeader.programInfoLength); /* Position after last descriptor */
+
+    if (pmtSection->sectionLength < PMT_HEADER_SIZE + SECTION_CRC_SIZE - SECTION_LENGTH_OFFSET)
+    {
+        printf("\n%s : ERROR PMT section is too short\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
+
+    extractPmtHeader(pmtSection->buffer, &(pmtTable->pmtHeader));
+
+    elementaryLoopEnd = pmtSection->buffer + SECTION_LENGTH_OFFSET + pmtSection->sectionLength - SECTION_CRC_SIZE;
+    pmtTable->programInfo = pmtSection->buffer + PMT_HEADER_SIZE;
+    currentBufferPosition = pmtTable->programInfo + pmtTable->pmtHeader.programInfoLength; /* Position after last descriptor */
     pmtTable->elementaryInfoCount = 0; /* Number of elementary info presented in PMT table */
+
+    if (currentBufferPosition > elementaryLoopEnd)
+    {
+        printf("\n%s : ERROR program info length exceeds section\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
     
-    while(parsedLength < pmtTable->pmtHeader.sectionLength)
+    while(currentBufferPosition + PMT_ELEMENTARY_INFO_SIZE <= elementaryLoopEnd)
     {
+        PmtElementaryInfo* elementaryInfo = &(pmtTable->pmtElementaryInfoArray[pmtTable->elementaryInfoCount]);
+
         if(pmtTable->elementaryInfoCount > TABLES_MAX_NUMBER_OF_ELEMENTARY_PID - 1)
         {
             printf("\n%s : ERROR there is not enough space in PMT structure for elementary info\n", __FUNCTION__);
             return TABLES_PARSE_ERROR;
         }
         
-        if(parsePmtElementaryInfo(currentBufferPosition, &(pmtTable->pmtElementaryInfoArray[pmtTable->elementaryInfoCount])) == TABLES_PARSE_OK)
+        extractPmtElementaryInfo(currentBufferPosition, elementaryInfo);
+        elementaryInfo->esInfo = currentBufferPosition + PMT_ELEMENTARY_INFO_SIZE;
+        currentBufferPosition += PMT_ELEMENTARY_INFO_SIZE + elementaryInfo->esInfoLength; /* Size from stream type to end of elementary info descriptors */
+
+        if (currentBufferPosition > elementaryLoopEnd)
         {
-            currentBufferPosition += 5 + pmtTable->pmtElementaryInfoArray[pmtTable->elementaryInfoCount].esInfoLength; /* Size from stream type to elemntary info descriptor*/
-            parsedLength += 5 + pmtTable->pmtElementaryInfoArray[pmtTable->elementaryInfoCount].esInfoLength; /* Size from stream type to elementary info descriptor */
-            pmtTable->elementaryInfoCount++;
-        }    
+            printf("\n%s : ERROR ES info length exceeds section\n", __FUNCTION__);
+            return TABLES_PARSE_ERROR;
+        }
+
+        pmtTable->elementaryInfoCount++;
     }
 
     return TABLES_PARSE_OK;
@@ -299,38 +322,21 @@ ParseErrorCode printPmtTable(PmtTable* pmtTable)
     return TABLES_PARSE_OK;
 }
 
-ParseErrorCode parseTdtTable(const uint8_t* tdtSectionBuffer, TdtTable* tdtTable)
+ParseErrorCode parseTdtTable(const SectionView* tdtSection, TdtTable* tdtTable)
 {
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-
-    if (tdtSectionBuffer == NULL || tdtTable == NULL)
+    if (tdtSection == NULL || tdtTable == NULL)
     {
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
 
-    tdtTable->tableId = (uint8_t)* tdtSectionBuffer;
-
-    higher8Bits = (uint8_t) *(tdtSectionBuffer + 1);
-    lower8Bits = (uint8_t) *(tdtSectionBuffer + 2);
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    tdtTable->sectionLength = all16Bits & 0x0FFF;
-
-    higher8Bits = (uint8_t) *(tdtSectionBuffer + 3);
-    lower8Bits = (uint8_t) *(tdtSectionBuffer + 4);
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    tdtTable->MJD = all16Bits;
-
-    lower8Bits = (uint8_t) *(tdtSectionBuffer + 5);
-    tdtTable->hours = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
-
-    lower8Bits = (uint8_t) *(tdtSectionBuffer + 6);
-    tdtTable->minutes = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
+    if (tdtSection->tableId != 0x70 || tdtSection->sectionLength < TDT_SECTION_LENGTH)
+    {
+        printf("\n%s : ERROR it is not a valid TDT Table\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
 
-    lower8Bits = (uint8_t) *(tdtSectionBuffer + 7);
-    tdtTable->seconds = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
+    extractTdtTable(tdtSection->buffer, tdtTable);
 
     return TABLES_PARSE_OK;
 }
@@ -353,78 +359,65 @@ ParseErrorCode printTdtTable(TdtTable* tdtTable)
     return TABLES_PARSE_OK;
 }
 
-ParseErrorCode parseTotTable(const uint8_t* totSectionBuffer, TotTable* totTable)
+ParseErrorCode parseTotTable(const SectionView* totSection, TotTable* totTable)
 {
-    uint8_t lower8Bits = 0;
-    uint8_t higher8Bits = 0;
-    uint16_t all16Bits = 0;
-    uint16_t descriptorLoopLength = 0;
-    uint8_t infoLoopLength = 0;
-    totTable->descriptorsCount = 0;
+    DescriptorIterator iterator;
+    Descriptor descriptor;
+    TypedDescriptor localTimeOffset;
+    uint8_t i = 0;
 
-    if (totSectionBuffer == NULL || totTable == NULL)
+    if (totSection == NULL || totTable == NULL)
     {
         printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
         return TABLES_PARSE_ERROR;
     }
 
-    totTable->tableId = (uint8_t)* totSectionBuffer;
-
-    higher8Bits = (uint8_t) *(totSectionBuffer + 1);
-    lower8Bits = (uint8_t) *(totSectionBuffer + 2);
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    totTable->sectionLength = all16Bits & 0x0FFF;
+    if (totSection->tableId != 0x73 || totSection->sectionLength < TOT_HEADER_SIZE + SECTION_CRC_SIZE - SECTION_LENGTH_OFFSET)
+    {
+        printf("\n%s : ERROR it is not a valid TOT Table\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
 
-    higher8Bits = (uint8_t) *(totSectionBuffer + 3);
-    lower8Bits = (uint8_t) *(totSectionBuffer + 4);
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    totTable->MJD = all16Bits;
+    extractTotTable(totSection->buffer, totTable);
+    totTable->descriptorsCount = 0;
 
-    lower8Bits = (uint8_t) *(totSectionBuffer + 5);
-    totTable->hours = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
+    if (TOT_HEADER_SIZE + totTable->descriptorsLoopLength + SECTION_CRC_SIZE > totSection->sectionLength + SECTION_LENGTH_OFFSET)
+    {
+        printf("\n%s : ERROR descriptors loop length exceeds section\n", __FUNCTION__);
+        return TABLES_PARSE_ERROR;
+    }
 
-    lower8Bits = (uint8_t) *(totSectionBuffer + 6);
-    totTable->minutes = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
+    /* only local time offset descriptors are kept, everything else is skipped in place */
+    descriptorIteratorInit(&iterator, totSection->buffer + TOT_HEADER_SIZE, totTable->descriptorsLoopLength);
+    while (descriptorIteratorNext(&iterator, &descriptor))
+    {
+        LocalTimeOffsetDescriptor* totDescriptor = &(totTable->descriptors[totTable->descriptorsCount]);
 
-    lower8Bits = (uint8_t) *(totSectionBuffer + 7);
-    totTable->seconds = 10*(lower8Bits >> 4) + (lower8Bits & 0x0F);
+        if (descriptor.tag != DESCRIPTOR_TAG_LOCAL_TIME_OFFSET || decodeDescriptor(&descriptor, &localTimeOffset) != TABLES_PARSE_OK)
+        {
+            continue;
+        }
 
-    higher8Bits = (uint8_t) *(totSectionBuffer + 8);
-    lower8Bits = (uint8_t) *(totSectionBuffer + 9);
-    all16Bits = (uint16_t) ((higher8Bits << 8) + lower8Bits);
-    totTable->descriptorsLoopLength = all16Bits & 0x0FFF;
-    descriptorLoopLength = all16Bits & 0x0FFF;
+        if (totTable->descriptorsCount > TABLES_MAX_NUMBER_OF_TOT_DESCRIPTORS - 1)
+        {
+            printf("\n%s : ERROR there is not enough space in TOT structure for descriptors\n", __FUNCTION__);
+            return TABLES_PARSE_ERROR;
+        }
 
-    while (descriptorLoopLength > 4)
-    {
-        uint8_t i = 0;
-        uint8_t currentDesc = totTable->descriptorsCount;
-        uint8_t currentTag = (uint8_t) *(totSectionBuffer + 10 + 15*currentDesc);
+        totDescriptor->descriptorTag = descriptor.tag;
+        totDescriptor->descriptorLength = descriptor.length;
+        totDescriptor->numberOfInfos = localTimeOffset.value.localTimeOffset.numberOfEntries;
+        if (totDescriptor->numberOfInfos > TABLES_MAX_NUMBER_OF_LTO_DESCRIPTORS)
+        {
+            totDescriptor->numberOfInfos = TABLES_MAX_NUMBER_OF_LTO_DESCRIPTORS;
+        }
 
-        if (currentTag == 0x58)
+        for (i = 0; i < totDescriptor->numberOfInfos; i++)
         {
-            totTable->descriptors[currentDesc].descriptorTag = currentTag;
-            totTable->descriptors[currentDesc].descriptorLength = (uint8_t) *(totSectionBuffer + 11 + 15*currentDesc);
-            totTable->descriptors[currentDesc].numberOfInfos = (uint8_t) (*(totSectionBuffer + 11 + 15*currentDesc)/13);
-
-            for (i = 0; i < totTable->descriptors[currentDesc].numberOfInfos; i++)
-            {
-                totTable->descriptors[currentDesc].ltoInfo[i].countryCH1 = (uint8_t) *(totSectionBuffer + 12 + i*13);
-                totTable->descriptors[currentDesc].ltoInfo[i].countryCH2 = (uint8_t) *(totSectionBuffer + 13 + i*13);
-                totTable->descriptors[currentDesc].ltoInfo[i].countryCH3 = (uint8_t) *(totSectionBuffer + 14 + i*13);
-
-                lower8Bits = (uint8_t) *(totSectionBuffer + 15 + i*13);
-                totTable->descriptors[currentDesc].ltoInfo[i].localTimeOffsetPolarity = lower8Bits & 0x01;
-                totTable->descriptors[currentDesc].ltoInfo[i].countryRegionId = lower8Bits >> 2;
-            
-                higher8Bits = (uint8_t) *(totSectionBuffer + 16 + i*13);
-                lower8Bits = (uint8_t) *(totSectionBuffer + 17 + i*13);
-                totTable->descriptors[currentDesc].ltoInfo[i].localTimeOffsetHours = (higher8Bits & 0x0F) + 10*((higher8Bits & 0xF0) >> 4);
-                totTable->descriptors[currentDesc].ltoInfo[i].localTimeOffsetMinutes = (lower8Bits & 0x0F) + 10*((lower8Bits & 0xF0) >> 4);
-            }
+            getLocalTimeOffsetEntry(&(localTimeOffset.value.localTimeOffset), i, &(totDescriptor->ltoInfo[i]));
         }
+
         totTable->descriptorsCount++;
-        descriptorLoopLength -= (totTable->descriptors[currentDesc].descriptorLength + 2);
     }
 
     return TABLES_PARSE_OK;    
@@ -469,3 +462,16 @@ ParseErrorCode printTotTable(TotTable* totTable)
 
     return TABLES_PARSE_OK;
 }
+
+uint32_t tablesCrc32(const uint8_t* buffer, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        crc = (crc << 8) ^ crc32Table[((crc >> 24) ^ buffer[i]) & 0xFF];
+    }
+
+    return crc;
+}
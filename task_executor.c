@@ -0,0 +1,620 @@
+#define _GNU_SOURCE                                 /* pthread_setaffinity_np */
+#include "task_executor.h"
+#include <unistd.h>
+#include <sched.h>
+
+#define TASK_EXECUTOR_COUNT(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_RELAXED)
+
+/**
+ * @brief Structure that holds one queued task
+ */
+typedef struct _Task
+{
+    TaskFunction function;
+    void* argument;
+    TaskGroup* group;
+}Task;
+
+/**
+ * @brief Structure of one worker deque, owner pushes and pops at bottom, thieves steal at top
+ */
+typedef struct _TaskDeque
+{
+    pthread_mutex_t mutex;
+    uint32_t top;                                   /* Oldest task, free running counter */
+    uint32_t bottom;                                /* One after newest task */
+    Task tasks[TASK_EXECUTOR_DEQUE_SIZE];
+}TaskDeque;
+
+/**
+ * @brief Structure that holds state of one worker thread
+ */
+typedef struct _TaskWorker
+{
+    TaskExecutor* executor;
+    uint32_t index;
+    pthread_t thread;
+    uint32_t nextVictim;                            /* Worker to try stealing from first */
+    TaskDeque deques[TASK_PRIORITY_COUNT];
+}TaskWorker;
+
+struct _TaskExecutor
+{
+    TaskWorker* workers;
+    uint32_t numberOfWorkers;
+    uint32_t maxBackgroundWorkers;
+    uint32_t nextWorker;                            /* Round robin target of tasks submitted by other threads */
+
+    /* queued counters let workers skip empty priorities and decide to sleep without locking deques */
+    uint32_t queued[TASK_PRIORITY_COUNT];
+    uint32_t runningBackground;
+
+    pthread_mutex_t idleMutex;
+    pthread_cond_t idleCond;
+    uint32_t idleWorkers;
+    bool exit;
+
+    TaskExecutorStatistics statistics;
+};
+
+
+static void* workerTask(void* workerArgument);
+static bool findTask(TaskExecutor* executor, TaskWorker* worker, Task* task, TaskPriority* priority);
+static bool pushTask(TaskDeque* deque, const Task* task);
+static bool popTask(TaskDeque* deque, Task* task);
+static bool stealTask(TaskDeque* deque, Task* task);
+static bool hasRunnableTask(TaskExecutor* executor);
+static void runTask(TaskExecutor* executor, const Task* task, TaskPriority priority);
+static void wakeWorker(TaskExecutor* executor);
+static void wakeAllWorkers(TaskExecutor* executor);
+
+static __thread TaskWorker* currentWorker = NULL;
+static __thread uint32_t heldBackgroundSlots = 0;  /* Background tasks running on this thread, nested ones included */
+
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+static TaskExecutor* sharedExecutor = NULL;
+static uint32_t sharedUsers = 0;
+
+
+void taskGroupInit(TaskGroup* group)
+{
+    group->pending = 0;
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->doneCond, NULL);
+}
+
+void taskGroupDestroy(TaskGroup* group)
+{
+    pthread_cond_destroy(&group->doneCond);
+    pthread_mutex_destroy(&group->mutex);
+}
+
+TaskExecutorError taskExecutorCreate(const TaskExecutorConfig* config, TaskExecutor** executor)
+{
+    TaskExecutor* newExecutor = NULL;
+    cpu_set_t cpuSet;
+    long numberOfCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t i = 0;
+    uint8_t j = 0;
+
+    if (executor == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    newExecutor = (TaskExecutor*)malloc(sizeof(TaskExecutor));
+    if (newExecutor == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+    memset(newExecutor, 0x0, sizeof(TaskExecutor));
+
+    /* more workers than cores only adds switching, the pool never grows past the machine */
+    numberOfCpus = (numberOfCpus < 1) ? 1 : numberOfCpus;
+    newExecutor->numberOfWorkers = (config != NULL && config->numberOfWorkers != 0) ? config->numberOfWorkers : (uint32_t)numberOfCpus;
+    if (newExecutor->numberOfWorkers > TASK_EXECUTOR_MAX_WORKERS)
+    {
+        newExecutor->numberOfWorkers = TASK_EXECUTOR_MAX_WORKERS;
+    }
+    newExecutor->maxBackgroundWorkers = (config != NULL && config->maxBackgroundWorkers != 0) ? config->maxBackgroundWorkers
+        : newExecutor->numberOfWorkers - 1;
+    if (newExecutor->maxBackgroundWorkers == 0 || newExecutor->maxBackgroundWorkers > newExecutor->numberOfWorkers)
+    {
+        newExecutor->maxBackgroundWorkers = (newExecutor->maxBackgroundWorkers == 0) ? 1 : newExecutor->numberOfWorkers;
+    }
+
+    newExecutor->workers = (TaskWorker*)calloc(newExecutor->numberOfWorkers, sizeof(TaskWorker));
+    if (newExecutor->workers == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        free(newExecutor);
+        return TE_ERROR;
+    }
+    pthread_mutex_init(&newExecutor->idleMutex, NULL);
+    pthread_cond_init(&newExecutor->idleCond, NULL);
+
+    for (i = 0; i < newExecutor->numberOfWorkers; i++)
+    {
+        newExecutor->workers[i].executor = newExecutor;
+        newExecutor->workers[i].index = i;
+        newExecutor->workers[i].nextVictim = (i + 1) % newExecutor->numberOfWorkers;
+        for (j = 0; j < TASK_PRIORITY_COUNT; j++)
+        {
+            pthread_mutex_init(&newExecutor->workers[i].deques[j].mutex, NULL);
+        }
+    }
+
+    for (i = 0; i < newExecutor->numberOfWorkers; i++)
+    {
+        if (pthread_create(&newExecutor->workers[i].thread, NULL, &workerTask, &newExecutor->workers[i]))
+        {
+            printf("\n%s : ERROR pthread_create() failed\n", __FUNCTION__);
+            newExecutor->numberOfWorkers = i;
+            taskExecutorDestroy(newExecutor);
+            return TE_THREAD_ERROR;
+        }
+
+        if (config != NULL && config->pinWorkers)
+        {
+            CPU_ZERO(&cpuSet);
+            CPU_SET(i % numberOfCpus, &cpuSet);
+            if (pthread_setaffinity_np(newExecutor->workers[i].thread, sizeof(cpuSet), &cpuSet))
+            {
+                printf("\n%s : ERROR cannot pin worker %u, it runs on any CPU\n", __FUNCTION__, i);
+            }
+        }
+    }
+    newExecutor->statistics.numberOfWorkers = newExecutor->numberOfWorkers;
+
+    *executor = newExecutor;
+    return TE_NO_ERROR;
+}
+
+TaskExecutorError taskExecutorDestroy(TaskExecutor* executor)
+{
+    TaskExecutorError result = TE_NO_ERROR;
+    uint32_t i = 0;
+    uint8_t j = 0;
+
+    if (executor == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    pthread_mutex_lock(&executor->idleMutex);
+    __atomic_store_n(&executor->exit, true, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&executor->idleCond);
+    pthread_mutex_unlock(&executor->idleMutex);
+
+    for (i = 0; i < executor->numberOfWorkers; i++)
+    {
+        if (pthread_join(executor->workers[i].thread, NULL))
+        {
+            printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
+            result = TE_THREAD_ERROR;
+        }
+    }
+
+    for (i = 0; i < executor->numberOfWorkers; i++)
+    {
+        for (j = 0; j < TASK_PRIORITY_COUNT; j++)
+        {
+            pthread_mutex_destroy(&executor->workers[i].deques[j].mutex);
+        }
+    }
+    pthread_cond_destroy(&executor->idleCond);
+    pthread_mutex_destroy(&executor->idleMutex);
+    free(executor->workers);
+    free(executor);
+
+    return result;
+}
+
+TaskExecutorError taskExecutorSubmit(TaskExecutor* executor, TaskPriority priority, TaskFunction function, void* argument,
+    TaskGroup* group)
+{
+    TaskWorker* worker = NULL;
+    Task task;
+
+    if (executor == NULL || function == NULL || priority >= TASK_PRIORITY_COUNT)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    task.function = function;
+    task.argument = argument;
+    task.group = group;
+    if (group != NULL)
+    {
+        __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+    }
+    TASK_EXECUTOR_COUNT(executor->statistics.submitted);
+
+    /* own deque keeps data of the task hot in this worker's cache, others take it only when idle */
+    worker = (currentWorker != NULL && currentWorker->executor == executor) ? currentWorker
+        : &executor->workers[__atomic_fetch_add(&executor->nextWorker, 1, __ATOMIC_RELAXED) % executor->numberOfWorkers];
+
+    /* counter goes up first, so it never drops below the number of tasks in deques */
+    __atomic_add_fetch(&executor->queued[priority], 1, __ATOMIC_SEQ_CST);
+    if (!pushTask(&worker->deques[priority], &task))
+    {
+        __atomic_sub_fetch(&executor->queued[priority], 1, __ATOMIC_SEQ_CST);
+        TASK_EXECUTOR_COUNT(executor->statistics.inlined);
+        if (priority == TASK_PRIORITY_BACKGROUND)
+        {
+            __atomic_add_fetch(&executor->runningBackground, 1, __ATOMIC_ACQUIRE);
+        }
+        runTask(executor, &task, priority);
+        return TE_NO_ERROR;
+    }
+
+    wakeWorker(executor);
+
+    return TE_NO_ERROR;
+}
+
+TaskExecutorError taskExecutorWait(TaskExecutor* executor, TaskGroup* group)
+{
+    TaskPriority priority = TASK_PRIORITY_NORMAL;
+    uint32_t releasedSlots = 0;
+    Task task;
+
+    if (executor == NULL || group == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    /* background task that waits for its own background subtasks would hold the slot they need, it is lent out meanwhile */
+    releasedSlots = heldBackgroundSlots;
+    if (releasedSlots != 0)
+    {
+        heldBackgroundSlots = 0;
+        __atomic_sub_fetch(&executor->runningBackground, releasedSlots, __ATOMIC_SEQ_CST);
+        wakeAllWorkers(executor);
+    }
+
+    /* a worker that blocked could deadlock the pool when all workers wait, so it keeps running tasks */
+    if (currentWorker != NULL && currentWorker->executor == executor)
+    {
+        while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+        {
+            if (findTask(executor, currentWorker, &task, &priority))
+            {
+                runTask(executor, &task, priority);
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+    }
+
+    /* last task of the group may still hold the mutex, group can be destroyed only after it let go */
+    pthread_mutex_lock(&group->mutex);
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) != 0)
+    {
+        pthread_cond_wait(&group->doneCond, &group->mutex);
+    }
+    pthread_mutex_unlock(&group->mutex);
+
+    /* taken back without checking the limit, the waiting task has to finish and it runs at most briefly over it */
+    if (releasedSlots != 0)
+    {
+        __atomic_add_fetch(&executor->runningBackground, releasedSlots, __ATOMIC_SEQ_CST);
+        heldBackgroundSlots = releasedSlots;
+    }
+
+    return TE_NO_ERROR;
+}
+
+TaskExecutorError taskExecutorAcquireShared(TaskExecutor** executor)
+{
+    TaskExecutorError result = TE_NO_ERROR;
+
+    if (executor == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    pthread_mutex_lock(&sharedMutex);
+    if (sharedUsers == 0)
+    {
+        result = taskExecutorCreate(NULL, &sharedExecutor);
+    }
+    if (result == TE_NO_ERROR)
+    {
+        sharedUsers++;
+        *executor = sharedExecutor;
+    }
+    pthread_mutex_unlock(&sharedMutex);
+
+    return result;
+}
+
+TaskExecutorError taskExecutorReleaseShared()
+{
+    TaskExecutorError result = TE_NO_ERROR;
+
+    pthread_mutex_lock(&sharedMutex);
+    if (sharedUsers == 0)
+    {
+        pthread_mutex_unlock(&sharedMutex);
+        printf("\n%s : ERROR shared executor is not acquired\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+    if (--sharedUsers == 0)
+    {
+        result = taskExecutorDestroy(sharedExecutor);
+        sharedExecutor = NULL;
+    }
+    pthread_mutex_unlock(&sharedMutex);
+
+    return result;
+}
+
+int32_t taskExecutorCurrentWorker(TaskExecutor* executor)
+{
+    if (currentWorker == NULL || currentWorker->executor != executor)
+    {
+        return -1;
+    }
+
+    return (int32_t)currentWorker->index;
+}
+
+uint32_t taskExecutorGetNumberOfWorkers(TaskExecutor* executor)
+{
+    return (executor != NULL) ? executor->numberOfWorkers : 0;
+}
+
+TaskExecutorError taskExecutorGetStatistics(TaskExecutor* executor, TaskExecutorStatistics* statistics)
+{
+    uint8_t i = 0;
+
+    if (executor == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TE_ERROR;
+    }
+
+    statistics->numberOfWorkers = executor->numberOfWorkers;
+    statistics->submitted = __atomic_load_n(&executor->statistics.submitted, __ATOMIC_RELAXED);
+    for (i = 0; i < TASK_PRIORITY_COUNT; i++)
+    {
+        statistics->executed[i] = __atomic_load_n(&executor->statistics.executed[i], __ATOMIC_RELAXED);
+    }
+    statistics->stolen = __atomic_load_n(&executor->statistics.stolen, __ATOMIC_RELAXED);
+    statistics->inlined = __atomic_load_n(&executor->statistics.inlined, __ATOMIC_RELAXED);
+    statistics->sleeps = __atomic_load_n(&executor->statistics.sleeps, __ATOMIC_RELAXED);
+
+    return TE_NO_ERROR;
+}
+
+void* workerTask(void* workerArgument)
+{
+    TaskWorker* worker = (TaskWorker*)workerArgument;
+    TaskExecutor* executor = worker->executor;
+    TaskPriority priority = TASK_PRIORITY_NORMAL;
+    Task task;
+    uint8_t i = 0;
+    uint32_t queued = 0;
+
+    currentWorker = worker;
+
+    while (1)
+    {
+        if (findTask(executor, worker, &task, &priority))
+        {
+            runTask(executor, &task, priority);
+            continue;
+        }
+
+        /* idle count goes up before queued counters are checked, submitter checks them the other way round */
+        pthread_mutex_lock(&executor->idleMutex);
+        __atomic_add_fetch(&executor->idleWorkers, 1, __ATOMIC_SEQ_CST);
+        while (!hasRunnableTask(executor) && !__atomic_load_n(&executor->exit, __ATOMIC_SEQ_CST))
+        {
+            TASK_EXECUTOR_COUNT(executor->statistics.sleeps);
+            pthread_cond_wait(&executor->idleCond, &executor->idleMutex);
+        }
+        __atomic_sub_fetch(&executor->idleWorkers, 1, __ATOMIC_SEQ_CST);
+
+        /* on exit queued tasks are still run, background limit no longer applies */
+        for (i = 0, queued = 0; i < TASK_PRIORITY_COUNT; i++)
+        {
+            queued += __atomic_load_n(&executor->queued[i], __ATOMIC_SEQ_CST);
+        }
+        if (executor->exit && queued == 0)
+        {
+            pthread_mutex_unlock(&executor->idleMutex);
+            break;
+        }
+        pthread_mutex_unlock(&executor->idleMutex);
+    }
+
+    currentWorker = NULL;
+
+    return NULL;
+}
+
+/**
+ * @brief Takes highest priority task, from own deque first and then from the other workers
+ *
+ * @return true if task was taken
+ */
+bool findTask(TaskExecutor* executor, TaskWorker* worker, Task* task, TaskPriority* priority)
+{
+    TaskWorker* victim = NULL;
+    uint32_t running = 0;
+    uint32_t i = 0;
+    uint8_t p = 0;
+
+    for (p = 0; p < TASK_PRIORITY_COUNT; p++)
+    {
+        if (__atomic_load_n(&executor->queued[p], __ATOMIC_ACQUIRE) == 0)
+        {
+            continue;
+        }
+
+        /* background slot is reserved before the search and given back if nothing was found */
+        if (p == TASK_PRIORITY_BACKGROUND)
+        {
+            running = __atomic_load_n(&executor->runningBackground, __ATOMIC_RELAXED);
+            do
+            {
+                if (running >= executor->maxBackgroundWorkers && !__atomic_load_n(&executor->exit, __ATOMIC_RELAXED))
+                {
+                    return false;
+                }
+            } while (!__atomic_compare_exchange_n(&executor->runningBackground, &running, running + 1, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+        }
+
+        if (popTask(&worker->deques[p], task))
+        {
+            __atomic_sub_fetch(&executor->queued[p], 1, __ATOMIC_SEQ_CST);
+            *priority = (TaskPriority)p;
+            return true;
+        }
+
+        for (i = 0; i < executor->numberOfWorkers; i++)
+        {
+            victim = &executor->workers[(worker->nextVictim + i) % executor->numberOfWorkers];
+            if (victim != worker && stealTask(&victim->deques[p], task))
+            {
+                /* next steal starts where this one succeeded, that worker likely has more */
+                worker->nextVictim = victim->index;
+                __atomic_sub_fetch(&executor->queued[p], 1, __ATOMIC_SEQ_CST);
+                TASK_EXECUTOR_COUNT(executor->statistics.stolen);
+                *priority = (TaskPriority)p;
+                return true;
+            }
+        }
+
+        if (p == TASK_PRIORITY_BACKGROUND)
+        {
+            __atomic_sub_fetch(&executor->runningBackground, 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    return false;
+}
+
+bool pushTask(TaskDeque* deque, const Task* task)
+{
+    bool pushed = false;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->bottom - deque->top < TASK_EXECUTOR_DEQUE_SIZE)
+    {
+        deque->tasks[deque->bottom % TASK_EXECUTOR_DEQUE_SIZE] = *task;
+        deque->bottom++;
+        pushed = true;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return pushed;
+}
+
+bool popTask(TaskDeque* deque, Task* task)
+{
+    bool popped = false;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->bottom != deque->top)
+    {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % TASK_EXECUTOR_DEQUE_SIZE];
+        popped = true;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return popped;
+}
+
+bool stealTask(TaskDeque* deque, Task* task)
+{
+    bool stolen = false;
+
+    /* thieves skip a deque another thread is using instead of waiting for it */
+    if (pthread_mutex_trylock(&deque->mutex))
+    {
+        return false;
+    }
+    if (deque->bottom != deque->top)
+    {
+        *task = deque->tasks[deque->top % TASK_EXECUTOR_DEQUE_SIZE];
+        deque->top++;
+        stolen = true;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return stolen;
+}
+
+bool hasRunnableTask(TaskExecutor* executor)
+{
+    return __atomic_load_n(&executor->queued[TASK_PRIORITY_HIGH], __ATOMIC_SEQ_CST) != 0
+        || __atomic_load_n(&executor->queued[TASK_PRIORITY_NORMAL], __ATOMIC_SEQ_CST) != 0
+        || (__atomic_load_n(&executor->queued[TASK_PRIORITY_BACKGROUND], __ATOMIC_SEQ_CST) != 0
+            && __atomic_load_n(&executor->runningBackground, __ATOMIC_SEQ_CST) < executor->maxBackgroundWorkers);
+}
+
+/**
+ * @brief Runs task taken from a deque or inlined by submitter, and completes its group
+ */
+void runTask(TaskExecutor* executor, const Task* task, TaskPriority priority)
+{
+    if (priority == TASK_PRIORITY_BACKGROUND)
+    {
+        heldBackgroundSlots++;
+    }
+
+    task->function(task->argument);
+
+    if (priority == TASK_PRIORITY_BACKGROUND)
+    {
+        heldBackgroundSlots--;
+        __atomic_sub_fetch(&executor->runningBackground, 1, __ATOMIC_RELEASE);
+    }
+    TASK_EXECUTOR_COUNT(executor->statistics.executed[priority]);
+
+    /* decrement under the mutex, so a waiter that saw zero can destroy the group right away */
+    if (task->group != NULL)
+    {
+        pthread_mutex_lock(&task->group->mutex);
+        if (__atomic_sub_fetch(&task->group->pending, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            pthread_cond_broadcast(&task->group->doneCond);
+        }
+        pthread_mutex_unlock(&task->group->mutex);
+    }
+}
+
+/* waiting workers are counted before they check the queues, so no wake up is lost */
+void wakeWorker(TaskExecutor* executor)
+{
+    if (__atomic_load_n(&executor->idleWorkers, __ATOMIC_SEQ_CST) != 0)
+    {
+        pthread_mutex_lock(&executor->idleMutex);
+        pthread_cond_signal(&executor->idleCond);
+        pthread_mutex_unlock(&executor->idleMutex);
+    }
+}
+
+/* background slot was given back, any number of sleeping workers may now have something to run */
+void wakeAllWorkers(TaskExecutor* executor)
+{
+    if (__atomic_load_n(&executor->idleWorkers, __ATOMIC_SEQ_CST) != 0)
+    {
+        pthread_mutex_lock(&executor->idleMutex);
+        pthread_cond_broadcast(&executor->idleCond);
+        pthread_mutex_unlock(&executor->idleMutex);
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef __TASK_EXECUTOR_H__
+#define __TASK_EXECUTOR_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+
+#define TASK_EXECUTOR_MAX_WORKERS 64
+#define TASK_EXECUTOR_DEQUE_SIZE 1024               /* Tasks one worker holds per priority, submitting to a full deque runs the task at once */
+
+/**
+ * @brief Enumeration of possible task executor error codes
+ */
+typedef enum _TaskExecutorError
+{
+    TE_NO_ERROR = 0,
+    TE_ERROR,
+    TE_THREAD_ERROR
+}TaskExecutorError;
+
+/**
+ * @brief Enumeration of task priorities, workers always take the highest priority task they can find
+ */
+typedef enum _TaskPriority
+{
+    TASK_PRIORITY_HIGH = 0,                         /* Work somebody waits for, e.g. parsing of tables needed for zapping */
+    TASK_PRIORITY_NORMAL,
+    TASK_PRIORITY_BACKGROUND,                       /* Runs on at most maxBackgroundWorkers workers at once */
+    TASK_PRIORITY_COUNT
+}TaskPriority;
+
+/**
+ * @brief Task function, runs on one of the worker threads
+ */
+typedef void(*TaskFunction)(void* argument);
+
+/**
+ * @brief Structure that tracks completion of a set of tasks
+ */
+typedef struct _TaskGroup
+{
+    uint32_t pending;                               /* Submitted tasks that did not finish */
+    pthread_mutex_t mutex;
+    pthread_cond_t doneCond;
+}TaskGroup;
+
+/**
+ * @brief Structure that defines executor setup
+ */
+typedef struct _TaskExecutorConfig
+{
+    uint32_t numberOfWorkers;                       /* 0 creates one worker per online CPU */
+    uint32_t maxBackgroundWorkers;                  /* 0 leaves one worker free of background tasks */
+    bool pinWorkers;                                /* Bind worker i to CPU i modulo number of CPUs */
+}TaskExecutorConfig;
+
+/**
+ * @brief Structure that holds executor counters
+ */
+typedef struct _TaskExecutorStatistics
+{
+    uint32_t numberOfWorkers;
+    uint64_t submitted;
+    uint64_t executed[TASK_PRIORITY_COUNT];
+    uint64_t stolen;                                /* Tasks taken from deque of another worker */
+    uint64_t inlined;                               /* Tasks run by submitting thread because deque was full */
+    uint64_t sleeps;                                /* Times a worker found nothing to do and slept */
+}TaskExecutorStatistics;
+
+/**
+ * @brief Task executor, fixed pool of workers with per worker deques and work stealing
+ */
+typedef struct _TaskExecutor TaskExecutor;
+
+/**
+ * @brief Initializes empty task group
+ *
+ * @param [in] group - group to initialize
+ */
+void taskGroupInit(TaskGroup* group);
+
+/**
+ * @brief Releases task group, no task of the group may still run
+ *
+ * @param [in] group - group to release
+ */
+void taskGroupDestroy(TaskGroup* group);
+
+/**
+ * @brief Creates executor and starts its workers
+ *
+ * @param [in] config - executor setup, NULL for defaults
+ * @param [out] executor - created executor
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorCreate(const TaskExecutorConfig* config, TaskExecutor** executor);
+
+/**
+ * @brief Runs all queued tasks, stops workers and frees executor
+ *
+ * @param [in] executor - executor to destroy
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorDestroy(TaskExecutor* executor);
+
+/**
+ * @brief Queues task
+ *
+ * Worker threads queue on their own deque, other threads spread tasks over all workers.
+ * Idle workers steal from the others, so tasks do not have to be balanced by the caller.
+ *
+ * @param [in] executor - task executor
+ * @param [in] priority - task priority
+ * @param [in] function - task function
+ * @param [in] argument - passed to function
+ * @param [in] group - group the task is counted in, can be NULL
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorSubmit(TaskExecutor* executor, TaskPriority priority, TaskFunction function, void* argument,
+    TaskGroup* group);
+
+/**
+ * @brief Waits until all tasks of group finished, a worker that waits runs queued tasks meanwhile
+ *
+ * A background task that waits gives its background slot back until the wait is over,
+ * so its background subtasks can run even when the limit is one worker.
+ *
+ * @param [in] executor - task executor
+ * @param [in] group - group to wait for
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorWait(TaskExecutor* executor, TaskGroup* group);
+
+/**
+ * @brief Returns executor shared by all modules of the process, created by the first caller
+ *
+ * One pool for section parsing, asset decoding and analysis keeps the box from running
+ * more busy threads than it has cores. Every acquire has to be matched by a release.
+ *
+ * @param [out] executor - shared executor with default setup
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorAcquireShared(TaskExecutor** executor);
+
+/**
+ * @brief Drops one reference to the shared executor, the last one destroys it
+ *
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorReleaseShared();
+
+/**
+ * @brief Returns index of calling worker, lets tasks keep per worker state
+ *
+ * @param [in] executor - task executor
+ * @return worker index, -1 if called from a thread that is not a worker of executor
+ */
+int32_t taskExecutorCurrentWorker(TaskExecutor* executor);
+
+/**
+ * @brief Returns number of workers
+ *
+ * @param [in] executor - task executor
+ * @return number of workers
+ */
+uint32_t taskExecutorGetNumberOfWorkers(TaskExecutor* executor);
+
+/**
+ * @brief Returns executor counters
+ *
+ * @param [in] executor - task executor
+ * @param [out] statistics - counters
+ * @return task executor error code
+ */
+TaskExecutorError taskExecutorGetStatistics(TaskExecutor* executor, TaskExecutorStatistics* statistics);
+
+#endif /* __TASK_EXECUTOR_H__ */
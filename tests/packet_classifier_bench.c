@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "packet_classifier.h"
+
+#define BENCH_CACHED_PACKETS 512                    /* Batch that stays in L1/L2, about 94 KB */
+#define BENCH_CACHED_ROUNDS 20000
+#define BENCH_STREAM_PACKETS (256 * 1024)           /* About 47 MB, larger than any cache */
+#define BENCH_STREAM_ROUNDS 10
+#define BENCH_SYNC_LENGTH (64 * 1024)               /* Garbage searched before the packet boundary is found */
+#define BENCH_SYNC_ROUNDS 2000
+#define BENCH_REPEATS 5                             /* Runs of every kernel, the fastest is reported */
+
+static void fillPackets(uint8_t* data, uint32_t numberOfPackets);
+static double classifyNanoseconds(const uint8_t* data, uint32_t numberOfPackets, uint32_t rounds, ClassifiedPacket* packets);
+static double findSyncNanoseconds(const uint8_t* data, uint32_t length, uint32_t rounds);
+static double monotonicNanoseconds();
+
+static const char* const kernelNames[] = {"scalar", "SSE2", "AVX2"};
+
+
+int main()
+{
+    uint8_t* cached = (uint8_t*)malloc(BENCH_CACHED_PACKETS * TS_PACKET_SIZE);
+    uint8_t* stream = (uint8_t*)malloc((size_t)BENCH_STREAM_PACKETS * TS_PACKET_SIZE);
+    uint8_t* garbage = (uint8_t*)malloc(BENCH_SYNC_LENGTH + PACKET_CLASSIFIER_SYNC_CONFIRMATIONS * TS_PACKET_SIZE);
+    ClassifiedPacket* reference = (ClassifiedPacket*)malloc(BENCH_STREAM_PACKETS * sizeof(ClassifiedPacket));
+    ClassifiedPacket* packets = (ClassifiedPacket*)malloc(BENCH_STREAM_PACKETS * sizeof(ClassifiedPacket));
+    double scalarCached = 0;
+    double scalarStream = 0;
+    double scalarSync = 0;
+    double cachedTime = 0;
+    double streamTime = 0;
+    double syncTime = 0;
+    int32_t kernel = 0;
+    int32_t failed = 0;
+    uint32_t i = 0;
+
+    if (cached == NULL || stream == NULL || garbage == NULL || reference == NULL || packets == NULL)
+    {
+        printf("packet_classifier_bench: ERROR Cannot allocate memory\n");
+        return 1;
+    }
+
+    srand(1);
+    fillPackets(cached, BENCH_CACHED_PACKETS);
+    fillPackets(stream, BENCH_STREAM_PACKETS);
+    for (i = 0; i < BENCH_SYNC_LENGTH; i++)
+    {
+        garbage[i] = (uint8_t)((rand() % 255) + (rand() % 255 >= TS_SYNC_BYTE));
+    }
+    fillPackets(garbage + BENCH_SYNC_LENGTH, PACKET_CLASSIFIER_SYNC_CONFIRMATIONS);
+
+    packetClassifierSelect(PC_KERNEL_SCALAR);
+    classifyPackets(stream, BENCH_STREAM_PACKETS, reference);
+
+    printf("kernel   cached ns/packet   stream ns/packet   sync ns/byte\n");
+    for (kernel = PC_KERNEL_SCALAR; kernel <= PC_KERNEL_AVX2; kernel++)
+    {
+        if (packetClassifierSelect((PacketClassifierKernel)kernel))
+        {
+            continue;
+        }
+
+        /* every kernel must match the scalar reference */
+        memset(packets, 0x0, BENCH_STREAM_PACKETS * sizeof(ClassifiedPacket));
+        if (classifyPackets(stream, BENCH_STREAM_PACKETS, packets) != BENCH_STREAM_PACKETS
+            || memcmp(packets, reference, BENCH_STREAM_PACKETS * sizeof(ClassifiedPacket)) != 0
+            || findPacketSync(garbage, BENCH_SYNC_LENGTH + PACKET_CLASSIFIER_SYNC_CONFIRMATIONS * TS_PACKET_SIZE)
+                != BENCH_SYNC_LENGTH)
+        {
+            printf("%-8s FAIL output differs from scalar kernel\n", kernelNames[kernel]);
+            failed = 1;
+            continue;
+        }
+
+        cachedTime = classifyNanoseconds(cached, BENCH_CACHED_PACKETS, BENCH_CACHED_ROUNDS, packets);
+        streamTime = classifyNanoseconds(stream, BENCH_STREAM_PACKETS, BENCH_STREAM_ROUNDS, packets);
+        syncTime = findSyncNanoseconds(garbage, BENCH_SYNC_LENGTH + PACKET_CLASSIFIER_SYNC_CONFIRMATIONS * TS_PACKET_SIZE,
+            BENCH_SYNC_ROUNDS);
+        if (kernel == PC_KERNEL_SCALAR)
+        {
+            scalarCached = cachedTime;
+            scalarStream = streamTime;
+            scalarSync = syncTime;
+        }
+
+        printf("%-8s %7.3f (%4.1fx)     %7.3f (%4.1fx)     %6.3f (%5.1fx)\n", kernelNames[kernel],
+            cachedTime, scalarCached / cachedTime, streamTime, scalarStream / streamTime, syncTime, scalarSync / syncTime);
+    }
+
+    free(cached);
+    free(stream);
+    free(garbage);
+    free(reference);
+    free(packets);
+
+    return failed;
+}
+
+/* Random headers with valid sync bytes, payload is left as is */
+void fillPackets(uint8_t* data, uint32_t numberOfPackets)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < numberOfPackets; i++, data += TS_PACKET_SIZE)
+    {
+        data[0] = TS_SYNC_BYTE;
+        data[1] = (uint8_t)rand();
+        data[2] = (uint8_t)rand();
+        data[3] = (uint8_t)rand();
+    }
+}
+
+double classifyNanoseconds(const uint8_t* data, uint32_t numberOfPackets, uint32_t rounds, ClassifiedPacket* packets)
+{
+    double best = 0;
+    double start = 0;
+    double time = 0;
+    uint32_t repeat = 0;
+    uint32_t i = 0;
+
+    for (repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        start = monotonicNanoseconds();
+        for (i = 0; i < rounds; i++)
+        {
+            classifyPackets(data, numberOfPackets, packets);
+            __asm__ volatile("" : : "r"(packets) : "memory");
+        }
+        time = (monotonicNanoseconds() - start) / ((double)rounds * numberOfPackets);
+        best = (repeat == 0 || time < best) ? time : best;
+    }
+
+    return best;
+}
+
+/* Time per byte searched before the boundary */
+double findSyncNanoseconds(const uint8_t* data, uint32_t length, uint32_t rounds)
+{
+    double best = 0;
+    double start = 0;
+    double time = 0;
+    int32_t found = 0;
+    uint32_t repeat = 0;
+    uint32_t i = 0;
+
+    for (repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        start = monotonicNanoseconds();
+        for (i = 0; i < rounds; i++)
+        {
+            found = findPacketSync(data, length);
+            __asm__ volatile("" : : "r"(found) : "memory");
+        }
+        time = (monotonicNanoseconds() - start) / ((double)rounds * found);
+        best = (repeat == 0 || time < best) ? time : best;
+    }
+
+    return best;
+}
+
+double monotonicNanoseconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1e9 + now.tv_nsec;
+}
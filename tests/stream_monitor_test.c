@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream_monitor.h"
+
+#define TEST_DURATION_MS 6000                       /* Stream length, one packet per millisecond */
+#define TEST_CHUNK_SIZE 1000                        /* Not a multiple of the packet size, packets straddle chunks */
+#define TEST_PMT_PID 0x0100
+#define TEST_VIDEO_PID 0x0101
+#define TEST_NULL_PID 0x1FFF
+#define TEST_PSI_INTERVAL 100                       /* Packets between PAT/PMT repetitions */
+#define TEST_PCR_INTERVAL 20                        /* Packets between PCRs */
+#define TEST_PCR_PER_PACKET 27000ULL                /* One millisecond in 27 MHz ticks */
+#define TEST_NS_PER_PACKET 1000000ULL
+
+/* faults injected into the broken stream, positions in packets */
+#define FAULT_CONTINUITY_AT 705                     /* Video continuity counter skips one value */
+#define FAULT_SYNC_AT 1505                          /* Three packets with corrupted sync byte */
+#define FAULT_SYNC_PACKETS 3
+#define FAULT_CRC_AT 2300                           /* PMT with corrupted CRC */
+#define FAULT_TRANSPORT_AT 2610                     /* Null packet with transport_error_indicator set */
+#define FAULT_PAT_GAP_START 3000                    /* PAT is not sent for 1.5 s */
+#define FAULT_PAT_GAP_END 4500
+#define FAULT_EMPTY_PAT_AT 5200                     /* PAT with section_length 0, zeros instead of stuffing */
+
+/**
+ * @brief Structure that holds counters expected after a stream was analyzed
+ */
+typedef struct _ExpectedReport
+{
+    uint32_t tsSyncLoss;
+    uint32_t syncByteErrors;
+    uint32_t patErrors;
+    uint32_t continuityErrors;
+    uint32_t pmtErrors;
+    uint32_t transportErrors;
+    uint32_t crcErrors;
+}ExpectedReport;
+
+
+static uint32_t generateStream(uint8_t* stream, bool broken);
+static void writeSection(uint8_t* packet, uint16_t pid, uint8_t continuityCounter, const uint8_t* section, uint32_t length);
+static void writeVideo(uint8_t* packet, uint8_t continuityCounter, bool withPcr, uint64_t pcr);
+static int32_t runTest(const char* name, bool broken, const ExpectedReport* expected);
+
+
+int main()
+{
+    ExpectedReport clean;
+    ExpectedReport broken;
+    int32_t failures = 0;
+
+    memset(&clean, 0x0, sizeof(ExpectedReport));
+
+    memset(&broken, 0x0, sizeof(ExpectedReport));
+    broken.tsSyncLoss = 1;
+    broken.syncByteErrors = 2;                      /* Third corrupted packet is skipped while out of sync */
+    broken.patErrors = 1;
+    broken.continuityErrors = 1;
+    broken.transportErrors = 1;
+    broken.crcErrors = 2;
+
+    failures += runTest("clean stream", false, &clean);
+    failures += runTest("broken stream", true, &broken);
+
+    printf("%s\n", (failures == 0) ? "stream_monitor_test: all passed" : "stream_monitor_test: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
+
+int32_t runTest(const char* name, bool broken, const ExpectedReport* expected)
+{
+    uint8_t* stream = (uint8_t*)malloc(TEST_DURATION_MS * TS_PACKET_SIZE);
+    StreamMonitor* monitor = NULL;
+    StreamMonitorReport report;
+    PidStatistics statistics;
+    uint32_t length = 0;
+    uint32_t offset = 0;
+    uint32_t chunkLength = 0;
+    int32_t failed = 0;
+
+    if (stream == NULL || streamMonitorCreate(&monitor))
+    {
+        printf("%-14s FAIL cannot create monitor\n", name);
+        free(stream);
+        return 1;
+    }
+
+    length = generateStream(stream, broken);
+    for (offset = 0; offset < length; offset += chunkLength)
+    {
+        chunkLength = (length - offset < TEST_CHUNK_SIZE) ? length - offset : TEST_CHUNK_SIZE;
+        streamMonitorProcess(monitor, stream + offset, chunkLength, (offset / TS_PACKET_SIZE + 1) * TEST_NS_PER_PACKET);
+    }
+
+    streamMonitorGetReport(monitor, &report);
+    streamMonitorGetPidStatistics(monitor, TEST_VIDEO_PID, &statistics);
+
+    failed = report.tsSyncLoss != expected->tsSyncLoss || report.syncByteErrors != expected->syncByteErrors
+        || report.patErrors != expected->patErrors || report.continuityErrors != expected->continuityErrors
+        || report.pmtErrors != expected->pmtErrors || report.pidErrors != 0
+        || report.transportErrors != expected->transportErrors || report.crcErrors != expected->crcErrors
+        || report.pcrRepetitionErrors != 0 || report.pcrDiscontinuityErrors != 0 || report.pcrAccuracyErrors != 0
+        || statistics.continuityErrors != expected->continuityErrors || !report.inSync;
+
+    printf("%-14s %s sync loss %u, sync byte %u, PAT %u, CC %u, PMT %u, PID %u, transport %u, CRC %u, PCR %u/%u/%u, %llu packets\n",
+        name, failed ? "FAIL" : "ok  ", report.tsSyncLoss, report.syncByteErrors, report.patErrors, report.continuityErrors,
+        report.pmtErrors, report.pidErrors, report.transportErrors, report.crcErrors, report.pcrRepetitionErrors,
+        report.pcrDiscontinuityErrors, report.pcrAccuracyErrors, (unsigned long long)report.totalPackets);
+
+    streamMonitorDestroy(monitor);
+    free(stream);
+
+    return failed;
+}
+
+/* One program with PMT on TEST_PMT_PID and PCR carried on the video PID, constant bitrate of one packet per ms */
+uint32_t generateStream(uint8_t* stream, bool broken)
+{
+    static const uint8_t patSection[] = {0x00, 0xB0, 0x0D, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0x00, 0x01, 0xE0 | (TEST_PMT_PID >> 8), TEST_PMT_PID & 0xFF};
+    static const uint8_t pmtSection[] = {0x02, 0xB0, 0x12, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0x00,
+        0x1B, 0xE0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xFF, 0xF0, 0x00};
+    uint8_t* packet = stream;
+    uint8_t patCounter = 0;
+    uint8_t pmtCounter = 0;
+    uint8_t videoCounter = 0;
+    uint32_t index = 0;
+    uint32_t i = 0;
+
+    for (index = 0; index < TEST_DURATION_MS; index++, packet += TS_PACKET_SIZE)
+    {
+        if (index % TEST_PSI_INTERVAL == 0)
+        {
+            if (broken && index >= FAULT_PAT_GAP_START && index < FAULT_PAT_GAP_END)
+            {
+                memset(packet, 0xFF, TS_PACKET_SIZE);
+                packet[0] = TS_SYNC_BYTE;
+                packet[1] = TEST_NULL_PID >> 8;
+                packet[2] = TEST_NULL_PID & 0xFF;
+                packet[3] = 0x10;
+            }
+            else
+            {
+                writeSection(packet, 0x0000, patCounter++ & 0x0F, patSection, sizeof(patSection));
+            }
+            if (broken && index == FAULT_EMPTY_PAT_AT)
+            {
+                memset(packet + 5, 0x0, TS_PACKET_SIZE - 5);
+                packet[6] = 0xB0;
+            }
+        }
+        else if (index % TEST_PSI_INTERVAL == 1)
+        {
+            writeSection(packet, TEST_PMT_PID, pmtCounter++ & 0x0F, pmtSection, sizeof(pmtSection));
+            if (broken && index == FAULT_CRC_AT + 1)
+            {
+                packet[5 + sizeof(pmtSection) + 3] ^= 0x01;
+            }
+        }
+        else if (broken && index == FAULT_TRANSPORT_AT)
+        {
+            /* on a null packet, so continuity of the other PIDs is not affected */
+            memset(packet, 0xFF, TS_PACKET_SIZE);
+            packet[0] = TS_SYNC_BYTE;
+            packet[1] = 0x80 | (TEST_NULL_PID >> 8);
+            packet[2] = TEST_NULL_PID & 0xFF;
+            packet[3] = 0x10;
+        }
+        else
+        {
+            if (broken && index == FAULT_CONTINUITY_AT)
+            {
+                videoCounter++;
+            }
+            writeVideo(packet, videoCounter++ & 0x0F, index % TEST_PCR_INTERVAL == 2, index * TEST_PCR_PER_PACKET);
+        }
+    }
+
+    if (broken)
+    {
+        for (i = 0; i < FAULT_SYNC_PACKETS; i++)
+        {
+            stream[(FAULT_SYNC_AT + i) * TS_PACKET_SIZE] = 0x00;
+        }
+    }
+
+    return TEST_DURATION_MS * TS_PACKET_SIZE;
+}
+
+void writeSection(uint8_t* packet, uint16_t pid, uint8_t continuityCounter, const uint8_t* section, uint32_t length)
+{
+    uint32_t crc = 0;
+
+    memset(packet, 0xFF, TS_PACKET_SIZE);
+    packet[0] = TS_SYNC_BYTE;
+    packet[1] = 0x40 | (pid >> 8);
+    packet[2] = pid & 0xFF;
+    packet[3] = 0x10 | continuityCounter;
+    packet[4] = 0x00;                               /* Pointer field */
+    memcpy(packet + 5, section, length);
+
+    crc = tablesCrc32(section, length);
+    packet[5 + length] = (uint8_t)(crc >> 24);
+    packet[5 + length + 1] = (uint8_t)(crc >> 16);
+    packet[5 + length + 2] = (uint8_t)(crc >> 8);
+    packet[5 + length + 3] = (uint8_t)crc;
+}
+
+void writeVideo(uint8_t* packet, uint8_t continuityCounter, bool withPcr, uint64_t pcr)
+{
+    uint64_t pcrBase = pcr / 300;
+    uint32_t pcrExtension = (uint32_t)(pcr % 300);
+
+    memset(packet, 0xFF, TS_PACKET_SIZE);
+    packet[0] = TS_SYNC_BYTE;
+    packet[1] = TEST_VIDEO_PID >> 8;
+    packet[2] = TEST_VIDEO_PID & 0xFF;
+    packet[3] = 0x10 | continuityCounter;
+
+    if (withPcr)
+    {
+        packet[3] |= 0x20;
+        packet[4] = 7;                              /* Adaptation field length */
+        packet[5] = 0x10;                           /* PCR flag */
+        packet[6] = (uint8_t)(pcrBase >> 25);
+        packet[7] = (uint8_t)(pcrBase >> 17);
+        packet[8] = (uint8_t)(pcrBase >> 9);
+        packet[9] = (uint8_t)(pcrBase >> 1);
+        packet[10] = (uint8_t)(((pcrBase & 0x01) << 7) | 0x7E | (pcrExtension >> 8));
+        packet[11] = (uint8_t)pcrExtension;
+    }
+}
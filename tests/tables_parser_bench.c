@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "tables.h"
+#include "tables_fields.h"
+
+#define BENCH_ROUNDS 2000000                        /* Sections parsed per measurement */
+#define BENCH_REPEATS 5
+#define BENCH_PROGRAMS 16                           /* Programs in the PAT, a full multiplex */
+#define BENCH_STREAMS 8                             /* Elementary streams in the PMT */
+#define BENCH_ES_INFO_LENGTH 6                      /* ISO 639 language descriptor on every stream */
+#define BENCH_LTO_ENTRIES 4                         /* Local time offset entries in the TOT */
+
+/**
+ * @brief Structure that holds one generated section
+ */
+typedef struct _BenchSection
+{
+    const char* name;
+    uint8_t data[TABLES_MAX_SECTION_SIZE];
+    uint32_t length;
+}BenchSection;
+
+
+static void buildPat(BenchSection* section);
+static void buildPmt(BenchSection* section);
+static void buildTdt(BenchSection* section);
+static void buildTot(BenchSection* section);
+static void finishSection(BenchSection* section, uint32_t length, bool withCrc);
+static ParseErrorCode parseSection(const BenchSection* section, bool handwritten);
+static int32_t checkSections(const BenchSection* pat, const BenchSection* pmt, const BenchSection* tdt, const BenchSection* tot);
+static int32_t checkHandwritten(const BenchSection* pat, const BenchSection* pmt);
+static int32_t checkRejected(const char* name, BenchSection* section, uint32_t lengthPosition, uint32_t badLength);
+static double parseNanoseconds(const BenchSection* section, bool handwritten);
+static double monotonicNanoseconds();
+static ParseErrorCode handwrittenPatTable(const SectionView* patSection, PatTable* patTable) __attribute__((noinline));
+static ParseErrorCode handwrittenPmtTable(const SectionView* pmtSection, PmtTable* pmtTable) __attribute__((noinline));
+
+static PatTable patTable;
+static PmtTable pmtTable;
+static TdtTable tdtTable;
+static TotTable totTable;
+
+
+int main()
+{
+    static BenchSection sections[4];
+    double time = 0;
+    double handwrittenTime = 0;
+    int32_t failed = 0;
+    uint32_t i = 0;
+
+    buildPat(&sections[0]);
+    buildPmt(&sections[1]);
+    buildTdt(&sections[2]);
+    buildTot(&sections[3]);
+
+    /* a parser that is fast because it skips fields or checks is no result */
+    failed = checkSections(&sections[0], &sections[1], &sections[2], &sections[3])
+        || checkHandwritten(&sections[0], &sections[1]);
+    if (failed)
+    {
+        printf("tables_parser_bench: FAILED parsed tables differ from generated ones\n");
+        return 1;
+    }
+
+    /* time covers sectionViewInit and the parser, as dispatchSection runs them */
+    printf("table  bytes   ns/section   ns/byte   hand-written ns/section\n");
+    for (i = 0; i < sizeof(sections) / sizeof(sections[0]); i++)
+    {
+        time = parseNanoseconds(&sections[i], false);
+        printf("%-6s %5u   %10.1f   %7.3f", sections[i].name, sections[i].length, time, time / sections[i].length);
+        if (sections[i].data[0] == 0x00 || sections[i].data[0] == 0x02)
+        {
+            handwrittenTime = parseNanoseconds(&sections[i], true);
+            printf("   %10.1f (%4.2fx)", handwrittenTime, handwrittenTime / time);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+/* Generated sections are parsed back, and lengths running past the section are refused */
+int32_t checkSections(const BenchSection* pat, const BenchSection* pmt, const BenchSection* tdt, const BenchSection* tot)
+{
+    static BenchSection broken;
+    int32_t failed = 0;
+    uint8_t i = 0;
+
+    failed |= parseSection(pat, false) != TABLES_PARSE_OK || patTable.serviceInfoCount != BENCH_PROGRAMS
+        || patTable.patHeader.transportStreamId != 0x0401 || patTable.patHeader.versionNumber != 3;
+    for (i = 0; i < patTable.serviceInfoCount; i++)
+    {
+        failed |= patTable.patServiceInfoArray[i].programNumber != i + 1 || patTable.patServiceInfoArray[i].pid != 0x1000 + i;
+    }
+
+    failed |= parseSection(pmt, false) != TABLES_PARSE_OK || pmtTable.elementaryInfoCount != BENCH_STREAMS
+        || pmtTable.pmtHeader.pcrPid != 0x0100 || pmtTable.pmtHeader.programNumber != 1 || pmtTable.pmtHeader.programInfoLength != 0;
+    for (i = 0; i < pmtTable.elementaryInfoCount; i++)
+    {
+        failed |= pmtTable.pmtElementaryInfoArray[i].elementaryPid != 0x0100 + i
+            || pmtTable.pmtElementaryInfoArray[i].esInfoLength != BENCH_ES_INFO_LENGTH
+            || pmtTable.pmtElementaryInfoArray[i].esInfo[0] != 0x0A;
+    }
+
+    failed |= parseSection(tdt, false) != TABLES_PARSE_OK || tdtTable.MJD != 0xE3F0 || tdtTable.hours != 12 || tdtTable.minutes != 34
+        || tdtTable.seconds != 56;
+
+    failed |= parseSection(tot, false) != TABLES_PARSE_OK || totTable.descriptorsCount != 1
+        || totTable.descriptors[0].numberOfInfos != BENCH_LTO_ENTRIES || totTable.descriptors[0].ltoInfo[1].localTimeOffsetHours != 1
+        || totTable.descriptors[0].ltoInfo[1].countryRegionId != 1;
+
+    /* program_info_length, ES_info_length and descriptor loop length one byte past the section, parsers report each */
+    printf("rejection checks, four parser errors are expected\n");
+    memcpy(&broken, pmt, sizeof(BenchSection));
+    failed |= checkRejected("program info", &broken, 10, pmt->length - PMT_HEADER_SIZE - SECTION_CRC_SIZE + 1);
+    memcpy(&broken, pmt, sizeof(BenchSection));
+    failed |= checkRejected("ES info", &broken, PMT_HEADER_SIZE + (BENCH_STREAMS - 1) * (PMT_ELEMENTARY_INFO_SIZE + BENCH_ES_INFO_LENGTH) + 3,
+        BENCH_ES_INFO_LENGTH + 1);
+    memcpy(&broken, tot, sizeof(BenchSection));
+    failed |= checkRejected("TOT loop", &broken, 8, tot->length - TOT_HEADER_SIZE - SECTION_CRC_SIZE + 1);
+
+    /* declared section_length longer than the buffer never reaches a parser */
+    memcpy(&broken, pat, sizeof(BenchSection));
+    broken.length--;
+    failed |= parseSection(&broken, false) != TABLES_PARSE_ERROR;
+
+    return failed;
+}
+
+/* Writes 12 bit length at lengthPosition, the section must then be refused */
+int32_t checkRejected(const char* name, BenchSection* section, uint32_t lengthPosition, uint32_t badLength)
+{
+    section->data[lengthPosition] = (section->data[lengthPosition] & 0xF0) | ((badLength >> 8) & 0x0F);
+    section->data[lengthPosition + 1] = badLength & 0xFF;
+
+    if (parseSection(section, false) != TABLES_PARSE_ERROR)
+    {
+        printf("%s length past the section was accepted\n", name);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Hand-written reference parsers must fill the tables exactly as the declarative extractors do */
+int32_t checkHandwritten(const BenchSection* pat, const BenchSection* pmt)
+{
+    static PatTable declarativePat;
+    static PmtTable declarativePmt;
+
+    memset(&patTable, 0x0, sizeof(PatTable));
+    memset(&pmtTable, 0x0, sizeof(PmtTable));
+    parseSection(pat, false);
+    parseSection(pmt, false);
+    memcpy(&declarativePat, &patTable, sizeof(PatTable));
+    memcpy(&declarativePmt, &pmtTable, sizeof(PmtTable));
+
+    memset(&patTable, 0x0, sizeof(PatTable));
+    memset(&pmtTable, 0x0, sizeof(PmtTable));
+    parseSection(pat, true);
+    parseSection(pmt, true);
+
+    return memcmp(&declarativePat, &patTable, sizeof(PatTable)) != 0 || memcmp(&declarativePmt, &pmtTable, sizeof(PmtTable)) != 0;
+}
+
+ParseErrorCode parseSection(const BenchSection* section, bool handwritten)
+{
+    SectionView view;
+
+    if (sectionViewInit(&view, section->data, section->length) != TABLES_PARSE_OK)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    switch (view.tableId)
+    {
+        case 0x00:
+            return handwritten ? handwrittenPatTable(&view, &patTable) : parsePatTable(&view, &patTable);
+        case 0x02:
+            return handwritten ? handwrittenPmtTable(&view, &pmtTable) : parsePmtTable(&view, &pmtTable);
+        case 0x70:
+            return parseTdtTable(&view, &tdtTable);
+        default:
+            return parseTotTable(&view, &totTable);
+    }
+}
+
+double parseNanoseconds(const BenchSection* section, bool handwritten)
+{
+    double best = 0;
+    double start = 0;
+    double time = 0;
+    uint32_t repeat = 0;
+    uint32_t i = 0;
+
+    for (repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        start = monotonicNanoseconds();
+        for (i = 0; i < BENCH_ROUNDS; i++)
+        {
+            parseSection(section, handwritten);
+            __asm__ volatile("" : : "r"(section) : "memory");
+        }
+        time = (monotonicNanoseconds() - start) / BENCH_ROUNDS;
+        best = (repeat == 0 || time < best) ? time : best;
+    }
+
+    return best;
+}
+
+void buildPat(BenchSection* section)
+{
+    uint8_t* data = section->data;
+    uint32_t position = PAT_HEADER_SIZE;
+    uint16_t i = 0;
+
+    section->name = "PAT";
+    data[0] = 0x00;
+    data[3] = 0x04;
+    data[4] = 0x01;
+    data[5] = 0xC1 | (3 << 1);
+    for (i = 0; i < BENCH_PROGRAMS; i++, position += PAT_SERVICE_INFO_SIZE)
+    {
+        data[position] = (i + 1) >> 8;
+        data[position + 1] = (i + 1) & 0xFF;
+        data[position + 2] = 0xE0 | ((0x1000 + i) >> 8);
+        data[position + 3] = (0x1000 + i) & 0xFF;
+    }
+
+    finishSection(section, position + SECTION_CRC_SIZE, true);
+}
+
+void buildPmt(BenchSection* section)
+{
+    static const uint8_t language[BENCH_ES_INFO_LENGTH] = {0x0A, 0x04, 's', 'r', 'p', 0x00};
+    uint8_t* data = section->data;
+    uint32_t position = PMT_HEADER_SIZE;
+    uint16_t i = 0;
+
+    section->name = "PMT";
+    data[0] = 0x02;
+    data[4] = 0x01;
+    data[5] = 0xC1;
+    data[8] = 0xE1;
+    data[9] = 0x00;
+    data[10] = 0xF0;
+    for (i = 0; i < BENCH_STREAMS; i++)
+    {
+        data[position] = (i == 0) ? 0x1B : 0x03;
+        data[position + 1] = 0xE0 | ((0x0100 + i) >> 8);
+        data[position + 2] = (0x0100 + i) & 0xFF;
+        data[position + 3] = 0xF0;
+        data[position + 4] = BENCH_ES_INFO_LENGTH;
+        memcpy(data + position + PMT_ELEMENTARY_INFO_SIZE, language, BENCH_ES_INFO_LENGTH);
+        position += PMT_ELEMENTARY_INFO_SIZE + BENCH_ES_INFO_LENGTH;
+    }
+
+    finishSection(section, position + SECTION_CRC_SIZE, true);
+}
+
+void buildTdt(BenchSection* section)
+{
+    section->name = "TDT";
+    section->data[0] = 0x70;
+    section->data[3] = 0xE3;
+    section->data[4] = 0xF0;
+    section->data[5] = 0x12;
+    section->data[6] = 0x34;
+    section->data[7] = 0x56;
+
+    finishSection(section, SECTION_LENGTH_OFFSET + TDT_SECTION_LENGTH, false);
+}
+
+/* One local time offset descriptor, entry i has region i and offset of i hours */
+void buildTot(BenchSection* section)
+{
+    uint8_t* data = section->data;
+    uint32_t position = TOT_HEADER_SIZE + DESCRIPTOR_HEADER_SIZE;
+    uint32_t loopLength = DESCRIPTOR_HEADER_SIZE + BENCH_LTO_ENTRIES * LTO_INFO_SIZE;
+    uint8_t i = 0;
+
+    section->name = "TOT";
+    data[0] = 0x73;
+    data[3] = 0xE3;
+    data[4] = 0xF0;
+    data[5] = 0x12;
+    data[6] = 0x34;
+    data[7] = 0x56;
+    data[8] = 0xF0 | (loopLength >> 8);
+    data[9] = loopLength & 0xFF;
+    data[TOT_HEADER_SIZE] = 0x58;
+    data[TOT_HEADER_SIZE + 1] = BENCH_LTO_ENTRIES * LTO_INFO_SIZE;
+    for (i = 0; i < BENCH_LTO_ENTRIES; i++, position += LTO_INFO_SIZE)
+    {
+        memcpy(data + position, "SRB", LANGUAGE_CODE_SIZE);
+        data[position + 3] = (i << 2) | 0x02;
+        data[position + 4] = i;
+        memset(data + position + 5, 0x00, LTO_INFO_SIZE - 5);
+    }
+
+    finishSection(section, position + SECTION_CRC_SIZE, true);
+}
+
+/* Field by field byte juggling the parsers used before the X-macro layouts, loop bounds are the same as parsePatTable's */
+ParseErrorCode handwrittenPatTable(const SectionView* patSection, PatTable* patTable)
+{
+    const uint8_t* buffer = patSection->buffer;
+    const uint8_t* currentBufferPosition = buffer + PAT_HEADER_SIZE;
+    const uint8_t* programLoopEnd = buffer + SECTION_LENGTH_OFFSET + patSection->sectionLength - SECTION_CRC_SIZE;
+    uint8_t lower8Bits = 0;
+    uint8_t higher8Bits = 0;
+
+    if (patSection->tableId != 0x00 || patSection->sectionLength < PAT_HEADER_SIZE + SECTION_CRC_SIZE - SECTION_LENGTH_OFFSET)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    patTable->patHeader.tableId = buffer[0];
+    lower8Bits = buffer[1] >> 7;
+    patTable->patHeader.sectionSyntaxIndicator = lower8Bits & 0x01;
+    higher8Bits = buffer[1];
+    lower8Bits = buffer[2];
+    patTable->patHeader.sectionLength = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x0FFF;
+    higher8Bits = buffer[3];
+    lower8Bits = buffer[4];
+    patTable->patHeader.transportStreamId = (uint16_t)((higher8Bits << 8) + lower8Bits);
+    lower8Bits = buffer[5] >> 1;
+    patTable->patHeader.versionNumber = lower8Bits & 0x1F;
+    patTable->patHeader.currentNextIndicator = buffer[5] & 0x01;
+    patTable->patHeader.sectionNumber = buffer[6];
+    patTable->patHeader.lastSectionNumber = buffer[7];
+
+    patTable->serviceInfoCount = 0;
+    while (currentBufferPosition + PAT_SERVICE_INFO_SIZE <= programLoopEnd)
+    {
+        if (patTable->serviceInfoCount > TABLES_MAX_NUMBER_OF_PIDS_IN_PAT - 1)
+        {
+            return TABLES_PARSE_ERROR;
+        }
+        higher8Bits = currentBufferPosition[0];
+        lower8Bits = currentBufferPosition[1];
+        patTable->patServiceInfoArray[patTable->serviceInfoCount].programNumber = (uint16_t)((higher8Bits << 8) + lower8Bits);
+        higher8Bits = currentBufferPosition[2];
+        lower8Bits = currentBufferPosition[3];
+        patTable->patServiceInfoArray[patTable->serviceInfoCount].pid = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x1FFF;
+        currentBufferPosition += PAT_SERVICE_INFO_SIZE;
+        patTable->serviceInfoCount++;
+    }
+
+    return TABLES_PARSE_OK;
+}
+
+ParseErrorCode handwrittenPmtTable(const SectionView* pmtSection, PmtTable* pmtTable)
+{
+    const uint8_t* buffer = pmtSection->buffer;
+    const uint8_t* currentBufferPosition = NULL;
+    const uint8_t* elementaryLoopEnd = buffer + SECTION_LENGTH_OFFSET + pmtSection->sectionLength - SECTION_CRC_SIZE;
+    PmtElementaryInfo* elementaryInfo = NULL;
+    uint8_t lower8Bits = 0;
+    uint8_t higher8Bits = 0;
+
+    if (pmtSection->tableId != 0x02 || pmtSection->sectionLength < PMT_HEADER_SIZE + SECTION_CRC_SIZE - SECTION_LENGTH_OFFSET)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    pmtTable->pmtHeader.tableId = buffer[0];
+    lower8Bits = buffer[1] >> 7;
+    pmtTable->pmtHeader.sectionSyntaxIndicator = lower8Bits & 0x01;
+    higher8Bits = buffer[1];
+    lower8Bits = buffer[2];
+    pmtTable->pmtHeader.sectionLength = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x0FFF;
+    higher8Bits = buffer[3];
+    lower8Bits = buffer[4];
+    pmtTable->pmtHeader.programNumber = (uint16_t)((higher8Bits << 8) + lower8Bits);
+    lower8Bits = buffer[5] >> 1;
+    pmtTable->pmtHeader.versionNumber = lower8Bits & 0x1F;
+    pmtTable->pmtHeader.currentNextIndicator = buffer[5] & 0x01;
+    pmtTable->pmtHeader.sectionNumber = buffer[6];
+    pmtTable->pmtHeader.lastSectionNumber = buffer[7];
+    higher8Bits = buffer[8];
+    lower8Bits = buffer[9];
+    pmtTable->pmtHeader.pcrPid = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x1FFF;
+    higher8Bits = buffer[10];
+    lower8Bits = buffer[11];
+    pmtTable->pmtHeader.programInfoLength = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x0FFF;
+
+    pmtTable->programInfo = buffer + PMT_HEADER_SIZE;
+    currentBufferPosition = pmtTable->programInfo + pmtTable->pmtHeader.programInfoLength;
+    pmtTable->elementaryInfoCount = 0;
+    if (currentBufferPosition > elementaryLoopEnd)
+    {
+        return TABLES_PARSE_ERROR;
+    }
+
+    while (currentBufferPosition + PMT_ELEMENTARY_INFO_SIZE <= elementaryLoopEnd)
+    {
+        if (pmtTable->elementaryInfoCount > TABLES_MAX_NUMBER_OF_ELEMENTARY_PID - 1)
+        {
+            return TABLES_PARSE_ERROR;
+        }
+        elementaryInfo = &(pmtTable->pmtElementaryInfoArray[pmtTable->elementaryInfoCount]);
+        elementaryInfo->streamType = currentBufferPosition[0];
+        higher8Bits = currentBufferPosition[1];
+        lower8Bits = currentBufferPosition[2];
+        elementaryInfo->elementaryPid = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x1FFF;
+        higher8Bits = currentBufferPosition[3];
+        lower8Bits = currentBufferPosition[4];
+        elementaryInfo->esInfoLength = (uint16_t)((higher8Bits << 8) + lower8Bits) & 0x0FFF;
+        elementaryInfo->esInfo = currentBufferPosition + PMT_ELEMENTARY_INFO_SIZE;
+        currentBufferPosition += PMT_ELEMENTARY_INFO_SIZE + elementaryInfo->esInfoLength;
+        if (currentBufferPosition > elementaryLoopEnd)
+        {
+            return TABLES_PARSE_ERROR;
+        }
+        pmtTable->elementaryInfoCount++;
+    }
+
+    return TABLES_PARSE_OK;
+}
+
+/* Sets section_length and CRC_32 once the body is written */
+void finishSection(BenchSection* section, uint32_t length, bool withCrc)
+{
+    uint32_t crc = 0;
+
+    section->data[1] = (withCrc ? 0xB0 : 0x70) | ((length - SECTION_LENGTH_OFFSET) >> 8);
+    section->data[2] = (length - SECTION_LENGTH_OFFSET) & 0xFF;
+    section->length = length;
+
+    if (withCrc)
+    {
+        crc = tablesCrc32(section->data, length - SECTION_CRC_SIZE);
+        section->data[length - 4] = (uint8_t)(crc >> 24);
+        section->data[length - 3] = (uint8_t)(crc >> 16);
+        section->data[length - 2] = (uint8_t)(crc >> 8);
+        section->data[length - 1] = (uint8_t)crc;
+    }
+}
+
+double monotonicNanoseconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec * 1e9 + now.tv_nsec;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "task_executor.h"
+#include "test_runner.h"
+
+#define TEST_TIMEOUT_S 10
+#define FORK_DEPTH 4
+#define FORK_WIDTH 3
+
+/**
+ * @brief Structure that holds one fork/join test case
+ */
+typedef struct _ForkTest
+{
+    TaskExecutor* executor;
+    TaskPriority priority;
+    uint32_t leaves;                                /* Tasks that reached the bottom of the tree */
+}ForkTest;
+
+/**
+ * @brief Structure that holds one task of the tree, each level waits for the level below
+ */
+typedef struct _ForkNode
+{
+    ForkTest* test;
+    uint32_t depth;
+}ForkNode;
+
+
+static void forkTask(void* nodeArgument);
+static int32_t runForkTest(const char* name, uint32_t numberOfWorkers, uint32_t maxBackgroundWorkers, TaskPriority priority);
+
+
+int main()
+{
+    int32_t failures = 0;
+
+    failures += runForkTest("nested normal, 2 workers", 2, 1, TASK_PRIORITY_NORMAL);
+    failures += runForkTest("nested background, 2 workers, 1 background", 2, 1, TASK_PRIORITY_BACKGROUND);
+    failures += runForkTest("nested background, 1 worker", 1, 1, TASK_PRIORITY_BACKGROUND);
+    failures += runForkTest("nested background, 4 workers, 2 background", 4, 2, TASK_PRIORITY_BACKGROUND);
+
+    printf("%s\n", (failures == 0) ? "task_executor_test: all passed" : "task_executor_test: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
+
+/* Every node above the leaves submits FORK_WIDTH children of the same priority and waits for them */
+void forkTask(void* nodeArgument)
+{
+    ForkNode* node = (ForkNode*)nodeArgument;
+    ForkNode children[FORK_WIDTH];
+    TaskGroup group;
+    uint32_t i = 0;
+
+    if (node->depth == FORK_DEPTH)
+    {
+        __atomic_add_fetch(&node->test->leaves, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    taskGroupInit(&group);
+    for (i = 0; i < FORK_WIDTH; i++)
+    {
+        children[i].test = node->test;
+        children[i].depth = node->depth + 1;
+        taskExecutorSubmit(node->test->executor, node->test->priority, forkTask, &children[i], &group);
+    }
+    taskExecutorWait(node->test->executor, &group);
+    taskGroupDestroy(&group);
+}
+
+int32_t runForkTest(const char* name, uint32_t numberOfWorkers, uint32_t maxBackgroundWorkers, TaskPriority priority)
+{
+    TaskExecutorConfig config;
+    ForkTest test;
+    ForkNode root;
+    TaskGroup group;
+    uint32_t expectedLeaves = 1;
+    uint32_t i = 0;
+
+    for (i = 0; i < FORK_DEPTH; i++)
+    {
+        expectedLeaves *= FORK_WIDTH;
+    }
+
+    config.numberOfWorkers = numberOfWorkers;
+    config.maxBackgroundWorkers = maxBackgroundWorkers;
+    config.pinWorkers = false;
+    if (taskExecutorCreate(&config, &test.executor))
+    {
+        printf("FAIL %s: executor not created\n", name);
+        return 1;
+    }
+    test.priority = priority;
+    test.leaves = 0;
+    root.test = &test;
+    root.depth = 0;
+
+    currentTest = name;
+    testSetDeadline(TEST_TIMEOUT_S);
+
+    taskGroupInit(&group);
+    taskExecutorSubmit(test.executor, priority, forkTask, &root, &group);
+    taskExecutorWait(test.executor, &group);
+    taskGroupDestroy(&group);
+
+    testSetDeadline(0);
+    taskExecutorDestroy(test.executor);
+
+    if (test.leaves != expectedLeaves)
+    {
+        printf("FAIL %s: %u of %u leaves ran\n", name, test.leaves, expectedLeaves);
+        return 1;
+    }
+
+    printf("ok   %s\n", name);
+
+    return 0;
+}
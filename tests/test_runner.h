@@ -0,0 +1,41 @@
+#ifndef __TEST_RUNNER_H__
+#define __TEST_RUNNER_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+/* name of the running test, reported when its deadline passes */
+static const char* currentTest = "";
+
+/**
+ * @brief Reports the running test as failed and ends the test binary, runs as SIGALRM handler
+ *
+ * @param [in] signalNumber - not used
+ */
+static inline void testTimeoutHandler(int signalNumber)
+{
+    static const char message[] = "FAIL timed out, test did not finish: ";
+
+    (void)signalNumber;
+    write(STDOUT_FILENO, message, sizeof(message) - 1);
+    write(STDOUT_FILENO, currentTest, strlen(currentTest));
+    write(STDOUT_FILENO, "\n", 1);
+    _exit(1);
+}
+
+/**
+ * @brief Ends the test binary as failed if it is still running after timeoutSeconds
+ *
+ * A test that hangs is deadlocked, the deadline turns it into a failure instead of a stuck build.
+ *
+ * @param [in] timeoutSeconds - seconds from now, 0 cancels the deadline
+ */
+static inline void testSetDeadline(uint32_t timeoutSeconds)
+{
+    signal(SIGALRM, testTimeoutHandler);
+    alarm(timeoutSeconds);
+}
+
+#endif /* __TEST_RUNNER_H__ */
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include "thread_policy.h"
+
+#define BENCH_WAKEUPS 2000                          /* Wakeups measured per run */
+#define BENCH_PERIOD_US 1000                        /* Period of the measured thread, same order as key repeat handling */
+#define BENCH_TIMER_PERIOD_MS 10                    /* Period of SIGEV_THREAD timer created with role attributes */
+#define BENCH_LOADERS 2                             /* Busy threads in default class competing for the CPU */
+
+/**
+ * @brief Structure that holds results of the measured thread
+ */
+typedef struct _WakeupResults
+{
+    uint64_t lateness[BENCH_WAKEUPS];               /* Microseconds between planned and real wakeup */
+}WakeupResults;
+
+
+static void* wakeupThread(void* resultsArgument);
+static void* loaderThread(void* argument);
+static void timerFired(union sigval signalArg);
+static uint64_t monotonicMicroseconds();
+static int compareLateness(const void* first, const void* second);
+
+static volatile int loadersRun = 1;
+static volatile uint32_t timerFires = 0;
+
+
+int main(int argc, char** argv)
+{
+    const char* policyText = (argc > 1) ? argv[1] : "other:0:any";
+    static WakeupResults results;
+    ThreadPolicy policy;
+    pthread_t loaders[BENCH_LOADERS];
+    pthread_t wakeup;
+    struct sigevent timerEvent;
+    struct itimerspec timerSpec;
+    timer_t timer;
+    uint64_t sum = 0;
+    double mean = 0;
+    double variance = 0;
+    uint64_t startTime = 0;
+    uint32_t expectedFires = 0;
+    uint32_t i = 0;
+
+    if (threadPolicyParse(policyText, &policy) || threadPolicyConfigure(THREAD_ROLE_INPUT, &policy))
+    {
+        return 1;
+    }
+
+    for (i = 0; i < BENCH_LOADERS; i++)
+    {
+        pthread_create(&loaders[i], NULL, loaderThread, NULL);
+    }
+
+    /* same setup tv_app uses for its key timers */
+    memset(&timerEvent, 0x0, sizeof(struct sigevent));
+    timerEvent.sigev_notify = SIGEV_THREAD;
+    timerEvent.sigev_notify_function = timerFired;
+    timerEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_INPUT);
+    timer_create(CLOCK_MONOTONIC, &timerEvent, &timer);
+    memset(&timerSpec, 0x0, sizeof(struct itimerspec));
+    timerSpec.it_value.tv_nsec = BENCH_TIMER_PERIOD_MS * 1000000;
+    timerSpec.it_interval.tv_nsec = BENCH_TIMER_PERIOD_MS * 1000000;
+    startTime = monotonicMicroseconds();
+    timer_settime(timer, 0, &timerSpec, NULL);
+
+    if (threadPolicyCreateThread(THREAD_ROLE_INPUT, &wakeup, wakeupThread, &results))
+    {
+        return 1;
+    }
+    pthread_join(wakeup, NULL);
+
+    expectedFires = (uint32_t)((monotonicMicroseconds() - startTime) / (BENCH_TIMER_PERIOD_MS * 1000));
+    timer_delete(timer);
+    loadersRun = 0;
+    for (i = 0; i < BENCH_LOADERS; i++)
+    {
+        pthread_join(loaders[i], NULL);
+    }
+
+    for (i = 0; i < BENCH_WAKEUPS; i++)
+    {
+        sum += results.lateness[i];
+    }
+    mean = (double)sum / BENCH_WAKEUPS;
+    for (i = 0; i < BENCH_WAKEUPS; i++)
+    {
+        variance += (results.lateness[i] - mean) * (results.lateness[i] - mean);
+    }
+    qsort(results.lateness, BENCH_WAKEUPS, sizeof(uint64_t), compareLateness);
+
+    printf("%-14s wakeup late mean %7.1f us, p99 %6llu us, max %6llu us, jitter %7.1f us, timer fired %u of %u\n",
+        policyText, mean, (unsigned long long)results.lateness[BENCH_WAKEUPS * 99 / 100],
+        (unsigned long long)results.lateness[BENCH_WAKEUPS - 1], sqrt(variance / BENCH_WAKEUPS), timerFires, expectedFires);
+
+    return 0;
+}
+
+void* wakeupThread(void* resultsArgument)
+{
+    WakeupResults* results = (WakeupResults*)resultsArgument;
+    struct timespec planned;
+    uint64_t plannedTime = 0;
+    uint32_t i = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &planned);
+    for (i = 0; i < BENCH_WAKEUPS; i++)
+    {
+        planned.tv_nsec += BENCH_PERIOD_US * 1000;
+        if (planned.tv_nsec >= 1000000000)
+        {
+            planned.tv_sec++;
+            planned.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &planned, NULL);
+        plannedTime = (uint64_t)planned.tv_sec * 1000000 + planned.tv_nsec / 1000;
+        results->lateness[i] = monotonicMicroseconds() - plannedTime;
+    }
+
+    return NULL;
+}
+
+void* loaderThread(void* argument)
+{
+    volatile uint64_t counter = 0;
+
+    while (loadersRun)
+    {
+        counter++;
+    }
+
+    return argument;
+}
+
+void timerFired(union sigval signalArg)
+{
+    (void)signalArg;
+    __sync_fetch_and_add(&timerFires, 1);
+}
+
+uint64_t monotonicMicroseconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+int compareLateness(const void* first, const void* second)
+{
+    uint64_t a = *(const uint64_t*)first;
+    uint64_t b = *(const uint64_t*)second;
+
+    return (a > b) - (a < b);
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "timeshift_buffer.h"
+#include "time_service.h"
+#include "test_runner.h"
+
+#define TEST_TIMEOUT_S 30
+#define TEST_RING_BLOCKS 8
+#define TEST_PACKETS_PER_BLOCK (TIMESHIFT_BLOCK_SIZE / TS_PACKET_SIZE)
+#define TEST_RECORDED_PID 0x0100
+#define TEST_SKIPPED_PID 0x0200                     /* Every other packet, must never reach the ring file */
+#define TEST_CHUNK_SIZE 1000                        /* Leaves part of a packet for the next write to complete */
+#define TEST_POLL_US 1000
+
+/**
+ * @brief Structure that holds what playback handed over, written only by the playback thread
+ */
+typedef struct _PlaybackCheck
+{
+    uint32_t firstSequence;
+    uint32_t nextSequence;
+    uint32_t packets;
+    uint32_t errors;                                /* Wrong sync byte, PID or sequence number */
+    bool started;
+}PlaybackCheck;
+
+
+static void playbackCallback(const uint8_t* data, uint32_t length, void* userData);
+static void recordPackets(TimeshiftBuffer* timeshiftBuffer, uint32_t firstSequence, uint32_t numberOfPackets);
+static void waitForDisk(TimeshiftBuffer* timeshiftBuffer);
+static int32_t playBack(TimeshiftBuffer* timeshiftBuffer, PlaybackCheck* check, const char* name, uint32_t expectedFirst,
+    uint32_t expectedPackets);
+
+
+int main(int argc, char* argv[])
+{
+    const char* fileName = (argc > 1) ? argv[1] : "/tmp/timeshift_buffer_test.ts";
+    TimeshiftBuffer* timeshiftBuffer = NULL;
+    TimeshiftStatistics statistics;
+    static PlaybackCheck check;
+    uint16_t pid = TEST_RECORDED_PID;
+    int32_t failures = 0;
+
+    testSetDeadline(TEST_TIMEOUT_S);
+
+    currentTest = "create";
+    if (timeshiftBufferCreate(fileName, (uint64_t)TEST_RING_BLOCKS * TIMESHIFT_BLOCK_SIZE, playbackCallback, &check, &timeshiftBuffer)
+        || timeshiftBufferSetPids(timeshiftBuffer, &pid, 1))
+    {
+        printf("timeshift_buffer_test: FAILED cannot create buffer in %s\n", fileName);
+        return 1;
+    }
+
+    /* half of the ring, nothing overwritten yet */
+    currentTest = "rewind";
+    recordPackets(timeshiftBuffer, 0, TEST_RING_BLOCKS / 2 * TEST_PACKETS_PER_BLOCK);
+    failures += playBack(timeshiftBuffer, &check, "rewind", 0, TEST_RING_BLOCKS / 2 * TEST_PACKETS_PER_BLOCK);
+
+    /* recording went around the ring, rewind is clamped behind the block being overwritten next */
+    currentTest = "wrapped";
+    timeshiftBufferGoLive(timeshiftBuffer);
+    recordPackets(timeshiftBuffer, TEST_RING_BLOCKS / 2 * TEST_PACKETS_PER_BLOCK, TEST_RING_BLOCKS * TEST_PACKETS_PER_BLOCK);
+    failures += playBack(timeshiftBuffer, &check, "wrapped", (TEST_RING_BLOCKS / 2 + 1) * TEST_PACKETS_PER_BLOCK,
+        (TEST_RING_BLOCKS - 1) * TEST_PACKETS_PER_BLOCK);
+
+    timeshiftBufferGetStatistics(timeshiftBuffer, &statistics);
+    if (statistics.droppedPackets != 0 || statistics.writeErrors != 0 || statistics.readErrors != 0 || statistics.syncLosses != 0)
+    {
+        printf("counters       FAIL dropped %u, write errors %u, read errors %u, sync losses %u\n", statistics.droppedPackets,
+            statistics.writeErrors, statistics.readErrors, statistics.syncLosses);
+        failures++;
+    }
+
+    currentTest = "destroy";
+    timeshiftBufferDestroy(timeshiftBuffer);
+    if (access(fileName, F_OK) == 0)
+    {
+        printf("destroy        FAIL ring file %s was left behind\n", fileName);
+        failures++;
+    }
+
+    printf("ring file %s, %s\n", fileName, statistics.directIo ? "O_DIRECT" : "buffered, file system refused O_DIRECT");
+    printf("%s\n", (failures == 0) ? "timeshift_buffer_test: all passed" : "timeshift_buffer_test: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
+
+/* Every packet must be the recorded PID and carry the sequence number following the previous one */
+void playbackCallback(const uint8_t* data, uint32_t length, void* userData)
+{
+    PlaybackCheck* check = (PlaybackCheck*)userData;
+    uint32_t sequence = 0;
+    uint32_t offset = 0;
+
+    for (offset = 0; offset + TS_PACKET_SIZE <= length; offset += TS_PACKET_SIZE)
+    {
+        sequence = ((uint32_t)data[offset + 4] << 24) | ((uint32_t)data[offset + 5] << 16) | ((uint32_t)data[offset + 6] << 8)
+            | data[offset + 7];
+        if (!check->started)
+        {
+            check->firstSequence = sequence;
+            check->nextSequence = sequence;
+            check->started = true;
+        }
+        if (data[offset] != TS_SYNC_BYTE || (((data[offset + 1] & 0x1F) << 8) | data[offset + 2]) != TEST_RECORDED_PID
+            || sequence != check->nextSequence)
+        {
+            check->errors++;
+        }
+        check->nextSequence = sequence + 1;
+        check->packets++;
+    }
+    if (length % TS_PACKET_SIZE != 0)
+    {
+        check->errors++;
+    }
+}
+
+/* Recorded PID packets are numbered, skipped PID packets are interleaved with them */
+void recordPackets(TimeshiftBuffer* timeshiftBuffer, uint32_t firstSequence, uint32_t numberOfPackets)
+{
+    static uint8_t chunk[2 * TEST_CHUNK_SIZE];
+    uint8_t packet[TS_PACKET_SIZE];
+    uint32_t fill = 0;
+    uint32_t sequence = 0;
+    uint32_t i = 0;
+    uint8_t skipped = 0;
+
+    memset(packet, 0xFF, TS_PACKET_SIZE);
+    packet[0] = TS_SYNC_BYTE;
+    packet[3] = 0x10;
+
+    for (sequence = firstSequence; sequence < firstSequence + numberOfPackets; )
+    {
+        packet[1] = skipped ? (TEST_SKIPPED_PID >> 8) : (TEST_RECORDED_PID >> 8);
+        packet[2] = skipped ? (TEST_SKIPPED_PID & 0xFF) : (TEST_RECORDED_PID & 0xFF);
+        for (i = 0; i < 4; i++)
+        {
+            packet[4 + i] = skipped ? 0xEE : (uint8_t)(sequence >> (24 - 8 * i));
+        }
+        sequence += !skipped;
+        skipped = !skipped;
+
+        memcpy(chunk + fill, packet, TS_PACKET_SIZE);
+        fill += TS_PACKET_SIZE;
+        if (fill >= TEST_CHUNK_SIZE)
+        {
+            timeshiftBufferWrite(timeshiftBuffer, chunk, TEST_CHUNK_SIZE, monotonicMicroseconds());
+            memmove(chunk, chunk + TEST_CHUNK_SIZE, fill - TEST_CHUNK_SIZE);
+            fill -= TEST_CHUNK_SIZE;
+            waitForDisk(timeshiftBuffer);
+        }
+    }
+    timeshiftBufferWrite(timeshiftBuffer, chunk, fill, monotonicMicroseconds());
+
+    waitForDisk(timeshiftBuffer);
+}
+
+/* Staging is a few blocks only, the test writes faster than any stream so it waits where a tuner would not */
+void waitForDisk(TimeshiftBuffer* timeshiftBuffer)
+{
+    TimeshiftStatistics statistics;
+
+    timeshiftBufferGetStatistics(timeshiftBuffer, &statistics);
+    while (statistics.recordedBytes - statistics.writtenBytes >= TIMESHIFT_BLOCK_SIZE)
+    {
+        usleep(TEST_POLL_US);
+        timeshiftBufferGetStatistics(timeshiftBuffer, &statistics);
+    }
+}
+
+/* Rewinds far into the past and checks that playback delivers every recorded packet from the oldest readable one */
+int32_t playBack(TimeshiftBuffer* timeshiftBuffer, PlaybackCheck* check, const char* name, uint32_t expectedFirst,
+    uint32_t expectedPackets)
+{
+    TimeshiftStatistics statistics;
+    int32_t failed = 0;
+
+    memset(check, 0x0, sizeof(PlaybackCheck));
+    timeshiftBufferPause(timeshiftBuffer);
+    if (timeshiftBufferSeek(timeshiftBuffer, -1000) || timeshiftBufferResume(timeshiftBuffer))
+    {
+        printf("%-14s FAIL seek or resume refused\n", name);
+        return 1;
+    }
+
+    do
+    {
+        usleep(TEST_POLL_US);
+        timeshiftBufferGetStatistics(timeshiftBuffer, &statistics);
+    } while (statistics.readPosition < statistics.writtenBytes);
+    timeshiftBufferPause(timeshiftBuffer);
+
+    failed = !check->started || check->errors != 0 || check->firstSequence != expectedFirst || check->packets != expectedPackets
+        || statistics.overruns != 0;
+    printf("%-14s %s %u packets from %u, %u errors, %u overruns\n", name, failed ? "FAIL" : "ok  ", check->packets,
+        check->firstSequence, check->errors, statistics.overruns);
+
+    return failed;
+}
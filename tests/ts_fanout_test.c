@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ts_fanout.h"
+#include "test_runner.h"
+
+#define TEST_TIMEOUT_S 30
+#define TEST_RING_PACKETS 4096
+#define TEST_ROUNDS 400
+#define TEST_ROUND_PACKETS 1000                     /* Produced at once, then the producer sleeps */
+#define TEST_ROUND_PAUSE_US 2000                    /* About 500k packets per second, faster than any tuner */
+#define TEST_CHUNK_SIZE (7 * TS_PACKET_SIZE + 13)   /* Readers must never get a packet the producer wrote only half of */
+#define TEST_READ_PACKETS 512
+#define TEST_READ_TIMEOUT_MS 200
+#define TEST_SLOW_READER_PAUSE_US 20000             /* Slow reader gets far less than produced and has to lose packets */
+#define TEST_NUMBER_OF_READERS 2
+#define TEST_POLL_US 1000
+
+/**
+ * @brief Structure that holds what one reader process got
+ */
+typedef struct _ReaderResult
+{
+    uint64_t packets;
+    uint64_t gaps;                                  /* Packets missing between consecutive sequence numbers */
+    uint64_t tornPackets;                           /* Packets whose head and tail come from different writes */
+    uint64_t firstSequence;
+}ReaderResult;
+
+
+static int32_t runReader(const char* socketPath, bool slow);
+static void fillPacket(uint8_t* packet, uint64_t sequence);
+static uint64_t packetSequence(const uint8_t* packet, uint32_t offset);
+
+
+int main(int argc, char* argv[])
+{
+    const char* socketPath = (argc > 1) ? argv[1] : "/tmp/ts_fanout_test.sock";
+    static uint8_t stream[TEST_ROUND_PACKETS * TS_PACKET_SIZE];
+    TsFanout* fanout = NULL;
+    TsFanoutStatistics statistics;
+    pid_t readers[TEST_NUMBER_OF_READERS];
+    uint64_t sequence = 0;
+    uint64_t slowLag = 0;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    uint32_t round = 0;
+    uint32_t i = 0;
+    int32_t failures = 0;
+    int status = 0;
+
+    testSetDeadline(TEST_TIMEOUT_S);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    currentTest = "create";
+    if (tsFanoutCreate(socketPath, TEST_RING_PACKETS, &fanout))
+    {
+        printf("ts_fanout_test: FAILED cannot create ring on %s\n", socketPath);
+        return 1;
+    }
+
+    /* reader 0 keeps up, reader 1 is slow */
+    for (i = 0; i < TEST_NUMBER_OF_READERS; i++)
+    {
+        readers[i] = fork();
+        if (readers[i] == 0)
+        {
+            _exit(runReader(socketPath, i == 1));
+        }
+    }
+
+    /* readers start at the newest packet, nothing is produced before both are in */
+    currentTest = "connect";
+    do
+    {
+        usleep(TEST_POLL_US);
+        tsFanoutGetStatistics(fanout, &statistics);
+    } while (statistics.numberOfReaders < TEST_NUMBER_OF_READERS);
+
+    currentTest = "produce";
+    for (round = 0; round < TEST_ROUNDS; round++)
+    {
+        for (i = 0; i < TEST_ROUND_PACKETS; i++)
+        {
+            fillPacket(stream + i * TS_PACKET_SIZE, sequence++);
+        }
+        for (offset = 0; offset < sizeof(stream); offset += length)
+        {
+            length = (sizeof(stream) - offset < TEST_CHUNK_SIZE) ? sizeof(stream) - offset : TEST_CHUNK_SIZE;
+            tsFanoutWrite(fanout, stream + offset, length);
+        }
+
+        /* lag of the slow reader is visible to the producer while it runs */
+        tsFanoutGetStatistics(fanout, &statistics);
+        for (i = 0; i < statistics.numberOfReaders; i++)
+        {
+            slowLag = (statistics.readers[i].lag > slowLag) ? statistics.readers[i].lag : slowLag;
+        }
+        usleep(TEST_ROUND_PAUSE_US);
+    }
+
+    tsFanoutGetStatistics(fanout, &statistics);
+    if (statistics.writtenPackets != sequence || statistics.syncLosses != 0 || statistics.connections != TEST_NUMBER_OF_READERS
+        || slowLag < TEST_RING_PACKETS / 2)
+    {
+        printf("producer       FAIL written %llu of %llu, sync losses %u, connections %u, highest lag %llu\n",
+            (unsigned long long)statistics.writtenPackets, (unsigned long long)sequence, statistics.syncLosses,
+            statistics.connections, (unsigned long long)slowLag);
+        failures++;
+    }
+    else
+    {
+        printf("producer       ok   %llu packets, %u readers, highest lag %llu packets\n", (unsigned long long)sequence,
+            statistics.connections, (unsigned long long)slowLag);
+    }
+
+    /* readers drain what is left and see the producer gone */
+    currentTest = "destroy";
+    tsFanoutDestroy(fanout);
+    for (i = 0; i < TEST_NUMBER_OF_READERS; i++)
+    {
+        if (waitpid(readers[i], &status, 0) != readers[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            failures++;
+        }
+    }
+    if (access(socketPath, F_OK) == 0)
+    {
+        printf("destroy        FAIL socket %s was left behind\n", socketPath);
+        failures++;
+    }
+
+    printf("%s\n", (failures == 0) ? "ts_fanout_test: all passed" : "ts_fanout_test: FAILED");
+
+    return (failures == 0) ? 0 : 1;
+}
+
+/* Fast reader must get every packet, slow one must lose some and count exactly the packets it missed */
+int32_t runReader(const char* socketPath, bool slow)
+{
+    static uint8_t buffer[TEST_READ_PACKETS * TS_PACKET_SIZE];
+    const char* name = slow ? "slow reader" : "fast reader";
+    TsFanoutReader* reader = NULL;
+    TsFanoutReaderStatistics statistics;
+    ReaderResult result;
+    uint64_t sequence = 0;
+    uint32_t numberOfPackets = 0;
+    uint32_t i = 0;
+    int32_t failed = 0;
+
+    memset(&result, 0x0, sizeof(ReaderResult));
+    if (tsFanoutReaderOpen(socketPath, &reader))
+    {
+        printf("%-14s FAIL cannot connect\n", name);
+        return 1;
+    }
+
+    while (tsFanoutRead(reader, buffer, TEST_READ_PACKETS, TEST_READ_TIMEOUT_MS, &numberOfPackets) == TF_NO_ERROR)
+    {
+        for (i = 0; i < numberOfPackets; i++)
+        {
+            sequence = packetSequence(buffer + i * TS_PACKET_SIZE, 4);
+            if (buffer[i * TS_PACKET_SIZE] != TS_SYNC_BYTE || sequence != packetSequence(buffer + i * TS_PACKET_SIZE, TS_PACKET_SIZE - 8))
+            {
+                result.tornPackets++;
+            }
+            if (result.packets == 0)
+            {
+                result.firstSequence = sequence;
+            }
+            else if (sequence > result.firstSequence + result.packets + result.gaps)
+            {
+                result.gaps += sequence - (result.firstSequence + result.packets + result.gaps);
+            }
+            result.packets++;
+        }
+        if (slow && numberOfPackets > 0)
+        {
+            usleep(TEST_SLOW_READER_PAUSE_US);
+        }
+    }
+
+    tsFanoutReaderGetStatistics(reader, &statistics);
+    tsFanoutReaderClose(reader);
+
+    if (slow)
+    {
+        failed = result.tornPackets != 0 || statistics.lostPackets == 0 || statistics.overruns == 0 || result.gaps != statistics.lostPackets;
+    }
+    else
+    {
+        failed = result.tornPackets != 0 || result.gaps != 0 || statistics.lostPackets != 0 || result.firstSequence != 0
+            || result.packets != (uint64_t)TEST_ROUNDS * TEST_ROUND_PACKETS;
+    }
+    printf("%-14s %s %llu packets from %llu, %llu missing, %llu lost, %u overruns, %llu torn\n", name, failed ? "FAIL" : "ok  ",
+        (unsigned long long)result.packets, (unsigned long long)result.firstSequence, (unsigned long long)result.gaps,
+        (unsigned long long)statistics.lostPackets, statistics.overruns, (unsigned long long)result.tornPackets);
+
+    return failed;
+}
+
+/* Sequence number is written at both ends of the packet, a packet copied while it was overwritten has them differ */
+void fillPacket(uint8_t* packet, uint64_t sequence)
+{
+    uint32_t i = 0;
+
+    memset(packet, 0xFF, TS_PACKET_SIZE);
+    packet[0] = TS_SYNC_BYTE;
+    packet[1] = 0x01;
+    packet[3] = 0x10 | (sequence & 0x0F);
+    for (i = 0; i < 8; i++)
+    {
+        packet[4 + i] = (uint8_t)(sequence >> (56 - 8 * i));
+        packet[TS_PACKET_SIZE - 8 + i] = (uint8_t)(sequence >> (56 - 8 * i));
+    }
+}
+
+uint64_t packetSequence(const uint8_t* packet, uint32_t offset)
+{
+    uint64_t sequence = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        sequence = (sequence << 8) | packet[offset + i];
+    }
+
+    return sequence;
+}
@@ -0,0 +1,376 @@
+#define _GNU_SOURCE                                 /* CPU sets, SCHED_BATCH, SCHED_IDLE */
+#include "thread_policy.h"
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#define THREAD_POLICY_TEXT_LENGTH 64
+#define THREAD_POLICY_MIN_NICE -20
+#define THREAD_POLICY_MAX_NICE 19
+
+/**
+ * @brief Structure passed to threads created by threadPolicyCreateThread
+ */
+typedef struct _ThreadStart
+{
+    ThreadRole role;
+    bool applyAll;                                  /* Thread was created with default attributes, policy is applied by the thread */
+    void* (*startRoutine)(void*);
+    void* argument;
+}ThreadStart;
+
+
+static void* threadStart(void* startArgument);
+static void* probeStart(void* argument);
+static void setAttributes(ThreadRole role);
+static ThreadPolicyError applyPolicy(ThreadRole role, bool applyAll);
+static bool isRealTime(int32_t schedulingClass);
+static ThreadPolicyError parseCpus(char* text, uint32_t* cpuMask);
+static void setCpus(uint32_t cpuMask, cpu_set_t* cpuSet);
+
+static const char* const roleNames[THREAD_ROLE_COUNT] = {"input", "zap", "sections", "render", "background"};
+static ThreadPolicy policies[THREAD_ROLE_COUNT];
+static pthread_attr_t attributes[THREAD_ROLE_COUNT];
+static __thread uint32_t appliedRoles = 0;         /* Roles applied to the calling thread by threadPolicyApplyOnce */
+
+
+ThreadPolicyError threadPolicyParse(const char* text, ThreadPolicy* policy)
+{
+    char buffer[THREAD_POLICY_TEXT_LENGTH];
+    char* savePointer = NULL;
+    char* className = NULL;
+    char* priority = NULL;
+    char* cpus = NULL;
+    char* end = NULL;
+
+    if (text == NULL || policy == NULL || strlen(text) >= sizeof(buffer))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TP_ERROR;
+    }
+
+    strcpy(buffer, text);
+    memset(policy, 0x0, sizeof(ThreadPolicy));
+
+    className = strtok_r(buffer, ":", &savePointer);
+    priority = strtok_r(NULL, ":", &savePointer);
+    cpus = strtok_r(NULL, ":", &savePointer);
+    if (className == NULL || priority == NULL)
+    {
+        printf("\n%s : ERROR policy %s is not class:priority:cpus\n", __FUNCTION__, text);
+        return TP_ERROR;
+    }
+
+    if (strcmp(className, "other") == 0)
+    {
+        policy->schedulingClass = SCHED_OTHER;
+    }
+    else if (strcmp(className, "batch") == 0)
+    {
+        policy->schedulingClass = SCHED_BATCH;
+    }
+    else if (strcmp(className, "idle") == 0)
+    {
+        policy->schedulingClass = SCHED_IDLE;
+    }
+    else if (strcmp(className, "fifo") == 0)
+    {
+        policy->schedulingClass = SCHED_FIFO;
+    }
+    else if (strcmp(className, "rr") == 0)
+    {
+        policy->schedulingClass = SCHED_RR;
+    }
+    else
+    {
+        printf("\n%s : ERROR unknown scheduling class %s\n", __FUNCTION__, className);
+        return TP_ERROR;
+    }
+
+    policy->priority = (int32_t)strtol(priority, &end, 10);
+    if (*end != '\0'
+        || (isRealTime(policy->schedulingClass) && (policy->priority < sched_get_priority_min(policy->schedulingClass)
+            || policy->priority > sched_get_priority_max(policy->schedulingClass)))
+        || (!isRealTime(policy->schedulingClass) && (policy->priority < THREAD_POLICY_MIN_NICE || policy->priority > THREAD_POLICY_MAX_NICE)))
+    {
+        printf("\n%s : ERROR priority %s is out of range of class %s\n", __FUNCTION__, priority, className);
+        return TP_ERROR;
+    }
+
+    if (cpus != NULL && parseCpus(cpus, &policy->cpuMask))
+    {
+        printf("\n%s : ERROR CPU set %s is not valid\n", __FUNCTION__, cpus);
+        return TP_ERROR;
+    }
+
+    policy->configured = true;
+
+    return TP_NO_ERROR;
+}
+
+ThreadPolicyError threadPolicyConfigure(ThreadRole role, const ThreadPolicy* policy)
+{
+    pthread_t probe;
+    int result = 0;
+
+    if (role >= THREAD_ROLE_COUNT || policy == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TP_ERROR;
+    }
+
+    if (policies[role].configured)
+    {
+        pthread_attr_destroy(&attributes[role]);
+    }
+    policies[role] = *policy;
+    if (!policy->configured)
+    {
+        return TP_NO_ERROR;
+    }
+
+    pthread_attr_init(&attributes[role]);
+    setAttributes(role);
+
+    /* SIGEV_THREAD timers have no fallback, a class that is not permitted would keep them from ever firing */
+    if (isRealTime(policy->schedulingClass))
+    {
+        result = pthread_create(&probe, &attributes[role], probeStart, NULL);
+        if (result == 0)
+        {
+            pthread_join(probe, NULL);
+        }
+        else if (result == EPERM || result == EINVAL)
+        {
+            printf("\n%s : ERROR %s threads use default class, real time is not permitted (%s)\n", __FUNCTION__, roleNames[role],
+                strerror(result));
+            policies[role].schedulingClass = SCHED_OTHER;
+            policies[role].priority = 0;
+            setAttributes(role);
+        }
+    }
+
+    printf("Thread role %s: class %d, priority %d, CPU mask 0x%x\n", roleNames[role], policies[role].schedulingClass,
+        policies[role].priority, policies[role].cpuMask);
+
+    return TP_NO_ERROR;
+}
+
+pthread_attr_t* threadPolicyGetAttributes(ThreadRole role)
+{
+    if (role >= THREAD_ROLE_COUNT || !policies[role].configured)
+    {
+        return NULL;
+    }
+
+    return &attributes[role];
+}
+
+ThreadPolicyError threadPolicyCreateThread(ThreadRole role, pthread_t* thread, void* (*startRoutine)(void*), void* argument)
+{
+    ThreadStart* start = NULL;
+    int result = 0;
+
+    if (role >= THREAD_ROLE_COUNT || thread == NULL || startRoutine == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TP_ERROR;
+    }
+
+    if (!policies[role].configured)
+    {
+        return pthread_create(thread, NULL, startRoutine, argument) ? TP_THREAD_ERROR : TP_NO_ERROR;
+    }
+
+    start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (start == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TP_ERROR;
+    }
+    start->role = role;
+    start->applyAll = false;
+    start->startRoutine = startRoutine;
+    start->argument = argument;
+
+    result = pthread_create(thread, &attributes[role], threadStart, start);
+    if (result == EPERM || result == EINVAL)
+    {
+        /* thread still runs, with whatever part of the policy it is allowed to set itself */
+        printf("\n%s : ERROR %s thread can not be created with its policy (%s)\n", __FUNCTION__, roleNames[role], strerror(result));
+        start->applyAll = true;
+        result = pthread_create(thread, NULL, threadStart, start);
+    }
+    if (result != 0)
+    {
+        printf("\n%s : ERROR pthread_create() failed\n", __FUNCTION__);
+        free(start);
+        return TP_THREAD_ERROR;
+    }
+
+    return TP_NO_ERROR;
+}
+
+ThreadPolicyError threadPolicyApplyOnce(ThreadRole role)
+{
+    if (role >= THREAD_ROLE_COUNT)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TP_ERROR;
+    }
+
+    if (appliedRoles & (1U << role))
+    {
+        return TP_NO_ERROR;
+    }
+    appliedRoles |= 1U << role;
+
+    if (!policies[role].configured)
+    {
+        return TP_NO_ERROR;
+    }
+
+    return applyPolicy(role, true);
+}
+
+void* probeStart(void* argument)
+{
+    return argument;
+}
+
+/**
+ * @brief Fills attributes of a role from its policy
+ */
+void setAttributes(ThreadRole role)
+{
+    const ThreadPolicy* policy = &policies[role];
+    struct sched_param parameter;
+    cpu_set_t cpuSet;
+
+    /* without explicit scheduling new threads would inherit the creator's, batch and idle are set by the thread itself */
+    pthread_attr_setinheritsched(&attributes[role], PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attributes[role], isRealTime(policy->schedulingClass) ? policy->schedulingClass : SCHED_OTHER);
+    parameter.sched_priority = isRealTime(policy->schedulingClass) ? policy->priority : 0;
+    pthread_attr_setschedparam(&attributes[role], &parameter);
+    if (policy->cpuMask != 0)
+    {
+        setCpus(policy->cpuMask, &cpuSet);
+        pthread_attr_setaffinity_np(&attributes[role], sizeof(cpuSet), &cpuSet);
+    }
+}
+
+void* threadStart(void* startArgument)
+{
+    ThreadStart start = *(ThreadStart*)startArgument;
+
+    free(startArgument);
+    applyPolicy(start.role, start.applyAll);
+
+    return start.startRoutine(start.argument);
+}
+
+/**
+ * @brief Applies policy to the calling thread, only what attributes can not carry unless applyAll is set
+ */
+ThreadPolicyError applyPolicy(ThreadRole role, bool applyAll)
+{
+    const ThreadPolicy* policy = &policies[role];
+    ThreadPolicyError result = TP_NO_ERROR;
+    struct sched_param parameter;
+    cpu_set_t cpuSet;
+    int error = 0;
+
+    if (applyAll || policy->schedulingClass == SCHED_BATCH || policy->schedulingClass == SCHED_IDLE)
+    {
+        parameter.sched_priority = isRealTime(policy->schedulingClass) ? policy->priority : 0;
+        error = pthread_setschedparam(pthread_self(), policy->schedulingClass, &parameter);
+        if (error != 0 && policy->schedulingClass != SCHED_OTHER)
+        {
+            printf("\n%s : ERROR %s thread stays in default class (%s)\n", __FUNCTION__, roleNames[role], strerror(error));
+            result = TP_ERROR;
+        }
+    }
+
+    if (applyAll)
+    {
+        if (policy->cpuMask != 0)
+        {
+            setCpus(policy->cpuMask, &cpuSet);
+            error = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+            if (error != 0)
+            {
+                printf("\n%s : ERROR %s thread runs on any CPU (%s)\n", __FUNCTION__, roleNames[role], strerror(error));
+                result = TP_ERROR;
+            }
+        }
+    }
+
+    /* nice value is per thread on Linux, it is set through the thread id */
+    if (!isRealTime(policy->schedulingClass) && policy->priority != 0
+        && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), policy->priority) < 0)
+    {
+        printf("\n%s : ERROR %s thread keeps default nice value (%s)\n", __FUNCTION__, roleNames[role], strerror(errno));
+        result = TP_ERROR;
+    }
+
+    return result;
+}
+
+bool isRealTime(int32_t schedulingClass)
+{
+    return schedulingClass == SCHED_FIFO || schedulingClass == SCHED_RR;
+}
+
+/* CPU list like "0,2-3", or "any" */
+ThreadPolicyError parseCpus(char* text, uint32_t* cpuMask)
+{
+    char* position = text;
+    long first = 0;
+    long last = 0;
+
+    *cpuMask = 0;
+    if (strcmp(text, "any") == 0 || text[0] == '\0')
+    {
+        return TP_NO_ERROR;
+    }
+
+    while (*position != '\0')
+    {
+        first = strtol(position, &position, 10);
+        last = first;
+        if (*position == '-')
+        {
+            last = strtol(position + 1, &position, 10);
+        }
+        if (first < 0 || last < first || last >= THREAD_POLICY_MAX_CPUS || (*position != ',' && *position != '\0'))
+        {
+            return TP_ERROR;
+        }
+        for (; first <= last; first++)
+        {
+            *cpuMask |= 1U << first;
+        }
+        if (*position == ',')
+        {
+            position++;
+        }
+    }
+
+    return TP_NO_ERROR;
+}
+
+void setCpus(uint32_t cpuMask, cpu_set_t* cpuSet)
+{
+    uint32_t cpu = 0;
+
+    CPU_ZERO(cpuSet);
+    for (cpu = 0; cpu < THREAD_POLICY_MAX_CPUS; cpu++)
+    {
+        if (cpuMask & (1U << cpu))
+        {
+            CPU_SET(cpu, cpuSet);
+        }
+    }
+}
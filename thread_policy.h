@@ -0,0 +1,104 @@
+#ifndef __THREAD_POLICY_H__
+#define __THREAD_POLICY_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+
+#define THREAD_POLICY_MAX_CPUS 32                   /* CPUs that can be named in a CPU set */
+
+/**
+ * @brief Enumeration of possible thread policy error codes
+ */
+typedef enum _ThreadPolicyError
+{
+    TP_NO_ERROR = 0,
+    TP_ERROR,
+    TP_THREAD_ERROR
+}ThreadPolicyError;
+
+/**
+ * @brief Enumeration of thread roles, every role has its own scheduling setup
+ */
+typedef enum _ThreadRole
+{
+    THREAD_ROLE_INPUT = 0,                          /* Remote controller input */
+    THREAD_ROLE_ZAP_CONTROL,                        /* Stream pipelines, player commands, channel number timer */
+    THREAD_ROLE_SECTIONS,                           /* Driver section and tuner callbacks, executor workers parsing sections */
+    THREAD_ROLE_RENDER,                             /* Render loop and screen timers */
+    THREAD_ROLE_BACKGROUND,                         /* Recording and serving of local readers */
+    THREAD_ROLE_COUNT
+}ThreadRole;
+
+/**
+ * @brief Structure that defines scheduling of one role
+ */
+typedef struct _ThreadPolicy
+{
+    bool configured;                                /* false keeps default scheduling of created threads */
+    int32_t schedulingClass;                        /* SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO or SCHED_RR */
+    int32_t priority;                               /* Real time priority for SCHED_FIFO and SCHED_RR, nice value otherwise */
+    uint32_t cpuMask;                               /* Bit per CPU threads may run on, 0 for any */
+}ThreadPolicy;
+
+/**
+ * @brief Parses policy written as class:priority:cpus, e.g. "fifo:50:0,1" or "other:-5:any"
+ *
+ * Class is one of other, batch, idle, fifo and rr. CPUs are a comma separated list of CPUs and ranges.
+ *
+ * @param [in] text - policy text
+ * @param [out] policy - parsed policy
+ * @return thread policy error code
+ */
+ThreadPolicyError threadPolicyParse(const char* text, ThreadPolicy* policy);
+
+/**
+ * @brief Sets scheduling of a role, threads of the role created afterwards use it
+ *
+ * Real time class that the system does not permit is replaced by the default class here,
+ * so attributes returned by threadPolicyGetAttributes can always create a thread.
+ *
+ * @param [in] role - thread role
+ * @param [in] policy - role scheduling
+ * @return thread policy error code
+ */
+ThreadPolicyError threadPolicyConfigure(ThreadRole role, const ThreadPolicy* policy);
+
+/**
+ * @brief Returns thread attributes of a role, for threads created by others such as SIGEV_THREAD timers
+ *
+ * Attributes carry real time class and priority and CPU set, batch and idle classes and nice value can not be set through them.
+ *
+ * @param [in] role - thread role
+ * @return attributes, NULL if role is not configured
+ */
+pthread_attr_t* threadPolicyGetAttributes(ThreadRole role);
+
+/**
+ * @brief Creates thread of a role, scheduled as configured from its first instruction on
+ *
+ * Thread is created with default scheduling and the error is printed when the system does not allow
+ * the configured one, e.g. real time class without CAP_SYS_NICE.
+ *
+ * @param [in] role - thread role
+ * @param [out] thread - created thread
+ * @param [in] startRoutine - thread function
+ * @param [in] argument - passed to startRoutine
+ * @return thread policy error code, TP_THREAD_ERROR if thread could not be created at all
+ */
+ThreadPolicyError threadPolicyCreateThread(ThreadRole role, pthread_t* thread, void* (*startRoutine)(void*), void* argument);
+
+/**
+ * @brief Applies scheduling of a role to the calling thread, once per thread
+ *
+ * Meant for threads the application does not create, such as driver callback threads.
+ *
+ * @param [in] role - thread role
+ * @return thread policy error code
+ */
+ThreadPolicyError threadPolicyApplyOnce(ThreadRole role);
+
+#endif /* __THREAD_POLICY_H__ */
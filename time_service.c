@@ -0,0 +1,173 @@
+#include "time_service.h"
+
+#define MJD_UNIX_EPOCH 40587                        /* MJD of 1970-01-01 */
+#define SECONDS_PER_DAY 86400
+
+/**
+ * @brief Structure that holds one anchor of broadcast time to the monotonic clock
+ */
+typedef struct _TimeAnchor
+{
+    int64_t utcSeconds;                             /* Broadcast UTC at the anchor */
+    uint64_t monotonicTime;                         /* CLOCK_MONOTONIC at the anchor in microseconds */
+    int32_t offsetSeconds;                          /* Local time offset */
+    bool valid;
+}TimeAnchor;
+
+/* anchor is written by the section thread only, readers retry while sequence is odd or changes */
+static volatile uint32_t anchorSequence = 0;
+static TimeAnchor anchor;
+
+static char countryCode[3];
+static uint8_t regionId = 0;
+static bool anyCountry = true;
+
+
+static void writeAnchor(int64_t utcSeconds, int32_t offsetSeconds)
+{
+    __sync_fetch_and_add(&anchorSequence, 1);
+    __sync_synchronize();
+
+    anchor.utcSeconds = utcSeconds;
+    anchor.monotonicTime = monotonicMicroseconds();
+    anchor.offsetSeconds = offsetSeconds;
+    anchor.valid = true;
+
+    __sync_synchronize();
+    __sync_fetch_and_add(&anchorSequence, 1);
+}
+
+static void readAnchor(TimeAnchor* copy)
+{
+    uint32_t sequence = 0;
+
+    do
+    {
+        sequence = anchorSequence;
+        __sync_synchronize();
+        *copy = anchor;
+        __sync_synchronize();
+    } while ((sequence & 1) || sequence != anchorSequence);
+}
+
+static int64_t utcFromBroadcastTime(uint16_t mjd, uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    return ((int64_t)mjd - MJD_UNIX_EPOCH) * SECONDS_PER_DAY + hours*3600 + minutes*60 + seconds;
+}
+
+TimeServiceError timeServiceInit(const char* country, uint8_t countryRegionId)
+{
+    anyCountry = (country == NULL || strlen(country) < 3);
+    if (!anyCountry)
+    {
+        memcpy(countryCode, country, 3);
+    }
+    regionId = countryRegionId;
+
+    memset(&anchor, 0x0, sizeof(TimeAnchor));
+    anchorSequence = 0;
+
+    return TS_NO_ERROR;
+}
+
+TimeServiceError timeServiceUpdateFromTdt(const TdtTable* tdtTable)
+{
+    TimeAnchor current;
+
+    if (tdtTable == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TS_ERROR;
+    }
+
+    /* TDT carries no offset, keep the one from the last TOT */
+    readAnchor(&current);
+    writeAnchor(utcFromBroadcastTime(tdtTable->MJD, tdtTable->hours, tdtTable->minutes, tdtTable->seconds), current.offsetSeconds);
+
+    return TS_NO_ERROR;
+}
+
+TimeServiceError timeServiceUpdateFromTot(const TotTable* totTable)
+{
+    const LTODescriptorInfo* matchingInfo = NULL;
+    int32_t offsetSeconds = 0;
+    uint8_t i = 0;
+    uint8_t j = 0;
+
+    if (totTable == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TS_ERROR;
+    }
+
+    for (i = 0; i < totTable->descriptorsCount && matchingInfo == NULL; i++)
+    {
+        for (j = 0; j < totTable->descriptors[i].numberOfInfos; j++)
+        {
+            const LTODescriptorInfo* info = &(totTable->descriptors[i].ltoInfo[j]);
+
+            if (anyCountry
+                || (info->countryCH1 == (uint8_t)countryCode[0] && info->countryCH2 == (uint8_t)countryCode[1]
+                    && info->countryCH3 == (uint8_t)countryCode[2] && info->countryRegionId == regionId))
+            {
+                matchingInfo = info;
+                break;
+            }
+        }
+    }
+
+    if (matchingInfo != NULL)
+    {
+        offsetSeconds = matchingInfo->localTimeOffsetHours*3600 + matchingInfo->localTimeOffsetMinutes*60;
+        if (matchingInfo->localTimeOffsetPolarity == 1)
+        {
+            offsetSeconds = -offsetSeconds;
+        }
+    }
+
+    writeAnchor(utcFromBroadcastTime(totTable->MJD, totTable->hours, totTable->minutes, totTable->seconds), offsetSeconds);
+
+    return TS_NO_ERROR;
+}
+
+TimeServiceError timeServiceGetLocalTime(LocalTime* localTime)
+{
+    TimeAnchor current;
+    int64_t utcSeconds = 0;
+    int64_t secondsOfDay = 0;
+
+    if (localTime == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TS_ERROR;
+    }
+
+    readAnchor(&current);
+    if (!current.valid)
+    {
+        return TS_TIME_NOT_AVAILABLE;
+    }
+
+    utcSeconds = current.utcSeconds + (int64_t)(monotonicMicroseconds() - current.monotonicTime) / 1000000;
+    secondsOfDay = (utcSeconds + current.offsetSeconds) % SECONDS_PER_DAY;
+    if (secondsOfDay < 0)
+    {
+        secondsOfDay += SECONDS_PER_DAY;
+    }
+
+    localTime->hours = secondsOfDay / 3600;
+    localTime->minutes = (secondsOfDay % 3600) / 60;
+    localTime->seconds = secondsOfDay % 60;
+    localTime->utcSeconds = (time_t)utcSeconds;
+
+    return TS_NO_ERROR;
+}
+
+uint64_t monotonicMicroseconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
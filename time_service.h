@@ -0,0 +1,72 @@
+#ifndef __TIME_SERVICE_H__
+#define __TIME_SERVICE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "tables.h"
+
+/**
+ * @brief Enumeration of possible time service error codes
+ */
+typedef enum _TimeServiceError
+{
+    TS_NO_ERROR = 0,
+    TS_ERROR,
+    TS_TIME_NOT_AVAILABLE
+}TimeServiceError;
+
+/**
+ * @brief Structure that defines broken down local time
+ */
+typedef struct _LocalTime
+{
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t seconds;
+    time_t utcSeconds;                              /* Current UTC as seconds since the epoch */
+}LocalTime;
+
+/**
+ * @brief Initializes time service
+ *
+ * @param [in] country - ISO 3166 country code whose local time offset is applied, NULL or "" takes the first one
+ * @param [in] countryRegionId - region inside the country, 0 for the whole country
+ * @return time service error code
+ */
+TimeServiceError timeServiceInit(const char* country, uint8_t countryRegionId);
+
+/**
+ * @brief Anchors broadcast UTC to the monotonic clock
+ *
+ * @param [in] tdtTable - parsed TDT table
+ * @return time service error code
+ */
+TimeServiceError timeServiceUpdateFromTdt(const TdtTable* tdtTable);
+
+/**
+ * @brief Anchors broadcast UTC and takes local time offset of the configured country and region
+ *
+ * @param [in] totTable - parsed TOT table
+ * @return time service error code
+ */
+TimeServiceError timeServiceUpdateFromTot(const TotTable* totTable);
+
+/**
+ * @brief Returns current local time extrapolated from the last anchor, never blocks
+ *
+ * @param [out] localTime - current local time
+ * @return time service error code, TS_TIME_NOT_AVAILABLE before first TDT/TOT
+ */
+TimeServiceError timeServiceGetLocalTime(LocalTime* localTime);
+
+/**
+ * @brief Returns CLOCK_MONOTONIC time, works without timeServiceInit
+ *
+ * @return monotonic time in microseconds
+ */
+uint64_t monotonicMicroseconds();
+
+#endif /* __TIME_SERVICE_H__ */
@@ -0,0 +1,853 @@
+#define _GNU_SOURCE                                 /* O_DIRECT */
+#include "timeshift_buffer.h"
+#include "thread_policy.h"
+#include "time_service.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+
+#define TIMESHIFT_NUMBER_OF_PIDS 8192
+#define TIMESHIFT_PAGE_SIZE 4096                    /* Alignment of O_DIRECT buffers, offsets and lengths */
+#define TIMESHIFT_NO_SEEK UINT64_MAX
+#define TIMESHIFT_IDLE_WAIT 10000                   /* Microseconds playback waits for data to reach the disk */
+#define TIMESHIFT_MAX_PACING_WAIT 20000             /* Longest playback sleep, so control requests are seen in time */
+#define TIMESHIFT_PROGRAM_SET (1ULL << 48)          /* Marks indexed program request, PIDs and stream type are packed below */
+#define TIMESHIFT_PCR_TICKS_PER_SECOND 90000
+
+/* positions are byte counts of recorded stream, one thread writes each of them, others load without locking */
+#define TIMESHIFT_LOAD(value) __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+#define TIMESHIFT_STORE(value, newValue) __atomic_store_n(&(value), (newValue), __ATOMIC_RELEASE)
+#define TIMESHIFT_INCREMENT(counter) __atomic_store_n(&(counter), (counter) + 1, __ATOMIC_RELAXED)
+
+/**
+ * @brief Structure that holds one block of recorded packets waiting for the writer thread
+ */
+typedef struct _StagingBlock
+{
+    uint8_t* data;                                  /* TIMESHIFT_BLOCK_SIZE bytes, page aligned */
+    uint64_t firstArrivalTime;                      /* Arrival time of the first packet in the block */
+}StagingBlock;
+
+struct _TimeshiftBuffer
+{
+    char fileName[256];
+    int fileDescriptor;
+    uint64_t size;
+    uint32_t numberOfBlocks;
+    uint64_t* blockTimes;                           /* Arrival time of the first packet of every ring file block */
+    bool directIo;
+    char indexFileName[260];
+    TsIndexWriter* indexWriter;                     /* Used by writer thread, NULL if index could not be created */
+    TsIndex* index;                                 /* Used under controlMutex */
+    uint64_t indexProgram;                          /* Program requested for the index, applied by writer thread */
+
+    uint32_t pidMap[TIMESHIFT_NUMBER_OF_PIDS / 32];
+
+    /* ingestion thread */
+    StagingBlock staging[TIMESHIFT_STAGING_BLOCKS];
+    uint32_t stagingTail;                           /* Number of blocks filled, published to writer thread */
+    uint32_t stagingFill;                           /* Bytes in block being filled */
+    uint8_t carry[TS_PACKET_SIZE];           /* Packet split between two chunks */
+    uint32_t carryLength;
+    bool inSync;
+    uint64_t recordedPosition;
+    uint64_t lastArrivalTime;
+
+    /* writer thread */
+    uint32_t stagingHead;                           /* Number of blocks written, published to ingestion thread */
+    uint64_t writtenPosition;                       /* Bytes on disk, playback never reads past it */
+    uint64_t overwriteEnd;                          /* End of block being written, older data than overwriteEnd - size is gone */
+
+    /* playback thread */
+    uint64_t readPosition;
+    uint8_t* playbackData;                          /* Page aligned, holds the pages around TIMESHIFT_PLAYBACK_PACKETS */
+    TimeshiftPacketCallback playbackCallback;
+    void* userData;
+
+    /* control, serialized by controlMutex and read by playback thread without locking */
+    pthread_mutex_t controlMutex;
+    TimeshiftState state;
+    uint64_t seekRequest;                           /* Position playback has to continue from, TIMESHIFT_NO_SEEK if none */
+
+    TimeshiftStatistics statistics;
+
+    pthread_t writerThread;
+    pthread_t playbackThread;
+    sem_t writerSemaphore;
+    sem_t playbackSemaphore;
+    bool threadExit;
+};
+
+
+static void* writerTask(void* bufferArgument);
+static void* playbackTask(void* bufferArgument);
+static void recordPacket(TimeshiftBuffer* timeshiftBuffer, const uint8_t* packet, uint64_t arrivalTime);
+static void writeBlock(TimeshiftBuffer* timeshiftBuffer, const StagingBlock* block, uint64_t position);
+static const uint8_t* readPackets(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint32_t length);
+static uint64_t oldestPosition(TimeshiftBuffer* timeshiftBuffer);
+static uint64_t positionTime(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint64_t writtenPosition);
+static uint64_t findPosition(TimeshiftBuffer* timeshiftBuffer, uint64_t targetTime);
+static void waitForControl(TimeshiftBuffer* timeshiftBuffer, uint64_t microseconds);
+static uint64_t findRandomAccessPosition(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint64_t writtenPosition, int32_t seconds);
+static void freeBuffer(TimeshiftBuffer* timeshiftBuffer);
+
+
+TimeshiftBufferError timeshiftBufferCreate(const char* fileName, uint64_t size, TimeshiftPacketCallback playbackCallback, void* userData,
+    TimeshiftBuffer** timeshiftBuffer)
+{
+    TimeshiftBuffer* newBuffer = NULL;
+    uint8_t i = 0;
+
+    if (fileName == NULL || timeshiftBuffer == NULL || size / TIMESHIFT_BLOCK_SIZE < TIMESHIFT_MIN_BLOCKS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    newBuffer = (TimeshiftBuffer*)malloc(sizeof(TimeshiftBuffer));
+    if (newBuffer == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+    memset(newBuffer, 0x0, sizeof(TimeshiftBuffer));
+
+    strncpy(newBuffer->fileName, fileName, sizeof(newBuffer->fileName) - 1);
+    newBuffer->fileDescriptor = -1;
+    newBuffer->numberOfBlocks = size / TIMESHIFT_BLOCK_SIZE;
+    newBuffer->size = (uint64_t)newBuffer->numberOfBlocks * TIMESHIFT_BLOCK_SIZE;
+    newBuffer->playbackCallback = playbackCallback;
+    newBuffer->userData = userData;
+    newBuffer->state = TIMESHIFT_LIVE;
+    newBuffer->seekRequest = TIMESHIFT_NO_SEEK;
+    newBuffer->inSync = true;
+    pthread_mutex_init(&newBuffer->controlMutex, NULL);
+    sem_init(&newBuffer->writerSemaphore, 0, 0);
+    sem_init(&newBuffer->playbackSemaphore, 0, 0);
+
+    /* reads are widened to whole pages, which adds at most one page on each side */
+    newBuffer->blockTimes = (uint64_t*)calloc(newBuffer->numberOfBlocks, sizeof(uint64_t));
+    if (newBuffer->blockTimes == NULL || posix_memalign((void**)&newBuffer->playbackData, TIMESHIFT_PAGE_SIZE,
+        TIMESHIFT_PLAYBACK_PACKETS * TS_PACKET_SIZE + 2 * TIMESHIFT_PAGE_SIZE))
+    {
+        newBuffer->playbackData = NULL;
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        freeBuffer(newBuffer);
+        return TB_ERROR;
+    }
+
+    for (i = 0; i < TIMESHIFT_STAGING_BLOCKS; i++)
+    {
+        if (posix_memalign((void**)&newBuffer->staging[i].data, TIMESHIFT_PAGE_SIZE, TIMESHIFT_BLOCK_SIZE))
+        {
+            printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+            newBuffer->staging[i].data = NULL;
+            freeBuffer(newBuffer);
+            return TB_ERROR;
+        }
+    }
+
+    /* ring file bypasses page cache where the file system allows it, so it does not evict what live path needs,
+     * reads then have to be O_DIRECT too, mapped or cached pages of the file would be invalidated on every write */
+    newBuffer->fileDescriptor = open(newBuffer->fileName, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    newBuffer->directIo = (newBuffer->fileDescriptor >= 0);
+    if (newBuffer->fileDescriptor < 0)
+    {
+        newBuffer->fileDescriptor = open(newBuffer->fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (newBuffer->fileDescriptor < 0)
+    {
+        printf("\n%s : ERROR Cannot open %s\n", __FUNCTION__, newBuffer->fileName);
+        freeBuffer(newBuffer);
+        return TB_ERROR;
+    }
+
+    if (ftruncate(newBuffer->fileDescriptor, newBuffer->size))
+    {
+        printf("\n%s : ERROR Cannot resize %s\n", __FUNCTION__, newBuffer->fileName);
+        freeBuffer(newBuffer);
+        return TB_ERROR;
+    }
+
+    /* seeks work without index, only less precisely */
+    snprintf(newBuffer->indexFileName, sizeof(newBuffer->indexFileName), "%s.idx", newBuffer->fileName);
+    if (tsIndexWriterCreate(newBuffer->indexFileName, &newBuffer->indexWriter) == TI_NO_ERROR
+        && tsIndexOpen(newBuffer->indexFileName, &newBuffer->index) != TI_NO_ERROR)
+    {
+        newBuffer->index = NULL;
+    }
+
+    /* recording only has to keep up with the stream, playback feeds the player and keeps default scheduling */
+    if (threadPolicyCreateThread(THREAD_ROLE_BACKGROUND, &newBuffer->writerThread, &writerTask, newBuffer))
+    {
+        printf("\n%s : ERROR creating writer task\n", __FUNCTION__);
+        freeBuffer(newBuffer);
+        return TB_THREAD_ERROR;
+    }
+
+    if (pthread_create(&newBuffer->playbackThread, NULL, &playbackTask, newBuffer))
+    {
+        printf("\n%s : ERROR creating playback task\n", __FUNCTION__);
+        TIMESHIFT_STORE(newBuffer->threadExit, true);
+        sem_post(&newBuffer->writerSemaphore);
+        pthread_join(newBuffer->writerThread, NULL);
+        freeBuffer(newBuffer);
+        return TB_THREAD_ERROR;
+    }
+
+    *timeshiftBuffer = newBuffer;
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferDestroy(TimeshiftBuffer* timeshiftBuffer)
+{
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    TIMESHIFT_STORE(timeshiftBuffer->threadExit, true);
+    sem_post(&timeshiftBuffer->writerSemaphore);
+    sem_post(&timeshiftBuffer->playbackSemaphore);
+
+    if (pthread_join(timeshiftBuffer->writerThread, NULL) || pthread_join(timeshiftBuffer->playbackThread, NULL))
+    {
+        printf("\n%s : ERROR pthread_join fail!\n", __FUNCTION__);
+        return TB_THREAD_ERROR;
+    }
+
+    freeBuffer(timeshiftBuffer);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferSetPids(TimeshiftBuffer* timeshiftBuffer, const uint16_t* pids, uint8_t numberOfPids)
+{
+    uint32_t pidMap[TIMESHIFT_NUMBER_OF_PIDS / 32];
+    uint32_t i = 0;
+
+    if (timeshiftBuffer == NULL || (pids == NULL && numberOfPids != 0) || numberOfPids > TIMESHIFT_MAX_PIDS)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    memset(pidMap, 0x0, sizeof(pidMap));
+    for (i = 0; i < numberOfPids; i++)
+    {
+        pidMap[(pids[i] & 0x1FFF) >> 5] |= 1u << (pids[i] & 0x1F);
+    }
+
+    /* ingestion may see a mix of old and new set for a few packets, which only matters at a channel change */
+    for (i = 0; i < TIMESHIFT_NUMBER_OF_PIDS / 32; i++)
+    {
+        if (__atomic_load_n(&timeshiftBuffer->pidMap[i], __ATOMIC_RELAXED) != pidMap[i])
+        {
+            __atomic_store_n(&timeshiftBuffer->pidMap[i], pidMap[i], __ATOMIC_RELAXED);
+        }
+    }
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferSetProgram(TimeshiftBuffer* timeshiftBuffer, uint16_t pcrPid, uint16_t videoPid, uint8_t videoStreamType)
+{
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    TIMESHIFT_STORE(timeshiftBuffer->indexProgram, TIMESHIFT_PROGRAM_SET | ((uint64_t)videoStreamType << 32)
+        | ((uint64_t)pcrPid << 16) | videoPid);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferWrite(TimeshiftBuffer* timeshiftBuffer, const uint8_t* data, uint32_t length, uint64_t arrivalTime)
+{
+    const uint8_t* syncByte = NULL;
+    uint32_t offset = 0;
+    uint32_t copyLength = 0;
+
+    if (timeshiftBuffer == NULL || (data == NULL && length != 0))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    /* complete packet split at the end of previous chunk */
+    if (timeshiftBuffer->carryLength > 0)
+    {
+        copyLength = TS_PACKET_SIZE - timeshiftBuffer->carryLength;
+        copyLength = (copyLength < length) ? copyLength : length;
+        memcpy(timeshiftBuffer->carry + timeshiftBuffer->carryLength, data, copyLength);
+        timeshiftBuffer->carryLength += copyLength;
+        offset = copyLength;
+
+        if (timeshiftBuffer->carryLength < TS_PACKET_SIZE)
+        {
+            return TB_NO_ERROR;
+        }
+        recordPacket(timeshiftBuffer, timeshiftBuffer->carry, arrivalTime);
+        timeshiftBuffer->carryLength = 0;
+    }
+
+    while (offset < length)
+    {
+        if (data[offset] != TS_SYNC_BYTE)
+        {
+            if (timeshiftBuffer->inSync)
+            {
+                TIMESHIFT_INCREMENT(timeshiftBuffer->statistics.syncLosses);
+                timeshiftBuffer->inSync = false;
+            }
+            syncByte = (const uint8_t*)memchr(data + offset, TS_SYNC_BYTE, length - offset);
+            if (syncByte == NULL)
+            {
+                break;
+            }
+            offset = syncByte - data;
+            continue;
+        }
+
+        if (length - offset < TS_PACKET_SIZE)
+        {
+            memcpy(timeshiftBuffer->carry, data + offset, length - offset);
+            timeshiftBuffer->carryLength = length - offset;
+            break;
+        }
+
+        timeshiftBuffer->inSync = true;
+        recordPacket(timeshiftBuffer, data + offset, arrivalTime);
+        offset += TS_PACKET_SIZE;
+    }
+
+    TIMESHIFT_STORE(timeshiftBuffer->lastArrivalTime, arrivalTime);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferPause(TimeshiftBuffer* timeshiftBuffer)
+{
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    pthread_mutex_lock(&timeshiftBuffer->controlMutex);
+    if (timeshiftBuffer->state == TIMESHIFT_LIVE)
+    {
+        TIMESHIFT_STORE(timeshiftBuffer->seekRequest, TIMESHIFT_LOAD(timeshiftBuffer->recordedPosition));
+    }
+    TIMESHIFT_STORE(timeshiftBuffer->state, TIMESHIFT_PAUSED);
+    pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+
+    sem_post(&timeshiftBuffer->playbackSemaphore);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferResume(TimeshiftBuffer* timeshiftBuffer)
+{
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    pthread_mutex_lock(&timeshiftBuffer->controlMutex);
+    if (timeshiftBuffer->state == TIMESHIFT_LIVE)
+    {
+        pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+        return TB_ERROR;
+    }
+    TIMESHIFT_STORE(timeshiftBuffer->state, TIMESHIFT_PLAYING);
+    pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+
+    sem_post(&timeshiftBuffer->playbackSemaphore);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferSeek(TimeshiftBuffer* timeshiftBuffer, int32_t seconds)
+{
+    uint64_t writtenPosition = 0;
+    uint64_t position = 0;
+    uint64_t baseTime = 0;
+    int64_t targetTime = 0;
+
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    pthread_mutex_lock(&timeshiftBuffer->controlMutex);
+    writtenPosition = TIMESHIFT_LOAD(timeshiftBuffer->writtenPosition);
+    if (writtenPosition == 0)
+    {
+        /* nothing reached the disk yet */
+        pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+        return TB_ERROR;
+    }
+
+    /* seek is relative to what the viewer sees */
+    position = TIMESHIFT_LOAD(timeshiftBuffer->seekRequest);
+    if (position == TIMESHIFT_NO_SEEK)
+    {
+        position = TIMESHIFT_LOAD(timeshiftBuffer->readPosition);
+    }
+    if (timeshiftBuffer->state == TIMESHIFT_LIVE || position >= writtenPosition)
+    {
+        baseTime = TIMESHIFT_LOAD(timeshiftBuffer->lastArrivalTime);
+    }
+    else
+    {
+        baseTime = positionTime(timeshiftBuffer, position, writtenPosition);
+    }
+    targetTime = (int64_t)baseTime + (int64_t)seconds * 1000000;
+
+    if (targetTime >= (int64_t)TIMESHIFT_LOAD(timeshiftBuffer->lastArrivalTime))
+    {
+        TIMESHIFT_STORE(timeshiftBuffer->seekRequest, TIMESHIFT_NO_SEEK);
+        TIMESHIFT_STORE(timeshiftBuffer->state, TIMESHIFT_LIVE);
+    }
+    else
+    {
+        position = findRandomAccessPosition(timeshiftBuffer, (timeshiftBuffer->state == TIMESHIFT_LIVE) ? writtenPosition : position,
+            writtenPosition, seconds);
+        if (position == TIMESHIFT_NO_SEEK)
+        {
+            position = findPosition(timeshiftBuffer, (targetTime > 0) ? targetTime : 0);
+        }
+        TIMESHIFT_STORE(timeshiftBuffer->seekRequest, position);
+        if (timeshiftBuffer->state == TIMESHIFT_LIVE)
+        {
+            TIMESHIFT_STORE(timeshiftBuffer->state, TIMESHIFT_PLAYING);
+        }
+    }
+    pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+
+    sem_post(&timeshiftBuffer->playbackSemaphore);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferGoLive(TimeshiftBuffer* timeshiftBuffer)
+{
+    if (timeshiftBuffer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    pthread_mutex_lock(&timeshiftBuffer->controlMutex);
+    TIMESHIFT_STORE(timeshiftBuffer->seekRequest, TIMESHIFT_NO_SEEK);
+    TIMESHIFT_STORE(timeshiftBuffer->state, TIMESHIFT_LIVE);
+    pthread_mutex_unlock(&timeshiftBuffer->controlMutex);
+
+    sem_post(&timeshiftBuffer->playbackSemaphore);
+
+    return TB_NO_ERROR;
+}
+
+TimeshiftBufferError timeshiftBufferGetStatistics(TimeshiftBuffer* timeshiftBuffer, TimeshiftStatistics* statistics)
+{
+    uint64_t writtenPosition = 0;
+    uint64_t readPosition = 0;
+    uint64_t lastArrivalTime = 0;
+    uint64_t readTime = 0;
+
+    if (timeshiftBuffer == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TB_ERROR;
+    }
+
+    writtenPosition = TIMESHIFT_LOAD(timeshiftBuffer->writtenPosition);
+    readPosition = TIMESHIFT_LOAD(timeshiftBuffer->readPosition);
+    lastArrivalTime = TIMESHIFT_LOAD(timeshiftBuffer->lastArrivalTime);
+
+    memset(statistics, 0x0, sizeof(TimeshiftStatistics));
+    statistics->state = TIMESHIFT_LOAD(timeshiftBuffer->state);
+    statistics->recordedBytes = TIMESHIFT_LOAD(timeshiftBuffer->recordedPosition);
+    statistics->writtenBytes = writtenPosition;
+    statistics->readPosition = readPosition;
+    statistics->oldestPosition = oldestPosition(timeshiftBuffer);
+    statistics->droppedPackets = TIMESHIFT_LOAD(timeshiftBuffer->statistics.droppedPackets);
+    statistics->syncLosses = TIMESHIFT_LOAD(timeshiftBuffer->statistics.syncLosses);
+    statistics->overruns = TIMESHIFT_LOAD(timeshiftBuffer->statistics.overruns);
+    statistics->writeErrors = TIMESHIFT_LOAD(timeshiftBuffer->statistics.writeErrors);
+    statistics->readErrors = TIMESHIFT_LOAD(timeshiftBuffer->statistics.readErrors);
+    statistics->directIo = TIMESHIFT_LOAD(timeshiftBuffer->directIo);
+
+    if (statistics->state != TIMESHIFT_LIVE && readPosition < writtenPosition)
+    {
+        readTime = positionTime(timeshiftBuffer, readPosition, writtenPosition);
+        statistics->delay = (lastArrivalTime > readTime) ? (uint32_t)((lastArrivalTime - readTime) / 1000) : 0;
+    }
+
+    return TB_NO_ERROR;
+}
+
+/* Called on ingestion thread, copies packet into block being filled and hands full blocks to the writer */
+void recordPacket(TimeshiftBuffer* timeshiftBuffer, const uint8_t* packet, uint64_t arrivalTime)
+{
+    StagingBlock* block = NULL;
+    uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+
+    if (!(__atomic_load_n(&timeshiftBuffer->pidMap[pid >> 5], __ATOMIC_RELAXED) & (1u << (pid & 0x1F))))
+    {
+        return;
+    }
+
+    block = &timeshiftBuffer->staging[timeshiftBuffer->stagingTail % TIMESHIFT_STAGING_BLOCKS];
+    if (timeshiftBuffer->stagingFill == 0)
+    {
+        /* disk fell behind, live path must not wait for it */
+        if (timeshiftBuffer->stagingTail - TIMESHIFT_LOAD(timeshiftBuffer->stagingHead) == TIMESHIFT_STAGING_BLOCKS)
+        {
+            TIMESHIFT_INCREMENT(timeshiftBuffer->statistics.droppedPackets);
+            return;
+        }
+        block->firstArrivalTime = arrivalTime;
+    }
+
+    memcpy(block->data + timeshiftBuffer->stagingFill, packet, TS_PACKET_SIZE);
+    timeshiftBuffer->stagingFill += TS_PACKET_SIZE;
+    TIMESHIFT_STORE(timeshiftBuffer->recordedPosition, timeshiftBuffer->recordedPosition + TS_PACKET_SIZE);
+
+    if (timeshiftBuffer->stagingFill == TIMESHIFT_BLOCK_SIZE)
+    {
+        timeshiftBuffer->stagingFill = 0;
+        TIMESHIFT_STORE(timeshiftBuffer->stagingTail, timeshiftBuffer->stagingTail + 1);
+        sem_post(&timeshiftBuffer->writerSemaphore);
+    }
+}
+
+void* writerTask(void* bufferArgument)
+{
+    TimeshiftBuffer* timeshiftBuffer = (TimeshiftBuffer*)bufferArgument;
+    StagingBlock* block = NULL;
+    uint64_t indexProgram = 0;
+
+    while (true)
+    {
+        sem_wait(&timeshiftBuffer->writerSemaphore);
+        if (TIMESHIFT_LOAD(timeshiftBuffer->threadExit))
+        {
+            break;
+        }
+
+        while (timeshiftBuffer->stagingHead != TIMESHIFT_LOAD(timeshiftBuffer->stagingTail))
+        {
+            block = &timeshiftBuffer->staging[timeshiftBuffer->stagingHead % TIMESHIFT_STAGING_BLOCKS];
+            writeBlock(timeshiftBuffer, block, timeshiftBuffer->writtenPosition);
+
+            /* indexed after the block is on disk, so index never points to data that can not be read */
+            if (timeshiftBuffer->indexWriter != NULL)
+            {
+                indexProgram = __atomic_exchange_n(&timeshiftBuffer->indexProgram, 0, __ATOMIC_ACQ_REL);
+                if (indexProgram & TIMESHIFT_PROGRAM_SET)
+                {
+                    tsIndexWriterSetProgram(timeshiftBuffer->indexWriter, (indexProgram >> 16) & 0xFFFF, indexProgram & 0xFFFF,
+                        (indexProgram >> 32) & 0xFF);
+                }
+                tsIndexWriterProcess(timeshiftBuffer->indexWriter, block->data, TIMESHIFT_BLOCK_SIZE,
+                    timeshiftBuffer->writtenPosition - TIMESHIFT_BLOCK_SIZE);
+                tsIndexWriterFlush(timeshiftBuffer->indexWriter);
+            }
+            TIMESHIFT_STORE(timeshiftBuffer->stagingHead, timeshiftBuffer->stagingHead + 1);
+        }
+    }
+
+    return NULL;
+}
+
+/* Called on writer thread, ring file size is a multiple of block size so a block never wraps */
+void writeBlock(TimeshiftBuffer* timeshiftBuffer, const StagingBlock* block, uint64_t position)
+{
+    uint32_t blockIndex = (position / TIMESHIFT_BLOCK_SIZE) % timeshiftBuffer->numberOfBlocks;
+    off_t fileOffset = (off_t)blockIndex * TIMESHIFT_BLOCK_SIZE;
+    ssize_t written = 0;
+
+    /* playback checks this after copying, so it notices data that changed under it */
+    __atomic_store_n(&timeshiftBuffer->overwriteEnd, position + TIMESHIFT_BLOCK_SIZE, __ATOMIC_SEQ_CST);
+
+    written = pwrite(timeshiftBuffer->fileDescriptor, block->data, TIMESHIFT_BLOCK_SIZE, fileOffset);
+    if (written != TIMESHIFT_BLOCK_SIZE && timeshiftBuffer->directIo && errno == EINVAL)
+    {
+        /* file system accepted O_DIRECT at open but not at write */
+        fcntl(timeshiftBuffer->fileDescriptor, F_SETFL, fcntl(timeshiftBuffer->fileDescriptor, F_GETFL) & ~O_DIRECT);
+        TIMESHIFT_STORE(timeshiftBuffer->directIo, false);
+        written = pwrite(timeshiftBuffer->fileDescriptor, block->data, TIMESHIFT_BLOCK_SIZE, fileOffset);
+    }
+    if (written != TIMESHIFT_BLOCK_SIZE)
+    {
+        printf("\n%s : ERROR pwrite() fail\n", __FUNCTION__);
+        TIMESHIFT_INCREMENT(timeshiftBuffer->statistics.writeErrors);
+    }
+
+    timeshiftBuffer->blockTimes[blockIndex] = block->firstArrivalTime;
+    TIMESHIFT_STORE(timeshiftBuffer->writtenPosition, position + TIMESHIFT_BLOCK_SIZE);
+}
+
+void* playbackTask(void* bufferArgument)
+{
+    TimeshiftBuffer* timeshiftBuffer = (TimeshiftBuffer*)bufferArgument;
+    uint64_t readPosition = 0;
+    uint64_t writtenPosition = 0;
+    uint64_t seekPosition = 0;
+    uint64_t anchorTime = 0;
+    uint64_t anchorStreamTime = 0;
+    uint64_t streamTime = 0;
+    uint64_t now = 0;
+    uint64_t dueTime = 0;
+    const uint8_t* packets = NULL;
+    uint32_t length = 0;
+    bool anchored = false;
+
+    while (!TIMESHIFT_LOAD(timeshiftBuffer->threadExit))
+    {
+        seekPosition = __atomic_exchange_n(&timeshiftBuffer->seekRequest, TIMESHIFT_NO_SEEK, __ATOMIC_ACQ_REL);
+        if (seekPosition != TIMESHIFT_NO_SEEK)
+        {
+            readPosition = seekPosition;
+            TIMESHIFT_STORE(timeshiftBuffer->readPosition, readPosition);
+            anchored = false;
+        }
+
+        if (TIMESHIFT_LOAD(timeshiftBuffer->state) != TIMESHIFT_PLAYING)
+        {
+            sem_wait(&timeshiftBuffer->playbackSemaphore);
+            anchored = false;
+            continue;
+        }
+
+        writtenPosition = TIMESHIFT_LOAD(timeshiftBuffer->writtenPosition);
+        if (readPosition >= writtenPosition)
+        {
+            waitForControl(timeshiftBuffer, TIMESHIFT_IDLE_WAIT);
+            continue;
+        }
+
+        if (readPosition < oldestPosition(timeshiftBuffer))
+        {
+            TIMESHIFT_INCREMENT(timeshiftBuffer->statistics.overruns);
+            readPosition = oldestPosition(timeshiftBuffer) + TIMESHIFT_BLOCK_SIZE;
+            TIMESHIFT_STORE(timeshiftBuffer->readPosition, readPosition);
+            anchored = false;
+            continue;
+        }
+
+        /* hand packets over in the pace they were recorded */
+        streamTime = positionTime(timeshiftBuffer, readPosition, writtenPosition);
+        now = monotonicMicroseconds();
+        if (!anchored)
+        {
+            anchorTime = now;
+            anchorStreamTime = streamTime;
+            anchored = true;
+        }
+        dueTime = anchorTime + ((streamTime > anchorStreamTime) ? streamTime - anchorStreamTime : 0);
+        if (dueTime > now)
+        {
+            waitForControl(timeshiftBuffer, (dueTime - now < TIMESHIFT_MAX_PACING_WAIT) ? dueTime - now : TIMESHIFT_MAX_PACING_WAIT);
+            continue;
+        }
+
+        length = TIMESHIFT_PLAYBACK_PACKETS * TS_PACKET_SIZE;
+        if (length > writtenPosition - readPosition)
+        {
+            length = writtenPosition - readPosition;
+        }
+        if (length > TIMESHIFT_BLOCK_SIZE - readPosition % TIMESHIFT_BLOCK_SIZE)
+        {
+            length = TIMESHIFT_BLOCK_SIZE - readPosition % TIMESHIFT_BLOCK_SIZE;
+        }
+
+        packets = readPackets(timeshiftBuffer, readPosition, length);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (readPosition < oldestPosition(timeshiftBuffer))
+        {
+            /* block was overwritten while it was read, next pass jumps forward */
+            continue;
+        }
+        if (packets == NULL)
+        {
+            waitForControl(timeshiftBuffer, TIMESHIFT_IDLE_WAIT);
+            continue;
+        }
+
+        if (timeshiftBuffer->playbackCallback != NULL)
+        {
+            timeshiftBuffer->playbackCallback(packets, length, timeshiftBuffer->userData);
+        }
+        readPosition += length;
+        TIMESHIFT_STORE(timeshiftBuffer->readPosition, readPosition);
+    }
+
+    return NULL;
+}
+
+/* Called on playback thread, reads whole pages around the packets so the same read works with and without O_DIRECT
+ * Block size is a multiple of page size and length never crosses a block, so the pages never wrap around the file
+ */
+const uint8_t* readPackets(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint32_t length)
+{
+    off_t fileOffset = (off_t)(position % timeshiftBuffer->size);
+    off_t alignedOffset = fileOffset & ~((off_t)TIMESHIFT_PAGE_SIZE - 1);
+    size_t alignedLength = ((size_t)(fileOffset - alignedOffset) + length + TIMESHIFT_PAGE_SIZE - 1) & ~((size_t)TIMESHIFT_PAGE_SIZE - 1);
+
+    if (pread(timeshiftBuffer->fileDescriptor, timeshiftBuffer->playbackData, alignedLength, alignedOffset) != (ssize_t)alignedLength)
+    {
+        printf("\n%s : ERROR pread() fail\n", __FUNCTION__);
+        TIMESHIFT_INCREMENT(timeshiftBuffer->statistics.readErrors);
+        return NULL;
+    }
+
+    return timeshiftBuffer->playbackData + (fileOffset - alignedOffset);
+}
+
+/* Oldest position whose block is not being overwritten */
+uint64_t oldestPosition(TimeshiftBuffer* timeshiftBuffer)
+{
+    uint64_t overwriteEnd = __atomic_load_n(&timeshiftBuffer->overwriteEnd, __ATOMIC_SEQ_CST);
+
+    return (overwriteEnd > timeshiftBuffer->size) ? overwriteEnd - timeshiftBuffer->size : 0;
+}
+
+/* Recording time of position below writtenPosition, interpolated between arrival times of neighbouring blocks */
+uint64_t positionTime(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint64_t writtenPosition)
+{
+    uint64_t block = position / TIMESHIFT_BLOCK_SIZE;
+    uint64_t startTime = timeshiftBuffer->blockTimes[block % timeshiftBuffer->numberOfBlocks];
+    uint64_t endTime = 0;
+
+    if ((block + 1) * TIMESHIFT_BLOCK_SIZE < writtenPosition)
+    {
+        endTime = timeshiftBuffer->blockTimes[(block + 1) % timeshiftBuffer->numberOfBlocks];
+    }
+    else if (block > 0 && block * TIMESHIFT_BLOCK_SIZE > oldestPosition(timeshiftBuffer))
+    {
+        /* newest block, assume it lasts as long as the one before */
+        endTime = 2 * startTime - timeshiftBuffer->blockTimes[(block - 1) % timeshiftBuffer->numberOfBlocks];
+    }
+
+    if (endTime <= startTime)
+    {
+        return startTime;
+    }
+
+    return startTime + (endTime - startTime) * (position % TIMESHIFT_BLOCK_SIZE) / TIMESHIFT_BLOCK_SIZE;
+}
+
+/* Start of the last recorded block that began before targetTime, block times grow with position */
+uint64_t findPosition(TimeshiftBuffer* timeshiftBuffer, uint64_t targetTime)
+{
+    uint64_t writtenPosition = TIMESHIFT_LOAD(timeshiftBuffer->writtenPosition);
+    uint64_t firstBlock = oldestPosition(timeshiftBuffer) / TIMESHIFT_BLOCK_SIZE;
+    uint64_t lastBlock = writtenPosition / TIMESHIFT_BLOCK_SIZE - 1;
+    uint64_t middleBlock = 0;
+
+    /* oldest block can be overwritten at any moment, playback would jump right away */
+    if (oldestPosition(timeshiftBuffer) > 0 && firstBlock < lastBlock)
+    {
+        firstBlock++;
+    }
+
+    while (firstBlock < lastBlock)
+    {
+        middleBlock = firstBlock + (lastBlock - firstBlock + 1) / 2;
+        if (timeshiftBuffer->blockTimes[middleBlock % timeshiftBuffer->numberOfBlocks] <= targetTime)
+        {
+            firstBlock = middleBlock;
+        }
+        else
+        {
+            lastBlock = middleBlock - 1;
+        }
+    }
+
+    return firstBlock * TIMESHIFT_BLOCK_SIZE;
+}
+
+/* Called with controlMutex locked, random access point seconds of PCR time away from position, TIMESHIFT_NO_SEEK if index has none */
+uint64_t findRandomAccessPosition(TimeshiftBuffer* timeshiftBuffer, uint64_t position, uint64_t writtenPosition, int32_t seconds)
+{
+    TsIndexRecord record;
+    int64_t targetTime = 0;
+
+    if (timeshiftBuffer->index == NULL || tsIndexRefresh(timeshiftBuffer->index) || tsIndexGetCount(timeshiftBuffer->index) == 0)
+    {
+        return TIMESHIFT_NO_SEEK;
+    }
+
+    if (position >= writtenPosition)
+    {
+        tsIndexGetRecord(timeshiftBuffer->index, tsIndexGetCount(timeshiftBuffer->index) - 1, &record);
+    }
+    else
+    {
+        tsIndexFindOffset(timeshiftBuffer->index, position, &record);
+    }
+
+    targetTime = (int64_t)record.time + (int64_t)seconds * TIMESHIFT_PCR_TICKS_PER_SECOND;
+    if (tsIndexFindRandomAccess(timeshiftBuffer->index, (targetTime > 0) ? targetTime : 0,
+        oldestPosition(timeshiftBuffer) + TIMESHIFT_BLOCK_SIZE, &record) || record.offset >= writtenPosition)
+    {
+        return TIMESHIFT_NO_SEEK;
+    }
+
+    return record.offset;
+}
+
+/* Sleeps at most given time, control requests wake playback up */
+void waitForControl(TimeshiftBuffer* timeshiftBuffer, uint64_t microseconds)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (microseconds % 1000000) * 1000;
+    deadline.tv_sec += microseconds / 1000000 + deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    sem_timedwait(&timeshiftBuffer->playbackSemaphore, &deadline);
+}
+
+void freeBuffer(TimeshiftBuffer* timeshiftBuffer)
+{
+    uint8_t i = 0;
+
+    pthread_mutex_destroy(&timeshiftBuffer->controlMutex);
+    sem_destroy(&timeshiftBuffer->writerSemaphore);
+    sem_destroy(&timeshiftBuffer->playbackSemaphore);
+    if (timeshiftBuffer->index != NULL)
+    {
+        tsIndexClose(timeshiftBuffer->index);
+    }
+    if (timeshiftBuffer->indexWriter != NULL)
+    {
+        tsIndexWriterDestroy(timeshiftBuffer->indexWriter);
+        unlink(timeshiftBuffer->indexFileName);
+    }
+    if (timeshiftBuffer->fileDescriptor >= 0)
+    {
+        /* recording is not kept between sessions */
+        close(timeshiftBuffer->fileDescriptor);
+        unlink(timeshiftBuffer->fileName);
+    }
+    for (i = 0; i < TIMESHIFT_STAGING_BLOCKS; i++)
+    {
+        free(timeshiftBuffer->staging[i].data);
+    }
+    free(timeshiftBuffer->blockTimes);
+    free(timeshiftBuffer->playbackData);
+    free(timeshiftBuffer);
+}
@@ -0,0 +1,180 @@
+#ifndef __TIMESHIFT_BUFFER_H__
+#define __TIMESHIFT_BUFFER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+#include "ts_index.h"
+#include "ts_packet.h"
+
+#define TIMESHIFT_BLOCK_SIZE (TS_PACKET_SIZE * 4096)    /* Unit of disk writes, multiple of both packet and page size */
+#define TIMESHIFT_STAGING_BLOCKS 8                  /* Blocks buffered in memory while writer thread waits for the disk */
+#define TIMESHIFT_MIN_BLOCKS 4                      /* Smallest ring file, in blocks */
+#define TIMESHIFT_PLAYBACK_PACKETS 256              /* Packets handed to the player at once */
+#define TIMESHIFT_MAX_PIDS 8                        /* Max number of PIDs recorded at the same time */
+
+/**
+ * @brief Enumeration of possible timeshift buffer error codes
+ */
+typedef enum _TimeshiftBufferError
+{
+    TB_NO_ERROR = 0,
+    TB_ERROR,
+    TB_THREAD_ERROR
+}TimeshiftBufferError;
+
+/**
+ * @brief Enumeration of timeshift playback states
+ */
+typedef enum _TimeshiftState
+{
+    TIMESHIFT_LIVE = 0,                             /* Player decodes the tuner, buffer only records */
+    TIMESHIFT_PAUSED,                               /* Nothing is played, recording goes on */
+    TIMESHIFT_PLAYING                               /* Player is fed from the ring file */
+}TimeshiftState;
+
+/**
+ * @brief Structure that holds timeshift buffer counters
+ */
+typedef struct _TimeshiftStatistics
+{
+    TimeshiftState state;
+    uint64_t recordedBytes;                         /* Bytes of packets that passed the PID filter */
+    uint64_t writtenBytes;                          /* Bytes written to the ring file */
+    uint64_t readPosition;                          /* Stream position of next byte fed to the player */
+    uint64_t oldestPosition;                        /* Oldest stream position that can still be played */
+    uint32_t delay;                                 /* Milliseconds played position is behind live */
+    uint32_t droppedPackets;                        /* Packets dropped because the disk did not keep up */
+    uint32_t syncLosses;                            /* Times recorded data did not start with sync byte */
+    uint32_t overruns;                              /* Times playback was overtaken by recording and jumped forward */
+    uint32_t writeErrors;
+    uint32_t readErrors;
+    uint8_t directIo;                               /* 1 if ring file is written and read with O_DIRECT */
+}TimeshiftStatistics;
+
+/**
+ * @brief Packet callback, called on the playback thread with packets read from the ring file
+ *
+ * @param [in] data - whole transport stream packets, valid only during the call
+ * @param [in] length - number of bytes in data
+ * @param [in] userData - user data given at buffer creation
+ */
+typedef void(*TimeshiftPacketCallback)(const uint8_t* data, uint32_t length, void* userData);
+
+/**
+ * @brief Timeshift buffer, records one service into a fixed size circular file and plays it back
+ */
+typedef struct _TimeshiftBuffer TimeshiftBuffer;
+
+/**
+ * @brief Creates ring file and its index and starts writer and playback threads
+ *
+ * Index is written next to the ring file, with ".idx" appended to its name.
+ *
+ * @param [in] fileName - ring file, created or truncated
+ * @param [in] size - ring file size in bytes, rounded down to whole blocks
+ * @param [in] playbackCallback - receives packets while playing
+ * @param [in] userData - passed to playbackCallback
+ * @param [out] timeshiftBuffer - created buffer
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferCreate(const char* fileName, uint64_t size, TimeshiftPacketCallback playbackCallback, void* userData,
+    TimeshiftBuffer** timeshiftBuffer);
+
+/**
+ * @brief Stops threads, closes and removes ring and index files and frees buffer
+ *
+ * @param [in] timeshiftBuffer - buffer to destroy
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferDestroy(TimeshiftBuffer* timeshiftBuffer);
+
+/**
+ * @brief Sets PIDs that are recorded, packets of all other PIDs are skipped
+ *
+ * Can be called from any thread while recording runs.
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @param [in] pids - PIDs to record
+ * @param [in] numberOfPids - number of PIDs, at most TIMESHIFT_MAX_PIDS
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferSetPids(TimeshiftBuffer* timeshiftBuffer, const uint16_t* pids, uint8_t numberOfPids);
+
+/**
+ * @brief Sets program the recording is indexed by, index lets seeks land on random access points
+ *
+ * Can be called from any thread while recording runs.
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @param [in] pcrPid - PID carrying PCR of the program
+ * @param [in] videoPid - video PID, TS_INDEX_NO_PID for radio
+ * @param [in] videoStreamType - PMT stream_type of video
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferSetProgram(TimeshiftBuffer* timeshiftBuffer, uint16_t pcrPid, uint16_t videoPid, uint8_t videoStreamType);
+
+/**
+ * @brief Records chunk of live transport stream
+ *
+ * Must be called from a single ingestion thread. Packets are only copied to memory, the call never
+ * waits for the disk, packets that do not fit are dropped and counted. Chunks do not have to be packet aligned.
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @param [in] data - transport stream bytes
+ * @param [in] length - number of bytes in data
+ * @param [in] arrivalTime - monotonic arrival time of the chunk in microseconds
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferWrite(TimeshiftBuffer* timeshiftBuffer, const uint8_t* data, uint32_t length, uint64_t arrivalTime);
+
+/**
+ * @brief Stops playback, when live the position of pause is the newest recorded packet
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferPause(TimeshiftBuffer* timeshiftBuffer);
+
+/**
+ * @brief Starts feeding player from the position playback stopped at, in recording pace
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @return timeshift buffer error code, TB_ERROR if buffer is live
+ */
+TimeshiftBufferError timeshiftBufferResume(TimeshiftBuffer* timeshiftBuffer);
+
+/**
+ * @brief Moves playback position, rewinding from live starts playback
+ *
+ * Playback starts from the random access point found in the index, or from the recorded block
+ * nearest in time when the index has none. Position is clamped to the oldest recorded block,
+ * seeking past the newest packet goes live.
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @param [in] seconds - relative amount of recording time, negative rewinds
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferSeek(TimeshiftBuffer* timeshiftBuffer, int32_t seconds);
+
+/**
+ * @brief Stops playback from the file, recording goes on
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferGoLive(TimeshiftBuffer* timeshiftBuffer);
+
+/**
+ * @brief Returns buffer counters, can be called from any thread
+ *
+ * @param [in] timeshiftBuffer - timeshift buffer
+ * @param [out] statistics - counters
+ * @return timeshift buffer error code
+ */
+TimeshiftBufferError timeshiftBufferGetStatistics(TimeshiftBuffer* timeshiftBuffer, TimeshiftStatistics* statistics);
+
+#endif /* __TIMESHIFT_BUFFER_H__ */
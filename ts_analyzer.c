@@ -0,0 +1,1002 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tables.h"
+#include "software_demux.h"
+#include "ts_index.h"
+#include "spts_extractor.h"
+#include "task_executor.h"
+#include "stream_monitor.h"
+
+#define CHUNK_PACKETS 89240                         /* ~16 MB of packets per work item */
+#define CHUNK_SIZE ((uint64_t)CHUNK_PACKETS * TS_PACKET_SIZE)
+#define MAX_WORKERS TASK_EXECUTOR_MAX_WORKERS
+#define MAX_PROGRAMS TABLES_MAX_NUMBER_OF_PIDS_IN_PAT
+#define MJD_UNIX_EPOCH 40587                        /* MJD of 1970-01-01 */
+#define SECONDS_PER_DAY 86400
+#define PAT_PID 0x0000
+#define TDT_TOT_PID 0x0014
+#define INDEX_BENCHMARK_SEEKS 100000                /* Random seeks timed on the written index */
+#define EXPORT_FILE_NAME_LENGTH 256
+#define MONITOR_CHUNK_SIZE (7 * TS_PACKET_SIZE)     /* Bytes handed to the monitor at once, one UDP datagram */
+#define MONITOR_DEFAULT_BITRATE 38000000            /* Used when the capture carries no usable PCR */
+#define MONITOR_PCR_PID_NONE 0xFFFF
+#define PCR_CLOCK 27000000ULL
+#define NS_PER_SECOND 1000000000ULL
+
+/**
+ * @brief Enumeration of timeline event types
+ */
+typedef enum _TimelineEventType
+{
+    EVENT_PAT = 0,
+    EVENT_PMT,
+    EVENT_TDT,
+    EVENT_TOT
+}TimelineEventType;
+
+/**
+ * @brief Structure that holds one timeline entry
+ *
+ * For PAT entries hold (program number, PMT PID) pairs, for PMT (stream type, elementary PID) pairs.
+ */
+typedef struct _TimelineEvent
+{
+    uint64_t streamOffset;
+    TimelineEventType type;
+    uint16_t pid;
+    uint16_t tableIdExtension;                      /* transport_stream_id of PAT, program_number of PMT */
+    uint16_t pcrPid;
+    uint8_t version;
+    uint8_t numberOfEntries;
+    uint16_t entries[2 * TABLES_MAX_NUMBER_OF_ELEMENTARY_PID];
+    int64_t utcSeconds;
+}TimelineEvent;
+
+/**
+ * @brief Structure that holds events found in one chunk
+ */
+typedef struct _ChunkResult
+{
+    TimelineEvent* events;
+    uint32_t numberOfEvents;
+    uint32_t capacity;
+
+    /* versions already reported inside the chunk */
+    int16_t patVersion;
+    uint16_t pmtProgramNumbers[MAX_PROGRAMS];
+    int16_t pmtVersions[MAX_PROGRAMS];
+    uint8_t numberOfPmts;
+    bool tdtSeen;
+    bool totSeen;
+}ChunkResult;
+
+/**
+ * @brief Structure that holds programs exported into single program files
+ */
+typedef struct _ExportState
+{
+    SoftwareDemux* demux;
+    SptsExtractor* extractor;
+    const char* prefix;
+    uint16_t programNumbers[MAX_PROGRAMS];
+    uint8_t pmtVersions[MAX_PROGRAMS];
+    uint16_t pmtPids[MAX_PROGRAMS];
+    uint32_t pmtUpdates[MAX_PROGRAMS];
+    uint8_t outputs[MAX_PROGRAMS];
+    int fileDescriptors[MAX_PROGRAMS];
+    uint8_t numberOfPrograms;
+    bool exporting;                                 /* Programs are known, only PMT versions are followed */
+    uint64_t exportedOffset;                        /* Stream offset up to which the extractor got the stream */
+}ExportState;
+
+/**
+ * @brief Structure that holds state of one executor worker, chunks it runs share its demux
+ */
+typedef struct _AnalyzerWorker
+{
+    SoftwareDemux* demux;
+    ChunkResult* currentChunk;
+}AnalyzerWorker;
+
+
+static void analyzeChunk(void* chunkArgument);
+static void sectionCallback(const uint8_t* section, uint32_t length, uint16_t pid, uint64_t streamOffset, void* userData);
+static TimelineEvent* addEvent(ChunkResult* chunk, TimelineEventType type, uint16_t pid, uint64_t streamOffset);
+static void printTimeline();
+static void printPidSummary(AnalyzerWorker* workers, uint32_t numberOfWorkers);
+static void printEvent(const TimelineEvent* event);
+static int64_t utcFromBroadcastTime(uint16_t mjd, uint8_t hours, uint8_t minutes, uint8_t seconds);
+static void writeIndex(const char* indexFileName);
+static void benchmarkIndex(const char* indexFileName);
+static void exportPrograms(const char* prefix);
+static void exportSectionCallback(const uint8_t* section, uint32_t length, uint16_t pid, uint64_t streamOffset, void* userData);
+static void monitorStream(uint32_t bitrate);
+static uint32_t estimateBitrate();
+
+static const uint8_t* fileData = NULL;
+static uint64_t fileSize = 0;
+static uint64_t firstPacketOffset = 0;
+static uint32_t numberOfChunks = 0;
+static TaskExecutor* executor = NULL;
+static AnalyzerWorker workers[MAX_WORKERS];
+static ChunkResult* chunkResults = NULL;
+
+
+int main(int argc, char* argv[])
+{
+    TaskExecutorConfig executorConfig;
+    TaskExecutorStatistics executorStatistics;
+    TaskGroup chunkGroup;
+    uint32_t numberOfWorkers = 0;
+    int32_t syncOffset = 0;
+    const char* fileName = argv[1];
+    bool monitorMode = false;
+    struct stat fileStat;
+    struct timespec startTime;
+    struct timespec endTime;
+    double elapsed = 0;
+    uint32_t i = 0;
+    int fd = 0;
+
+    if (argc > 2 && strcmp(argv[1], "--monitor") == 0)
+    {
+        monitorMode = true;
+        fileName = argv[2];
+    }
+    else if (argc < 2 || strcmp(argv[1], "--monitor") == 0)
+    {
+        printf("Usage: %s <file.ts> [number of threads] [index file|-] [export prefix]\n", argv[0]);
+        printf("       %s --monitor <file.ts> [bitrate]\n", argv[0]);
+        return -1;
+    }
+
+    numberOfWorkers = (argc > 2) ? (uint32_t)atoi(argv[2]) : (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if (numberOfWorkers < 1)
+    {
+        numberOfWorkers = 1;
+    }
+    if (numberOfWorkers > MAX_WORKERS)
+    {
+        numberOfWorkers = MAX_WORKERS;
+    }
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0 || fstat(fd, &fileStat) < 0)
+    {
+        printf("\n%s : ERROR cannot open %s (%s)\n", __FUNCTION__, fileName, strerror(errno));
+        return -1;
+    }
+    fileSize = (uint64_t)fileStat.st_size;
+    if (fileSize < TS_PACKET_SIZE)
+    {
+        printf("\n%s : ERROR %s is too small\n", __FUNCTION__, fileName);
+        close(fd);
+        return -1;
+    }
+
+    fileData = (const uint8_t*)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (fileData == MAP_FAILED)
+    {
+        printf("\n%s : ERROR mmap failed (%s)\n", __FUNCTION__, strerror(errno));
+        return -1;
+    }
+
+    syncOffset = findPacketSync(fileData, (fileSize > CHUNK_SIZE) ? (uint32_t)CHUNK_SIZE : (uint32_t)fileSize);
+    if (syncOffset < 0)
+    {
+        printf("\n%s : ERROR no transport stream packets found\n", __FUNCTION__);
+        munmap((void*)fileData, fileSize);
+        return -1;
+    }
+    firstPacketOffset = (uint64_t)syncOffset;
+
+    if (monitorMode)
+    {
+        printf("Monitoring %s: %llu bytes\n", fileName, (unsigned long long)fileSize);
+        monitorStream((argc > 3) ? (uint32_t)atoi(argv[3]) : 0);
+        munmap((void*)fileData, fileSize);
+        return 0;
+    }
+
+    /* chunks start on packet boundaries so workers never share a packet */
+    numberOfChunks = (uint32_t)((fileSize - firstPacketOffset + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    chunkResults = (ChunkResult*)calloc(numberOfChunks, sizeof(ChunkResult));
+    if (chunkResults == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        munmap((void*)fileData, fileSize);
+        return -1;
+    }
+
+    printf("Analyzing %s: %llu bytes, %u chunks, %u threads, %s kernel\n", fileName, (unsigned long long)fileSize,
+        numberOfChunks, numberOfWorkers, (packetClassifierInit() == PC_KERNEL_AVX2) ? "AVX2" :
+        (packetClassifierGetKernel() == PC_KERNEL_SSE2) ? "SSE2" : "scalar");
+
+    memset(&executorConfig, 0x0, sizeof(executorConfig));
+    executorConfig.numberOfWorkers = numberOfWorkers;
+    for (i = 0; i < numberOfWorkers; i++)
+    {
+        if (softwareDemuxCreate(&workers[i].demux, sectionCallback, &workers[i]))
+        {
+            printf("\n%s : ERROR cannot create demux of worker %d\n", __FUNCTION__, i);
+            numberOfWorkers = i;
+            break;
+        }
+    }
+    if (numberOfWorkers == 0 || taskExecutorCreate(&executorConfig, &executor))
+    {
+        printf("\n%s : ERROR cannot start workers\n", __FUNCTION__);
+        for (i = 0; i < numberOfWorkers; i++)
+        {
+            softwareDemuxDestroy(workers[i].demux);
+        }
+        free(chunkResults);
+        munmap((void*)fileData, fileSize);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    /* chunks are independent, idle workers steal them from busy ones */
+    taskGroupInit(&chunkGroup);
+    for (i = 0; i < numberOfChunks; i++)
+    {
+        taskExecutorSubmit(executor, TASK_PRIORITY_NORMAL, analyzeChunk, (void*)(uintptr_t)i, &chunkGroup);
+    }
+    taskExecutorWait(executor, &chunkGroup);
+    taskGroupDestroy(&chunkGroup);
+
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    taskExecutorGetStatistics(executor, &executorStatistics);
+    taskExecutorDestroy(executor);
+    elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+
+    printTimeline();
+    printPidSummary(workers, numberOfWorkers);
+    printf("\nAnalyzed in %.3f s, %.1f MB/s, %llu of %llu chunks stolen by idle workers\n", elapsed,
+        (elapsed > 0) ? fileSize / elapsed / 1e6 : 0.0, (unsigned long long)executorStatistics.stolen,
+        (unsigned long long)executorStatistics.submitted);
+
+    if (argc > 3 && strcmp(argv[3], "-") != 0)
+    {
+        writeIndex(argv[3]);
+        benchmarkIndex(argv[3]);
+    }
+    if (argc > 4)
+    {
+        exportPrograms(argv[4]);
+    }
+
+    for (i = 0; i < numberOfWorkers; i++)
+    {
+        softwareDemuxDestroy(workers[i].demux);
+    }
+    for (i = 0; i < numberOfChunks; i++)
+    {
+        free(chunkResults[i].events);
+    }
+    free(chunkResults);
+    munmap((void*)fileData, fileSize);
+
+    return 0;
+}
+
+void analyzeChunk(void* chunkArgument)
+{
+    AnalyzerWorker* worker = &workers[taskExecutorCurrentWorker(executor)];
+    uint32_t chunkIndex = (uint32_t)(uintptr_t)chunkArgument;
+    uint64_t chunkOffset = 0;
+    uint64_t chunkLength = 0;
+    uint64_t nextLength = 0;
+
+    chunkOffset = firstPacketOffset + (uint64_t)chunkIndex * CHUNK_SIZE;
+    chunkLength = (fileSize - chunkOffset < CHUNK_SIZE) ? fileSize - chunkOffset : CHUNK_SIZE;
+
+    /* start readahead of the whole chunk, workers read far apart parts of the file */
+    madvise((void*)((uintptr_t)(fileData + chunkOffset) & ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1)),
+        chunkLength, MADV_WILLNEED);
+
+    worker->currentChunk = &chunkResults[chunkIndex];
+    worker->currentChunk->patVersion = -1;
+
+    /* PMT PIDs are learned again from the first PAT of every chunk */
+    softwareDemuxReset(worker->demux);
+    softwareDemuxAddSectionFilter(worker->demux, PAT_PID);
+    softwareDemuxAddSectionFilter(worker->demux, TDT_TOT_PID);
+
+    softwareDemuxProcess(worker->demux, fileData + chunkOffset, chunkLength, chunkOffset);
+
+    /* sections started in this chunk are finished from the next one, which skips them as it starts mid section */
+    nextLength = fileSize - chunkOffset - chunkLength;
+    if (nextLength > 0)
+    {
+        softwareDemuxDrain(worker->demux, fileData + chunkOffset + chunkLength, (nextLength < CHUNK_SIZE) ? nextLength : CHUNK_SIZE,
+            chunkOffset + chunkLength);
+    }
+}
+
+void sectionCallback(const uint8_t* section, uint32_t length, uint16_t pid, uint64_t streamOffset, void* userData)
+{
+    AnalyzerWorker* worker = (AnalyzerWorker*)userData;
+    ChunkResult* chunk = worker->currentChunk;
+    TimelineEvent* event = NULL;
+    SectionView view;
+    PatTable patTable;
+    PmtTable pmtTable;
+    TdtTable tdtTable;
+    TotTable totTable;
+    uint8_t tableId = section[0];
+    uint8_t i = 0;
+
+    /* TDT has no CRC, every other handled table has one */
+    if (tableId != 0x70 && tablesCrc32(section, length) != 0)
+    {
+        return;
+    }
+    if (sectionViewInit(&view, section, length) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+
+    if (pid == PAT_PID && tableId == 0x00)
+    {
+        if (parsePatTable(&view, &patTable) != TABLES_PARSE_OK || patTable.patHeader.versionNumber == chunk->patVersion)
+        {
+            return;
+        }
+        chunk->patVersion = patTable.patHeader.versionNumber;
+
+        event = addEvent(chunk, EVENT_PAT, pid, streamOffset);
+        if (event == NULL)
+        {
+            return;
+        }
+        event->tableIdExtension = patTable.patHeader.transportStreamId;
+        event->version = patTable.patHeader.versionNumber;
+        for (i = 0; i < patTable.serviceInfoCount; i++)
+        {
+            event->entries[2 * i] = patTable.patServiceInfoArray[i].programNumber;
+            event->entries[2 * i + 1] = patTable.patServiceInfoArray[i].pid;
+            if (patTable.patServiceInfoArray[i].programNumber != 0)
+            {
+                softwareDemuxAddSectionFilter(worker->demux, patTable.patServiceInfoArray[i].pid);
+            }
+        }
+        event->numberOfEntries = patTable.serviceInfoCount;
+    }
+    else if (tableId == 0x02)
+    {
+        if (parsePmtTable(&view, &pmtTable) != TABLES_PARSE_OK)
+        {
+            return;
+        }
+
+        for (i = 0; i < chunk->numberOfPmts; i++)
+        {
+            if (chunk->pmtProgramNumbers[i] == pmtTable.pmtHeader.programNumber)
+            {
+                break;
+            }
+        }
+        if (i == chunk->numberOfPmts)
+        {
+            if (i == MAX_PROGRAMS)
+            {
+                return;
+            }
+            chunk->pmtProgramNumbers[i] = pmtTable.pmtHeader.programNumber;
+            chunk->pmtVersions[i] = -1;
+            chunk->numberOfPmts++;
+        }
+        if (chunk->pmtVersions[i] == pmtTable.pmtHeader.versionNumber)
+        {
+            return;
+        }
+        chunk->pmtVersions[i] = pmtTable.pmtHeader.versionNumber;
+
+        event = addEvent(chunk, EVENT_PMT, pid, streamOffset);
+        if (event == NULL)
+        {
+            return;
+        }
+        event->tableIdExtension = pmtTable.pmtHeader.programNumber;
+        event->version = pmtTable.pmtHeader.versionNumber;
+        event->pcrPid = pmtTable.pmtHeader.pcrPid;
+        for (i = 0; i < pmtTable.elementaryInfoCount; i++)
+        {
+            event->entries[2 * i] = pmtTable.pmtElementaryInfoArray[i].streamType;
+            event->entries[2 * i + 1] = pmtTable.pmtElementaryInfoArray[i].elementaryPid;
+        }
+        event->numberOfEntries = pmtTable.elementaryInfoCount;
+    }
+    else if (pid == TDT_TOT_PID && tableId == 0x70 && !chunk->tdtSeen)
+    {
+        /* one time stamp per chunk is enough for the timeline */
+        if (parseTdtTable(&view, &tdtTable) == TABLES_PARSE_OK && (event = addEvent(chunk, EVENT_TDT, pid, streamOffset)) != NULL)
+        {
+            event->utcSeconds = utcFromBroadcastTime(tdtTable.MJD, tdtTable.hours, tdtTable.minutes, tdtTable.seconds);
+            chunk->tdtSeen = true;
+        }
+    }
+    else if (pid == TDT_TOT_PID && tableId == 0x73 && !chunk->totSeen)
+    {
+        if (parseTotTable(&view, &totTable) == TABLES_PARSE_OK && (event = addEvent(chunk, EVENT_TOT, pid, streamOffset)) != NULL)
+        {
+            event->utcSeconds = utcFromBroadcastTime(totTable.MJD, totTable.hours, totTable.minutes, totTable.seconds);
+            chunk->totSeen = true;
+        }
+    }
+}
+
+TimelineEvent* addEvent(ChunkResult* chunk, TimelineEventType type, uint16_t pid, uint64_t streamOffset)
+{
+    TimelineEvent* events = NULL;
+
+    if (chunk->numberOfEvents == chunk->capacity)
+    {
+        events = (TimelineEvent*)realloc(chunk->events, (chunk->capacity ? 2 * chunk->capacity : 16) * sizeof(TimelineEvent));
+        if (events == NULL)
+        {
+            printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+            return NULL;
+        }
+        chunk->events = events;
+        chunk->capacity = chunk->capacity ? 2 * chunk->capacity : 16;
+    }
+
+    memset(&chunk->events[chunk->numberOfEvents], 0x0, sizeof(TimelineEvent));
+    chunk->events[chunk->numberOfEvents].type = type;
+    chunk->events[chunk->numberOfEvents].pid = pid;
+    chunk->events[chunk->numberOfEvents].streamOffset = streamOffset;
+
+    return &chunk->events[chunk->numberOfEvents++];
+}
+
+/* Merges chunk results in file order, a table version is printed only when it differs
+ * from the one seen before, so repetitions found again by every chunk are dropped
+ */
+void printTimeline()
+{
+    int16_t patVersion = -1;
+    uint16_t pmtProgramNumbers[MAX_PROGRAMS];
+    int16_t pmtVersions[MAX_PROGRAMS];
+    uint8_t numberOfPmts = 0;
+    const TimelineEvent* event = NULL;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint8_t k = 0;
+
+    printf("\n%-14s %-6s %s\n", "offset", "table", "content");
+
+    for (i = 0; i < numberOfChunks; i++)
+    {
+        for (j = 0; j < chunkResults[i].numberOfEvents; j++)
+        {
+            event = &chunkResults[i].events[j];
+
+            if (event->type == EVENT_PAT)
+            {
+                if (event->version == patVersion)
+                {
+                    continue;
+                }
+                patVersion = event->version;
+            }
+            else if (event->type == EVENT_PMT)
+            {
+                for (k = 0; k < numberOfPmts; k++)
+                {
+                    if (pmtProgramNumbers[k] == event->tableIdExtension)
+                    {
+                        break;
+                    }
+                }
+                if (k == numberOfPmts && numberOfPmts < MAX_PROGRAMS)
+                {
+                    pmtProgramNumbers[k] = event->tableIdExtension;
+                    pmtVersions[k] = -1;
+                    numberOfPmts++;
+                }
+                if (k < numberOfPmts && event->version == pmtVersions[k])
+                {
+                    continue;
+                }
+                if (k < numberOfPmts)
+                {
+                    pmtVersions[k] = event->version;
+                }
+            }
+
+            printEvent(event);
+        }
+    }
+}
+
+void printEvent(const TimelineEvent* event)
+{
+    struct tm utcTime;
+    time_t seconds = 0;
+    char timeString[32];
+    uint8_t i = 0;
+
+    printf("%-14llu ", (unsigned long long)event->streamOffset);
+
+    switch (event->type)
+    {
+        case EVENT_PAT:
+            printf("%-6s ts_id %d version %d, services:", "PAT", event->tableIdExtension, event->version);
+            for (i = 0; i < event->numberOfEntries; i++)
+            {
+                printf(" %d->0x%04x", event->entries[2 * i], event->entries[2 * i + 1]);
+            }
+            break;
+        case EVENT_PMT:
+            printf("%-6s program %d on 0x%04x version %d, pcr 0x%04x, streams:", "PMT", event->tableIdExtension,
+                event->pid, event->version, event->pcrPid);
+            for (i = 0; i < event->numberOfEntries; i++)
+            {
+                printf(" 0x%04x(type 0x%02x)", event->entries[2 * i + 1], event->entries[2 * i]);
+            }
+            break;
+        case EVENT_TDT:
+        case EVENT_TOT:
+            seconds = (time_t)event->utcSeconds;
+            gmtime_r(&seconds, &utcTime);
+            strftime(timeString, sizeof(timeString), "%Y-%m-%d %H:%M:%S", &utcTime);
+            printf("%-6s %s UTC", (event->type == EVENT_TDT) ? "TDT" : "TOT", timeString);
+            break;
+    }
+
+    printf("\n");
+}
+
+void printPidSummary(AnalyzerWorker* workers, uint32_t numberOfWorkers)
+{
+    SoftwareDemuxStatistics statistics;
+    uint64_t totalPackets = 0;
+    uint64_t packetCount = 0;
+    uint32_t syncLosses = 0;
+    uint32_t continuityErrors = 0;
+    uint32_t pid = 0;
+    uint32_t i = 0;
+
+    for (i = 0; i < numberOfWorkers; i++)
+    {
+        softwareDemuxGetStatistics(workers[i].demux, &statistics);
+        totalPackets += statistics.totalPackets;
+        syncLosses += statistics.syncLosses;
+        continuityErrors += statistics.continuityErrors;
+    }
+
+    printf("\n%-8s %-14s %s\n", "pid", "packets", "share");
+    for (pid = 0; pid < SOFTWARE_DEMUX_NUMBER_OF_PIDS; pid++)
+    {
+        packetCount = 0;
+        for (i = 0; i < numberOfWorkers; i++)
+        {
+            packetCount += softwareDemuxGetPidPacketCount(workers[i].demux, pid);
+        }
+        if (packetCount > 0)
+        {
+            printf("0x%04x   %-14llu %6.2f%%\n", pid, (unsigned long long)packetCount, 100.0 * packetCount / totalPackets);
+        }
+    }
+
+    printf("\nPackets: %llu, sync losses: %u, PSI continuity errors: %u\n", (unsigned long long)totalPackets, syncLosses, continuityErrors);
+}
+
+int64_t utcFromBroadcastTime(uint16_t mjd, uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    return ((int64_t)mjd - MJD_UNIX_EPOCH) * SECONDS_PER_DAY + hours*3600 + minutes*60 + seconds;
+}
+
+/* Indexes video of the first program that has one, index is written in one sequential pass */
+void writeIndex(const char* indexFileName)
+{
+    TsIndexWriter* writer = NULL;
+    const TimelineEvent* event = NULL;
+    uint64_t length = (fileSize - firstPacketOffset) / TS_PACKET_SIZE * TS_PACKET_SIZE;
+    uint64_t offset = 0;
+    uint64_t chunkLength = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint8_t k = 0;
+    bool programFound = false;
+
+    if (tsIndexWriterCreate(indexFileName, &writer))
+    {
+        return;
+    }
+
+    for (i = 0; i < numberOfChunks && !programFound; i++)
+    {
+        for (j = 0; j < chunkResults[i].numberOfEvents && !programFound; j++)
+        {
+            event = &chunkResults[i].events[j];
+            if (event->type != EVENT_PMT)
+            {
+                continue;
+            }
+            for (k = 0; k < event->numberOfEntries; k++)
+            {
+                if (event->entries[2 * k] == 0x01 || event->entries[2 * k] == 0x02 || event->entries[2 * k] == 0x1B
+                    || event->entries[2 * k] == 0x24)
+                {
+                    printf("\nIndexing program %d: PCR pid %d, video pid %d, stream type 0x%02x\n", event->tableIdExtension,
+                        event->pcrPid, event->entries[2 * k + 1], event->entries[2 * k]);
+                    tsIndexWriterSetProgram(writer, event->pcrPid, event->entries[2 * k + 1], (uint8_t)event->entries[2 * k]);
+                    programFound = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!programFound)
+    {
+        printf("\nNo video program found, index holds PCR only\n");
+    }
+
+    for (offset = 0; offset < length; offset += chunkLength)
+    {
+        chunkLength = (length - offset < CHUNK_SIZE) ? length - offset : CHUNK_SIZE;
+        tsIndexWriterProcess(writer, fileData + firstPacketOffset + offset, (uint32_t)chunkLength, firstPacketOffset + offset);
+    }
+
+    tsIndexWriterDestroy(writer);
+}
+
+void benchmarkIndex(const char* indexFileName)
+{
+    TsIndex* index = NULL;
+    TsIndexRecord firstRecord;
+    TsIndexRecord lastRecord;
+    TsIndexRecord record;
+    struct timespec startTime;
+    struct timespec endTime;
+    uint64_t randomAccessPoints = 0;
+    uint64_t found = 0;
+    uint64_t span = 0;
+    uint64_t i = 0;
+    uint32_t seed = 1;
+    double elapsed = 0;
+
+    if (tsIndexOpen(indexFileName, &index))
+    {
+        return;
+    }
+
+    if (tsIndexGetCount(index) == 0)
+    {
+        printf("\nIndex %s is empty\n", indexFileName);
+        tsIndexClose(index);
+        return;
+    }
+
+    for (i = 0; i < tsIndexGetCount(index); i++)
+    {
+        tsIndexGetRecord(index, i, &record);
+        randomAccessPoints += (record.flags & TS_INDEX_FLAG_RAP) ? 1 : 0;
+    }
+    tsIndexGetRecord(index, 0, &firstRecord);
+    tsIndexGetRecord(index, tsIndexGetCount(index) - 1, &lastRecord);
+    span = lastRecord.time - firstRecord.time;
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (i = 0; i < INDEX_BENCHMARK_SEEKS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if (!tsIndexFindRandomAccess(index, firstRecord.time + (span != 0 ? seed % span : 0), 0, &record))
+        {
+            found++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+
+    printf("Index %s: %llu records, %llu random access points, %.1f s of stream\n", indexFileName,
+        (unsigned long long)tsIndexGetCount(index), (unsigned long long)randomAccessPoints, span / 90000.0);
+    printf("%u seeks to random access point, %llu found, %.3f us per seek\n", INDEX_BENCHMARK_SEEKS,
+        (unsigned long long)found, elapsed * 1e6 / INDEX_BENCHMARK_SEEKS);
+
+    tsIndexClose(index);
+}
+
+void exportPrograms(const char* prefix)
+{
+    ExportState state;
+    SptsOutputStatistics statistics;
+    struct timespec startTime;
+    struct timespec endTime;
+    uint64_t length = (fileSize - firstPacketOffset) / TS_PACKET_SIZE * TS_PACKET_SIZE;
+    uint64_t offset = 0;
+    uint64_t chunkLength = 0;
+    uint64_t writtenBytes = 0;
+    double elapsed = 0;
+    uint8_t i = 0;
+
+    memset(&state, 0x0, sizeof(ExportState));
+    state.prefix = prefix;
+
+    /* programs are taken from PAT and PMTs of the first chunk */
+    if (softwareDemuxCreate(&state.demux, exportSectionCallback, &state))
+    {
+        return;
+    }
+    softwareDemuxAddSectionFilter(state.demux, PAT_PID);
+    softwareDemuxProcess(state.demux, fileData + firstPacketOffset, (length < CHUNK_SIZE) ? length : CHUNK_SIZE, firstPacketOffset);
+    softwareDemuxDestroy(state.demux);
+    state.demux = NULL;
+
+    if (state.extractor == NULL || state.numberOfPrograms == 0)
+    {
+        printf("\nNo program found to export\n");
+        if (state.extractor != NULL)
+        {
+            sptsExtractorDestroy(state.extractor);
+        }
+        return;
+    }
+
+    /* PMTs are followed through the whole file, a new version changes the output where it was sent */
+    state.exporting = true;
+    state.exportedOffset = firstPacketOffset;
+    if (softwareDemuxCreate(&state.demux, exportSectionCallback, &state))
+    {
+        sptsExtractorDestroy(state.extractor);
+        return;
+    }
+    for (i = 0; i < state.numberOfPrograms; i++)
+    {
+        softwareDemuxAddSectionFilter(state.demux, state.pmtPids[i]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (offset = 0; offset < length; offset += chunkLength)
+    {
+        chunkLength = (length - offset < CHUNK_SIZE) ? length - offset : CHUNK_SIZE;
+        softwareDemuxProcess(state.demux, fileData + firstPacketOffset + offset, chunkLength, firstPacketOffset + offset);
+        sptsExtractorProcess(state.extractor, fileData + state.exportedOffset, firstPacketOffset + offset + chunkLength
+            - state.exportedOffset);
+        state.exportedOffset = firstPacketOffset + offset + chunkLength;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    softwareDemuxDestroy(state.demux);
+    elapsed = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+
+    printf("\nExported programs:\n");
+    for (i = 0; i < state.numberOfPrograms; i++)
+    {
+        sptsExtractorGetStatistics(state.extractor, state.outputs[i], &statistics);
+        printf("  %s_%d.ts: %llu packets, %llu PAT/PMT packets, %u PMT updates, %llu bytes in %u writes, %u write errors\n",
+            prefix, statistics.programNumber, (unsigned long long)statistics.packets, (unsigned long long)statistics.psiPackets,
+            state.pmtUpdates[i], (unsigned long long)statistics.writtenBytes, statistics.writes, statistics.writeErrors);
+        writtenBytes += statistics.writtenBytes;
+        sptsExtractorRemoveOutput(state.extractor, state.outputs[i]);
+        close(state.fileDescriptors[i]);
+    }
+    printf("%d programs exported in %.3f s on one thread, %.1f MB/s of input, %.1f MB/s written\n", state.numberOfPrograms,
+        elapsed, (elapsed > 0) ? length / elapsed / 1e6 : 0.0, (elapsed > 0) ? writtenBytes / elapsed / 1e6 : 0.0);
+
+    sptsExtractorDestroy(state.extractor);
+}
+
+void exportSectionCallback(const uint8_t* section, uint32_t length, uint16_t pid, uint64_t streamOffset, void* userData)
+{
+    ExportState* state = (ExportState*)userData;
+    char fileName[EXPORT_FILE_NAME_LENGTH];
+    SectionView view;
+    PatTable patTable;
+    PmtTable pmtTable;
+    uint8_t i = 0;
+    int fd = 0;
+
+    if (tablesCrc32(section, length) != 0 || sectionViewInit(&view, section, length) != TABLES_PARSE_OK)
+    {
+        return;
+    }
+
+    if (pid == PAT_PID && section[0] == 0x00)
+    {
+        if (state->extractor != NULL || parsePatTable(&view, &patTable) != TABLES_PARSE_OK
+            || sptsExtractorCreate(patTable.patHeader.transportStreamId, &state->extractor))
+        {
+            return;
+        }
+        for (i = 0; i < patTable.serviceInfoCount; i++)
+        {
+            if (patTable.patServiceInfoArray[i].programNumber != 0)
+            {
+                softwareDemuxAddSectionFilter(state->demux, patTable.patServiceInfoArray[i].pid);
+            }
+        }
+    }
+    else if (section[0] == 0x02 && state->extractor != NULL)
+    {
+        if (parsePmtTable(&view, &pmtTable) != TABLES_PARSE_OK)
+        {
+            return;
+        }
+        for (i = 0; i < state->numberOfPrograms; i++)
+        {
+            if (state->programNumbers[i] == pmtTable.pmtHeader.programNumber)
+            {
+                break;
+            }
+        }
+
+        if (i < state->numberOfPrograms)
+        {
+            if (!state->exporting || state->pmtVersions[i] == pmtTable.pmtHeader.versionNumber)
+            {
+                return;
+            }
+            /* stream up to the packet that completed the new PMT goes out with the old one */
+            sptsExtractorProcess(state->extractor, fileData + state->exportedOffset, streamOffset + TS_PACKET_SIZE
+                - state->exportedOffset);
+            state->exportedOffset = streamOffset + TS_PACKET_SIZE;
+            if (sptsExtractorUpdateOutput(state->extractor, state->outputs[i], &pmtTable, pid) == SE_NO_ERROR)
+            {
+                state->pmtVersions[i] = pmtTable.pmtHeader.versionNumber;
+                state->pmtUpdates[i]++;
+            }
+            return;
+        }
+        if (state->exporting || state->numberOfPrograms == MAX_PROGRAMS)
+        {
+            return;
+        }
+
+        snprintf(fileName, sizeof(fileName), "%s_%d.ts", state->prefix, pmtTable.pmtHeader.programNumber);
+        fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            printf("\n%s : ERROR cannot open %s (%s)\n", __FUNCTION__, fileName, strerror(errno));
+            return;
+        }
+        if (sptsExtractorAddOutput(state->extractor, &pmtTable, pid, fd, &state->outputs[state->numberOfPrograms]))
+        {
+            close(fd);
+            return;
+        }
+        state->programNumbers[state->numberOfPrograms] = pmtTable.pmtHeader.programNumber;
+        state->pmtVersions[state->numberOfPrograms] = pmtTable.pmtHeader.versionNumber;
+        state->pmtPids[state->numberOfPrograms] = pid;
+        state->fileDescriptors[state->numberOfPrograms] = fd;
+        state->numberOfPrograms++;
+    }
+}
+
+/* Feeds the whole capture to the TR 101 290 monitor as if it arrived at a constant bitrate */
+void monitorStream(uint32_t bitrate)
+{
+    StreamMonitor* monitor = NULL;
+    StreamMonitorReport report;
+    PidStatistics statistics;
+    const char* bitrateSource = "given";
+    uint64_t offset = 0;
+    uint64_t chunkLength = 0;
+    uint32_t pid = 0;
+
+    if (bitrate == 0)
+    {
+        bitrate = estimateBitrate();
+        bitrateSource = "estimated from PCR";
+    }
+    if (bitrate == 0)
+    {
+        bitrate = MONITOR_DEFAULT_BITRATE;
+        bitrateSource = "default, no PCR found";
+    }
+
+    if (streamMonitorCreate(&monitor))
+    {
+        return;
+    }
+
+    /* starts at byte 0 instead of the first packet, the monitor acquires sync itself */
+    for (offset = 0; offset < fileSize; offset += chunkLength)
+    {
+        chunkLength = (fileSize - offset < MONITOR_CHUNK_SIZE) ? fileSize - offset : MONITOR_CHUNK_SIZE;
+        streamMonitorProcess(monitor, fileData + offset, (uint32_t)chunkLength,
+            1 + (uint64_t)((double)offset * 8 * NS_PER_SECOND / bitrate));
+    }
+
+    streamMonitorGetReport(monitor, &report);
+
+    printf("\n%.3f s of stream at %.3f Mbit/s (%s), %llu packets, %s at the end\n", (double)fileSize * 8 / bitrate,
+        bitrate / 1e6, bitrateSource, (unsigned long long)report.totalPackets, report.inSync ? "in sync" : "out of sync");
+    printf("\nPriority 1\n");
+    printf("  1.1 TS_sync_loss                       %u\n", report.tsSyncLoss);
+    printf("  1.2 Sync_byte_error                    %u\n", report.syncByteErrors);
+    printf("  1.3 PAT_error                          %u\n", report.patErrors);
+    printf("  1.4 Continuity_count_error             %u\n", report.continuityErrors);
+    printf("  1.5 PMT_error                          %u\n", report.pmtErrors);
+    printf("  1.6 PID_error                          %u\n", report.pidErrors);
+    printf("Priority 2\n");
+    printf("  2.1 Transport_error                    %u\n", report.transportErrors);
+    printf("  2.2 CRC_error                          %u\n", report.crcErrors);
+    printf("  2.3a PCR_repetition_error              %u\n", report.pcrRepetitionErrors);
+    printf("  2.3b PCR_discontinuity_indicator_error %u\n", report.pcrDiscontinuityErrors);
+    printf("  2.4 PCR_accuracy_error                 %u\n", report.pcrAccuracyErrors);
+
+    printf("\n%-8s %-14s %-10s %-6s %-6s %-10s %-6s %s\n", "pid", "packets", "kbit/s", "CC", "PID", "transport", "CRC",
+        "PCR rep/disc/acc");
+    for (pid = 0; pid < STREAM_MONITOR_NUMBER_OF_PIDS; pid++)
+    {
+        streamMonitorGetPidStatistics(monitor, (uint16_t)pid, &statistics);
+        if (statistics.packetCount > 0)
+        {
+            printf("0x%04x   %-14llu %-10u %-6u %-6u %-10u %-6u %u/%u/%u\n", pid, (unsigned long long)statistics.packetCount,
+                statistics.bitrate / 1000, statistics.continuityErrors, statistics.pidErrors, statistics.transportErrors,
+                statistics.crcErrors, statistics.pcrRepetitionErrors, statistics.pcrDiscontinuityErrors,
+                statistics.pcrAccuracyErrors);
+        }
+    }
+
+    streamMonitorDestroy(monitor);
+}
+
+/* Bitrate between the first and the last PCR of the first PCR PID in the first chunk, 0 if there are not two */
+uint32_t estimateBitrate()
+{
+    const uint8_t* packet = NULL;
+    uint64_t length = (fileSize - firstPacketOffset < CHUNK_SIZE) ? fileSize - firstPacketOffset : CHUNK_SIZE;
+    uint64_t offset = 0;
+    uint64_t pcr = 0;
+    uint64_t firstPcr = 0;
+    uint64_t firstOffset = 0;
+    uint64_t lastPcr = 0;
+    uint64_t lastOffset = 0;
+    uint16_t pcrPid = MONITOR_PCR_PID_NONE;
+    uint16_t pid = 0;
+
+    for (offset = 0; offset + TS_PACKET_SIZE <= length; offset += TS_PACKET_SIZE)
+    {
+        packet = fileData + firstPacketOffset + offset;
+        pid = (uint16_t)(((packet[1] & 0x1F) << 8) | packet[2]);
+
+        /* adaptation field present, long enough and carrying PCR */
+        if (packet[0] != TS_SYNC_BYTE || !(packet[3] & 0x20) || packet[4] < 7 || !(packet[5] & 0x10)
+            || (pcrPid != MONITOR_PCR_PID_NONE && pid != pcrPid))
+        {
+            continue;
+        }
+        if (pcrPid != MONITOR_PCR_PID_NONE && (packet[5] & 0x80))
+        {
+            break;
+        }
+
+        pcr = (((uint64_t)packet[6] << 25) | ((uint64_t)packet[7] << 17) | ((uint64_t)packet[8] << 9)
+            | ((uint64_t)packet[9] << 1) | (packet[10] >> 7)) * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+        if (pcrPid == MONITOR_PCR_PID_NONE)
+        {
+            pcrPid = pid;
+            firstPcr = pcr;
+            firstOffset = offset;
+        }
+        else if (pcr > firstPcr)
+        {
+            lastPcr = pcr;
+            lastOffset = offset;
+        }
+    }
+
+    if (lastPcr == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((lastOffset - firstOffset) * 8 * PCR_CLOCK / (lastPcr - firstPcr));
+}
@@ -0,0 +1,820 @@
+#define _GNU_SOURCE                                 /* memfd_create, SO_PEERCRED */
+#include "ts_fanout.h"
+#include "thread_policy.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TS_FANOUT_MAGIC 0x54554F46                  /* "FOUT" */
+#define TS_FANOUT_VERSION 1
+#define TS_FANOUT_PAGE_SIZE 4096                    /* Packets start on the page after the header */
+#define TS_FANOUT_LISTEN_BACKLOG 4
+
+/* counters shared between processes, each has one writer */
+#define TS_FANOUT_LOAD(value) __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+#define TS_FANOUT_STORE(value, newValue) __atomic_store_n(&(value), (newValue), __ATOMIC_RELEASE)
+
+/**
+ * @brief Structure of one reader slot in shared memory
+ *
+ * Producer sets the slot up when it hands the ring out, after that only the reader writes cursor and lostPackets.
+ */
+typedef struct _TsFanoutSlot
+{
+    uint32_t used;                                  /* 1 while reader is connected */
+    int32_t processId;
+    uint32_t waiting;                               /* 1 while reader waits on semaphore for new packets */
+    uint32_t reserved;
+    uint64_t cursor;                                /* Number of the packet reader reads next */
+    uint64_t lostPackets;
+    sem_t semaphore;                                /* Posted by producer after publishing to a waiting reader */
+}TsFanoutSlot;
+
+/**
+ * @brief Structure of shared memory header, ring of packets starts on the next page
+ */
+typedef struct _TsFanoutHeader
+{
+    uint32_t magic;                                 /* TS_FANOUT_MAGIC */
+    uint16_t version;                               /* TS_FANOUT_VERSION */
+    uint16_t packetSize;
+    uint32_t capacity;                              /* Ring size in packets */
+    uint32_t closed;                                /* 1 once producer stopped publishing */
+    uint64_t writeStart;                            /* Packets producer started to write, older than writeStart - capacity may be overwritten */
+    uint64_t writeCount;                            /* Packets published */
+    TsFanoutSlot slots[TS_FANOUT_MAX_READERS];
+}TsFanoutHeader;
+
+/**
+ * @brief Structure of handshake message, memfd of the ring goes along as SCM_RIGHTS
+ */
+typedef struct _TsFanoutHandshake
+{
+    uint32_t magic;
+    uint32_t slot;                                  /* Reader slot assigned to the connection */
+    uint64_t mapSize;
+}TsFanoutHandshake;
+
+#define TS_FANOUT_DATA_OFFSET ((sizeof(TsFanoutHeader) + TS_FANOUT_PAGE_SIZE - 1) / TS_FANOUT_PAGE_SIZE * TS_FANOUT_PAGE_SIZE)
+
+struct _TsFanout
+{
+    char socketPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    int memoryDescriptor;
+    int listenSocket;
+    int wakePipe[2];                                /* Stops handshake thread */
+    int connections[TS_FANOUT_MAX_READERS];         /* Socket of reader in every slot, -1 if slot is free */
+    pthread_t thread;
+
+    uint8_t* map;
+    uint64_t mapSize;
+    TsFanoutHeader* header;
+    uint8_t* packets;
+    uint32_t capacity;
+
+    uint8_t carry[TS_PACKET_SIZE];           /* Packet split between two writes */
+    uint32_t carryLength;
+    bool inSync;
+    uint32_t syncLosses;
+    uint32_t connectionCount;
+    uint32_t rejectedConnections;
+};
+
+struct _TsFanoutReader
+{
+    int socket;                                     /* Kept open, producer releases the slot when it closes */
+    uint8_t* map;
+    uint64_t mapSize;
+    TsFanoutHeader* header;
+    const uint8_t* packets;
+    uint32_t capacity;
+    TsFanoutSlot* slot;
+    uint64_t cursor;
+    TsFanoutReaderStatistics statistics;
+};
+
+
+static void* handshakeTask(void* fanoutArgument);
+static void acceptReader(TsFanout* fanout);
+static void releaseReader(TsFanout* fanout, uint8_t slot);
+static void publishPackets(TsFanout* fanout, const uint8_t* data, uint32_t numberOfPackets);
+static void wakeReaders(TsFanout* fanout);
+static uint32_t copyPackets(TsFanoutReader* reader, uint8_t* buffer, uint32_t maxPackets);
+static bool waitForPackets(TsFanoutReader* reader, uint32_t timeout);
+static bool isProducerGone(TsFanoutReader* reader);
+
+
+TsFanoutError tsFanoutCreate(const char* socketPath, uint32_t capacity, TsFanout** fanout)
+{
+    TsFanout* newFanout = NULL;
+    struct sockaddr_un address;
+    uint8_t i = 0;
+
+    if (socketPath == NULL || fanout == NULL || capacity < TS_FANOUT_MIN_PACKETS
+        || strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    newFanout = (TsFanout*)malloc(sizeof(TsFanout));
+    if (newFanout == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+    memset(newFanout, 0x0, sizeof(TsFanout));
+    strcpy(newFanout->socketPath, socketPath);
+    newFanout->capacity = capacity;
+    newFanout->mapSize = TS_FANOUT_DATA_OFFSET + (uint64_t)capacity * TS_PACKET_SIZE;
+    newFanout->listenSocket = -1;
+    newFanout->wakePipe[0] = -1;
+    newFanout->wakePipe[1] = -1;
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        newFanout->connections[i] = -1;
+    }
+
+    /* sealed size lets readers trust the mapping never shrinks under them */
+    newFanout->memoryDescriptor = memfd_create("ts_fanout", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (newFanout->memoryDescriptor < 0 || ftruncate(newFanout->memoryDescriptor, newFanout->mapSize) < 0
+        || fcntl(newFanout->memoryDescriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+    {
+        printf("\n%s : ERROR cannot create shared memory (%s)\n", __FUNCTION__, strerror(errno));
+        if (newFanout->memoryDescriptor >= 0)
+        {
+            close(newFanout->memoryDescriptor);
+        }
+        free(newFanout);
+        return TF_ERROR;
+    }
+
+    newFanout->map = (uint8_t*)mmap(NULL, newFanout->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, newFanout->memoryDescriptor, 0);
+    if (newFanout->map == MAP_FAILED)
+    {
+        printf("\n%s : ERROR mmap failed (%s)\n", __FUNCTION__, strerror(errno));
+        close(newFanout->memoryDescriptor);
+        free(newFanout);
+        return TF_ERROR;
+    }
+    newFanout->header = (TsFanoutHeader*)newFanout->map;
+    newFanout->packets = newFanout->map + TS_FANOUT_DATA_OFFSET;
+
+    newFanout->header->magic = TS_FANOUT_MAGIC;
+    newFanout->header->version = TS_FANOUT_VERSION;
+    newFanout->header->packetSize = TS_PACKET_SIZE;
+    newFanout->header->capacity = capacity;
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        sem_init(&newFanout->header->slots[i].semaphore, 1, 0);
+    }
+
+    memset(&address, 0x0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    unlink(socketPath);
+
+    newFanout->listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (newFanout->listenSocket < 0 || bind(newFanout->listenSocket, (struct sockaddr*)&address, sizeof(address)) < 0
+        || listen(newFanout->listenSocket, TS_FANOUT_LISTEN_BACKLOG) < 0 || pipe(newFanout->wakePipe) < 0)
+    {
+        printf("\n%s : ERROR cannot listen on %s (%s)\n", __FUNCTION__, socketPath, strerror(errno));
+        tsFanoutDestroy(newFanout);
+        return TF_ERROR;
+    }
+
+    if (threadPolicyCreateThread(THREAD_ROLE_BACKGROUND, &newFanout->thread, handshakeTask, newFanout))
+    {
+        printf("\n%s : ERROR pthread_create() failed\n", __FUNCTION__);
+        close(newFanout->wakePipe[1]);
+        newFanout->wakePipe[1] = -1;
+        tsFanoutDestroy(newFanout);
+        return TF_THREAD_ERROR;
+    }
+
+    *fanout = newFanout;
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutDestroy(TsFanout* fanout)
+{
+    uint8_t i = 0;
+
+    if (fanout == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    /* thread is running only if its wake pipe is open */
+    if (fanout->wakePipe[1] >= 0)
+    {
+        if (write(fanout->wakePipe[1], "x", 1) != 1 || pthread_join(fanout->thread, NULL))
+        {
+            printf("\n%s : ERROR cannot stop handshake thread\n", __FUNCTION__);
+            return TF_THREAD_ERROR;
+        }
+        close(fanout->wakePipe[1]);
+    }
+    if (fanout->wakePipe[0] >= 0)
+    {
+        close(fanout->wakePipe[0]);
+    }
+
+    /* readers drain what is left and then see the ring closed */
+    TS_FANOUT_STORE(fanout->header->closed, 1);
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        sem_post(&fanout->header->slots[i].semaphore);
+        if (fanout->connections[i] >= 0)
+        {
+            close(fanout->connections[i]);
+        }
+    }
+
+    if (fanout->listenSocket >= 0)
+    {
+        close(fanout->listenSocket);
+        unlink(fanout->socketPath);
+    }
+    munmap(fanout->map, fanout->mapSize);
+    close(fanout->memoryDescriptor);
+    free(fanout);
+
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutWrite(TsFanout* fanout, const uint8_t* data, uint32_t length)
+{
+    const uint8_t* syncByte = NULL;
+    uint32_t offset = 0;
+    uint32_t copyLength = 0;
+    uint32_t runStart = 0;
+    uint32_t runPackets = 0;
+
+    if (fanout == NULL || (data == NULL && length != 0))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    /* complete packet split at the end of previous chunk */
+    if (fanout->carryLength > 0)
+    {
+        copyLength = TS_PACKET_SIZE - fanout->carryLength;
+        copyLength = (copyLength < length) ? copyLength : length;
+        memcpy(fanout->carry + fanout->carryLength, data, copyLength);
+        fanout->carryLength += copyLength;
+        offset = copyLength;
+
+        if (fanout->carryLength < TS_PACKET_SIZE)
+        {
+            return TF_NO_ERROR;
+        }
+        publishPackets(fanout, fanout->carry, 1);
+        fanout->carryLength = 0;
+    }
+
+    /* runs of aligned packets are published with one copy */
+    while (offset < length)
+    {
+        if (data[offset] != TS_SYNC_BYTE)
+        {
+            publishPackets(fanout, data + runStart, runPackets);
+            runPackets = 0;
+            if (fanout->inSync)
+            {
+                __atomic_store_n(&fanout->syncLosses, fanout->syncLosses + 1, __ATOMIC_RELAXED);
+                fanout->inSync = false;
+            }
+            syncByte = (const uint8_t*)memchr(data + offset, TS_SYNC_BYTE, length - offset);
+            if (syncByte == NULL)
+            {
+                break;
+            }
+            offset = syncByte - data;
+            continue;
+        }
+
+        if (length - offset < TS_PACKET_SIZE)
+        {
+            memcpy(fanout->carry, data + offset, length - offset);
+            fanout->carryLength = length - offset;
+            break;
+        }
+
+        fanout->inSync = true;
+        if (runPackets == 0)
+        {
+            runStart = offset;
+        }
+        runPackets++;
+        offset += TS_PACKET_SIZE;
+    }
+    publishPackets(fanout, data + runStart, runPackets);
+
+    wakeReaders(fanout);
+
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutGetStatistics(TsFanout* fanout, TsFanoutStatistics* statistics)
+{
+    TsFanoutSlot* slot = NULL;
+    uint64_t writeCount = 0;
+    uint64_t cursor = 0;
+    uint8_t i = 0;
+
+    if (fanout == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    memset(statistics, 0x0, sizeof(TsFanoutStatistics));
+    writeCount = TS_FANOUT_LOAD(fanout->header->writeCount);
+    statistics->writtenPackets = writeCount;
+    statistics->syncLosses = __atomic_load_n(&fanout->syncLosses, __ATOMIC_RELAXED);
+    statistics->connections = __atomic_load_n(&fanout->connectionCount, __ATOMIC_RELAXED);
+    statistics->rejectedConnections = __atomic_load_n(&fanout->rejectedConnections, __ATOMIC_RELAXED);
+
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        slot = &fanout->header->slots[i];
+        if (!TS_FANOUT_LOAD(slot->used))
+        {
+            continue;
+        }
+        /* cursor is written by the reader process, it can be behind by the packets it is copying */
+        cursor = __atomic_load_n(&slot->cursor, __ATOMIC_RELAXED);
+        statistics->readers[statistics->numberOfReaders].processId = slot->processId;
+        statistics->readers[statistics->numberOfReaders].lag = (writeCount > cursor) ? writeCount - cursor : 0;
+        statistics->readers[statistics->numberOfReaders].lostPackets = __atomic_load_n(&slot->lostPackets, __ATOMIC_RELAXED);
+        statistics->numberOfReaders++;
+    }
+
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutReaderOpen(const char* socketPath, TsFanoutReader** reader)
+{
+    TsFanoutReader* newReader = NULL;
+    TsFanoutHandshake handshake;
+    struct sockaddr_un address;
+    struct msghdr message;
+    struct iovec iov;
+    struct cmsghdr* controlMessage = NULL;
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    }control;
+    struct stat memoryStat;
+    int memoryDescriptor = -1;
+
+    if (socketPath == NULL || reader == NULL || strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    newReader = (TsFanoutReader*)malloc(sizeof(TsFanoutReader));
+    if (newReader == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+    memset(newReader, 0x0, sizeof(TsFanoutReader));
+
+    memset(&address, 0x0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    newReader->socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (newReader->socket < 0 || connect(newReader->socket, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        printf("\n%s : ERROR cannot connect to %s (%s)\n", __FUNCTION__, socketPath, strerror(errno));
+        if (newReader->socket >= 0)
+        {
+            close(newReader->socket);
+        }
+        free(newReader);
+        return TF_ERROR;
+    }
+
+    memset(&message, 0x0, sizeof(message));
+    iov.iov_base = &handshake;
+    iov.iov_len = sizeof(handshake);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    /* producer closes the connection without a message when all slots are used */
+    if (recvmsg(newReader->socket, &message, MSG_CMSG_CLOEXEC) != sizeof(handshake) || handshake.magic != TS_FANOUT_MAGIC
+        || handshake.slot >= TS_FANOUT_MAX_READERS)
+    {
+        printf("\n%s : ERROR no handshake from %s\n", __FUNCTION__, socketPath);
+        close(newReader->socket);
+        free(newReader);
+        return TF_ERROR;
+    }
+    controlMessage = CMSG_FIRSTHDR(&message);
+    if (controlMessage != NULL && controlMessage->cmsg_level == SOL_SOCKET && controlMessage->cmsg_type == SCM_RIGHTS)
+    {
+        memcpy(&memoryDescriptor, CMSG_DATA(controlMessage), sizeof(int));
+    }
+    if (memoryDescriptor < 0 || fstat(memoryDescriptor, &memoryStat) < 0 || (uint64_t)memoryStat.st_size != handshake.mapSize)
+    {
+        printf("\n%s : ERROR handshake did not carry the ring\n", __FUNCTION__);
+        if (memoryDescriptor >= 0)
+        {
+            close(memoryDescriptor);
+        }
+        close(newReader->socket);
+        free(newReader);
+        return TF_ERROR;
+    }
+
+    /* reader writes only its own slot, packets are never written */
+    newReader->mapSize = handshake.mapSize;
+    newReader->map = (uint8_t*)mmap(NULL, newReader->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memoryDescriptor, 0);
+    close(memoryDescriptor);
+    if (newReader->map == MAP_FAILED)
+    {
+        printf("\n%s : ERROR mmap failed (%s)\n", __FUNCTION__, strerror(errno));
+        close(newReader->socket);
+        free(newReader);
+        return TF_ERROR;
+    }
+    newReader->header = (TsFanoutHeader*)newReader->map;
+    newReader->capacity = newReader->header->capacity;
+    if (newReader->header->version != TS_FANOUT_VERSION || newReader->header->packetSize != TS_PACKET_SIZE
+        || TS_FANOUT_DATA_OFFSET + (uint64_t)newReader->capacity * TS_PACKET_SIZE > newReader->mapSize)
+    {
+        printf("\n%s : ERROR ring layout is not supported\n", __FUNCTION__);
+        munmap(newReader->map, newReader->mapSize);
+        close(newReader->socket);
+        free(newReader);
+        return TF_ERROR;
+    }
+    newReader->packets = newReader->map + TS_FANOUT_DATA_OFFSET;
+    newReader->slot = &newReader->header->slots[handshake.slot];
+    newReader->cursor = TS_FANOUT_LOAD(newReader->slot->cursor);
+
+    *reader = newReader;
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutReaderClose(TsFanoutReader* reader)
+{
+    if (reader == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    munmap(reader->map, reader->mapSize);
+    close(reader->socket);
+    free(reader);
+
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutRead(TsFanoutReader* reader, uint8_t* buffer, uint32_t maxPackets, uint32_t timeout, uint32_t* numberOfPackets)
+{
+    uint32_t copied = 0;
+
+    if (reader == NULL || buffer == NULL || maxPackets == 0 || numberOfPackets == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    copied = copyPackets(reader, buffer, maxPackets);
+    if (copied == 0 && timeout != 0 && waitForPackets(reader, timeout))
+    {
+        copied = copyPackets(reader, buffer, maxPackets);
+    }
+
+    *numberOfPackets = copied;
+    if (copied == 0 && isProducerGone(reader))
+    {
+        return TF_ERROR;
+    }
+
+    return TF_NO_ERROR;
+}
+
+TsFanoutError tsFanoutReaderGetStatistics(TsFanoutReader* reader, TsFanoutReaderStatistics* statistics)
+{
+    if (reader == NULL || statistics == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TF_ERROR;
+    }
+
+    *statistics = reader->statistics;
+    statistics->lag = TS_FANOUT_LOAD(reader->header->writeCount) - reader->cursor;
+
+    return TF_NO_ERROR;
+}
+
+/**
+ * @brief Hands the ring to connecting readers and frees slots of readers that disconnected
+ */
+void* handshakeTask(void* fanoutArgument)
+{
+    TsFanout* fanout = (TsFanout*)fanoutArgument;
+    struct pollfd descriptors[2 + TS_FANOUT_MAX_READERS];
+    uint8_t slots[2 + TS_FANOUT_MAX_READERS];
+    uint8_t numberOfDescriptors = 0;
+    uint8_t i = 0;
+    char byte = 0;
+
+    while (1)
+    {
+        descriptors[0].fd = fanout->wakePipe[0];
+        descriptors[0].events = POLLIN;
+        descriptors[1].fd = fanout->listenSocket;
+        descriptors[1].events = POLLIN;
+        numberOfDescriptors = 2;
+        for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+        {
+            if (fanout->connections[i] >= 0)
+            {
+                descriptors[numberOfDescriptors].fd = fanout->connections[i];
+                descriptors[numberOfDescriptors].events = POLLIN;
+                slots[numberOfDescriptors] = i;
+                numberOfDescriptors++;
+            }
+        }
+
+        if (poll(descriptors, numberOfDescriptors, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("\n%s : ERROR poll failed (%s)\n", __FUNCTION__, strerror(errno));
+            break;
+        }
+
+        if (descriptors[0].revents != 0)
+        {
+            break;
+        }
+
+        /* readers never send, readable connection means it was closed */
+        for (i = 2; i < numberOfDescriptors; i++)
+        {
+            if (descriptors[i].revents != 0 && recv(descriptors[i].fd, &byte, 1, MSG_DONTWAIT) <= 0)
+            {
+                releaseReader(fanout, slots[i]);
+            }
+        }
+
+        if (descriptors[1].revents & POLLIN)
+        {
+            acceptReader(fanout);
+        }
+    }
+
+    return NULL;
+}
+
+void acceptReader(TsFanout* fanout)
+{
+    TsFanoutSlot* slot = NULL;
+    TsFanoutHandshake handshake;
+    struct ucred credentials;
+    socklen_t credentialsLength = sizeof(credentials);
+    struct msghdr message;
+    struct iovec iov;
+    struct cmsghdr* controlMessage = NULL;
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    }control;
+    int connection = -1;
+    uint8_t i = 0;
+
+    connection = accept(fanout->listenSocket, NULL, NULL);
+    if (connection < 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        if (fanout->connections[i] < 0)
+        {
+            break;
+        }
+    }
+    if (i == TS_FANOUT_MAX_READERS)
+    {
+        __atomic_store_n(&fanout->rejectedConnections, fanout->rejectedConnections + 1, __ATOMIC_RELAXED);
+        close(connection);
+        return;
+    }
+
+    /* new reader starts at the newest packet, posts meant for the previous reader are dropped */
+    slot = &fanout->header->slots[i];
+    while (sem_trywait(&slot->semaphore) == 0);
+    slot->processId = (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsLength) == 0) ? credentials.pid : -1;
+    slot->waiting = 0;
+    slot->lostPackets = 0;
+    slot->cursor = TS_FANOUT_LOAD(fanout->header->writeCount);
+    TS_FANOUT_STORE(slot->used, 1);
+
+    handshake.magic = TS_FANOUT_MAGIC;
+    handshake.slot = i;
+    handshake.mapSize = fanout->mapSize;
+
+    memset(&message, 0x0, sizeof(message));
+    iov.iov_base = &handshake;
+    iov.iov_len = sizeof(handshake);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    controlMessage = CMSG_FIRSTHDR(&message);
+    controlMessage->cmsg_level = SOL_SOCKET;
+    controlMessage->cmsg_type = SCM_RIGHTS;
+    controlMessage->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(controlMessage), &fanout->memoryDescriptor, sizeof(int));
+
+    fanout->connections[i] = connection;
+    if (sendmsg(connection, &message, MSG_NOSIGNAL) != sizeof(handshake))
+    {
+        printf("\n%s : ERROR handshake failed (%s)\n", __FUNCTION__, strerror(errno));
+        releaseReader(fanout, i);
+        return;
+    }
+
+    __atomic_store_n(&fanout->connectionCount, fanout->connectionCount + 1, __ATOMIC_RELAXED);
+}
+
+void releaseReader(TsFanout* fanout, uint8_t slot)
+{
+    TS_FANOUT_STORE(fanout->header->slots[slot].used, 0);
+    close(fanout->connections[slot]);
+    fanout->connections[slot] = -1;
+}
+
+/**
+ * @brief Copies packets into the ring and publishes them, wrapping at the end of the ring
+ *
+ * writeStart is raised before the copy, so a reader that copied while it ran can tell which packets it got torn.
+ */
+void publishPackets(TsFanout* fanout, const uint8_t* data, uint32_t numberOfPackets)
+{
+    uint64_t writeCount = fanout->header->writeCount;
+    uint32_t index = 0;
+    uint32_t count = 0;
+
+    while (numberOfPackets > 0)
+    {
+        index = (uint32_t)(writeCount % fanout->capacity);
+        count = (numberOfPackets < fanout->capacity - index) ? numberOfPackets : fanout->capacity - index;
+
+        __atomic_store_n(&fanout->header->writeStart, writeCount + count, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(fanout->packets + (uint64_t)index * TS_PACKET_SIZE, data, (uint64_t)count * TS_PACKET_SIZE);
+        writeCount += count;
+        TS_FANOUT_STORE(fanout->header->writeCount, writeCount);
+
+        data += (uint64_t)count * TS_PACKET_SIZE;
+        numberOfPackets -= count;
+    }
+}
+
+/* waiting flag and writeCount are both sequentially consistent, so either the reader sees new packets or the producer sees the flag */
+void wakeReaders(TsFanout* fanout)
+{
+    TsFanoutSlot* slot = NULL;
+    uint8_t i = 0;
+
+    for (i = 0; i < TS_FANOUT_MAX_READERS; i++)
+    {
+        slot = &fanout->header->slots[i];
+        if (__atomic_load_n(&slot->waiting, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&slot->waiting, 0, __ATOMIC_SEQ_CST))
+        {
+            sem_post(&slot->semaphore);
+        }
+    }
+}
+
+/**
+ * @brief Copies available packets and drops those the producer overwrote meanwhile
+ *
+ * @return number of valid packets in buffer
+ */
+uint32_t copyPackets(TsFanoutReader* reader, uint8_t* buffer, uint32_t maxPackets)
+{
+    uint64_t writeCount = 0;
+    uint64_t writeStart = 0;
+    uint64_t torn = 0;
+    uint32_t count = 0;
+    uint32_t index = 0;
+    uint32_t first = 0;
+
+    writeCount = TS_FANOUT_LOAD(reader->header->writeCount);
+    if (writeCount - reader->cursor > reader->capacity)
+    {
+        /* producer went around, continue a quarter ring ahead of its oldest packet so it does not overtake again at once */
+        reader->statistics.lostPackets += writeCount - reader->capacity + reader->capacity / 4 - reader->cursor;
+        reader->statistics.overruns++;
+        reader->cursor = writeCount - reader->capacity + reader->capacity / 4;
+    }
+
+    count = (writeCount - reader->cursor < maxPackets) ? (uint32_t)(writeCount - reader->cursor) : maxPackets;
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    index = (uint32_t)(reader->cursor % reader->capacity);
+    first = (count < reader->capacity - index) ? count : reader->capacity - index;
+    memcpy(buffer, reader->packets + (uint64_t)index * TS_PACKET_SIZE, (uint64_t)first * TS_PACKET_SIZE);
+    memcpy(buffer + (uint64_t)first * TS_PACKET_SIZE, reader->packets, (uint64_t)(count - first) * TS_PACKET_SIZE);
+
+    /* packets the producer started to overwrite during the copy are not valid */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    writeStart = __atomic_load_n(&reader->header->writeStart, __ATOMIC_RELAXED);
+    if (writeStart > reader->capacity && reader->cursor < writeStart - reader->capacity)
+    {
+        torn = writeStart - reader->capacity - reader->cursor;
+        torn = (torn < count) ? torn : count;
+        memmove(buffer, buffer + torn * TS_PACKET_SIZE, (count - torn) * TS_PACKET_SIZE);
+        reader->statistics.lostPackets += torn;
+        reader->statistics.overruns++;
+    }
+
+    reader->cursor += count;
+    reader->statistics.readPackets += count - torn;
+    __atomic_store_n(&reader->slot->cursor, reader->cursor, __ATOMIC_RELAXED);
+    __atomic_store_n(&reader->slot->lostPackets, reader->statistics.lostPackets, __ATOMIC_RELAXED);
+
+    return count - (uint32_t)torn;
+}
+
+/**
+ * @brief Sleeps until producer publishes packets or timeout expires
+ *
+ * @return true if packets may be available
+ */
+bool waitForPackets(TsFanoutReader* reader, uint32_t timeout)
+{
+    struct timespec deadline;
+    bool available = false;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    __atomic_store_n(&reader->slot->waiting, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&reader->header->writeCount, __ATOMIC_SEQ_CST) == reader->cursor && !TS_FANOUT_LOAD(reader->header->closed))
+    {
+        if (sem_timedwait(&reader->slot->semaphore, &deadline) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        __atomic_store_n(&reader->slot->waiting, 1, __ATOMIC_SEQ_CST);
+    }
+    available = (TS_FANOUT_LOAD(reader->header->writeCount) != reader->cursor);
+    __atomic_store_n(&reader->slot->waiting, 0, __ATOMIC_SEQ_CST);
+
+    return available;
+}
+
+/* producer either marked the ring closed or its process died and the connection hung up */
+bool isProducerGone(TsFanoutReader* reader)
+{
+    struct pollfd descriptor;
+
+    if (TS_FANOUT_LOAD(reader->header->closed))
+    {
+        return true;
+    }
+
+    descriptor.fd = reader->socket;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+
+    return (poll(&descriptor, 1, 0) > 0 && (descriptor.revents & (POLLHUP | POLLERR | POLLIN)));
+}
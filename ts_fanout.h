@@ -0,0 +1,149 @@
+#ifndef __TS_FANOUT_H__
+#define __TS_FANOUT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pthread.h"
+#include "ts_packet.h"
+
+#define TS_FANOUT_MAX_READERS 8                     /* Readers connected to one ring at the same time */
+#define TS_FANOUT_MIN_PACKETS 1024                  /* Smallest ring, in packets */
+
+/**
+ * @brief Enumeration of possible TS fan-out error codes
+ */
+typedef enum _TsFanoutError
+{
+    TF_NO_ERROR = 0,
+    TF_ERROR,
+    TF_THREAD_ERROR
+}TsFanoutError;
+
+/**
+ * @brief Structure that describes one connected reader, as seen by the producer
+ */
+typedef struct _TsFanoutReaderInfo
+{
+    int32_t processId;                              /* Reader process, from the socket credentials */
+    uint64_t lag;                                   /* Packets published but not read yet */
+    uint64_t lostPackets;                           /* Packets overwritten before the reader got to them */
+}TsFanoutReaderInfo;
+
+/**
+ * @brief Structure that holds producer counters
+ */
+typedef struct _TsFanoutStatistics
+{
+    uint64_t writtenPackets;
+    uint32_t syncLosses;                            /* Times written data did not start with sync byte */
+    uint32_t connections;                           /* Readers that got the ring since creation */
+    uint32_t rejectedConnections;                   /* Readers refused because all slots were used */
+    uint8_t numberOfReaders;
+    TsFanoutReaderInfo readers[TS_FANOUT_MAX_READERS];
+}TsFanoutStatistics;
+
+/**
+ * @brief Structure that holds reader counters
+ */
+typedef struct _TsFanoutReaderStatistics
+{
+    uint64_t readPackets;
+    uint64_t lostPackets;                           /* Packets overwritten before they were read */
+    uint32_t overruns;                              /* Times the producer overtook the reader */
+    uint64_t lag;                                   /* Packets published but not read yet */
+}TsFanoutReaderStatistics;
+
+/**
+ * @brief Producer side of the ring, owns shared memory and the socket readers connect to
+ */
+typedef struct _TsFanout TsFanout;
+
+/**
+ * @brief Reader side of the ring, maps shared memory received from the producer
+ */
+typedef struct _TsFanoutReader TsFanoutReader;
+
+/**
+ * @brief Creates shared memory ring, listens on Unix socket and starts thread that hands the ring to readers
+ *
+ * @param [in] socketPath - Unix socket path, replaced if it exists
+ * @param [in] capacity - ring size in packets, at least TS_FANOUT_MIN_PACKETS
+ * @param [out] fanout - created producer
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutCreate(const char* socketPath, uint32_t capacity, TsFanout** fanout);
+
+/**
+ * @brief Disconnects readers, removes socket and frees producer
+ *
+ * Readers keep their mapping, they see no new packets and get error once nothing is left to read.
+ *
+ * @param [in] fanout - producer to destroy
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutDestroy(TsFanout* fanout);
+
+/**
+ * @brief Publishes transport stream to all readers
+ *
+ * Must be called from a single thread. Never waits for readers, packets a slow reader did not read
+ * in time are overwritten and counted as lost on its side. Chunks do not have to be packet aligned.
+ *
+ * @param [in] fanout - producer
+ * @param [in] data - transport stream bytes
+ * @param [in] length - number of bytes in data
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutWrite(TsFanout* fanout, const uint8_t* data, uint32_t length);
+
+/**
+ * @brief Returns producer counters and lag of every connected reader
+ *
+ * @param [in] fanout - producer
+ * @param [out] statistics - counters
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutGetStatistics(TsFanout* fanout, TsFanoutStatistics* statistics);
+
+/**
+ * @brief Connects to producer and maps its ring, reading starts at the newest packet
+ *
+ * @param [in] socketPath - Unix socket the producer listens on
+ * @param [out] reader - opened reader
+ * @return TS fan-out error code, TF_ERROR if producer is not running or has no free slot
+ */
+TsFanoutError tsFanoutReaderOpen(const char* socketPath, TsFanoutReader** reader);
+
+/**
+ * @brief Disconnects from producer, unmaps ring and frees reader
+ *
+ * @param [in] reader - reader to close
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutReaderClose(TsFanoutReader* reader);
+
+/**
+ * @brief Copies next packets out of the ring
+ *
+ * @param [in] reader - reader
+ * @param [out] buffer - receives whole packets
+ * @param [in] maxPackets - buffer size in packets
+ * @param [in] timeout - milliseconds to wait when no packet is available, 0 returns at once
+ * @param [out] numberOfPackets - packets copied, 0 if timeout expired
+ * @return TS fan-out error code, TF_ERROR once producer is gone and all packets were read
+ */
+TsFanoutError tsFanoutRead(TsFanoutReader* reader, uint8_t* buffer, uint32_t maxPackets, uint32_t timeout, uint32_t* numberOfPackets);
+
+/**
+ * @brief Returns reader counters
+ *
+ * @param [in] reader - reader
+ * @param [out] statistics - counters
+ * @return TS fan-out error code
+ */
+TsFanoutError tsFanoutReaderGetStatistics(TsFanoutReader* reader, TsFanoutReaderStatistics* statistics);
+
+#endif /* __TS_FANOUT_H__ */
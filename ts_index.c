@@ -0,0 +1,571 @@
+#include "ts_index.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TS_INDEX_PCR_WRAP (1ULL << 33)
+#define TS_INDEX_MAX_PCR_STEP 900000                /* PCR step above 10 s, or any step back, is a discontinuity */
+
+/**
+ * @brief Structure that holds state of the index writer
+ */
+struct _TsIndexWriter
+{
+    int fileDescriptor;
+    uint16_t pcrPid;
+    uint16_t videoPid;
+    uint8_t videoStreamType;
+
+    bool timeValid;
+    uint64_t lastPcr;                               /* Last 33 bit PCR base */
+    uint64_t time;                                  /* Unwrapped recording time of last PCR */
+    uint64_t lastPcrRecordTime;
+
+    TsIndexRecord records[TS_INDEX_WRITE_RECORDS];
+    uint32_t numberOfRecords;
+};
+
+/**
+ * @brief Structure that holds mapped index file
+ */
+struct _TsIndex
+{
+    int fileDescriptor;
+    uint8_t* map;
+    uint64_t mapSize;
+    const TsIndexRecord* records;
+    uint64_t count;
+};
+
+
+static void indexPacket(TsIndexWriter* writer, const uint8_t* packet, uint64_t offset);
+static void updateTime(TsIndexWriter* writer, uint64_t pcr);
+static bool isRandomAccessPicture(const uint8_t* data, uint32_t length, uint8_t streamType);
+static void appendRecord(TsIndexWriter* writer, uint64_t offset, uint64_t pts, uint32_t flags);
+static TsIndexError mapIndex(TsIndex* index);
+static uint64_t findLastTime(TsIndex* index, uint64_t time);
+static uint64_t findLastOffset(TsIndex* index, uint64_t offset);
+
+
+TsIndexError tsIndexWriterCreate(const char* fileName, TsIndexWriter** writer)
+{
+    TsIndexWriter* newWriter = NULL;
+    TsIndexHeader header;
+
+    if (fileName == NULL || writer == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    newWriter = (TsIndexWriter*)malloc(sizeof(TsIndexWriter));
+    if (newWriter == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+    memset(newWriter, 0x0, sizeof(TsIndexWriter));
+    newWriter->pcrPid = TS_INDEX_NO_PID;
+    newWriter->videoPid = TS_INDEX_NO_PID;
+
+    newWriter->fileDescriptor = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (newWriter->fileDescriptor < 0)
+    {
+        printf("\n%s : ERROR Cannot open %s\n", __FUNCTION__, fileName);
+        free(newWriter);
+        return TI_ERROR;
+    }
+
+    memset(&header, 0x0, sizeof(TsIndexHeader));
+    header.magic = TS_INDEX_MAGIC;
+    header.version = TS_INDEX_VERSION;
+    header.recordSize = sizeof(TsIndexRecord);
+    if (write(newWriter->fileDescriptor, &header, sizeof(TsIndexHeader)) != sizeof(TsIndexHeader))
+    {
+        printf("\n%s : ERROR Cannot write %s\n", __FUNCTION__, fileName);
+        close(newWriter->fileDescriptor);
+        free(newWriter);
+        return TI_ERROR;
+    }
+
+    *writer = newWriter;
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexWriterDestroy(TsIndexWriter* writer)
+{
+    TsIndexError error = TI_NO_ERROR;
+
+    if (writer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    error = tsIndexWriterFlush(writer);
+    close(writer->fileDescriptor);
+    free(writer);
+
+    return error;
+}
+
+TsIndexError tsIndexWriterSetProgram(TsIndexWriter* writer, uint16_t pcrPid, uint16_t videoPid, uint8_t streamType)
+{
+    if (writer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    writer->pcrPid = pcrPid;
+    writer->videoPid = videoPid;
+    writer->videoStreamType = streamType;
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexWriterProcess(TsIndexWriter* writer, const uint8_t* data, uint32_t length, uint64_t streamOffset)
+{
+    uint32_t offset = 0;
+
+    if (writer == NULL || (data == NULL && length != 0))
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    for (offset = 0; offset + TS_PACKET_SIZE <= length; offset += TS_PACKET_SIZE)
+    {
+        if (data[offset] == TS_SYNC_BYTE)
+        {
+            indexPacket(writer, data + offset, streamOffset + offset);
+        }
+    }
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexWriterFlush(TsIndexWriter* writer)
+{
+    ssize_t length = 0;
+
+    if (writer == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    if (writer->numberOfRecords == 0)
+    {
+        return TI_NO_ERROR;
+    }
+
+    /* whole records only, a reader never maps half of one */
+    length = writer->numberOfRecords * sizeof(TsIndexRecord);
+    writer->numberOfRecords = 0;
+    if (write(writer->fileDescriptor, writer->records, length) != length)
+    {
+        printf("\n%s : ERROR write() fail\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexOpen(const char* fileName, TsIndex** index)
+{
+    TsIndex* newIndex = NULL;
+    TsIndexHeader header;
+
+    if (fileName == NULL || index == NULL)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    newIndex = (TsIndex*)malloc(sizeof(TsIndex));
+    if (newIndex == NULL)
+    {
+        printf("\n%s : ERROR Cannot allocate memory\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+    memset(newIndex, 0x0, sizeof(TsIndex));
+
+    newIndex->fileDescriptor = open(fileName, O_RDONLY);
+    if (newIndex->fileDescriptor < 0)
+    {
+        printf("\n%s : ERROR Cannot open %s\n", __FUNCTION__, fileName);
+        free(newIndex);
+        return TI_ERROR;
+    }
+
+    if (read(newIndex->fileDescriptor, &header, sizeof(TsIndexHeader)) != sizeof(TsIndexHeader)
+        || header.magic != TS_INDEX_MAGIC || header.version != TS_INDEX_VERSION || header.recordSize != sizeof(TsIndexRecord))
+    {
+        printf("\n%s : ERROR %s is not a TS index\n", __FUNCTION__, fileName);
+        close(newIndex->fileDescriptor);
+        free(newIndex);
+        return TI_ERROR;
+    }
+
+    if (mapIndex(newIndex))
+    {
+        close(newIndex->fileDescriptor);
+        free(newIndex);
+        return TI_ERROR;
+    }
+
+    *index = newIndex;
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexClose(TsIndex* index)
+{
+    if (index == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    munmap(index->map, index->mapSize);
+    close(index->fileDescriptor);
+    free(index);
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexRefresh(TsIndex* index)
+{
+    struct stat fileStatus;
+
+    if (index == NULL)
+    {
+        printf("\n%s : ERROR received parameter is not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    if (fstat(index->fileDescriptor, &fileStatus) || (uint64_t)fileStatus.st_size == index->mapSize)
+    {
+        return TI_NO_ERROR;
+    }
+
+    munmap(index->map, index->mapSize);
+    index->map = NULL;
+
+    return mapIndex(index);
+}
+
+uint64_t tsIndexGetCount(TsIndex* index)
+{
+    return (index != NULL) ? index->count : 0;
+}
+
+TsIndexError tsIndexGetRecord(TsIndex* index, uint64_t recordNumber, TsIndexRecord* record)
+{
+    if (index == NULL || record == NULL || recordNumber >= index->count)
+    {
+        printf("\n%s : ERROR received parameters are not ok\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    *record = index->records[recordNumber];
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexFindTime(TsIndex* index, uint64_t time, TsIndexRecord* record)
+{
+    if (index == NULL || record == NULL || index->count == 0)
+    {
+        return TI_ERROR;
+    }
+
+    *record = index->records[findLastTime(index, time)];
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexFindOffset(TsIndex* index, uint64_t offset, TsIndexRecord* record)
+{
+    if (index == NULL || record == NULL || index->count == 0)
+    {
+        return TI_ERROR;
+    }
+
+    *record = index->records[findLastOffset(index, offset)];
+
+    return TI_NO_ERROR;
+}
+
+TsIndexError tsIndexFindRandomAccess(TsIndex* index, uint64_t time, uint64_t minimumOffset, TsIndexRecord* record)
+{
+    uint64_t recordNumber = 0;
+    uint64_t scanned = 0;
+
+    if (index == NULL || record == NULL || index->count == 0)
+    {
+        return TI_ERROR;
+    }
+
+    /* random access points are a GOP apart, so only a few records are looked at */
+    recordNumber = findLastTime(index, time);
+    if (index->records[recordNumber].offset < minimumOffset)
+    {
+        /* time is older than what can still be played, oldest playable random access point is used */
+        recordNumber = findLastOffset(index, minimumOffset);
+    }
+    for (scanned = 0; scanned < TS_INDEX_MAX_RAP_SCAN && index->records[recordNumber].offset >= minimumOffset; scanned++)
+    {
+        if (index->records[recordNumber].flags & TS_INDEX_FLAG_RAP)
+        {
+            *record = index->records[recordNumber];
+            return TI_NO_ERROR;
+        }
+        if (recordNumber == 0)
+        {
+            break;
+        }
+        recordNumber--;
+    }
+
+    for (scanned = 0; scanned < TS_INDEX_MAX_RAP_SCAN && recordNumber < index->count; scanned++, recordNumber++)
+    {
+        if ((index->records[recordNumber].flags & TS_INDEX_FLAG_RAP) && index->records[recordNumber].offset >= minimumOffset)
+        {
+            *record = index->records[recordNumber];
+            return TI_NO_ERROR;
+        }
+    }
+
+    return TI_ERROR;
+}
+
+void indexPacket(TsIndexWriter* writer, const uint8_t* packet, uint64_t offset)
+{
+    uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x3;
+    uint32_t payloadOffset = 4;
+    uint32_t esOffset = 0;
+    uint64_t pts = 0;
+    uint32_t flags = 0;
+    bool randomAccess = false;
+
+    if (adaptationFieldControl & 0x2)
+    {
+        payloadOffset = 5 + packet[4];
+        if (packet[4] > 0)
+        {
+            randomAccess = (packet[5] & 0x40) != 0;
+            if ((packet[5] & 0x10) && packet[4] >= 7 && (writer->pcrPid == TS_INDEX_NO_PID || pid == writer->pcrPid))
+            {
+                updateTime(writer, ((uint64_t)packet[6] << 25) | ((uint64_t)packet[7] << 17) | ((uint64_t)packet[8] << 9)
+                    | ((uint64_t)packet[9] << 1) | (packet[10] >> 7));
+                flags |= TS_INDEX_FLAG_PCR;
+            }
+        }
+    }
+
+    /* pictures are indexed from the packet their PES starts in, start codes of random access points follow PES header */
+    if (pid == writer->videoPid && (packet[1] & 0x40) && (adaptationFieldControl & 0x1) && payloadOffset + 9 <= TS_PACKET_SIZE
+        && packet[payloadOffset] == 0x00 && packet[payloadOffset + 1] == 0x00 && packet[payloadOffset + 2] == 0x01)
+    {
+        if ((packet[payloadOffset + 7] & 0x80) && payloadOffset + 14 <= TS_PACKET_SIZE)
+        {
+            pts = ((uint64_t)(packet[payloadOffset + 9] & 0x0E) << 29) | ((uint64_t)packet[payloadOffset + 10] << 22)
+                | ((uint64_t)(packet[payloadOffset + 11] & 0xFE) << 14) | ((uint64_t)packet[payloadOffset + 12] << 7)
+                | (packet[payloadOffset + 13] >> 1);
+            flags |= TS_INDEX_FLAG_PTS;
+        }
+
+        esOffset = payloadOffset + 9 + packet[payloadOffset + 8];
+        if (randomAccess || (esOffset < TS_PACKET_SIZE
+            && isRandomAccessPicture(packet + esOffset, TS_PACKET_SIZE - esOffset, writer->videoStreamType)))
+        {
+            flags |= TS_INDEX_FLAG_RAP;
+        }
+    }
+
+    if (!writer->timeValid)
+    {
+        return;
+    }
+
+    /* PCR alone is recorded often enough to map time to offset, pictures only when decoding can start there */
+    if ((flags & TS_INDEX_FLAG_RAP) || ((flags & TS_INDEX_FLAG_PCR) && writer->time - writer->lastPcrRecordTime >= TS_INDEX_PCR_INTERVAL))
+    {
+        if (flags & TS_INDEX_FLAG_PCR)
+        {
+            writer->lastPcrRecordTime = writer->time;
+        }
+        appendRecord(writer, offset, pts, flags);
+    }
+}
+
+/* Keeps recording time growing over PCR wraps and discontinuities such as a channel change */
+void updateTime(TsIndexWriter* writer, uint64_t pcr)
+{
+    uint64_t step = 0;
+
+    if (!writer->timeValid)
+    {
+        writer->timeValid = true;
+        writer->lastPcr = pcr;
+        writer->time = pcr;
+        writer->lastPcrRecordTime = pcr - TS_INDEX_PCR_INTERVAL;
+        return;
+    }
+
+    step = (pcr + TS_INDEX_PCR_WRAP - writer->lastPcr) % TS_INDEX_PCR_WRAP;
+    if (step > TS_INDEX_MAX_PCR_STEP)
+    {
+        step = 0;
+    }
+    writer->time += step;
+    writer->lastPcr = pcr;
+}
+
+/* Sequence or GOP header for MPEG-2, IDR or SPS for H.264, IRAP or parameter set for HEVC */
+bool isRandomAccessPicture(const uint8_t* data, uint32_t length, uint8_t streamType)
+{
+    uint32_t i = 0;
+    uint8_t code = 0;
+
+    for (i = 0; i + 3 < length; i++)
+    {
+        if (data[i] != 0x00 || data[i + 1] != 0x00 || data[i + 2] != 0x01)
+        {
+            continue;
+        }
+
+        code = data[i + 3];
+        switch (streamType)
+        {
+            case 0x01:
+            case 0x02:
+                if (code == 0xB3 || code == 0xB8)
+                {
+                    return true;
+                }
+                /* picture header of I picture */
+                if (code == 0x00 && i + 5 < length && ((data[i + 5] >> 3) & 0x7) == 1)
+                {
+                    return true;
+                }
+                break;
+            case 0x1B:
+                if ((code & 0x1F) == 5 || (code & 0x1F) == 7)
+                {
+                    return true;
+                }
+                break;
+            case 0x24:
+                if (((code >> 1) & 0x3F) >= 16 && ((code >> 1) & 0x3F) <= 21)
+                {
+                    return true;
+                }
+                if (((code >> 1) & 0x3F) >= 32 && ((code >> 1) & 0x3F) <= 34)
+                {
+                    return true;
+                }
+                break;
+            default:
+                return false;
+        }
+        i += 2;
+    }
+
+    return false;
+}
+
+void appendRecord(TsIndexWriter* writer, uint64_t offset, uint64_t pts, uint32_t flags)
+{
+    TsIndexRecord* record = &writer->records[writer->numberOfRecords];
+
+    record->offset = offset;
+    record->time = writer->time;
+    record->pts = pts;
+    record->flags = flags;
+    record->reserved = 0;
+
+    writer->numberOfRecords++;
+    if (writer->numberOfRecords == TS_INDEX_WRITE_RECORDS)
+    {
+        tsIndexWriterFlush(writer);
+    }
+}
+
+TsIndexError mapIndex(TsIndex* index)
+{
+    struct stat fileStatus;
+
+    if (fstat(index->fileDescriptor, &fileStatus) || (uint64_t)fileStatus.st_size < sizeof(TsIndexHeader))
+    {
+        printf("\n%s : ERROR fstat() fail\n", __FUNCTION__);
+        return TI_ERROR;
+    }
+
+    index->mapSize = fileStatus.st_size;
+    index->map = (uint8_t*)mmap(NULL, index->mapSize, PROT_READ, MAP_SHARED, index->fileDescriptor, 0);
+    if (index->map == MAP_FAILED)
+    {
+        printf("\n%s : ERROR mmap() fail\n", __FUNCTION__);
+        index->map = NULL;
+        index->mapSize = 0;
+        index->count = 0;
+        return TI_ERROR;
+    }
+
+    index->records = (const TsIndexRecord*)(index->map + sizeof(TsIndexHeader));
+    index->count = (index->mapSize - sizeof(TsIndexHeader)) / sizeof(TsIndexRecord);
+
+    return TI_NO_ERROR;
+}
+
+/* Number of last record at or before time, 0 if all are later */
+uint64_t findLastTime(TsIndex* index, uint64_t time)
+{
+    uint64_t first = 0;
+    uint64_t last = index->count - 1;
+    uint64_t middle = 0;
+
+    while (first < last)
+    {
+        middle = first + (last - first + 1) / 2;
+        if (index->records[middle].time <= time)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle - 1;
+        }
+    }
+
+    return first;
+}
+
+/* Number of last record at or before offset, 0 if all are later */
+uint64_t findLastOffset(TsIndex* index, uint64_t offset)
+{
+    uint64_t first = 0;
+    uint64_t last = index->count - 1;
+    uint64_t middle = 0;
+
+    while (first < last)
+    {
+        middle = first + (last - first + 1) / 2;
+        if (index->records[middle].offset <= offset)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle - 1;
+        }
+    }
+
+    return first;
+}
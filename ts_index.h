@@ -0,0 +1,188 @@
+#ifndef __TS_INDEX_H__
+#define __TS_INDEX_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ts_packet.h"
+
+#define TS_INDEX_MAGIC 0x58495354                   /* "TSIX" */
+#define TS_INDEX_VERSION 1
+#define TS_INDEX_PCR_INTERVAL 9000                  /* 90 kHz ticks between two PCR only records */
+#define TS_INDEX_WRITE_RECORDS 128                  /* Records collected before they are appended to the file */
+#define TS_INDEX_MAX_RAP_SCAN 4096                  /* Records searched for a random access point around the seek time */
+#define TS_INDEX_NO_PID 0xFFFF
+
+#define TS_INDEX_FLAG_PCR 0x01                      /* Packet carries PCR */
+#define TS_INDEX_FLAG_PTS 0x02                      /* Video PES with PTS starts in the packet */
+#define TS_INDEX_FLAG_RAP 0x04                      /* Decoding can start at the packet */
+
+/**
+ * @brief Enumeration of possible TS index error codes
+ */
+typedef enum _TsIndexError
+{
+    TI_NO_ERROR = 0,
+    TI_ERROR
+}TsIndexError;
+
+/**
+ * @brief Structure of index file header
+ */
+typedef struct _TsIndexHeader
+{
+    uint32_t magic;                                 /* TS_INDEX_MAGIC */
+    uint16_t version;                               /* TS_INDEX_VERSION */
+    uint16_t recordSize;                            /* sizeof(TsIndexRecord) */
+    uint64_t reserved;
+}TsIndexHeader;
+
+/**
+ * @brief Structure of one index record, records are sorted by offset and by time
+ */
+typedef struct _TsIndexRecord
+{
+    uint64_t offset;                                /* Stream offset of the packet */
+    uint64_t time;                                  /* Recording time in 90 kHz ticks from unwrapped PCR, never decreases */
+    uint64_t pts;                                   /* PTS of the picture starting in the packet, valid with TS_INDEX_FLAG_PTS */
+    uint32_t flags;                                 /* TS_INDEX_FLAG_* */
+    uint32_t reserved;
+}TsIndexRecord;
+
+/**
+ * @brief Index writer, appends records of one recording to the index file
+ */
+typedef struct _TsIndexWriter TsIndexWriter;
+
+/**
+ * @brief Index reader, maps index file into memory
+ */
+typedef struct _TsIndex TsIndex;
+
+/**
+ * @brief Creates index file and writes its header
+ *
+ * @param [in] fileName - index file, created or truncated
+ * @param [out] writer - created writer
+ * @return TS index error code
+ */
+TsIndexError tsIndexWriterCreate(const char* fileName, TsIndexWriter** writer);
+
+/**
+ * @brief Appends collected records, closes index file and frees writer
+ *
+ * @param [in] writer - writer to destroy
+ * @return TS index error code
+ */
+TsIndexError tsIndexWriterDestroy(TsIndexWriter* writer);
+
+/**
+ * @brief Sets PIDs of the indexed program
+ *
+ * @param [in] writer - index writer
+ * @param [in] pcrPid - PID carrying PCR of the program, TS_INDEX_NO_PID takes PCR from any PID
+ * @param [in] videoPid - PID whose pictures are indexed
+ * @param [in] streamType - PMT stream_type of video, selects start codes of random access points
+ * @return TS index error code
+ */
+TsIndexError tsIndexWriterSetProgram(TsIndexWriter* writer, uint16_t pcrPid, uint16_t videoPid, uint8_t streamType);
+
+/**
+ * @brief Indexes packets of the recording
+ *
+ * @param [in] writer - index writer
+ * @param [in] data - whole transport stream packets
+ * @param [in] length - number of bytes in data
+ * @param [in] streamOffset - stream offset of data[0]
+ * @return TS index error code
+ */
+TsIndexError tsIndexWriterProcess(TsIndexWriter* writer, const uint8_t* data, uint32_t length, uint64_t streamOffset);
+
+/**
+ * @brief Appends collected records to the index file, so readers see them
+ *
+ * @param [in] writer - index writer
+ * @return TS index error code
+ */
+TsIndexError tsIndexWriterFlush(TsIndexWriter* writer);
+
+/**
+ * @brief Maps index file
+ *
+ * @param [in] fileName - index file
+ * @param [out] index - opened index
+ * @return TS index error code
+ */
+TsIndexError tsIndexOpen(const char* fileName, TsIndex** index);
+
+/**
+ * @brief Unmaps index file and frees index
+ *
+ * @param [in] index - index to close
+ * @return TS index error code
+ */
+TsIndexError tsIndexClose(TsIndex* index);
+
+/**
+ * @brief Maps records appended since the index was opened or last refreshed
+ *
+ * @param [in] index - opened index
+ * @return TS index error code
+ */
+TsIndexError tsIndexRefresh(TsIndex* index);
+
+/**
+ * @brief Returns number of mapped records
+ *
+ * @param [in] index - opened index
+ * @return number of records
+ */
+uint64_t tsIndexGetCount(TsIndex* index);
+
+/**
+ * @brief Returns one record
+ *
+ * @param [in] index - opened index
+ * @param [in] recordNumber - record number, 0 to count - 1
+ * @param [out] record - record
+ * @return TS index error code
+ */
+TsIndexError tsIndexGetRecord(TsIndex* index, uint64_t recordNumber, TsIndexRecord* record);
+
+/**
+ * @brief Finds last record at or before time
+ *
+ * @param [in] index - opened index
+ * @param [in] time - recording time in 90 kHz ticks
+ * @param [out] record - found record, first record if all are later
+ * @return TS index error code, TI_ERROR if index is empty
+ */
+TsIndexError tsIndexFindTime(TsIndex* index, uint64_t time, TsIndexRecord* record);
+
+/**
+ * @brief Finds last record at or before stream offset
+ *
+ * @param [in] index - opened index
+ * @param [in] offset - stream offset
+ * @param [out] record - found record, first record if all are later
+ * @return TS index error code, TI_ERROR if index is empty
+ */
+TsIndexError tsIndexFindOffset(TsIndex* index, uint64_t offset, TsIndexRecord* record);
+
+/**
+ * @brief Finds random access point to start playback of time from
+ *
+ * Returns last random access point at or before time, or first one after it when there is none
+ * before time at or after minimumOffset.
+ *
+ * @param [in] index - opened index
+ * @param [in] time - recording time in 90 kHz ticks
+ * @param [in] minimumOffset - oldest stream offset that can still be played
+ * @param [out] record - found random access point
+ * @return TS index error code, TI_ERROR if there is no random access point near time
+ */
+TsIndexError tsIndexFindRandomAccess(TsIndex* index, uint64_t time, uint64_t minimumOffset, TsIndexRecord* record);
+
+#endif /* __TS_INDEX_H__ */
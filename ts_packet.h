@@ -0,0 +1,7 @@
+#ifndef __TS_PACKET_H__
+#define __TS_PACKET_H__
+
+#define TS_PACKET_SIZE 188                          /* Size of one transport stream packet */
+#define TS_SYNC_BYTE 0x47                           /* Value of the first byte of every packet */
+
+#endif /* __TS_PACKET_H__ */
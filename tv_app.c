@@ -1,7 +1,9 @@
 #include <signal.h>
+#include <math.h>
 #include "remote_controller.h"
 #include "stream_controller.h"
 #include "graphics_controller.h"
+#include "startup_graph.h"
 
 static inline void textColor(int32_t attr, int32_t fg, int32_t bg)
 {
@@ -25,6 +27,14 @@ if (x != 0)                                                                 \
 }
 
 
+#define STARTUP_STAGE_TIMEOUT_MS 10000   /* Longest wait for each stage of stream startup */
+
+static int32_t startConfig(void* fileName);
+static int32_t startTimers(void* argument);
+static int32_t startStreamController(void* argument);
+static int32_t waitStreamStage(void* stage);
+static int32_t startGraphics(void* argument);
+static int32_t startRemoteController(void* argument);
 static void remoteControllerCallback(uint16_t code, uint16_t type, uint32_t value);
 static void registerCurrentTime(TimeStructure* timeStructure);
 static void registerCurrentVolume(uint8_t volumeValue);
@@ -32,7 +42,15 @@ static void registerProgramType(int16_t type);
 static void inputChannelNumber(uint8_t key);
 static void printCurrentTime();
 static void changeChannel();
+static void commitChannel();
+static uint16_t typedChannel();
 static void delayShowInfo();
+static void updateClock();
+static uint64_t keyEventTime();
+static void markZapKey();
+static void printZapStatistics();
+static void printGapStatistics(const char* name, const ZapGapStatistics* statistics);
+static void printOsdLatencyStatistics();
 
 
 static pthread_cond_t deinitCond = PTHREAD_COND_INITIALIZER;
@@ -40,75 +58,65 @@ static pthread_mutex_t deinitMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static timer_t keyTimer;
 static timer_t showInfoTimer;
+static timer_t clockTimer;
 static struct itimerspec keyTimerSpec;
 static struct itimerspec keyTimerSpecOld;
+static struct itimerspec keyTimerSpecDisarm;
 static struct itimerspec infoTimerSpec;
 static struct itimerspec intoTimerSpecOld;
 static struct sigevent keySignalEvent;
 static struct sigevent infoSignalEvent;
+static struct sigevent clockSignalEvent;
 static int32_t timerFlags;
-static bool timeRecieved;
+static bool clockStarted;
 
-static TimeStructure startTime;
 static TimeStructure currentTime;
 static ChannelInfo channelInfo;
 
+static pthread_mutex_t keyMutex = PTHREAD_MUTEX_INITIALIZER;
 static uint8_t keysPressed;
 static uint8_t keys[3];
 
 static uint8_t currentVolume = 5;
 
+static const StreamStartupStage tunerLockedStage = STREAM_STAGE_TUNER_LOCKED;
+static const StreamStartupStage patReceivedStage = STREAM_STAGE_PAT_RECEIVED;
+static const StreamStartupStage playingStage = STREAM_STAGE_PLAYING;
+
 int main(int argc, char *argv[])
 {
-    keySignalEvent.sigev_notify = SIGEV_THREAD;
-    keySignalEvent.sigev_notify_function = changeChannel;
-    keySignalEvent.sigev_value.sival_ptr = NULL;
-    keySignalEvent.sigev_notify_attributes = NULL;
-    timer_create(CLOCK_REALTIME, &keySignalEvent, &keyTimer);
-
-    memset(&keyTimerSpec, 0, sizeof(keyTimerSpec));
-    keyTimerSpec.it_value.tv_sec = 2;
-    keyTimerSpec.it_value.tv_nsec = 0;
-
-    infoSignalEvent.sigev_notify = SIGEV_THREAD;
-    infoSignalEvent.sigev_notify_function = delayShowInfo;
-    infoSignalEvent.sigev_value.sival_ptr = NULL;
-    infoSignalEvent.sigev_notify_attributes = NULL;
-    timer_create(CLOCK_REALTIME, &infoSignalEvent, &showInfoTimer);
+    StartupGraph* startupGraph = NULL;
+    bool started = false;
 
-    memset(&infoTimerSpec, 0, sizeof(infoTimerSpec));
-    infoTimerSpec.it_value.tv_sec = 3.5;
-    infoTimerSpec.it_value.tv_nsec = 0;
-
-    currentTime.hours = 30;
-
-    /* load initial info from config.ini file */
-    if (loadInitialInfo(argv[1]) || argc == 1)
+    if (argc == 1)
     {
         printf("Initial info required!\n");
         return -1;
     }
 
-    /* initialize remote controller module */
-    ERRORCHECK(remoteControllerInit());
-
-    /* register remote controller callback */
-    ERRORCHECK(registerRemoteControllerCallback(remoteControllerCallback));
-
-    /* initialize stream controller module */
-    ERRORCHECK(streamControllerInit());
-
-    /* register time callback */
-    ERRORCHECK(registerTimeCallback(registerCurrentTime));
-
-    /* register volume callback */
-    ERRORCHECK(registerVolumeCallback(registerCurrentVolume));
-
-    /* register program type callback */
-    ERRORCHECK(registerProgramTypeCallback(registerProgramType));
+    currentTime.hours = 30;
 
-    /* initialize graphics controller module */
-    ERRORCHECK(graphicsControllerInit());
+    /* steps run as soon as what they need is ready, video starts while OSD is still being set up */
+    ERRORCHECK(startupGraphCreate(&startupGraph));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "config", startConfig, argv[1], NULL));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "timers", startTimers, NULL, "config"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "stream", startStreamController, NULL, "config,timers"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "tuner_lock", waitStreamStage, (void*)&tunerLockedStage, "stream"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "pat", waitStreamStage, (void*)&patReceivedStage, "tuner_lock"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "playing", waitStreamStage, (void*)&playingStage, "pat"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "graphics", startGraphics, NULL, "config"));
+    ERRORCHECK(startupGraphAddNode(startupGraph, "remote", startRemoteController, NULL, "stream,graphics"));
+
+    /* stream stages that time out only show in the timeline, application runs without picture as before */
+    startupGraphRun(startupGraph);
+    startupGraphPrintTimeline(startupGraph);
+    started = startupGraphNodeDone(startupGraph, "remote");
+    startupGraphDestroy(startupGraph);
+    if (!started)
+    {
+        printf("\n%s : ERROR startup failed\n", __FUNCTION__);
+        return -1;
+    }
 
     /* wait for a EXIT remote controller key press event */
     pthread_mutex_lock(&deinitMutex);
@@ -136,11 +144,108 @@ int main(int argc, char *argv[])
 	/* unregister program type callback */
     ERRORCHECK(unregisterProgramTypeCallback());
 
+    /* print channel change timing of this session */
+    printZapStatistics();
+    printOsdLatencyStatistics();
+
     /* deinitialize stream controller module */
     ERRORCHECK(streamControllerDeinit());
 
     timer_delete(keyTimer);
     timer_delete(showInfoTimer);
+    timer_delete(clockTimer);
+
+    return 0;
+}
+
+/* load initial info from config.ini file, thread roles have to be known before any of their threads is created */
+int32_t startConfig(void* fileName)
+{
+    if (loadInitialInfo((char*)fileName))
+    {
+        printf("Initial info required!\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int32_t startTimers(void* argument)
+{
+    keySignalEvent.sigev_notify = SIGEV_THREAD;
+    keySignalEvent.sigev_notify_function = changeChannel;
+    keySignalEvent.sigev_value.sival_ptr = NULL;
+    keySignalEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_ZAP_CONTROL);
+    ERRORCHECK(timer_create(CLOCK_REALTIME, &keySignalEvent, &keyTimer));
+
+    memset(&keyTimerSpec, 0, sizeof(keyTimerSpec));
+    keyTimerSpec.it_value.tv_sec = 2;
+    keyTimerSpec.it_value.tv_nsec = 0;
+
+    infoSignalEvent.sigev_notify = SIGEV_THREAD;
+    infoSignalEvent.sigev_notify_function = delayShowInfo;
+    infoSignalEvent.sigev_value.sival_ptr = NULL;
+    infoSignalEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_RENDER);
+    ERRORCHECK(timer_create(CLOCK_REALTIME, &infoSignalEvent, &showInfoTimer));
+
+    memset(&infoTimerSpec, 0, sizeof(infoTimerSpec));
+    infoTimerSpec.it_value.tv_sec = 3.5;
+    infoTimerSpec.it_value.tv_nsec = 0;
+
+    clockSignalEvent.sigev_notify = SIGEV_THREAD;
+    clockSignalEvent.sigev_notify_function = updateClock;
+    clockSignalEvent.sigev_value.sival_ptr = NULL;
+    clockSignalEvent.sigev_notify_attributes = threadPolicyGetAttributes(THREAD_ROLE_RENDER);
+    ERRORCHECK(timer_create(CLOCK_MONOTONIC, &clockSignalEvent, &clockTimer));
+
+    /* program type callback of the stream step draws the info banner, maybe before the graphics step is done */
+    ERRORCHECK(graphicsControllerInitTimers());
+
+    return 0;
+}
+
+/* Stream controller tunes, parses PSI and starts the first channel on its own thread, stages are waited for separately */
+int32_t startStreamController(void* argument)
+{
+    /* initialize stream controller module */
+    ERRORCHECK(streamControllerInit());
+
+    /* register time callback */
+    ERRORCHECK(registerTimeCallback(registerCurrentTime));
+
+    /* register volume callback */
+    ERRORCHECK(registerVolumeCallback(registerCurrentVolume));
+
+    /* register program type callback */
+    ERRORCHECK(registerProgramTypeCallback(registerProgramType));
+
+    return 0;
+}
+
+int32_t waitStreamStage(void* stage)
+{
+    return waitStartupStage(*(const StreamStartupStage*)stage, STARTUP_STAGE_TIMEOUT_MS);
+}
+
+int32_t startGraphics(void* argument)
+{
+    InitialInfo initialInfo;
+
+    /* initialize graphics controller module */
+    ERRORCHECK(getInitialInfo(&initialInfo));
+    ERRORCHECK(graphicsControllerInit(initialInfo.graphicsBackend, initialInfo.assetBundle));
+
+    return 0;
+}
+
+/* Keys zap and draw, so input is taken once both stream and graphics controller are there */
+int32_t startRemoteController(void* argument)
+{
+    /* initialize remote controller module */
+    ERRORCHECK(remoteControllerInit());
+
+    /* register remote controller callback */
+    ERRORCHECK(registerRemoteControllerCallback(remoteControllerCallback));
 
     return 0;
 }
@@ -160,34 +265,37 @@ void remoteControllerCallback(uint16_t code, uint16_t type, uint32_t value)
                 printf("**********************************************************\n");
             }
             printCurrentTime();
-            drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext);
+            drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext,
+                keyEventTime());
             break;
         case KEYCODE_P_PLUS:
             printf("\nCH+ pressed\n");
+            markZapKey();
             channelUp();
             break;
         case KEYCODE_P_MINUS:
             printf("\nCH- pressed\n");
+            markZapKey();
             channelDown();
             break;
         case KEYCODE_V_PLUS:
             printf("\nV+ pressed\n");
             volumeUp();
             printf("\nCurrent volume : %d\n", currentVolume);
-            drawVolumeBar(currentVolume);
+            drawVolumeBar(currentVolume, keyEventTime());
             break;
         case KEYCODE_V_MINUS:
             printf("\nV- pressed\n");
             volumeDown();
             printf("\nCurrent volume : %d\n", currentVolume);
-            drawVolumeBar(currentVolume);
+            drawVolumeBar(currentVolume, keyEventTime());
             break;
         case KEYCODE_MUTE:
             printf("\nMUTE pressed\n");
             volumeMute();
             currentVolume = 0;
             printf("\nCurrent volume : %d\n", currentVolume);
-            drawVolumeBar(currentVolume);
+            drawVolumeBar(currentVolume, keyEventTime());
             break;
         case KEYCODE_EXIT:
             printf("\nExit pressed\n");
@@ -242,6 +350,11 @@ void remoteControllerCallback(uint16_t code, uint16_t type, uint32_t value)
 
 void inputChannelNumber(uint8_t key)
 {
+    uint16_t channelCount = 0;
+    uint16_t channel = 0;
+
+    pthread_mutex_lock(&keyMutex);
+
     if (keysPressed == 0)
     {
         keys[0] = key;
@@ -265,13 +378,46 @@ void inputChannelNumber(uint8_t key)
         keys[2] = 0;
     }
 
-    timer_settime(keyTimer, timerFlags, &keyTimerSpec, &keyTimerSpecOld);
-    channelDial(keysPressed, keys);
+    channelDial(keysPressed, keys, keyEventTime());
+    channel = typedChannel();
+
+    /* no other channel starts with typed digits, there is nothing to wait for */
+    if (getChannelCount(&channelCount) == SC_NO_ERROR && (keysPressed == 3 || 10*channel > channelCount))
+    {
+        timer_settime(keyTimer, timerFlags, &keyTimerSpecDisarm, NULL);
+        markZapKey();
+        commitChannel();
+    }
+    else
+    {
+        timer_settime(keyTimer, timerFlags, &keyTimerSpec, &keyTimerSpecOld);
+
+        /* typed number is what gets started if no more keys come */
+        if (channel > 0)
+        {
+            prefetchChannelKey(channel - 1);
+        }
+    }
+
+    pthread_mutex_unlock(&keyMutex);
 }
 
 void changeChannel()
 {
-    uint16_t channel;
+    pthread_mutex_lock(&keyMutex);
+
+    /* timer may fire while channel is committed early */
+    if (keysPressed != 0)
+    {
+        commitChannel();
+    }
+
+    pthread_mutex_unlock(&keyMutex);
+}
+
+uint16_t typedChannel()
+{
+    uint16_t channel = 0;
 
     if (keysPressed == 1)
     {
@@ -286,6 +432,14 @@ void changeChannel()
         channel = 100*keys[0] + 10*keys[1] + keys[2];
     }
 
+    return channel;
+}
+
+/* Called with keyMutex locked */
+void commitChannel()
+{
+    uint16_t channel = typedChannel();
+
     removeChannelDial();
     changeChannelKey(--channel);
 
@@ -297,48 +451,35 @@ void changeChannel()
 
 void registerCurrentTime(TimeStructure* timeStructure)
 {
-    startTime.hours = timeStructure->hours;
-    startTime.minutes = timeStructure->minutes;
-    startTime.seconds = timeStructure->seconds;
-    startTime.timeStampSeconds = timeStructure->timeStampSeconds;
-    timeRecieved = true;
-}
-
-void printCurrentTime()
-{
-    if (timeRecieved == true)
-    {    
-        struct timeval tempTime;
-
-        gettimeofday(&tempTime, NULL);
-        time_t timeElapsed = tempTime.tv_sec - startTime.timeStampSeconds;
+    struct itimerspec clockTimerSpec;
+    bool clockChanged = !clockStarted || currentTime.hours != timeStructure->hours || currentTime.minutes != timeStructure->minutes;
 
-        printf("Run time: %d seconds\n", timeElapsed);
+    currentTime.hours = timeStructure->hours;
+    currentTime.minutes = timeStructure->minutes;
+    currentTime.seconds = timeStructure->seconds;
+    clockStarted = true;
 
-        uint8_t hoursPassed = (timeElapsed - timeElapsed % 3600) / 3600;
-        uint8_t minutesPassed = (timeElapsed - hoursPassed*3600 - timeElapsed % 60) / 60;
-        uint8_t secondsPassed = timeElapsed - hoursPassed*3600 - minutesPassed*60;
+    /* every report realigns the timer, so drift and time jumps never keep the clock off the minute boundary */
+    memset(&clockTimerSpec, 0, sizeof(clockTimerSpec));
+    clockTimerSpec.it_value.tv_sec = 60 - timeStructure->seconds;
+    clockTimerSpec.it_interval.tv_sec = 60;
+    timer_settime(clockTimer, 0, &clockTimerSpec, NULL);
 
-        currentTime.hours = startTime.hours + hoursPassed;
-        currentTime.minutes = startTime.minutes + minutesPassed;
-        currentTime.seconds = startTime.seconds + secondsPassed;
-
-        if (currentTime.seconds > 59)
-        {
-            currentTime.seconds -= 60;
-            currentTime.minutes++;
-        }
+    if (clockChanged)
+    {
+        updateInfoClock(currentTime.hours, currentTime.minutes);
+    }
+}
 
-        if (currentTime.minutes > 59)
-        {
-            currentTime.minutes -= 60;
-            currentTime.hours++;
-        }
+void printCurrentTime()
+{
+    LocalTime localTime;
 
-        if (currentTime.hours > 23)
-        {
-            currentTime.hours -= 24;
-        }
+    if (timeServiceGetLocalTime(&localTime) == TS_NO_ERROR)
+    {
+        currentTime.hours = localTime.hours;
+        currentTime.minutes = localTime.minutes;
+        currentTime.seconds = localTime.seconds;
 
         printf("\nCurrent time: %.2d:%.2d:%.2d\n", currentTime.hours, currentTime.minutes, currentTime.seconds);
     }
@@ -348,6 +489,19 @@ void printCurrentTime()
     }
 }
 
+void updateClock()
+{
+    LocalTime localTime;
+
+    if (timeServiceGetLocalTime(&localTime) == TS_NO_ERROR)
+    {
+        currentTime.hours = localTime.hours;
+        currentTime.minutes = localTime.minutes;
+        currentTime.seconds = localTime.seconds;
+        updateInfoClock(currentTime.hours, currentTime.minutes);
+    }
+}
+
 void registerCurrentVolume(uint8_t volumeValue)
 {
     currentVolume = volumeValue;
@@ -369,7 +523,7 @@ void registerProgramType(int16_t type)
     if (type == -1)
     {
         setRadioLogo();
-        drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext);
+        drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext, 0);
     }
     else
     {
@@ -382,5 +536,119 @@ void registerProgramType(int16_t type)
 
 void delayShowInfo()
 {
-    drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext);
+    drawInfoRect(currentTime.hours, currentTime.minutes, channelInfo.audioPid, channelInfo.videoPid, channelInfo.programNumber, channelInfo.teletext, 0);
+}
+
+/* Valid only inside remote controller callback, 0 if key event time is not known */
+uint64_t keyEventTime()
+{
+    uint64_t keyTime = 0;
+
+    if (remoteControllerGetEventTime(&keyTime) != RC_NO_ERROR)
+    {
+        return 0;
+    }
+
+    return keyTime;
+}
+
+/* Zap requested from the callback that is running is measured from its key event */
+void markZapKey()
+{
+    uint64_t keyTime = keyEventTime();
+
+    if (keyTime != 0)
+    {
+        setZapKeyTime(keyTime);
+    }
+}
+
+void printZapStatistics()
+{
+    ZapStatistics zapStatistics;
+
+    if (getZapStatistics(&zapStatistics) != SC_NO_ERROR || zapStatistics.zapCount == 0)
+    {
+        return;
+    }
+
+    printf("\n********************* Zap statistics *********************\n");
+    printf("Zaps: %u\n", zapStatistics.zapCount);
+    printf("Zap time avg/max: %u/%u ms\n", (uint32_t)(zapStatistics.zap.total / zapStatistics.zap.count / 1000),
+        zapStatistics.zap.max / 1000);
+    printGapStatistics("Key to zap", &zapStatistics.keyToZap);
+    if (zapStatistics.blackScreen.count != 0)
+    {
+        printf("Black screen avg/max: %u/%u ms, video decoder kept %u times\n",
+            (uint32_t)(zapStatistics.blackScreen.total / zapStatistics.blackScreen.count / 1000), zapStatistics.blackScreen.max / 1000,
+            zapStatistics.blackScreen.keptCount);
+    }
+    if (zapStatistics.silence.count != 0)
+    {
+        printf("Silence avg/max: %u/%u ms, audio decoder kept %u times\n",
+            (uint32_t)(zapStatistics.silence.total / zapStatistics.silence.count / 1000), zapStatistics.silence.max / 1000,
+            zapStatistics.silence.keptCount);
+    }
+    printf("**********************************************************\n");
+}
+
+/* Jitter is standard deviation of the durations */
+void printGapStatistics(const char* name, const ZapGapStatistics* statistics)
+{
+    double average = 0;
+    double variance = 0;
+
+    if (statistics->count == 0)
+    {
+        return;
+    }
+
+    average = (double)statistics->total / statistics->count;
+    variance = (double)statistics->totalSquares / statistics->count - average * average;
+
+    printf("%s avg/min/max: %.1f/%.1f/%.1f ms, jitter %.2f ms over %u zaps\n", name, average / 1000,
+        statistics->min / 1000.0, statistics->max / 1000.0, (variance > 0) ? sqrt(variance) / 1000 : 0, statistics->count);
+}
+
+void printOsdLatencyStatistics()
+{
+    static const char* const interactionNames[OSD_INTERACTION_COUNT] = {"Volume", "Channel dial", "Info"};
+    OsdLatencyStatistics latencyStatistics;
+    const OsdLatencyHistogram* histogram = NULL;
+    bool printed = false;
+    uint8_t i = 0;
+    uint8_t bucket = 0;
+
+    if (getOsdLatencyStatistics(&latencyStatistics) != GC_NO_ERROR)
+    {
+        return;
+    }
+
+    for (i = 0; i < OSD_INTERACTION_COUNT; i++)
+    {
+        histogram = &latencyStatistics.interactions[i];
+        if (histogram->count == 0)
+        {
+            continue;
+        }
+
+        if (!printed)
+        {
+            printf("\n******************* Key to OSD latency *******************\n");
+            printed = true;
+        }
+
+        printf("%s avg/min/max: %.1f/%.1f/%.1f ms over %u keys\n", interactionNames[i],
+            (double)histogram->total / histogram->count / 1000, histogram->min / 1000.0, histogram->max / 1000.0, histogram->count);
+        for (bucket = 0; bucket < OSD_LATENCY_BUCKETS - 1; bucket++)
+        {
+            printf(" <%d:%u", OSD_LATENCY_FIRST_BUCKET_MS << bucket, histogram->buckets[bucket]);
+        }
+        printf(" >=%d:%u ms\n", OSD_LATENCY_FIRST_BUCKET_MS << (OSD_LATENCY_BUCKETS - 2), histogram->buckets[OSD_LATENCY_BUCKETS - 1]);
+    }
+
+    if (printed)
+    {
+        printf("**********************************************************\n");
+    }
 }